@@ -43,6 +43,7 @@ class HomeObjectConan(ConanFile):
         self.requires("homestore/[~=5,      include_prerelease=True]@oss/master")
         self.requires("sisl/[~=11, include_prerelease=True]@oss/master")
         self.requires("lz4/1.9.4", override=True)
+        self.requires("xxhash/0.8.2")
 
     def validate(self):
         if self.info.settings.os in ["Macos", "Windows"]:
@@ -2,6 +2,8 @@
 #include <memory>
 #include <optional>
 #include <string>
+#include <string_view>
+#include <vector>
 
 #include <sisl/fds/buffer.hpp>
 
@@ -10,11 +12,17 @@
 namespace homeobject {
 
 ENUM(BlobError, uint16_t, UNKNOWN = 1, TIMEOUT, INVALID_ARG, NOT_LEADER, UNKNOWN_SHARD, UNKNOWN_BLOB, CHECKSUM_MISMATCH,
-     READ_FAILED, INDEX_ERROR, SEALED_SHARD);
+     READ_FAILED, INDEX_ERROR, SEALED_SHARD, RETRY_LATER);
+
+// State of a blob as found by list_blobs(); ALL only serves as a filter matching either.
+ENUM(BlobState, uint8_t, ALIVE = 0, DELETED, ALL);
 
 struct Blob {
     Blob(sisl::io_blob_safe b, std::string const& u, uint64_t o) : body(std::move(b)), user_key(u), object_off(o) {}
 
+    // Allocates a body of size bytes aligned for direct io; a body filled in place is written without being copied.
+    static Blob make_aligned(uint32_t size, std::string const& user_key = {}, uint64_t object_off = 0);
+
     Blob clone() const;
 
     sisl::io_blob_safe body;
@@ -23,12 +31,91 @@ struct Blob {
     std::optional< peer_id_t > current_leader{std::nullopt};
 };
 
+// A Blob as returned by get_view(); body and user_key point into the buffer the blob was read into, which stays
+// alive for as long as any copy of the view holds it.
+struct BlobView {
+    Blob clone() const;
+
+    std::shared_ptr< const void > holder;
+    sisl::blob body;
+    std::string_view user_key{};
+    uint64_t object_off{};
+    std::optional< peer_id_t > current_leader{std::nullopt};
+};
+
+struct BlobListEntry {
+    blob_id_t id;
+    BlobState state;
+    // Bytes the blob takes up in the store, header and padding included; unset for deleted blobs.
+    std::optional< uint64_t > size{std::nullopt};
+};
+using BlobList = std::vector< BlobListEntry >;
+
+// Handle of a blob being put as a stream of segments, see BlobManager::open_stream().
+struct BlobStream {
+    shard_id_t shard;
+    // Id the blob is known by once the stream is committed.
+    blob_id_t blob;
+};
+
+// Read-your-writes token of a put, the position of the put in the replication log of the PG of its shard.
+using read_token_t = int64_t;
+
+struct PutReceipt {
+    blob_id_t blob;
+    read_token_t token;
+};
+
 class BlobManager : public Manager< BlobError > {
 public:
     virtual AsyncResult< blob_id_t > put(shard_id_t shard, Blob&&) = 0;
+    // Puts all blobs into the shard as a single replicated write; returned ids are in the order of the input.
+    virtual AsyncResult< std::vector< blob_id_t > > put_batch(shard_id_t shard, std::vector< Blob >&&) = 0;
     virtual AsyncResult< Blob > get(shard_id_t shard, blob_id_t const& blob, uint64_t off = 0,
                                     uint64_t len = 0) const = 0;
+    // Same as get() without copying the blob out of the read buffer.
+    virtual AsyncResult< BlobView > get_view(shard_id_t shard, blob_id_t const& blob, uint64_t off = 0,
+                                             uint64_t len = 0) const = 0;
+    // Gets whole blobs of one shard at once; results are in the order of the input and fail or succeed per blob.
+    virtual AsyncResult< std::vector< Result< Blob > > > get_batch(shard_id_t shard,
+                                                                   std::vector< blob_id_t > const& blobs) const = 0;
     virtual NullAsyncResult del(shard_id_t shard, blob_id_t const& blob) = 0;
+    // Deletes blobs of one shard as a single replicated write; blobs already gone are skipped.
+    virtual NullAsyncResult del_batch(shard_id_t shard, std::vector< blob_id_t > const& blobs) = 0;
+    // Deletes every blob of the shard with an id in [from, to) as a single replicated write.
+    virtual NullAsyncResult del_range(shard_id_t shard, blob_id_t from, blob_id_t to) = 0;
+    // Lists up to limit blobs of the shard in the state filter, in ascending id order starting at start. The next
+    // page starts after the last id returned; a page shorter than limit is the last one.
+    virtual AsyncResult< BlobList > list_blobs(shard_id_t shard, blob_id_t start, uint32_t limit,
+                                               BlobState filter = BlobState::ALIVE) const = 0;
+
+    ///
+    // Puts a blob too large to be held in memory or replicated at once. Each appended segment is written as soon as
+    // it is appended, without waiting for the previous ones, so the segments are replicated back to back; they are
+    // ordered by the order of the append calls. Committing waits for the segments and publishes the blob with a
+    // single write; the blob can not be read before and ranged gets of it read only the segments they cover. The
+    // segments of a stream that is aborted or fails to commit are deleted. A stream left without appends for ten
+    // minutes is aborted, and the segments of one the writer lost on a restart are deleted once they are found.
+    static constexpr uint32_t max_stream_segment_size = 8 * 1024 * 1024;
+    static constexpr uint32_t max_stream_segments = 1u << 20;
+    virtual AsyncResult< BlobStream > open_stream(shard_id_t shard) = 0;
+    // Fails with INVALID_ARG for an empty segment, one of more than max_stream_segment_size bytes or past the
+    // max_stream_segments of the stream, and UNKNOWN_BLOB once the stream is committed or aborted.
+    virtual NullAsyncResult append_stream(BlobStream const& stream, sisl::io_blob_safe&& segment) = 0;
+    virtual AsyncResult< blob_id_t > commit_stream(BlobStream const& stream, std::string const& user_key = {},
+                                                   uint64_t object_off = 0) = 0;
+    virtual NullAsyncResult abort_stream(BlobStream const& stream) = 0;
+    ///
+
+    ///
+    // Gets served by any replica of the PG. put_with_token() returns with the id of the blob the token of the put;
+    // get_local() serves the get from this replica if it is the leader or has applied the log of the PG up to token,
+    // and fails with NOT_LEADER otherwise so the client retries on the leader, see PGStats::leader. The blobs it
+    // returns name the leader in current_leader.
+    virtual AsyncResult< PutReceipt > put_with_token(shard_id_t shard, Blob&&) = 0;
+    virtual AsyncResult< Blob > get_local(shard_id_t shard, blob_id_t const& blob, read_token_t token,
+                                          uint64_t off = 0, uint64_t len = 0) const = 0;
+    ///
 };
 
 } // namespace homeobject
@@ -1,5 +1,6 @@
 #pragma once
 #include <compare>
+#include <optional>
 #include <set>
 #include <string>
 
@@ -47,6 +48,9 @@ struct PGStats {
     uint32_t avail_open_shards; // total number of shards that could be opened on this PG;
     uint64_t used_bytes;        // total number of bytes used by all shards on this PG;
     uint64_t avail_bytes;       // total number of bytes available on this PG;
+    uint64_t num_blobs{0};      // live blobs on this PG;
+    uint64_t deleted_bytes{0};  // bytes of the blobs deleted on this PG since it was loaded;
+    std::optional< peer_id_t > leader{std::nullopt}; // member the writes of this PG go through, if known;
     std::vector< std::tuple< peer_id_t, std::string, uint64_t /* last_commit_lsn */ > > members;
 
     std::string to_string() {
@@ -59,9 +63,11 @@ struct PGStats {
         }
 
         return fmt::format("PGStats: id={}, replica_set_uuid={}, num_members={}, total_shards={}, open_shards={}, "
-                           "avail_open_shards={}, used_bytes={}, avail_bytes={}, members: {}",
+                           "avail_open_shards={}, used_bytes={}, avail_bytes={}, num_blobs={}, deleted_bytes={}, "
+                           "leader={}, members: {}",
                            id, boost::uuids::to_string(replica_set_uuid), num_members, total_shards, open_shards,
-                           avail_open_shards, used_bytes, avail_bytes, members_str);
+                           avail_open_shards, used_bytes, avail_bytes, num_blobs, deleted_bytes,
+                           leader ? boost::uuids::to_string(*leader) : "unknown", members_str);
     }
 };
 
@@ -2,6 +2,7 @@
 #include <compare>
 #include <list>
 #include <optional>
+#include <vector>
 
 #include <sisl/utility/enum.hpp>
 
@@ -35,6 +36,7 @@ struct ShardInfo {
 };
 
 using InfoList = std::list< ShardInfo >;
+using InfoPage = std::vector< ShardInfo >;
 
 class ShardManager : public Manager< ShardError > {
 public:
@@ -43,7 +45,17 @@ public:
 
     virtual AsyncResult< ShardInfo > get_shard(shard_id_t id) const = 0;
     virtual AsyncResult< InfoList > list_shards(pg_id_t id) const = 0;
+    // Lists up to limit shards of the PG in the state filter, any state if none, in ascending id order starting at
+    // start. The next page starts after the last id returned; a page shorter than limit is the last one.
+    virtual AsyncResult< InfoPage > list_shards(pg_id_t id, shard_id_t start, uint32_t limit,
+                                                std::optional< ShardInfo::State > filter = std::nullopt) const = 0;
+    // Number of shards of the PG in the state filter, any state if none.
+    virtual AsyncResult< uint32_t > count_shards(pg_id_t id,
+                                                 std::optional< ShardInfo::State > filter = std::nullopt) const = 0;
     virtual AsyncResult< ShardInfo > create_shard(pg_id_t pg_owner, uint64_t size_bytes) = 0;
+    // Creates count shards of size_bytes each in pg_owner, with consecutive ids. On failure the first error is
+    // returned; shards that were created before it still exist.
+    virtual AsyncResult< InfoList > create_shards(pg_id_t pg_owner, uint32_t count, uint64_t size_bytes) = 0;
     virtual AsyncResult< ShardInfo > seal_shard(shard_id_t id) = 0;
 };
 
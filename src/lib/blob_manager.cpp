@@ -1,19 +1,126 @@
 #include "homeobject_impl.hpp"
 
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+
 namespace homeobject {
 
+///
+// The body of the blob of a committed stream: a StreamManifest followed by the size of each segment in order.
+struct StreamManifest {
+    static constexpr uint32_t stream_magic{0x4d525453}; // "STRM"
+    uint32_t magic{stream_magic};
+    uint32_t num_segments{0};
+};
+
+static sisl::io_blob_safe make_stream_manifest(std::vector< uint32_t > const& segment_sizes) {
+    auto const sizes_len = segment_sizes.size() * sizeof(uint32_t);
+    auto body = sisl::io_blob_safe(static_cast< uint32_t >(sizeof(StreamManifest) + sizes_len));
+    auto const manifest = StreamManifest{.num_segments = static_cast< uint32_t >(segment_sizes.size())};
+    std::memcpy(body.bytes(), &manifest, sizeof(manifest));
+    if (0 != sizes_len) { std::memcpy(body.bytes() + sizeof(manifest), segment_sizes.data(), sizes_len); }
+    return body;
+}
+
+static std::optional< std::vector< uint32_t > > parse_stream_manifest(sisl::blob const& body) {
+    StreamManifest manifest;
+    if (body.size() < sizeof(manifest)) { return std::nullopt; }
+    std::memcpy(&manifest, body.cbytes(), sizeof(manifest));
+    if (manifest.magic != StreamManifest::stream_magic ||
+        body.size() != sizeof(manifest) + uint64_t(manifest.num_segments) * sizeof(uint32_t)) {
+        return std::nullopt;
+    }
+    auto segment_sizes = std::vector< uint32_t >(manifest.num_segments);
+    if (0 != manifest.num_segments) {
+        std::memcpy(segment_sizes.data(), body.cbytes() + sizeof(manifest), manifest.num_segments * sizeof(uint32_t));
+    }
+    return segment_sizes;
+}
+
+static BlobManager::Result< Blob > clone_view(BlobManager::Result< BlobView > const& r) {
+    if (!r) { return folly::makeUnexpected(r.error()); }
+    return r.value().clone();
+}
+
 std::shared_ptr< BlobManager > HomeObjectImpl::blob_manager() { return shared_from_this(); }
 
 BlobManager::AsyncResult< Blob > HomeObjectImpl::get(shard_id_t shard, blob_id_t const& blob_id, uint64_t off,
                                                      uint64_t len) const {
-    return _get_shard(shard).thenValue([this, blob_id, off, len](auto const e) -> BlobManager::AsyncResult< Blob > {
+    return _with_shard(shard, [this, blob_id, off, len](auto const e) -> BlobManager::AsyncResult< Blob > {
         if (!e) return folly::makeUnexpected(BlobError::UNKNOWN_SHARD);
+        if (is_stream_blob(blob_id)) { return _get_stream_view(e.value(), blob_id, off, len).deferValue(clone_view); }
         return _get_blob(e.value(), blob_id, off, len);
     });
 }
 
+BlobManager::AsyncResult< Blob > HomeObjectImpl::get_local(shard_id_t shard, blob_id_t const& blob_id,
+                                                           read_token_t token, uint64_t off, uint64_t len) const {
+    return _with_shard(shard, [this, blob_id, token, off, len](auto const e) -> BlobManager::AsyncResult< Blob > {
+        if (!e) return folly::makeUnexpected(BlobError::UNKNOWN_SHARD);
+        auto const pg = e.value().placement_group;
+        auto const leader = _current_leader(pg);
+        if (leader != _our_id) {
+            if (auto const applied = _read_token(pg); applied < token) {
+                LOGD("[pg={}] applied up to {}, behind read token {}", pg, applied, token);
+                return folly::makeUnexpected(BlobError::NOT_LEADER);
+            }
+        }
+        auto get = is_stream_blob(blob_id) ? _get_stream_view(e.value(), blob_id, off, len).deferValue(clone_view)
+                                           : _get_blob(e.value(), blob_id, off, len);
+        return std::move(get).deferValue([leader](auto&& r) {
+            if (r) { r.value().current_leader = leader; }
+            return std::move(r);
+        });
+    });
+}
+
+BlobManager::AsyncResult< BlobView > HomeObjectImpl::get_view(shard_id_t shard, blob_id_t const& blob_id, uint64_t off,
+                                                              uint64_t len) const {
+    return _with_shard(shard, [this, blob_id, off, len](auto const e) -> BlobManager::AsyncResult< BlobView > {
+        if (!e) return folly::makeUnexpected(BlobError::UNKNOWN_SHARD);
+        if (is_stream_blob(blob_id)) { return _get_stream_view(e.value(), blob_id, off, len); }
+        return _get_blob_view(e.value(), blob_id, off, len);
+    });
+}
+
+BlobManager::AsyncResult< std::vector< BlobManager::Result< Blob > > >
+HomeObjectImpl::get_batch(shard_id_t shard, std::vector< blob_id_t > const& blob_ids) const {
+    if (blob_ids.empty()) return folly::makeUnexpected(BlobError::INVALID_ARG);
+    return _with_shard(shard,
+        [this, blob_ids](auto const e) -> BlobManager::AsyncResult< std::vector< BlobManager::Result< Blob > > > {
+            if (!e) return folly::makeUnexpected(BlobError::UNKNOWN_SHARD);
+            if (std::none_of(blob_ids.begin(), blob_ids.end(), is_stream_blob)) {
+                return _get_blob_batch(e.value(), blob_ids);
+            }
+            // Streams are read on their own, so every blob of a batch holding one is.
+            std::vector< BlobManager::AsyncResult< Blob > > gets;
+            gets.reserve(blob_ids.size());
+            for (auto const blob_id : blob_ids) {
+                if (is_stream_blob(blob_id)) {
+                    gets.push_back(_get_stream_view(e.value(), blob_id, 0, 0).deferValue(clone_view));
+                } else {
+                    gets.push_back(_get_blob(e.value(), blob_id));
+                }
+            }
+            return folly::collectAll(std::move(gets))
+                .deferValue([](auto&& tries) -> BlobManager::Result< std::vector< BlobManager::Result< Blob > > > {
+                    std::vector< BlobManager::Result< Blob > > results;
+                    results.reserve(tries.size());
+                    for (auto& t : tries) {
+                        if (t.hasException()) {
+                            results.push_back(folly::makeUnexpected(BlobError::READ_FAILED));
+                        } else {
+                            results.push_back(std::move(t.value()));
+                        }
+                    }
+                    return results;
+                });
+        });
+}
+
 BlobManager::AsyncResult< blob_id_t > HomeObjectImpl::put(shard_id_t shard, Blob&& blob) {
-    return _get_shard(shard).thenValue(
+    return _with_shard(shard,
         [this, blob = std::move(blob)](auto const e) mutable -> BlobManager::AsyncResult< blob_id_t > {
             if (!e) return folly::makeUnexpected(BlobError::UNKNOWN_SHARD);
             if (ShardInfo::State::SEALED == e.value().state) return folly::makeUnexpected(BlobError::SEALED_SHARD);
@@ -21,17 +128,380 @@ BlobManager::AsyncResult< blob_id_t > HomeObjectImpl::put(shard_id_t shard, Blob
         });
 }
 
+// The token is read once the put returned, by when this replica applied the log up to the put.
+BlobManager::AsyncResult< PutReceipt > HomeObjectImpl::put_with_token(shard_id_t shard, Blob&& blob) {
+    return _with_shard(shard,
+        [this, blob = std::move(blob)](auto const e) mutable -> BlobManager::AsyncResult< PutReceipt > {
+            if (!e) return folly::makeUnexpected(BlobError::UNKNOWN_SHARD);
+            if (ShardInfo::State::SEALED == e.value().state) return folly::makeUnexpected(BlobError::SEALED_SHARD);
+            return _put_blob(e.value(), std::move(blob))
+                .deferValue([this, pg = e.value().placement_group](auto const& r) -> BlobManager::Result< PutReceipt > {
+                    if (!r) return folly::makeUnexpected(r.error());
+                    return PutReceipt{.blob = r.value(), .token = _read_token(pg)};
+                });
+        });
+}
+
+BlobManager::AsyncResult< std::vector< blob_id_t > > HomeObjectImpl::put_batch(shard_id_t shard,
+                                                                                std::vector< Blob >&& blobs) {
+    if (blobs.empty()) return folly::makeUnexpected(BlobError::INVALID_ARG);
+    return _with_shard(shard,
+        [this, blobs = std::move(blobs)](auto const e) mutable -> BlobManager::AsyncResult< std::vector< blob_id_t > > {
+            if (!e) return folly::makeUnexpected(BlobError::UNKNOWN_SHARD);
+            if (ShardInfo::State::SEALED == e.value().state) return folly::makeUnexpected(BlobError::SEALED_SHARD);
+            return _put_blob_batch(e.value(), std::move(blobs));
+        });
+}
+
 BlobManager::NullAsyncResult HomeObjectImpl::del(shard_id_t shard, blob_id_t const& blob) {
-    return _get_shard(shard).thenValue([this, blob](auto const e) mutable -> BlobManager::NullAsyncResult {
+    return _with_shard(shard, [this, blob](auto const e) mutable -> BlobManager::NullAsyncResult {
         if (!e) return folly::makeUnexpected(BlobError::UNKNOWN_SHARD);
+        if (is_stream_blob(blob)) { return _del_blob_stream(e.value(), blob); }
         return _del_blob(e.value(), blob);
     });
 }
 
+static BlobManager::NullResult first_error(std::vector< folly::Try< BlobManager::NullResult > > const& tries) {
+    for (auto const& t : tries) {
+        if (t.hasException()) { return folly::makeUnexpected(BlobError::UNKNOWN); }
+        if (!t.value()) { return t.value(); }
+    }
+    return folly::Unit();
+}
+
+BlobManager::NullAsyncResult HomeObjectImpl::del_batch(shard_id_t shard, std::vector< blob_id_t > const& blob_ids) {
+    if (blob_ids.empty()) return folly::makeUnexpected(BlobError::INVALID_ARG);
+    return _with_shard(shard, [this, blob_ids](auto const e) mutable -> BlobManager::NullAsyncResult {
+        if (!e) return folly::makeUnexpected(BlobError::UNKNOWN_SHARD);
+        if (std::none_of(blob_ids.begin(), blob_ids.end(), is_stream_blob)) {
+            return _del_blob_batch(e.value(), blob_ids);
+        }
+        // Streams are deleted along with their segments, the other blobs with one batch.
+        std::vector< blob_id_t > others;
+        std::vector< BlobManager::NullAsyncResult > dels;
+        for (auto const blob_id : blob_ids) {
+            if (is_stream_blob(blob_id)) {
+                dels.push_back(_del_blob_stream(e.value(), blob_id));
+            } else {
+                others.push_back(blob_id);
+            }
+        }
+        if (!others.empty()) { dels.push_back(_del_blob_batch(e.value(), others)); }
+        return folly::collectAll(std::move(dels)).deferValue([](auto&& tries) { return first_error(tries); });
+    });
+}
+
+BlobManager::NullAsyncResult HomeObjectImpl::del_range(shard_id_t shard, blob_id_t from, blob_id_t to) {
+    if (from >= to) return folly::makeUnexpected(BlobError::INVALID_ARG);
+    return _with_shard(shard, [this, from, to](auto const e) mutable -> BlobManager::NullAsyncResult {
+        if (!e) return folly::makeUnexpected(BlobError::UNKNOWN_SHARD);
+        // The segments of the streams in the range go with them.
+        auto const first_stream = std::max(from, stream_blob_bit);
+        auto const end_stream = std::min(to, stream_blob_bit | (max_stream_sequence + 1));
+        if (first_stream >= end_stream) { return _del_blob_range(e.value(), from, to); }
+        return _del_blob_range(e.value(), from, to)
+            .deferValue(
+                [this, shard = e.value(), first_stream, end_stream](auto const& r) -> BlobManager::NullAsyncResult {
+                    if (!r) { return folly::makeUnexpected(r.error()); }
+                    return _del_blob_range(shard, stream_segments_begin(first_stream),
+                                           stream_segments_end(end_stream - 1));
+                });
+    });
+}
+
+BlobManager::AsyncResult< BlobList > HomeObjectImpl::list_blobs(shard_id_t shard, blob_id_t start, uint32_t limit,
+                                                                BlobState filter) const {
+    if (limit == 0) return folly::makeUnexpected(BlobError::INVALID_ARG);
+    // Segments of streams list after every other blob, a page reaching them is the last one.
+    if (is_stream_segment(start)) return BlobList{};
+    return _with_shard(shard, [this, start, limit, filter](auto const e) -> BlobManager::AsyncResult< BlobList > {
+        if (!e) return folly::makeUnexpected(BlobError::UNKNOWN_SHARD);
+        return _list_blobs(e.value(), start, limit, filter).deferValue([](auto&& r) -> BlobManager::Result< BlobList > {
+            if (!r) { return folly::makeUnexpected(r.error()); }
+            std::erase_if(r.value(), [](BlobListEntry const& entry) { return is_stream_segment(entry.id); });
+            return std::move(r.value());
+        });
+    });
+}
+
+BlobManager::AsyncResult< BlobView > HomeObjectImpl::_get_stream_view(ShardInfo const& shard, blob_id_t blob,
+                                                                      uint64_t off, uint64_t len) const {
+    return _get_blob_view(shard, blob, 0, 0)
+        .deferValue([this, shard, blob, off, len](auto&& r) -> BlobManager::AsyncResult< BlobView > {
+            if (!r) { return folly::makeUnexpected(r.error()); }
+            auto segment_sizes = parse_stream_manifest(r.value().body);
+            if (!segment_sizes) {
+                LOGE("Invalid manifest of stream [blob={}] in [shard={}]", blob, shard.id);
+                return folly::makeUnexpected(BlobError::READ_FAILED);
+            }
+            auto const size = std::accumulate(segment_sizes->begin(), segment_sizes->end(), uint64_t{0});
+            if (off + len > size) {
+                LOGD("Invalid offset length request in get stream offset {} len {} size {}", off, len, size);
+                return folly::makeUnexpected(BlobError::INVALID_ARG);
+            }
+            auto const end = (0 == len) ? size : off + len;
+
+            // Only the part of each segment within the range is read, a whole segment without a range.
+            std::vector< BlobManager::AsyncResult< BlobView > > parts;
+            uint64_t seg_start{0};
+            for (uint32_t i = 0; i < segment_sizes->size() && seg_start < end; seg_start += (*segment_sizes)[i++]) {
+                auto const seg_size = (*segment_sizes)[i];
+                if (seg_start + seg_size <= off) { continue; }
+                auto const from = std::max(off, seg_start) - seg_start;
+                auto const to = std::min(end, seg_start + seg_size) - seg_start;
+                auto const whole = (0 == from && seg_size == to);
+                parts.push_back(
+                    _get_blob_view(shard, stream_segment_id(blob, i), whole ? 0 : from, whole ? 0 : to - from));
+            }
+
+            auto manifest = std::make_shared< BlobView >(std::move(r.value()));
+            return folly::collectAll(std::move(parts))
+                .deferValue([manifest, size = end - off](auto&& tries) -> BlobManager::Result< BlobView > {
+                    for (auto const& t : tries) {
+                        if (t.hasException()) { return folly::makeUnexpected(BlobError::READ_FAILED); }
+                        if (!t.value()) { return folly::makeUnexpected(t.value().error()); }
+                    }
+                    // The view holds on to the manifest for the user key, and to the data of its one segment or to
+                    // the copy of the segments it spans.
+                    using holder_t = std::pair< std::shared_ptr< const void >, std::shared_ptr< const void > >;
+                    auto view = BlobView{.user_key = manifest->user_key, .object_off = manifest->object_off};
+                    if (1 == tries.size()) {
+                        auto& part = tries[0].value().value();
+                        view.holder = std::make_shared< holder_t >(std::move(part.holder), manifest->holder);
+                        view.body = part.body;
+                        return view;
+                    }
+                    auto data = std::make_shared_for_overwrite< uint8_t[] >(size);
+                    uint64_t copied{0};
+                    for (auto const& t : tries) {
+                        auto const& part = t.value().value();
+                        std::memcpy(data.get() + copied, part.body.cbytes(), part.body.size());
+                        copied += part.body.size();
+                    }
+                    view.body = sisl::blob{data.get(), static_cast< uint32_t >(size)};
+                    view.holder = std::make_shared< holder_t >(std::move(data), manifest->holder);
+                    return view;
+                });
+        });
+}
+
+BlobManager::AsyncResult< BlobStream > HomeObjectImpl::open_stream(shard_id_t shard) {
+    if (_stream_reap_limiter.allow()) { _reap_streams(); }
+    return _with_shard(shard, [this, shard](auto const e) -> BlobManager::AsyncResult< BlobStream > {
+        if (!e) return folly::makeUnexpected(BlobError::UNKNOWN_SHARD);
+        if (ShardInfo::State::SEALED == e.value().state) return folly::makeUnexpected(BlobError::SEALED_SHARD);
+        auto const sequence = _new_blob_id(e.value());
+        RELEASE_ASSERT(sequence <= max_stream_sequence, "exhausted all available stream blob ids");
+        auto const stream = BlobStream{.shard = shard, .blob = stream_blob_bit | sequence};
+        std::scoped_lock lock_guard(_stream_lock);
+        _streams.emplace(std::make_pair(stream.shard, stream.blob), std::make_shared< BlobStreamState >());
+        return stream;
+    });
+}
+
+BlobManager::NullAsyncResult HomeObjectImpl::append_stream(BlobStream const& stream, sisl::io_blob_safe&& segment) {
+    auto const size = segment.size();
+    if (0 == size || size > max_stream_segment_size) return folly::makeUnexpected(BlobError::INVALID_ARG);
+    if (_stream_reap_limiter.allow()) { _reap_streams(); }
+    shared< BlobStreamState > state;
+    {
+        std::scoped_lock lock_guard(_stream_lock);
+        auto it = _streams.find(std::make_pair(stream.shard, stream.blob));
+        if (_streams.end() == it) return folly::makeUnexpected(BlobError::UNKNOWN_BLOB);
+        state = it->second;
+    }
+
+    // The position of the segment is taken and its write started under the lock, so segments follow the order of
+    // the appends and a racing commit either sees the segment or fails the append.
+    std::scoped_lock lock_guard(state->mtx);
+    if (state->closed) return folly::makeUnexpected(BlobError::UNKNOWN_BLOB);
+    state->touched.store(std::chrono::steady_clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+    auto const index = static_cast< uint32_t >(state->segment_sizes.size());
+    if (max_stream_segments == index) return folly::makeUnexpected(BlobError::INVALID_ARG);
+    state->segment_sizes.push_back(size);
+    auto written =
+        _with_shard(stream.shard,
+                    [this, blob = stream_segment_id(stream.blob, index),
+                     body = std::move(segment)](auto const e) mutable -> BlobManager::AsyncResult< blob_id_t > {
+                        if (!e) return folly::makeUnexpected(BlobError::UNKNOWN_SHARD);
+                        if (ShardInfo::State::SEALED == e.value().state) {
+                            return folly::makeUnexpected(BlobError::SEALED_SHARD);
+                        }
+                        return _put_blob_with_id(e.value(), blob, Blob(std::move(body), std::string{}, 0));
+                    })
+            .thenValue([](auto const& r) -> BlobManager::NullResult {
+                if (!r) { return folly::makeUnexpected(r.error()); }
+                return folly::Unit();
+            });
+    state->segments.emplace_back(std::move(written));
+    return state->segments.back().getSemiFuture();
+}
+
+std::optional< HomeObjectImpl::ClosedStream > HomeObjectImpl::_close_stream(BlobStream const& stream) {
+    shared< BlobStreamState > state;
+    {
+        std::scoped_lock lock_guard(_stream_lock);
+        auto it = _streams.find(std::make_pair(stream.shard, stream.blob));
+        if (_streams.end() == it) return std::nullopt;
+        state = it->second;
+    }
+    std::scoped_lock lock_guard(state->mtx);
+    if (std::exchange(state->closed, true)) return std::nullopt;
+    auto closed = ClosedStream{.segment_sizes = std::move(state->segment_sizes)};
+    closed.writes.reserve(state->segments.size());
+    for (auto& segment : state->segments) {
+        closed.writes.push_back(segment.getSemiFuture());
+    }
+    return closed;
+}
+
+void HomeObjectImpl::_forget_stream(BlobStream const& stream) {
+    std::scoped_lock lock_guard(_stream_lock);
+    _streams.erase(std::make_pair(stream.shard, stream.blob));
+}
+
+BlobManager::AsyncResult< blob_id_t > HomeObjectImpl::commit_stream(BlobStream const& stream,
+                                                                    std::string const& user_key, uint64_t object_off) {
+    auto closed = _close_stream(stream);
+    if (!closed) return folly::makeUnexpected(BlobError::UNKNOWN_BLOB);
+    return folly::collectAll(std::move(closed->writes))
+        .deferValue([this, stream, segment_sizes = std::move(closed->segment_sizes), user_key,
+                     object_off](auto&& tries) mutable {
+            return _with_shard(stream.shard,
+                               [this, blob = stream.blob, written = first_error(tries),
+                                segment_sizes = std::move(segment_sizes), user_key,
+                                object_off](auto const e) mutable -> BlobManager::AsyncResult< blob_id_t > {
+                if (!e) return folly::makeUnexpected(BlobError::UNKNOWN_SHARD);
+                auto error = written ? std::optional< BlobError >{} : written.error();
+                if (!error && ShardInfo::State::SEALED == e.value().state) { error = BlobError::SEALED_SHARD; }
+                if (error) {
+                    LOGW("Failed to write the segments of stream [blob={}] in [shard={}], deleting them: {}", blob,
+                         e.value().id, *error);
+                    return _del_blob_stream(e.value(), blob).deferValue(
+                        [error](auto const&) -> BlobManager::Result< blob_id_t > {
+                            return folly::makeUnexpected(*error);
+                        });
+                }
+                // The manifest is published with the one index entry of the blob, the segments are only reachable
+                // through it.
+                return _put_blob_with_id(e.value(), blob,
+                                         Blob(make_stream_manifest(segment_sizes), user_key, object_off));
+            });
+        })
+        .deferEnsure([this, stream] { _forget_stream(stream); });
+}
+
+BlobManager::NullAsyncResult HomeObjectImpl::abort_stream(BlobStream const& stream) {
+    auto closed = _close_stream(stream);
+    if (!closed) return folly::makeUnexpected(BlobError::UNKNOWN_BLOB);
+    return folly::collectAll(std::move(closed->writes))
+        .deferValue([this, stream](auto&&) {
+            return _with_shard(stream.shard,
+                               [this, blob = stream.blob](auto const e) -> BlobManager::NullAsyncResult {
+                                   if (!e) return folly::makeUnexpected(BlobError::UNKNOWN_SHARD);
+                                   return _del_blob_stream(e.value(), blob);
+                               });
+        })
+        .deferEnsure([this, stream] { _forget_stream(stream); });
+}
+
+void HomeObjectImpl::_reap_streams() {
+    auto const now = std::chrono::steady_clock::now().time_since_epoch().count();
+    auto const lease = std::chrono::duration_cast< std::chrono::steady_clock::duration >(stream_lease).count();
+    std::vector< BlobStream > expired;
+    std::vector< pg_id_t > pg_ids;
+    _get_pg_ids(pg_ids);
+    std::vector< pg_id_t > to_sweep;
+    {
+        std::scoped_lock lock_guard(_stream_lock);
+        for (auto const& [key, state] : _streams) {
+            if (now - state->touched.load(std::memory_order_relaxed) > lease) {
+                expired.push_back(BlobStream{.shard = key.first, .blob = key.second});
+            }
+        }
+        for (auto const pg_id : pg_ids) {
+            // A PG led by another member is swept again once this instance takes the lead back.
+            if (_current_leader(pg_id) != _our_id) {
+                _stream_swept_pgs.erase(pg_id);
+            } else if (_stream_swept_pgs.insert(pg_id).second) {
+                to_sweep.push_back(pg_id);
+            }
+        }
+    }
+
+    for (auto const& stream : expired) {
+        LOGW("Aborting stream [blob={}] in [shard={}], not appended to for {} minutes", stream.blob, stream.shard,
+             stream_lease.count());
+        abort_stream(stream).via(executor_).thenValue([stream](auto const& r) {
+            if (!r && r.error() != BlobError::UNKNOWN_BLOB) {
+                LOGW("Failed to abort stream [blob={}] in [shard={}]: {}", stream.blob, stream.shard, r.error());
+            }
+        });
+    }
+    for (auto const pg_id : to_sweep) {
+        std::vector< ShardInfo > shards;
+        if (auto pg = _get_pg(pg_id); pg) {
+            std::shared_lock lock_guard(pg->mtx_);
+            for (auto const& shard : pg->shards_) {
+                shards.push_back(shard->info);
+            }
+        }
+        for (auto const& shard : shards) {
+            _sweep_stream_segments(shard, stream_segment_bit).via(executor_).thenValue([this, pg_id, shard](auto r) {
+                if (r) { return; }
+                LOGW("Failed to sweep the stream segments of [shard={}]: {}", shard.id, r.error());
+                std::scoped_lock lock_guard(_stream_lock);
+                _stream_swept_pgs.erase(pg_id);
+            });
+        }
+    }
+}
+
+BlobManager::NullAsyncResult HomeObjectImpl::_sweep_stream_segments(ShardInfo const& shard, blob_id_t start) {
+    // Only the first segment of a page is looked at, the sweep then skips to the segments of the next stream.
+    return _list_blobs(shard, start, 1024, BlobState::ALIVE)
+        .deferValue([this, shard](auto&& r) -> BlobManager::NullAsyncResult {
+            if (!r) return folly::makeUnexpected(r.error());
+            if (r.value().empty() || !is_stream_segment(r.value().front().id)) return folly::Unit();
+            auto const stream = stream_blob_bit | blob_sequence_of(r.value().front().id);
+            auto next = [this, shard, stream] { return _sweep_stream_segments(shard, stream_segments_end(stream)); };
+            {
+                std::scoped_lock lock_guard(_stream_lock);
+                if (_streams.contains(std::make_pair(shard.id, stream))) return next();
+            }
+            // Looked up once the stream is known not to be open here, a commit done by then has its manifest.
+            return _get_blob_view(shard, stream, 0, 0)
+                .deferValue([this, shard, stream, next](auto&& manifest) -> BlobManager::NullAsyncResult {
+                    if (manifest) return next();
+                    if (manifest.error() != BlobError::UNKNOWN_BLOB) return folly::makeUnexpected(manifest.error());
+                    LOGI("Deleting the segments of stream [blob={}] in [shard={}], it has no manifest", stream,
+                         shard.id);
+                    return _del_blob_stream(shard, stream)
+                        .deferValue([next](auto const& d) -> BlobManager::NullAsyncResult {
+                            if (!d) return folly::makeUnexpected(d.error());
+                            return next();
+                        });
+                });
+        });
+}
+
+// Matches the alignment the homestore backend requires to write a body without copying it.
+Blob Blob::make_aligned(uint32_t size, std::string const& user_key, uint64_t object_off) {
+    return Blob(sisl::io_blob_safe(size, 512), user_key, object_off);
+}
+
 Blob Blob::clone() const {
     auto new_body = sisl::io_blob_safe(body.size());
     std::memcpy(new_body.bytes(), body.cbytes(), body.size());
     return Blob(std::move(new_body), user_key, object_off);
 }
 
+Blob BlobView::clone() const {
+    auto new_body = sisl::io_blob_safe(body.size());
+    std::memcpy(new_body.bytes(), body.cbytes(), body.size());
+    auto blob = Blob(std::move(new_body), std::string(user_key), object_off);
+    blob.current_leader = current_leader;
+    return blob;
+}
+
 } // namespace homeobject
@@ -1,10 +1,16 @@
 #include "homeobject_impl.hpp"
 
 #include <algorithm>
+#include <thread>
+
+#include <folly/executors/thread_factory/NamedThreadFactory.h>
 
 SISL_OPTION_GROUP(homeobject,
                   (executor_type, "", "executor", "Executor to use for Future deferal",
-                   ::cxxopts::value< std::string >()->default_value("immediate"), "immediate|cpu|io"));
+                   ::cxxopts::value< std::string >()->default_value("immediate"), "immediate|cpu|io|sharded"),
+                  (executor_threads, "", "executor_threads",
+                   "Number of PG workers of the sharded executor, 0 for one per core",
+                   ::cxxopts::value< uint32_t >()->default_value("0"), "count"));
 
 SISL_LOGGING_DEF(HOMEOBJECT_LOG_MODS)
 
@@ -21,8 +27,25 @@ HomeObjectImpl::HomeObjectImpl(std::weak_ptr< HomeObjectApplication >&& applicat
         executor_ = folly::getGlobalIOExecutor();
     else if ("cpu" == exe_type)
         executor_ = folly::getGlobalCPUExecutor();
-    else
+    else if ("sharded" == exe_type) {
+        // Work not tied to a PG and the verification of reads go to the global CPU pool.
+        executor_ = folly::getGlobalCPUExecutor();
+        auto nthreads = SISL_OPTIONS["executor_threads"].as< uint32_t >();
+        if (0 == nthreads) nthreads = std::max(1u, std::thread::hardware_concurrency());
+        pg_executors_.reserve(nthreads);
+        for (uint32_t i = 0; i < nthreads; ++i) {
+            pg_executors_.push_back(std::make_unique< folly::CPUThreadPoolExecutor >(
+                1, std::make_shared< folly::NamedThreadFactory >(fmt::format("ho_pg_{}_", i))));
+        }
+    } else
         RELEASE_ASSERT(false, "Unknown Folly Executor type: [{}]", exe_type);
-    LOGI("initialized with [executor={}]", exe_type);
+    compute_executor_ = executor_;
+    LOGI("initialized with [executor={}] [pg_workers={}]", exe_type, pg_executors_.size());
+}
+
+void HomeObjectImpl::_join_pg_executors() {
+    for (auto& exe : pg_executors_) {
+        exe->join();
+    }
 }
 } // namespace homeobject
@@ -1,9 +1,18 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <set>
+
 #include "homeobject/homeobject.hpp"
 #include "homeobject/blob_manager.hpp"
 #include "homeobject/pg_manager.hpp"
 #include "homeobject/shard_manager.hpp"
+#include <folly/concurrency/ConcurrentHashMap.h>
+#include <folly/executors/CPUThreadPoolExecutor.h>
+#include <folly/futures/FutureSplitter.h>
 #include <sisl/logging/logging.h>
 
 #define LOGT(...) LOGTRACEMOD(homeobject, ##__VA_ARGS__)
@@ -13,6 +22,16 @@
 #define LOGE(...) LOGERRORMOD(homeobject, ##__VA_ARGS__)
 #define LOGC(...) LOGCRITICALMOD(homeobject, ##__VA_ARGS__)
 
+// For events that can happen on every operation: logs at most once per rate_limited_log_interval from each call site,
+// so a burst of them formats one line per interval instead of one per operation.
+#define HO_LOG_RATE_LIMITED(LOGX, ...)                                                                                 \
+    do {                                                                                                               \
+        static homeobject::LogRateLimiter _log_limiter{homeobject::rate_limited_log_interval};                         \
+        if (_log_limiter.allow()) { LOGX(__VA_ARGS__); }                                                               \
+    } while (0)
+#define LOGW_RATE_LIMITED(...) HO_LOG_RATE_LIMITED(LOGW, ##__VA_ARGS__)
+#define LOGE_RATE_LIMITED(...) HO_LOG_RATE_LIMITED(LOGE, ##__VA_ARGS__)
+
 namespace homeobject {
 
 template < typename T >
@@ -29,6 +48,25 @@ using intrusive = boost::intrusive_ptr< T >;
 
 template < typename T >
 using cintrusive = const boost::intrusive_ptr< T >;
+
+inline constexpr std::chrono::milliseconds rate_limited_log_interval{1000};
+
+// Lets through the first call of every interval, see HO_LOG_RATE_LIMITED.
+class LogRateLimiter {
+public:
+    explicit LogRateLimiter(std::chrono::milliseconds interval) :
+            interval_{std::chrono::duration_cast< std::chrono::steady_clock::duration >(interval).count()} {}
+
+    bool allow() {
+        auto const now = std::chrono::steady_clock::now().time_since_epoch().count();
+        auto next = next_.load(std::memory_order_relaxed);
+        return now >= next && next_.compare_exchange_strong(next, now + interval_, std::memory_order_relaxed);
+    }
+
+private:
+    int64_t const interval_;
+    std::atomic< int64_t > next_{0};
+};
 constexpr size_t pg_width = sizeof(pg_id_t) * 8;
 constexpr size_t shard_width = (sizeof(shard_id_t) * 8) - pg_width;
 constexpr size_t shard_mask = std::numeric_limits< homeobject::shard_id_t >::max() >> pg_width;
@@ -37,6 +75,31 @@ inline shard_id_t make_new_shard_id(pg_id_t pg, shard_id_t next_shard) {
     return ((uint64_t)pg << shard_width) | next_shard;
 }
 
+///
+// The id of a blob put as a stream is the sequence number it was opened with marked by stream_blob_bit, the blob
+// itself holding the manifest of the stream. Its segments are blobs of their own, with ids marked by
+// stream_segment_bit that are made of the sequence number and the position of the segment, so the segments of a
+// stream are the [stream_segments_begin, stream_segments_end) range and list after every other blob.
+constexpr blob_id_t stream_blob_bit = 1ull << 62;
+constexpr blob_id_t stream_segment_bit = 1ull << 63;
+constexpr size_t stream_segment_width = 20;
+// Sequence numbers past this one can not open a stream.
+constexpr blob_id_t max_stream_sequence = (1ull << (62 - stream_segment_width)) - 1;
+static_assert(BlobManager::max_stream_segments <= (1ull << stream_segment_width));
+
+inline bool is_stream_segment(blob_id_t id) { return id & stream_segment_bit; }
+inline bool is_stream_blob(blob_id_t id) { return !is_stream_segment(id) && (id & stream_blob_bit); }
+inline blob_id_t stream_segment_id(blob_id_t stream, uint32_t index) {
+    return stream_segment_bit | ((stream & ~stream_blob_bit) << stream_segment_width) | index;
+}
+inline blob_id_t stream_segments_begin(blob_id_t stream) { return stream_segment_id(stream, 0); }
+inline blob_id_t stream_segments_end(blob_id_t stream) { return stream_segment_id(stream + 1, 0); }
+// The sequence number the blob id was taken from, which replicas advance their own past.
+inline blob_id_t blob_sequence_of(blob_id_t id) {
+    if (is_stream_segment(id)) { return (id & ~stream_segment_bit) >> stream_segment_width; }
+    return id & ~stream_blob_bit;
+}
+
 struct Shard {
     explicit Shard(ShardInfo info) : info(std::move(info)) {}
     virtual ~Shard() = default;
@@ -45,8 +108,6 @@ struct Shard {
 };
 
 using ShardPtr = unique< Shard >;
-using ShardPtrList = std::list< ShardPtr >;
-using ShardIterator = ShardPtrList::iterator;
 
 struct PG {
     explicit PG(PGInfo info) : pg_info_(std::move(info)) {}
@@ -59,7 +120,36 @@ struct PG {
     PGInfo pg_info_;
     uint64_t shard_sequence_num_{0};
     std::atomic< blob_id_t > blob_sequence_num_{0ull};
-    ShardPtrList shards_;
+    // In ascending id order. Only the pointers are contiguous, the shards themselves stay where they are when the
+    // vector grows so _shard_map can point at them.
+    std::vector< ShardPtr > shards_;
+
+    // Guards structural changes of the PG: shards_, shard_sequence_num_ and the info of its shards.
+    mutable std::shared_mutex mtx_;
+
+    // Kept up to date on the commit paths of shards and blobs, so stats are read without walking shards_ or the
+    // index. used_bytes_ counts the bytes of the live blobs, deleted_bytes_ those of all the blobs deleted from the PG.
+    std::atomic< uint32_t > total_shards_{0};
+    std::atomic< uint32_t > open_shards_{0};
+    std::atomic< uint64_t > num_blobs_{0};
+    std::atomic< uint64_t > used_bytes_{0};
+    std::atomic< uint64_t > deleted_bytes_{0};
+
+    void on_shard_added(bool open) {
+        total_shards_.fetch_add(1, std::memory_order_relaxed);
+        if (open) { open_shards_.fetch_add(1, std::memory_order_relaxed); }
+    }
+    void on_shard_sealed() { open_shards_.fetch_sub(1, std::memory_order_relaxed); }
+    // The segments of a stream only count their bytes, the blob is counted by its manifest.
+    void on_blob_added(blob_id_t blob, uint64_t bytes) {
+        if (!is_stream_segment(blob)) { num_blobs_.fetch_add(1, std::memory_order_relaxed); }
+        used_bytes_.fetch_add(bytes, std::memory_order_relaxed);
+    }
+    void on_blob_deleted(blob_id_t blob, uint64_t bytes) {
+        if (!is_stream_segment(blob)) { num_blobs_.fetch_sub(1, std::memory_order_relaxed); }
+        used_bytes_.fetch_sub(bytes, std::memory_order_relaxed);
+        deleted_bytes_.fetch_add(bytes, std::memory_order_relaxed);
+    }
 };
 class HomeObjCPContext;
 class HomeObjectImpl : public HomeObject,
@@ -70,12 +160,33 @@ class HomeObjectImpl : public HomeObject,
 
     /// Implementation defines these
     virtual ShardManager::AsyncResult< ShardInfo > _create_shard(pg_id_t, uint64_t size_bytes) = 0;
+    virtual ShardManager::AsyncResult< InfoList > _create_shards(pg_id_t, uint32_t count, uint64_t size_bytes) = 0;
     virtual ShardManager::AsyncResult< ShardInfo > _seal_shard(ShardInfo const&) = 0;
 
     virtual BlobManager::AsyncResult< blob_id_t > _put_blob(ShardInfo const&, Blob&&) = 0;
+    virtual BlobManager::AsyncResult< std::vector< blob_id_t > > _put_blob_batch(ShardInfo const&,
+                                                                                 std::vector< Blob >&&) = 0;
     virtual BlobManager::AsyncResult< Blob > _get_blob(ShardInfo const&, blob_id_t, uint64_t off = 0,
                                                        uint64_t len = 0) const = 0;
+    virtual BlobManager::AsyncResult< BlobView > _get_blob_view(ShardInfo const&, blob_id_t, uint64_t off = 0,
+                                                                uint64_t len = 0) const = 0;
+    virtual BlobManager::AsyncResult< std::vector< BlobManager::Result< Blob > > >
+    _get_blob_batch(ShardInfo const&, std::vector< blob_id_t > const&) const = 0;
     virtual BlobManager::NullAsyncResult _del_blob(ShardInfo const&, blob_id_t) = 0;
+    virtual BlobManager::NullAsyncResult _del_blob_batch(ShardInfo const&, std::vector< blob_id_t > const&) = 0;
+    virtual BlobManager::NullAsyncResult _del_blob_range(ShardInfo const&, blob_id_t from, blob_id_t to) = 0;
+    virtual BlobManager::AsyncResult< BlobList > _list_blobs(ShardInfo const&, blob_id_t start, uint32_t limit,
+                                                             BlobState filter) const = 0;
+    // Takes the next blob sequence number of the PG of the shard.
+    virtual blob_id_t _new_blob_id(ShardInfo const&) = 0;
+    // Puts the blob with an id taken by _new_blob_id, the segments and manifests of streams.
+    virtual BlobManager::AsyncResult< blob_id_t > _put_blob_with_id(ShardInfo const&, blob_id_t, Blob&&) = 0;
+    // Deletes the manifest and the segments of a stream, at once if the backend can.
+    virtual BlobManager::NullAsyncResult _del_blob_stream(ShardInfo const&, blob_id_t) = 0;
+    // Position in the replication log of the PG up to which this replica has applied it.
+    virtual read_token_t _read_token(pg_id_t) const = 0;
+    // The member the writes of the PG go through, if known.
+    virtual std::optional< peer_id_t > _current_leader(pg_id_t) const = 0;
     ///
 
     virtual PGManager::NullAsyncResult _create_pg(PGInfo&& pg_info, std::set< peer_id_t > const& peers) = 0;
@@ -94,17 +205,85 @@ protected:
     std::weak_ptr< HomeObjectApplication > _application;
 
     folly::Executor::KeepAlive<> executor_;
-
     ///
-    mutable std::shared_mutex _pg_lock;
-    std::map< pg_id_t, unique< PG > > _pg_map;
+    // With the sharded executor every PG is bound to one single threaded worker, picked by its id, so the operations
+    // of a PG run in order on the same thread. The other executors leave this empty and run everything on executor_.
+    std::vector< unique< folly::CPUThreadPoolExecutor > > pg_executors_;
+    // CPU heavy work taken off the IO completion path, e.g. verifying the payload of a read.
+    folly::Executor::KeepAlive<> compute_executor_;
+    ///
 
-    mutable std::shared_mutex _shard_lock;
-    std::map< shard_id_t, ShardIterator > _shard_map;
     ///
+    // Lookups take no lock. PGs and shards are only ever added, so the PG and shard pointed at by an entry stay valid
+    // once found; anything they hold that may change is guarded by the owning PG::mtx_.
+    folly::ConcurrentHashMap< pg_id_t, unique< PG > > _pg_map;
+    folly::ConcurrentHashMap< shard_id_t, Shard* > _shard_map;
+    ///
+
+    // Returns nullptr for an unknown PG.
+    PG* _get_pg(pg_id_t id) const {
+        auto it = _pg_map.find(id);
+        return (_pg_map.cend() == it) ? nullptr : it->second.get();
+    }
+
+    folly::Executor::KeepAlive<> _pg_executor(pg_id_t id) const {
+        if (pg_executors_.empty()) { return executor_; }
+        return folly::getKeepAliveToken(pg_executors_[id % pg_executors_.size()].get());
+    }
+    // Waits for the PG workers to run what they have queued, called by backends before shutting down.
+    void _join_pg_executors();
 
     auto _defer() const { return folly::makeSemiFuture().via(executor_); }
-    folly::Future< ShardManager::Result< ShardInfo > > _get_shard(shard_id_t id) const;
+    auto _defer(pg_id_t id) const { return folly::makeSemiFuture().via(_pg_executor(id)); }
+    // Looks the shard up on the calling thread, returning a copy of its info taken under the lock of its PG.
+    ShardManager::Result< ShardInfo > _resolve_shard(shard_id_t id) const;
+
+    ///
+    // Streams open on this instance. Segments are appended under the lock of their stream, in the order of the
+    // append calls, and commit and abort wait for the writes of all of them. A stream stays in _streams until its
+    // commit or abort is done, so the sweep for segments without a manifest leaves it alone meanwhile.
+    struct BlobStreamState {
+        std::mutex mtx;
+        bool closed{false};
+        std::vector< uint32_t > segment_sizes;
+        std::vector< folly::FutureSplitter< BlobManager::NullResult > > segments;
+        // steady_clock ticks of the open or the last append, see stream_lease.
+        std::atomic< int64_t > touched{std::chrono::steady_clock::now().time_since_epoch().count()};
+    };
+    struct ClosedStream {
+        std::vector< uint32_t > segment_sizes;
+        std::vector< BlobManager::NullAsyncResult > writes;
+    };
+    // A stream not appended to for this long is taken as abandoned by its client and aborted.
+    static constexpr std::chrono::minutes stream_lease{10};
+    std::mutex _stream_lock;
+    std::map< std::pair< shard_id_t, blob_id_t >, shared< BlobStreamState > > _streams;
+    // PGs led by this instance whose shards were swept for segments without a manifest since it took the lead,
+    // guarded by _stream_lock.
+    std::set< pg_id_t > _stream_swept_pgs;
+    LogRateLimiter _stream_reap_limiter{std::chrono::minutes(1)};
+    // Closes the stream to appends, for commit and abort; nullopt if it is unknown or closed already.
+    std::optional< ClosedStream > _close_stream(BlobStream const& stream);
+    void _forget_stream(BlobStream const& stream);
+    // Aborts the streams past their lease. The shards of a PG this instance took the lead of are swept for the
+    // segments of streams that lost their writer, e.g. on a restart, and have no manifest; those are deleted.
+    void _reap_streams();
+    // Sweeps the segments of the shard from start on, a stream at a time.
+    BlobManager::NullAsyncResult _sweep_stream_segments(ShardInfo const& shard, blob_id_t start);
+    // Reads the manifest of a stream, then the part of each segment the range covers.
+    BlobManager::AsyncResult< BlobView > _get_stream_view(ShardInfo const& shard, blob_id_t blob, uint64_t off,
+                                                          uint64_t len) const;
+    ///
+
+    ///
+    // Used as the first call of the shard and blob operations, it initializes the Future on the executor of the
+    // shard's PG and resolves the shard within the same continuation as fn.
+    template < typename Fn >
+    auto _with_shard(shard_id_t id, Fn&& fn) const {
+        return _defer(id >> shard_width).thenValue([this, id, fn = std::forward< Fn >(fn)](auto) mutable {
+            return fn(_resolve_shard(id));
+        });
+    }
 
 public:
     explicit HomeObjectImpl(std::weak_ptr< HomeObjectApplication >&& application);
@@ -135,15 +314,37 @@ public:
     /// ShardManager
     ShardManager::AsyncResult< ShardInfo > get_shard(shard_id_t id) const final;
     ShardManager::AsyncResult< ShardInfo > create_shard(pg_id_t pg_owner, uint64_t size_bytes) final;
+    ShardManager::AsyncResult< InfoList > create_shards(pg_id_t pg_owner, uint32_t count, uint64_t size_bytes) final;
     ShardManager::AsyncResult< InfoList > list_shards(pg_id_t pg) const final;
+    ShardManager::AsyncResult< InfoPage > list_shards(pg_id_t pg, shard_id_t start, uint32_t limit,
+                                                      std::optional< ShardInfo::State > filter) const final;
+    ShardManager::AsyncResult< uint32_t > count_shards(pg_id_t pg,
+                                                       std::optional< ShardInfo::State > filter) const final;
     ShardManager::AsyncResult< ShardInfo > seal_shard(shard_id_t id) final;
     uint64_t get_current_timestamp();
 
     /// BlobManager
     BlobManager::AsyncResult< blob_id_t > put(shard_id_t shard, Blob&&) final;
+    BlobManager::AsyncResult< std::vector< blob_id_t > > put_batch(shard_id_t shard, std::vector< Blob >&&) final;
     BlobManager::AsyncResult< Blob > get(shard_id_t shard, blob_id_t const& blob, uint64_t off,
                                          uint64_t len) const final;
+    BlobManager::AsyncResult< BlobView > get_view(shard_id_t shard, blob_id_t const& blob, uint64_t off,
+                                                  uint64_t len) const final;
+    BlobManager::AsyncResult< std::vector< BlobManager::Result< Blob > > >
+    get_batch(shard_id_t shard, std::vector< blob_id_t > const& blobs) const final;
     BlobManager::NullAsyncResult del(shard_id_t shard, blob_id_t const& blob) final;
+    BlobManager::NullAsyncResult del_batch(shard_id_t shard, std::vector< blob_id_t > const& blobs) final;
+    BlobManager::NullAsyncResult del_range(shard_id_t shard, blob_id_t from, blob_id_t to) final;
+    BlobManager::AsyncResult< BlobList > list_blobs(shard_id_t shard, blob_id_t start, uint32_t limit,
+                                                    BlobState filter) const final;
+    BlobManager::AsyncResult< BlobStream > open_stream(shard_id_t shard) final;
+    BlobManager::NullAsyncResult append_stream(BlobStream const& stream, sisl::io_blob_safe&& segment) final;
+    BlobManager::AsyncResult< blob_id_t > commit_stream(BlobStream const& stream, std::string const& user_key,
+                                                        uint64_t object_off) final;
+    BlobManager::NullAsyncResult abort_stream(BlobStream const& stream) final;
+    BlobManager::AsyncResult< PutReceipt > put_with_token(shard_id_t shard, Blob&&) final;
+    BlobManager::AsyncResult< Blob > get_local(shard_id_t shard, blob_id_t const& blob, read_token_t token,
+                                               uint64_t off, uint64_t len) const final;
 };
 
 } // namespace homeobject
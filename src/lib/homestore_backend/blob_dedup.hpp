@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+
+#include <boost/functional/hash.hpp>
+
+#include "homeobject/common.hpp"
+
+namespace homeobject {
+
+///
+// Content of a blob as seen by deduplication: the 128 bit XXH3 of its body and user key, scoped to its shard. Only
+// blobs of the same shard share blocks, so GC moving the chunk of a shard moves every blob of an extent at once and
+// the headers of the blocks name the shard of all of their blobs. A key match only nominates a blob, the put compares
+// the blob read back before it refers to its blocks.
+struct BlobDedupKey {
+    shard_id_t shard;
+    uint64_t low;
+    uint64_t high;
+
+    bool operator==(BlobDedupKey const&) const = default;
+};
+
+} // namespace homeobject
+
+template <>
+struct std::hash< homeobject::BlobDedupKey > {
+    std::size_t operator()(homeobject::BlobDedupKey const& k) const noexcept {
+        std::size_t seed{0};
+        boost::hash_combine(seed, k.shard);
+        boost::hash_combine(seed, k.low);
+        boost::hash_combine(seed, k.high);
+        return seed;
+    }
+};
@@ -0,0 +1,138 @@
+#include "blob_index_queue.hpp"
+
+#include <algorithm>
+
+#include <homestore/homestore.hpp>
+
+namespace homeobject {
+
+void BlobIndexQueue::enqueue(std::vector< put_t >&& puts, done_cb_t done_cb) {
+    // First insert wins, the index keeps the first blkids put for a route as well.
+    for (auto const& [route, blkids] : puts) {
+        overlay_.insert(route, blkids);
+    }
+    submit(std::move(puts), nullptr, std::move(done_cb));
+}
+
+void BlobIndexQueue::enqueue_mutation(mutation_fn_t mutation, done_cb_t done_cb) {
+    submit({}, std::move(mutation), std::move(done_cb));
+}
+
+void BlobIndexQueue::submit(std::vector< put_t >&& puts, mutation_fn_t mutation, done_cb_t done_cb) {
+    bool apply_inline{false};
+    {
+        std::scoped_lock lock_guard(mtx_);
+        pending_.push_back(Request{std::move(puts), std::move(mutation), std::move(done_cb),
+                                   homestore::HomeStore::instance()->cp_mgr().cp_guard()});
+        if (stopped_) {
+            apply_inline = true;
+        } else if (std::exchange(scheduled_, true)) {
+            // The worker picks it up before going idle.
+            return;
+        }
+    }
+    if (apply_inline) {
+        drain();
+        return;
+    }
+    executor_->add([self = shared_from_this()] { self->run(); });
+}
+
+std::optional< BlobLocation > BlobIndexQueue::get(BlobRoute const& route) const {
+    auto it = overlay_.find(route);
+    if (it == overlay_.cend()) { return std::nullopt; }
+    return it->second;
+}
+
+std::vector< BlobIndexQueue::put_t > BlobIndexQueue::pending(BlobRoute const& first, BlobRoute const& last) const {
+    std::vector< put_t > puts;
+    for (auto const& [route, blkids] : overlay_) {
+        if (first <= route && route <= last) { puts.emplace_back(route, blkids); }
+    }
+    std::sort(puts.begin(), puts.end(), [](put_t const& a, put_t const& b) { return a.first < b.first; });
+    return puts;
+}
+
+void BlobIndexQueue::drain() { apply_pending(); }
+
+void BlobIndexQueue::stop() {
+    {
+        std::scoped_lock lock_guard(mtx_);
+        stopped_ = true;
+    }
+    drain();
+}
+
+void BlobIndexQueue::run() {
+    while (true) {
+        apply_pending();
+        std::scoped_lock lock_guard(mtx_);
+        if (pending_.empty()) {
+            scheduled_ = false;
+            return;
+        }
+    }
+}
+
+void BlobIndexQueue::apply_pending() {
+    std::deque< Request > reqs;
+    std::vector< BlobManager::NullResult > results;
+    {
+        std::scoped_lock apply_guard(apply_mtx_);
+        {
+            std::scoped_lock lock_guard(mtx_);
+            reqs.swap(pending_);
+        }
+        if (reqs.empty()) { return; }
+
+        // The puts in between two other mutations are applied together, each mutation once everything ahead of it
+        // is in the index.
+        results.assign(reqs.size(), BlobManager::NullResult(folly::Unit()));
+        size_t begin{0};
+        while (begin < reqs.size()) {
+            if (reqs[begin].mutation) {
+                results[begin] = reqs[begin].mutation();
+                ++begin;
+                continue;
+            }
+            auto end = begin + 1;
+            while (end < reqs.size() && !reqs[end].mutation) {
+                ++end;
+            }
+            apply_puts(reqs, begin, end, results);
+            begin = end;
+        }
+    }
+
+    // Outside of apply_mtx_, the callbacks may go on to drain the queue themselves.
+    for (size_t i = 0; i < reqs.size(); ++i) {
+        if (reqs[i].done_cb) { reqs[i].done_cb(std::move(results[i])); }
+    }
+}
+
+void BlobIndexQueue::apply_puts(std::deque< Request > const& reqs, size_t begin, size_t end,
+                                std::vector< BlobManager::NullResult >& results) {
+    struct Put {
+        put_t const* put;
+        size_t req;
+    };
+    std::vector< Put > puts;
+    for (auto i = begin; i < end; ++i) {
+        for (auto const& p : reqs[i].puts) {
+            puts.push_back(Put{&p, i});
+        }
+    }
+    // Stable so that puts of the same route are still applied in commit order.
+    std::stable_sort(puts.begin(), puts.end(), [](Put const& a, Put const& b) { return a.put->first < b.put->first; });
+
+    for (auto const& p : puts) {
+        auto r = apply_fn_(p.put->first, p.put->second);
+        if (!r && results[p.req]) { results[p.req] = std::move(r); }
+    }
+    // Out of the overlay before the mutation behind them runs, a delete would not be seen past it otherwise.
+    for (auto const& p : puts) {
+        overlay_.erase_if_equal(p.put->first, p.put->second);
+    }
+}
+
+} // namespace homeobject
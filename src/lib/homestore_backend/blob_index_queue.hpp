@@ -0,0 +1,86 @@
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include <folly/concurrency/ConcurrentHashMap.h>
+#include <folly/Executor.h>
+#include <homestore/checkpoint/cp_mgr.hpp>
+
+#include "blob_location.hpp"
+#include "homeobject/blob_manager.hpp"
+#include "lib/blob_route.hpp"
+
+namespace homeobject {
+
+///
+// Index mutations of the committed blobs of a PG, taken off the replication commit path. Commits enqueue their
+// BlobRoute -> BlobLocation puts, or any other mutation such as a delete, and return. A worker on the executor
+// applies everything pending at once in commit order: the puts between two other mutations are sorted by route so
+// consecutive ones land on the same leaf nodes.
+//
+// Until applied, the puts are served from an overlay which readers check before the index. Each request holds a
+// guard on the CP it was committed in, so that CP can not be flushed before its mutations are in the index.
+class BlobIndexQueue : public std::enable_shared_from_this< BlobIndexQueue > {
+public:
+    using put_t = std::pair< BlobRoute, BlobLocation >;
+    using apply_fn_t = std::function< BlobManager::NullResult(BlobRoute const&, BlobLocation const&) >;
+    // A mutation of the index other than a put, run on its own in commit order.
+    using mutation_fn_t = std::function< BlobManager::NullResult() >;
+    // Called once all the puts of a request are applied, with the first error hit if any, or with the result of its
+    // mutation.
+    using done_cb_t = std::function< void(BlobManager::NullResult) >;
+
+    BlobIndexQueue(apply_fn_t apply_fn, folly::Executor::KeepAlive<> executor) :
+            apply_fn_{std::move(apply_fn)}, executor_{std::move(executor)} {}
+
+    void enqueue(std::vector< put_t >&& puts, done_cb_t done_cb);
+    // Runs mutation after every request enqueued before it is applied and before any enqueued after it.
+    void enqueue_mutation(mutation_fn_t mutation, done_cb_t done_cb);
+
+    // Location of a blob committed but not yet applied to the index, if any.
+    std::optional< BlobLocation > get(BlobRoute const& route) const;
+    // Puts committed but not yet applied to the index with routes in [first, last], sorted by route.
+    std::vector< put_t > pending(BlobRoute const& first, BlobRoute const& last) const;
+
+    // Applies everything enqueued so far before returning; used before reading the index directly, e.g. to list the
+    // blobs of a shard.
+    void drain();
+
+    // Drains the queue, requests enqueued afterwards are applied inline.
+    void stop();
+
+private:
+    struct Request {
+        std::vector< put_t > puts;
+        mutation_fn_t mutation;
+        done_cb_t done_cb;
+        homestore::CPGuard cp_guard;
+    };
+
+    void submit(std::vector< put_t >&& puts, mutation_fn_t mutation, done_cb_t done_cb);
+    void run();
+    void apply_pending();
+    // Applies the puts of the requests [begin, end) sorted by route.
+    void apply_puts(std::deque< Request > const& reqs, size_t begin, size_t end,
+                    std::vector< BlobManager::NullResult >& results);
+
+    apply_fn_t apply_fn_;
+    folly::Executor::KeepAlive<> executor_;
+    folly::ConcurrentHashMap< BlobRoute, BlobLocation > overlay_;
+
+    std::mutex mtx_; // Protects the members below.
+    std::deque< Request > pending_;
+    bool scheduled_{false};
+    bool stopped_{false};
+
+    // Serializes application so puts are applied in commit order.
+    std::mutex apply_mtx_;
+};
+
+} // namespace homeobject
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <string>
+
+#include <fmt/format.h>
+#include <homestore/blk.h>
+
+namespace homeobject {
+
+///
+// Where the payload of a blob is stored. A blob packed with other small blobs into one extent shares its first and
+// last blocks with its neighbours, offset and size then give the byte range of its payload from the start of the
+// first block. Blobs that are not packed take up all of their blocks and have a size of 0.
+struct BlobLocation : public homestore::MultiBlkId {
+    uint32_t offset{0};
+    uint32_t size{0};
+
+    BlobLocation() = default;
+    BlobLocation(homestore::MultiBlkId const& pbas, uint32_t offset = 0, uint32_t size = 0) :
+            homestore::MultiBlkId{pbas}, offset{offset}, size{size} {}
+
+    bool packed() const { return size != 0; }
+    // Bytes of storage charged to the blob.
+    uint64_t bytes(uint32_t blk_size) const { return packed() ? size : uint64_t(blk_count()) * blk_size; }
+    std::string to_string() const {
+        if (!packed()) { return homestore::MultiBlkId::to_string(); }
+        return fmt::format("{} packed=[{}, +{})", homestore::MultiBlkId::to_string(), offset, size);
+    }
+};
+
+} // namespace homeobject
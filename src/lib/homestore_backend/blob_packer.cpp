@@ -0,0 +1,91 @@
+#include "blob_packer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <optional>
+
+#include <folly/futures/Future.h>
+
+#include "hs_backend_config.hpp"
+
+namespace homeobject {
+
+BlobManager::AsyncResult< blob_id_t > BlobPacker::add(ShardInfo const& shard, Blob&& blob) {
+    auto const bytes = blob.body.size() + blob.user_key.size();
+    folly::Promise< BlobManager::Result< blob_id_t > > promise;
+    auto result = promise.getSemiFuture();
+
+    std::optional< Pack > full;
+    std::optional< uint64_t > started;
+    {
+        std::scoped_lock lock_guard(mtx_);
+        if (stopped_) {
+            full = Pack{.shard = shard};
+            full->blobs.push_back(Pending{std::move(blob), std::move(promise)});
+        } else {
+            auto& pack = packs_[shard.id];
+            if (pack.blobs.empty()) {
+                pack.shard = shard;
+                pack.generation = ++next_generation_;
+                started = pack.generation;
+            }
+            pack.blobs.push_back(Pending{std::move(blob), std::move(promise)});
+            pack.bytes += bytes;
+            auto const max_blobs = std::min(HS_BACKEND_DYNAMIC_CONFIG(blob_pack_max_blobs), max_pack_blobs);
+            if (pack.blobs.size() >= max_blobs || pack.bytes >= HS_BACKEND_DYNAMIC_CONFIG(blob_pack_max_bytes)) {
+                full = std::move(pack);
+                packs_.erase(shard.id);
+                started.reset();
+            }
+        }
+    }
+
+    if (full) {
+        flush_fn_(full->shard, std::move(full->blobs));
+    } else if (started) {
+        auto const window = std::chrono::microseconds(HS_BACKEND_DYNAMIC_CONFIG(blob_pack_window_us));
+        folly::futures::sleep(window).via(executor_).thenValue(
+            [weak = weak_from_this(), shard_id = shard.id, generation = *started](auto) {
+                if (auto self = weak.lock()) { self->flush(shard_id, generation); }
+            });
+    }
+    return result;
+}
+
+void BlobPacker::flush(shard_id_t shard_id) {
+    std::optional< Pack > pack;
+    {
+        std::scoped_lock lock_guard(mtx_);
+        auto it = packs_.find(shard_id);
+        if (it == packs_.end()) { return; }
+        pack = std::move(it->second);
+        packs_.erase(it);
+    }
+    flush_fn_(pack->shard, std::move(pack->blobs));
+}
+
+void BlobPacker::flush(shard_id_t shard_id, uint64_t generation) {
+    std::optional< Pack > pack;
+    {
+        std::scoped_lock lock_guard(mtx_);
+        auto it = packs_.find(shard_id);
+        if (it == packs_.end() || it->second.generation != generation) { return; }
+        pack = std::move(it->second);
+        packs_.erase(it);
+    }
+    flush_fn_(pack->shard, std::move(pack->blobs));
+}
+
+void BlobPacker::stop() {
+    std::unordered_map< shard_id_t, Pack > packs;
+    {
+        std::scoped_lock lock_guard(mtx_);
+        stopped_ = true;
+        packs.swap(packs_);
+    }
+    for (auto& [_, pack] : packs) {
+        flush_fn_(pack.shard, std::move(pack.blobs));
+    }
+}
+
+} // namespace homeobject
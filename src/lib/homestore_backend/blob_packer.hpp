@@ -0,0 +1,67 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <folly/Executor.h>
+#include <folly/futures/Promise.h>
+
+#include "homeobject/blob_manager.hpp"
+#include "homeobject/shard_manager.hpp"
+
+namespace homeobject {
+
+///
+// Coalesces the puts of small blobs to a shard into packs. The first blob added to a shard starts a pack which is
+// handed to the flush function blob_pack_window_us later, together with every blob added to the shard meanwhile, to
+// be written as one extent with the payloads back to back. A pack is flushed right away once it holds
+// blob_pack_max_blobs blobs or blob_pack_max_bytes bytes.
+//
+// A put completes once the extent of its pack is committed, its blob id is only assigned when the pack is written.
+class BlobPacker : public std::enable_shared_from_this< BlobPacker > {
+public:
+    struct Pending {
+        Blob blob;
+        folly::Promise< BlobManager::Result< blob_id_t > > promise;
+    };
+    using flush_fn_t = std::function< void(ShardInfo const&, std::vector< Pending >&&) >;
+
+    // Most blobs a pack ever holds. Deletes look this far around a packed blob for the neighbours sharing its blocks.
+    static constexpr uint32_t max_pack_blobs{256};
+
+    BlobPacker(flush_fn_t flush_fn, folly::Executor::KeepAlive<> executor) :
+            flush_fn_{std::move(flush_fn)}, executor_{std::move(executor)} {}
+
+    BlobManager::AsyncResult< blob_id_t > add(ShardInfo const& shard, Blob&& blob);
+
+    // Writes the pack of the shard now, if it has one; used before the shard is sealed.
+    void flush(shard_id_t shard_id);
+
+    // Flushes every pack, blobs added afterwards are written on their own right away.
+    void stop();
+
+private:
+    struct Pack {
+        ShardInfo shard;
+        std::vector< Pending > blobs;
+        uint64_t bytes{0};
+        // Tells the timer of a pack apart from that of a later pack of the same shard.
+        uint64_t generation{0};
+    };
+
+    // Flushes the pack of the shard if it still is the one of generation, for the timer of the pack.
+    void flush(shard_id_t shard_id, uint64_t generation);
+
+    flush_fn_t flush_fn_;
+    folly::Executor::KeepAlive<> executor_;
+
+    std::mutex mtx_; // Protects the members below.
+    std::unordered_map< shard_id_t, Pack > packs_;
+    uint64_t next_generation_{0};
+    bool stopped_{false};
+};
+
+} // namespace homeobject
@@ -0,0 +1,499 @@
+#include "gc_manager.hpp"
+
+#include <algorithm>
+#include <map>
+#include <set>
+
+#include <homestore/blkdata_service.hpp>
+#include <homestore/homestore.hpp>
+
+#include "hs_backend_config.hpp"
+#include "hs_homeobject.hpp"
+
+namespace homeobject {
+
+void GCManager::start() {
+    {
+        std::scoped_lock lock_guard(mtx_);
+        stopped_ = false;
+    }
+    thread_ = std::thread([this] { run(); });
+}
+
+void GCManager::stop() {
+    {
+        std::scoped_lock lock_guard(mtx_);
+        stopped_ = true;
+    }
+    cv_.notify_all();
+    if (thread_.joinable()) { thread_.join(); }
+}
+
+bool GCManager::stopped() const {
+    std::scoped_lock lock_guard(mtx_);
+    return stopped_;
+}
+
+GCManager::Stats GCManager::stats() const {
+    return Stats{.chunks_reclaimed = chunks_reclaimed_.load(std::memory_order_relaxed),
+                 .blobs_moved = blobs_moved_.load(std::memory_order_relaxed),
+                 .bytes_moved = bytes_moved_.load(std::memory_order_relaxed),
+                 .tombstones_purged = tombstones_purged_.load(std::memory_order_relaxed)};
+}
+
+void GCManager::run() {
+    LOGI("GC started");
+    while (true) {
+        {
+            std::unique_lock lock_guard(mtx_);
+            auto const interval = std::chrono::seconds(HS_BACKEND_DYNAMIC_CONFIG(gc_interval_secs));
+            if (cv_.wait_for(lock_guard, interval, [this] { return stopped_; })) { break; }
+        }
+        // Abandoned streams hold space as well, reaped here too for a node no stream is opened or appended on.
+        home_object_._reap_streams();
+        // Keep going while there are chunks over the threshold, every chunk reclaimed is taken out of the heap. One
+        // left behind stays in it and is tried again next interval.
+        while (!stopped() && run_once(HS_BACKEND_DYNAMIC_CONFIG(gc_min_defrag_blks))) {}
+    }
+    LOGI("GC stopped");
+}
+
+bool GCManager::run_once(uint64_t min_defrag_blks) {
+    auto chunk_selector = home_object_.chunk_selector();
+    auto src = chunk_selector->most_defrag_chunk();
+    if (!src) { return false; }
+    homestore::VChunk const src_vchunk(src);
+    auto const src_chunk = src_vchunk.get_chunk_id();
+    if (src_vchunk.get_defrag_nblks() < std::max< uint64_t >(min_defrag_blks, 1)) {
+        chunk_selector->release_chunk(src_chunk);
+        return false;
+    }
+
+    auto const pdev_id = src_vchunk.get_pdev_id();
+    std::vector< ShardRef > shards;
+    if (!sealed_shards(pdev_id, src_chunk, shards)) {
+        chunk_selector->release_chunk(src_chunk);
+        return false;
+    }
+
+    // The live blobs go to the chunk with the most room left on the same device.
+    homestore::blk_alloc_hints hints;
+    hints.pdev_id_hint = pdev_id;
+    auto dest = chunk_selector->select_chunk(0, hints);
+    if (!dest) {
+        chunk_selector->release_chunk(src_chunk);
+        return false;
+    }
+    homestore::VChunk const dest_vchunk(dest);
+    auto const dest_chunk = dest_vchunk.get_chunk_id();
+    bool compacted{false};
+    if (dest_vchunk.available_blks() < live_blks(src_vchunk)) {
+        LOGW("GC skips chunk {}, {} live blks do not fit in chunk {} with {} available", src_chunk,
+             live_blks(src_vchunk), dest_chunk, dest_vchunk.available_blks());
+    } else {
+        compacted = compact_chunk(src_chunk, dest_chunk, shards);
+    }
+    chunk_selector->release_chunk(dest_chunk);
+
+    // An emptied chunk has its allocator rewound before it goes back to the heap, so new shards get all of its
+    // blocks. Only once every block of it is freed, which the repl dev holds off until the log no longer needs them,
+    // and no index entry points into it any more. The reset is made durable first, a replay must not find the old
+    // allocation offset of the chunk.
+    bool reclaimed{false};
+    if (compacted && live_blks(src_vchunk) == 0 && !chunk_in_use(src_chunk, shards)) {
+        reclaimed = chunk_selector->reset_chunk(src_chunk) &&
+            homestore::hs()->cp_mgr().trigger_cp_flush(true /* force */).get();
+        if (!reclaimed) { LOGE("GC failed to reset chunk {} it emptied, its blocks stay allocated", src_chunk); }
+    } else if (compacted) {
+        LOGI("GC holds off resetting chunk {} until its {} blks left are freed", src_chunk, live_blks(src_vchunk));
+    }
+    // Back to the defrag heap unless reset, a chunk emptied but not reset yet is reset by a later pass.
+    chunk_selector->release_chunk(src_chunk, !reclaimed /* defrag_candidate */);
+    if (reclaimed) { chunks_reclaimed_.fetch_add(1, std::memory_order_relaxed); }
+    return reclaimed;
+}
+
+uint64_t GCManager::live_blks(homestore::VChunk const& vchunk) {
+    return vchunk.get_total_blks() - vchunk.available_blks() - vchunk.get_defrag_nblks();
+}
+
+bool GCManager::sealed_shards(uint32_t pdev_id, homestore::chunk_num_t chunk, std::vector< ShardRef >& shards) const {
+    auto chunk_selector = home_object_.chunk_selector();
+    for (auto const& [pg_id, pg] : home_object_._pg_map) {
+        std::shared_lock lock_guard(pg->mtx_);
+        for (auto const& shard : pg->shards_) {
+            auto hs_shard = d_cast< HSHomeObject::HS_Shard* >(shard.get());
+            auto const shard_chunk = hs_shard->chunk_id();
+            // Chunks of open shards are never in the heap, bail out if one shows up anyway.
+            if (hs_shard->info.state != ShardInfo::State::SEALED) {
+                if (shard_chunk != chunk) { continue; }
+                LOGW("GC skips chunk {} holding open shard {}", chunk, hs_shard->info.id);
+                return false;
+            }
+            // Blobs only ever move between chunks of the same device.
+            if (shard_chunk != chunk && chunk_selector->chunk_to_hints(shard_chunk).pdev_id_hint != pdev_id) {
+                continue;
+            }
+            shards.push_back(ShardRef{pg_id, hs_shard->info.id, shard_chunk == chunk});
+        }
+    }
+    return true;
+}
+
+bool GCManager::chunk_in_use(homestore::chunk_num_t chunk, std::vector< ShardRef > const& shards) const {
+    for (auto const& ref : shards) {
+        auto hs_pg = static_cast< HSHomeObject::HS_PG* >(home_object_._get_pg(ref.pg_id));
+        auto blob_infos = home_object_.get_shard_blob_infos(*hs_pg, ref.shard_id);
+        // What can not be told is taken to be in use.
+        if (!blob_infos) { return true; }
+        for (auto const& blob_info : blob_infos.value()) {
+            if (blob_info.pbas != HSHomeObject::tombstone_pbas && blob_info.pbas.chunk_num() == chunk) {
+                LOGW("GC finds blob [route={}] still on chunk {}", BlobRoute{ref.shard_id, blob_info.blob_id}, chunk);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool GCManager::compact_chunk(homestore::chunk_num_t src_chunk, homestore::chunk_num_t dest_chunk,
+                              std::vector< ShardRef > const& shards) {
+    LOGI("GC compacts chunk {} onto chunk {}, looking at {} sealed shards", src_chunk, dest_chunk, shards.size());
+    bool all_moved{true};
+    std::vector< MovedBlob > moved;
+    std::vector< std::pair< pg_id_t, BlobRoute > > tombstones;
+    // Shards on src_chunk with all of their blobs there moved by this pass, they are on dest_chunk from now on.
+    std::vector< ShardRef > moved_shards;
+    std::set< pg_id_t > drained;
+    for (auto const& ref : shards) {
+        if (stopped()) {
+            all_moved = false;
+            break;
+        }
+        auto const pg_id = ref.pg_id;
+        auto const shard_id = ref.shard_id;
+        auto const num_moved = moved.size();
+        auto hs_pg = static_cast< HSHomeObject::HS_PG* >(home_object_._get_pg(pg_id));
+        // Puts still in the queue would be missed by the sweep.
+        if (drained.insert(pg_id).second) { hs_pg->index_queue_->drain(); }
+        auto blob_infos = home_object_.get_shard_blob_infos(*hs_pg, shard_id);
+        if (!blob_infos) {
+            all_moved = false;
+            continue;
+        }
+        // The blobs are found by where the index has them, a pass that left some of a shard behind leaves the
+        // others on the chunk it moved them to while the shard stays on its old one.
+        std::vector< std::pair< BlobLocation, std::vector< BlobRoute > > > extents;
+        std::map< std::pair< homestore::chunk_num_t, homestore::blk_num_t >, size_t > extent_of;
+        std::vector< std::pair< BlobRoute, BlobLocation > > packed;
+        for (auto const& blob_info : blob_infos.value()) {
+            auto const route = BlobRoute{shard_id, blob_info.blob_id};
+            if (blob_info.pbas == HSHomeObject::tombstone_pbas) {
+                if (ref.on_chunk) { tombstones.emplace_back(pg_id, route); }
+                continue;
+            }
+            if (blob_info.pbas.chunk_num() != src_chunk) { continue; }
+            if (blob_info.pbas.packed()) {
+                packed.emplace_back(route, blob_info.pbas);
+                continue;
+            }
+            // Blobs deduplicated onto one extent are moved together, so they keep sharing a single copy of it.
+            auto [it, fresh] =
+                extent_of.try_emplace({blob_info.pbas.chunk_num(), blob_info.pbas.blk_num()}, extents.size());
+            if (!fresh) {
+                extents[it->second].second.push_back(route);
+                continue;
+            }
+            extents.emplace_back(blob_info.pbas, std::vector< BlobRoute >{route});
+        }
+        // Packed blobs sharing blocks are moved as one run, so the blocks of their pack are copied once. A blob
+        // starting before the end of the run shares its first block with it.
+        std::sort(packed.begin(), packed.end(),
+                  [](auto const& a, auto const& b) { return a.second.blk_num() < b.second.blk_num(); });
+        std::vector< std::vector< std::pair< BlobRoute, BlobLocation > > > runs;
+        homestore::blk_num_t run_end{0};
+        for (auto const& blob : packed) {
+            auto const& pbas = blob.second;
+            if (runs.empty() || pbas.blk_num() >= run_end) { runs.emplace_back(); }
+            runs.back().push_back(blob);
+            run_end = std::max< homestore::blk_num_t >(run_end, pbas.blk_num() + pbas.blk_count());
+        }
+
+        bool shard_moved{true};
+        for (auto const& [pbas, routes] : extents) {
+            // Whatever got moved so far still has its old blocks freed below.
+            if (stopped()) {
+                shard_moved = false;
+                break;
+            }
+            if (auto r = move_blob(pg_id, routes, pbas, dest_chunk, moved); !r) {
+                LOGE("GC failed to move blob [route={}] off chunk {}, {}", routes.front(), src_chunk, r.error());
+                shard_moved = false;
+            }
+        }
+        for (auto const& run : runs) {
+            if (stopped()) {
+                shard_moved = false;
+                break;
+            }
+            if (auto r = move_packed_blobs(pg_id, run, dest_chunk, moved); !r) {
+                LOGE("GC failed to move packed blobs [route={}] off chunk {}, {}", run.front().first, src_chunk,
+                     r.error());
+                shard_moved = false;
+            }
+        }
+        if (!shard_moved) {
+            all_moved = false;
+        } else if (ref.on_chunk && moved.size() > num_moved) {
+            moved_shards.push_back(ref);
+        }
+    }
+
+    for (auto const& ref : moved_shards) {
+        std::scoped_lock lock_guard(home_object_._get_pg(ref.pg_id)->mtx_);
+        auto iter = home_object_._shard_map.find(ref.shard_id);
+        d_cast< HSHomeObject::HS_Shard* >(iter->second)->set_chunk_id(dest_chunk);
+    }
+
+    // The new index entries and the deletes behind the tombstones have to be durable before the old blocks are
+    // freed and the tombstones dropped, neither must be seen by a replay of the log after a crash.
+    if (!homestore::hs()->cp_mgr().trigger_cp_flush(true /* force */).get()) {
+        LOGE("GC failed to flush a CP after compacting chunk {}, leaving its blocks in place", src_chunk);
+        return false;
+    }
+
+    // Blocks shared by packed or deduplicated blobs are freed once, and only when none of the blobs sharing them is
+    // left behind.
+    std::map< pg_id_t, std::vector< HSHomeObject::BlobInfo > > old_blobs;
+    for (auto const& m : moved) {
+        old_blobs[m.pg_id].push_back(HSHomeObject::BlobInfo{m.route.shard, m.route.blob, m.old_pbas});
+    }
+    std::vector< folly::Future< std::error_code > > frees;
+    frees.reserve(moved.size());
+    for (auto& [pg_id, blob_infos] : old_blobs) {
+        auto hs_pg = static_cast< HSHomeObject::HS_PG* >(home_object_._get_pg(pg_id));
+        std::scoped_lock gc_guard(hs_pg->gc_mtx_);
+        // Left in place if their counts can not be told, the chunk gets them back once compacted.
+        if (auto r = HSHomeObject::unshare_extents(*hs_pg, blob_infos); !r) {
+            LOGE("GC keeps the old blocks of the blobs of pg {} moved off chunk {}, {}", pg_id, src_chunk, r.error());
+        }
+        for (auto const& blkids : home_object_.blks_to_free(*hs_pg, blob_infos)) {
+            frees.push_back(free_blks(pg_id, blkids));
+        }
+    }
+    folly::collectAll(std::move(frees)).get();
+
+    // The shards are sealed, no put is left to be kept from coming back by their tombstones.
+    for (auto const& [pg_id, route] : tombstones) {
+        auto hs_pg = static_cast< HSHomeObject::HS_PG* >(home_object_._get_pg(pg_id));
+        if (home_object_.remove_from_index_table(*hs_pg, route)) {
+            tombstones_purged_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    LOGI("GC moved {} blobs off chunk {} and purged {} tombstones", moved.size(), src_chunk, tombstones.size());
+    return all_moved;
+}
+
+folly::Future< std::error_code > GCManager::free_blks(pg_id_t pg_id, homestore::MultiBlkId const& blkids) {
+    // Freed through the repl dev like the blocks of deleted blobs, which holds them until the log no longer needs
+    // them; the puts of the blobs GC moves are all at or before the last lsn applied to the PG.
+    auto hs_pg = static_cast< HSHomeObject::HS_PG* >(home_object_._get_pg(pg_id));
+    return hs_pg->repl_dev_->async_free_blks(hs_pg->applied_lsn_.load(std::memory_order_acquire), blkids);
+}
+
+BlobManager::NullResult GCManager::move_blob(pg_id_t pg_id, std::vector< BlobRoute > const& routes,
+                                             BlobLocation const& pbas, homestore::chunk_num_t dest_chunk,
+                                             std::vector< MovedBlob >& moved) {
+    auto hs_pg = static_cast< HSHomeObject::HS_PG* >(home_object_._get_pg(pg_id));
+    auto const total_size = pbas.blk_count() * hs_pg->repl_dev_->get_blk_size();
+    throttle(total_size);
+
+    shared< uint8_t > buf;
+    if (auto read = read_blks(pg_id, pbas, buf); !read) { return read; }
+    // A blob whose header does not check out is left where it is for its readers to report.
+    auto const& first = routes.front();
+    if (auto h = home_object_.verify_blob_header(buf.get() + pbas.offset, first.shard, first.blob); !h) {
+        return folly::makeUnexpected(h.error());
+    }
+
+    auto written = write_blks(pg_id, buf, total_size, dest_chunk);
+    if (!written) { return folly::makeUnexpected(written.error()); }
+    auto const& new_pbas = written.value();
+
+    BlobManager::NullResult r = folly::Unit();
+    uint32_t num_moved{0};
+    {
+        // A delete committed meanwhile wins, it already tombstoned the blob and freed the old blocks.
+        std::scoped_lock gc_guard(hs_pg->gc_mtx_);
+        // The copy is counted as shared by all the blobs of the extent before the first of them moves onto it, so
+        // its count is never short of the entries pointing at it. The old extent is unshared once its blobs moved.
+        auto const refs = static_cast< int64_t >(routes.size()) - 1;
+        if (refs > 0) {
+            if (auto shared = HSHomeObject::add_extent_refs(*hs_pg, new_pbas, refs); !shared) {
+                free_blks(pg_id, new_pbas);
+                return folly::makeUnexpected(shared.error());
+            }
+        }
+        for (auto const& route : routes) {
+            auto replaced =
+                home_object_.replace_blob_pbas(*hs_pg, HSHomeObject::BlobInfo{route.shard, route.blob, pbas}, new_pbas);
+            if (!replaced) {
+                if (replaced.error() != BlobError::UNKNOWN_BLOB) { r = replaced; }
+                continue;
+            }
+            // Removed rather than updated, so a lookup racing with the swap can not cache the old blkids after it.
+            if (hs_pg->index_cache_) { hs_pg->index_cache_->remove(route); }
+            moved.push_back(MovedBlob{pg_id, route, pbas});
+            ++num_moved;
+        }
+        // Blobs deleted meanwhile stay behind, a count left too high only keeps the copy from being freed.
+        if (refs > 0 && num_moved < routes.size()) {
+            auto const dropped = static_cast< int64_t >(num_moved) - static_cast< int64_t >(routes.size());
+            if (auto shared = HSHomeObject::add_extent_refs(*hs_pg, new_pbas, dropped); !shared && r) {
+                r = folly::makeUnexpected(shared.error());
+            }
+        }
+    }
+    if (num_moved == 0) {
+        free_blks(pg_id, new_pbas);
+        return r;
+    }
+
+    blobs_moved_.fetch_add(num_moved, std::memory_order_relaxed);
+    bytes_moved_.fetch_add(total_size, std::memory_order_relaxed);
+    return r;
+}
+
+BlobManager::NullResult GCManager::move_packed_blobs(pg_id_t pg_id,
+                                                     std::vector< std::pair< BlobRoute, BlobLocation > > const& blobs,
+                                                     homestore::chunk_num_t dest_chunk,
+                                                     std::vector< MovedBlob >& moved) {
+    auto hs_pg = static_cast< HSHomeObject::HS_PG* >(home_object_._get_pg(pg_id));
+    auto const blk_size = hs_pg->repl_dev_->get_blk_size();
+    // The blobs are sorted by their first block, the run spans from that of the first to the last block of any.
+    auto const chunk = blobs.front().second.chunk_num();
+    auto const start = blobs.front().second.blk_num();
+    homestore::blk_num_t end{start};
+    for (auto const& [_, pbas] : blobs) {
+        end = std::max< homestore::blk_num_t >(end, pbas.blk_num() + pbas.blk_count());
+    }
+    auto const nblks = end - start;
+    auto const total_size = nblks * blk_size;
+    throttle(total_size);
+
+    shared< uint8_t > buf;
+    if (auto read = read_blks(pg_id, homestore::MultiBlkId{start, s_cast< homestore::blk_count_t >(nblks), chunk}, buf);
+        !read) {
+        return read;
+    }
+    // Blobs whose headers do not check out are left where they are for their readers to report.
+    std::vector< std::pair< BlobRoute, BlobLocation > const* > valid;
+    BlobManager::NullResult r = folly::Unit();
+    for (auto const& blob : blobs) {
+        auto const& [route, pbas] = blob;
+        auto const at = buf.get() + (pbas.blk_num() - start) * blk_size + pbas.offset;
+        if (auto h = home_object_.verify_blob_header(at, route.shard, route.blob); !h) {
+            r = folly::makeUnexpected(h.error());
+            continue;
+        }
+        valid.push_back(&blob);
+    }
+    if (valid.empty()) { return r; }
+
+    auto written = write_blks(pg_id, buf, total_size, dest_chunk);
+    if (!written) { return folly::makeUnexpected(written.error()); }
+    auto const& new_pbas = written.value();
+
+    // Blocks of the copy no moved blob points at, those of blobs deleted meanwhile, are freed right away.
+    std::vector< bool > used(nblks, false);
+    uint32_t num_moved{0};
+    {
+        // A delete committed meanwhile wins, it already tombstoned the blob and freed the old blocks it did not share.
+        std::scoped_lock gc_guard(hs_pg->gc_mtx_);
+        for (auto const blob : valid) {
+            auto const& [route, pbas] = *blob;
+            auto const blk_offset = pbas.blk_num() - start;
+            auto const blob_pbas = HSHomeObject::sub_blkids(new_pbas, blk_offset, pbas.blk_count());
+            auto replaced = home_object_.replace_blob_pbas(
+                *hs_pg, HSHomeObject::BlobInfo{route.shard, route.blob, pbas}, blob_pbas);
+            if (!replaced) {
+                if (replaced.error() != BlobError::UNKNOWN_BLOB && r) { r = replaced; }
+                continue;
+            }
+            if (hs_pg->index_cache_) { hs_pg->index_cache_->remove(route); }
+            moved.push_back(MovedBlob{pg_id, route, pbas});
+            std::fill_n(used.begin() + blk_offset, pbas.blk_count(), true);
+            ++num_moved;
+        }
+    }
+    for (uint32_t b = 0; b < nblks;) {
+        if (used[b]) {
+            ++b;
+            continue;
+        }
+        auto const from = b;
+        while (b < nblks && !used[b]) {
+            ++b;
+        }
+        free_blks(pg_id, HSHomeObject::sub_blkids(new_pbas, from, b - from));
+    }
+    if (num_moved == 0) { return r; }
+
+    blobs_moved_.fetch_add(num_moved, std::memory_order_relaxed);
+    bytes_moved_.fetch_add(total_size, std::memory_order_relaxed);
+    return r;
+}
+
+BlobManager::NullResult GCManager::read_blks(pg_id_t pg_id, homestore::MultiBlkId const& pbas,
+                                             shared< uint8_t >& buf) {
+    auto repl_dev = static_cast< HSHomeObject::HS_PG* >(home_object_._get_pg(pg_id))->repl_dev_;
+    auto const blk_size = repl_dev->get_blk_size();
+    auto const total_size = pbas.blk_count() * blk_size;
+    buf = shared< uint8_t >(iomanager.iobuf_alloc(blk_size, total_size), [](uint8_t* b) { iomanager.iobuf_free(b); });
+    sisl::sg_list sgs;
+    sgs.size = total_size;
+    sgs.iovs.emplace_back(iovec{.iov_base = buf.get(), .iov_len = total_size});
+    if (auto err = repl_dev->async_read(pbas, sgs, total_size).get(); err) {
+        return folly::makeUnexpected(BlobError::READ_FAILED);
+    }
+    return folly::Unit();
+}
+
+BlobManager::Result< homestore::MultiBlkId > GCManager::write_blks(pg_id_t pg_id, shared< uint8_t > const& buf,
+                                                                   uint32_t size, homestore::chunk_num_t dest_chunk) {
+    auto& data_service = homestore::hs()->data_service();
+    homestore::blk_alloc_hints hints;
+    hints.chunk_id_hint = dest_chunk;
+    homestore::MultiBlkId new_pbas;
+    if (data_service.alloc_blks(size, hints, new_pbas) != homestore::BlkAllocStatus::SUCCESS) {
+        return folly::makeUnexpected(BlobError::UNKNOWN);
+    }
+    sisl::sg_list sgs;
+    sgs.size = size;
+    sgs.iovs.emplace_back(iovec{.iov_base = buf.get(), .iov_len = size});
+    if (auto err = data_service.async_write(sgs, new_pbas).get(); err) {
+        free_blks(pg_id, new_pbas);
+        return folly::makeUnexpected(BlobError::UNKNOWN);
+    }
+    return new_pbas;
+}
+
+void GCManager::throttle(uint64_t bytes) {
+    auto const max_bytes_per_sec = HS_BACKEND_DYNAMIC_CONFIG(gc_max_bytes_per_sec);
+    if (max_bytes_per_sec == 0) { return; }
+    auto const now = std::chrono::steady_clock::now();
+    if (now - window_start_ >= std::chrono::seconds(1)) {
+        window_start_ = now;
+        window_bytes_ = 0;
+    }
+    window_bytes_ += bytes;
+    if (window_bytes_ <= max_bytes_per_sec) { return; }
+
+    // Over budget for this window, wait for the next one unless told to stop.
+    std::unique_lock lock_guard(mtx_);
+    cv_.wait_until(lock_guard, window_start_ + std::chrono::seconds(1), [this] { return stopped_; });
+    window_start_ = std::chrono::steady_clock::now();
+    window_bytes_ = bytes;
+}
+
+} // namespace homeobject
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <folly/futures/Future.h>
+#include <homestore/blk.h>
+#include <homestore/vchunk.h>
+
+#include "homeobject/blob_manager.hpp"
+#include "lib/blob_route.hpp"
+#include "blob_location.hpp"
+
+namespace homeobject {
+
+class HSHomeObject;
+
+///
+// Compacts the chunks of sealed shards. Deleted blobs only free their blocks back to the append allocator of the
+// chunk, which can not hand them out again, so chunks fragment as blobs get deleted. A pass takes the chunk with the
+// most freed blocks from the HeapChunkSelector, copies the blobs the index has on it onto another chunk of the same
+// device, swaps their index entries over and then frees the old blocks and purges the tombstones of the shards it
+// moved. The chunk is reset only once no index entry points into it and all of its blocks are freed.
+//
+// GC is local to the node, blkids are not replicated so each replica compacts its own chunks.
+class GCManager {
+public:
+    struct Stats {
+        uint64_t chunks_reclaimed{0};
+        uint64_t blobs_moved{0};
+        uint64_t bytes_moved{0};
+        uint64_t tombstones_purged{0};
+    };
+
+    explicit GCManager(HSHomeObject& home_object) : home_object_{home_object} {}
+    ~GCManager() { stop(); }
+
+    // Runs a pass every gc_interval_secs on a thread of its own until stopped.
+    void start();
+    void stop();
+
+    // Compacts the most fragmented chunk if it has at least min_defrag_blks freed blocks. Returns whether a chunk
+    // was emptied and reset.
+    bool run_once(uint64_t min_defrag_blks);
+
+    Stats stats() const;
+
+private:
+    struct MovedBlob {
+        pg_id_t pg_id;
+        BlobRoute route;
+        BlobLocation old_pbas;
+    };
+
+    // A sealed shard whose blobs may be on the chunk being compacted, on_chunk if the shard is placed on it.
+    struct ShardRef {
+        pg_id_t pg_id;
+        shard_id_t shard_id;
+        bool on_chunk;
+    };
+
+    void run();
+    bool stopped() const;
+    // Blocks of the chunk neither available nor freed.
+    static uint64_t live_blks(homestore::VChunk const& vchunk);
+    // Collects the sealed shards on the chunks of pdev_id, false if an open shard is on chunk.
+    bool sealed_shards(uint32_t pdev_id, homestore::chunk_num_t chunk, std::vector< ShardRef >& shards) const;
+    // Whether an index entry of any of shards points into chunk.
+    bool chunk_in_use(homestore::chunk_num_t chunk, std::vector< ShardRef > const& shards) const;
+    // Moves the blobs the index has on src_chunk over to dest_chunk, false if any of them is left behind.
+    bool compact_chunk(homestore::chunk_num_t src_chunk, homestore::chunk_num_t dest_chunk,
+                       std::vector< ShardRef > const& shards);
+    // Copies the blocks at pbas onto dest_chunk once and points the index entries of routes, the blobs sharing them,
+    // at the copy, but for those deleted meanwhile.
+    BlobManager::NullResult move_blob(pg_id_t pg_id, std::vector< BlobRoute > const& routes, BlobLocation const& pbas,
+                                      homestore::chunk_num_t dest_chunk, std::vector< MovedBlob >& moved);
+    // Copies the blocks spanned by a run of packed blobs, each sharing its first block with the end of the one before,
+    // onto dest_chunk once and points every blob at its part of the copy, keeping its packed range.
+    BlobManager::NullResult move_packed_blobs(pg_id_t pg_id,
+                                              std::vector< std::pair< BlobRoute, BlobLocation > > const& blobs,
+                                              homestore::chunk_num_t dest_chunk, std::vector< MovedBlob >& moved);
+    // Reads the blocks at pbas of the PG into buf, sized to hold them all.
+    BlobManager::NullResult read_blks(pg_id_t pg_id, homestore::MultiBlkId const& pbas, shared< uint8_t >& buf);
+    // Writes size bytes of buf to blocks newly allocated on dest_chunk.
+    BlobManager::Result< homestore::MultiBlkId > write_blks(pg_id_t pg_id, shared< uint8_t > const& buf, uint32_t size,
+                                                            homestore::chunk_num_t dest_chunk);
+    // Frees blocks of the PG through its repl dev, tied to the last lsn applied to it.
+    folly::Future< std::error_code > free_blks(pg_id_t pg_id, homestore::MultiBlkId const& blkids);
+    // Sleeps long enough to keep the copy rate under gc_max_bytes_per_sec.
+    void throttle(uint64_t bytes);
+
+    HSHomeObject& home_object_;
+    std::thread thread_;
+
+    mutable std::mutex mtx_; // Protects stopped_, signalled through cv_ to cut a wait short.
+    std::condition_variable cv_;
+    bool stopped_{false};
+
+    // Start of the current rate limiting window and the bytes copied in it.
+    std::chrono::steady_clock::time_point window_start_{};
+    uint64_t window_bytes_{0};
+
+    std::atomic< uint64_t > chunks_reclaimed_{0};
+    std::atomic< uint64_t > blobs_moved_{0};
+    std::atomic< uint64_t > bytes_moved_{0};
+    std::atomic< uint64_t > tombstones_purged_{0};
+};
+
+} // namespace homeobject
@@ -2,6 +2,8 @@
 
 #include <execution>
 #include <algorithm>
+#include <chrono>
+#include <tuple>
 #include <utility>
 
 #include <sisl/logging/logging.h>
@@ -19,7 +21,7 @@ namespace homeobject {
 // this should only be called when initializing HeapChunkSelector in Homestore
 void HeapChunkSelector::add_chunk(csharedChunk& chunk) { m_chunks.emplace(VChunk(chunk).get_chunk_id(), chunk); }
 
-void HeapChunkSelector::add_chunk_internal(const chunk_num_t chunkID, bool add_to_heap) {
+void HeapChunkSelector::add_chunk_internal(const chunk_num_t chunkID, bool add_to_heap, bool add_to_defrag_heap) {
     if (m_chunks.find(chunkID) == m_chunks.end()) {
         // sanity check
         LOGWARNMOD(homeobject, "No chunk found for ChunkID {}", chunkID);
@@ -33,21 +35,18 @@ void HeapChunkSelector::add_chunk_internal(const chunk_num_t chunkID, bool add_t
     auto it = m_per_dev_heap.find(pdevID);
     if (it == m_per_dev_heap.end()) { it = m_per_dev_heap.emplace(pdevID, std::make_shared< PerDevHeap >()).first; }
 
-    // build total blks for every chunk on this device;
-    it->second->m_total_blks += vchunk.get_total_blks();
-
     if (add_to_heap) {
         auto& avalableBlkCounter = it->second->available_blk_count;
         avalableBlkCounter.fetch_add(vchunk.available_blks());
 
         auto& heapLock = it->second->mtx;
         auto& heap = it->second->m_heap;
-        {
+        if (add_to_defrag_heap) {
             std::lock_guard< std::mutex > l(m_defrag_mtx);
-            m_defrag_heap.emplace(chunk);
+            m_defrag_heap.push(vchunk, vchunk.get_defrag_nblks());
         }
         std::lock_guard< std::mutex > l(heapLock);
-        heap.emplace(chunk);
+        heap.push(vchunk, vchunk.available_blks());
     }
 }
 
@@ -89,9 +88,9 @@ csharedChunk HeapChunkSelector::select_chunk(homestore::blk_count_t count, const
 
     auto vchunk = VChunk(nullptr);
     auto& heap = it->second->m_heap;
-    if (auto lock_guard = std::lock_guard< std::mutex >(it->second->mtx); !heap.empty()) {
-        vchunk = heap.top();
-        heap.pop();
+    {
+        std::lock_guard< std::mutex > lock_guard(it->second->mtx);
+        vchunk = heap.pop();
     }
 
     if (vchunk.get_internal_chunk()) {
@@ -121,22 +120,9 @@ csharedChunk HeapChunkSelector::select_specific_chunk(const chunk_num_t chunkID)
 
     auto vchunk = VChunk(nullptr);
     auto& heap = it->second->m_heap;
-    if (auto lock_guard = std::lock_guard< std::mutex >(it->second->mtx); !heap.empty()) {
-        std::vector< VChunk > chunks;
-        chunks.reserve(heap.size());
-        while (!heap.empty()) {
-            auto c = heap.top();
-            heap.pop();
-            if (c.get_chunk_id() == chunkID) {
-                vchunk = c;
-                break;
-            }
-            chunks.push_back(std::move(c));
-        }
-
-        for (auto& c : chunks) {
-            heap.emplace(c);
-        }
+    {
+        std::lock_guard< std::mutex > lock_guard(it->second->mtx);
+        vchunk = heap.erase(chunkID);
     }
 
     if (vchunk.get_internal_chunk()) {
@@ -151,33 +137,31 @@ csharedChunk HeapChunkSelector::select_specific_chunk(const chunk_num_t chunkID)
 // most_defrag_chunk will only be called when GC is triggered, and will return the chunk with the most
 // defrag blocks
 csharedChunk HeapChunkSelector::most_defrag_chunk() {
-    chunk_num_t chunkID{0};
+    {
+        // deletes keep freeing blocks of the chunks in the heap, so their priorities are refreshed first. GC is rare
+        // enough for this to be cheaper than tracking every free.
+        std::lock_guard< std::mutex > lg(m_defrag_mtx);
+        m_defrag_heap.reprioritize([](VChunk const& c) { return c.get_defrag_nblks(); });
+    }
     // the chunk might be seleted for creating shard. if this happens, we need to select another chunk
     for (;;) {
+        std::optional< chunk_num_t > chunkID;
         {
             std::lock_guard< std::mutex > lg(m_defrag_mtx);
-            if (m_defrag_heap.empty()) break;
-            chunkID = m_defrag_heap.top().get_chunk_id();
+            chunkID = m_defrag_heap.top();
         }
-        auto chunk = select_specific_chunk(chunkID);
+        if (!chunkID) break;
+        auto chunk = select_specific_chunk(*chunkID);
         if (chunk) return chunk;
+        // not in the heap of its device, drop it here as well so it is not picked again.
+        remove_chunk_from_defrag_heap(*chunkID);
     }
     return nullptr;
 }
 
 void HeapChunkSelector::remove_chunk_from_defrag_heap(const chunk_num_t chunkID) {
-    std::vector< VChunk > chunks;
     std::lock_guard< std::mutex > lg(m_defrag_mtx);
-    chunks.reserve(m_defrag_heap.size());
-    while (!m_defrag_heap.empty()) {
-        auto c = m_defrag_heap.top();
-        m_defrag_heap.pop();
-        if (c.get_chunk_id() == chunkID) break;
-        chunks.emplace_back(std::move(c));
-    }
-    for (auto& c : chunks) {
-        m_defrag_heap.emplace(c);
-    }
+    m_defrag_heap.erase(chunkID);
 }
 
 void HeapChunkSelector::foreach_chunks(std::function< void(csharedChunk&) >&& cb) {
@@ -186,22 +170,70 @@ void HeapChunkSelector::foreach_chunks(std::function< void(csharedChunk&) >&& cb
                   [cb = std::move(cb)](auto& p) { cb(p.second); });
 }
 
-void HeapChunkSelector::release_chunk(const chunk_num_t chunkID) {
+// the released chunk goes back with whatever it has left behind the blocks already allocated on it, so the next shard
+// selecting it packs its blobs in there. The chunk is already counted in the total blks of its device.
+void HeapChunkSelector::release_chunk(const chunk_num_t chunkID, bool defrag_candidate) {
     const auto& it = m_chunks.find(chunkID);
     if (it == m_chunks.end()) {
         // sanity check
         LOGWARNMOD(homeobject, "No chunk found for ChunkID {}", chunkID);
     } else {
-        add_chunk_internal(chunkID);
+        add_chunk_internal(chunkID, true /* add_to_heap */, defrag_candidate);
+    }
+}
+
+bool HeapChunkSelector::reset_chunk(const chunk_num_t chunkID) {
+    const auto& it = m_chunks.find(chunkID);
+    if (it == m_chunks.end()) {
+        // sanity check
+        LOGWARNMOD(homeobject, "No chunk found for ChunkID {}", chunkID);
+        return false;
     }
+    VChunk vchunk(it->second);
+    vchunk.reset();
+    return true;
 }
 
 void HeapChunkSelector::build_per_dev_chunk_heap(const std::unordered_set< chunk_num_t >& excludingChunks) {
+    // group the chunks by pdev first, so that the heap of every pdev can be built on a thread of its own;
+    std::unordered_map< uint32_t, std::vector< VChunk > > dev_chunks;
     for (const auto& p : m_chunks) {
-        bool add_to_heap = true;
-        if (excludingChunks.find(p.first) != excludingChunks.end()) { add_to_heap = false; }
-        add_chunk_internal(p.first, add_to_heap);
-    };
+        VChunk vchunk(p.second);
+        auto pdevID = vchunk.get_pdev_id();
+        if (m_per_dev_heap.find(pdevID) == m_per_dev_heap.end()) {
+            m_per_dev_heap.emplace(pdevID, std::make_shared< PerDevHeap >());
+        }
+        dev_chunks[pdevID].emplace_back(std::move(vchunk));
+    }
+
+    std::for_each(std::execution::par, dev_chunks.begin(), dev_chunks.end(), [this, &excludingChunks](auto& p) {
+        auto& dev_heap = m_per_dev_heap.at(p.first);
+        std::vector< VChunk > avail_chunks;
+        avail_chunks.reserve(p.second.size());
+        uint64_t total_blks{0};
+        uint64_t avail_blks{0};
+        for (auto& vchunk : p.second) {
+            // build total blks for every chunk on this device;
+            total_blks += vchunk.get_total_blks();
+            if (excludingChunks.find(vchunk.get_chunk_id()) != excludingChunks.end()) { continue; }
+            avail_blks += vchunk.available_blks();
+            avail_chunks.push_back(vchunk);
+        }
+
+        {
+            std::lock_guard< std::mutex > l(dev_heap->mtx);
+            dev_heap->m_total_blks += total_blks;
+            for (auto const& vchunk : avail_chunks) {
+                dev_heap->m_heap.push(vchunk, vchunk.available_blks());
+            }
+        }
+        dev_heap->available_blk_count.fetch_add(avail_blks);
+
+        std::lock_guard< std::mutex > l(m_defrag_mtx);
+        for (auto const& vchunk : avail_chunks) {
+            m_defrag_heap.push(vchunk, vchunk.get_defrag_nblks());
+        }
+    });
 }
 
 homestore::blk_alloc_hints HeapChunkSelector::chunk_to_hints(chunk_num_t chunk_id) const {
@@ -237,6 +269,94 @@ uint32_t HeapChunkSelector::avail_num_chunks(uint32_t dev_id) const {
 
 uint32_t HeapChunkSelector::total_chunks() const { return m_chunks.size(); }
 
+void HeapChunkSelector::IndexedChunkHeap::push(VChunk const& chunk, uint64_t priority) {
+    auto const chunk_id = chunk.get_chunk_id();
+    if (auto it = m_pos.find(chunk_id); it != m_pos.end()) {
+        // already in, only its priority moves.
+        auto const pos = it->second;
+        auto const old_priority = m_entries[pos].priority;
+        m_entries[pos].priority = priority;
+        if (priority > old_priority) {
+            sift_up(pos);
+        } else {
+            sift_down(pos);
+        }
+        return;
+    }
+    m_entries.push_back(Entry{priority, chunk});
+    m_pos.emplace(chunk_id, m_entries.size() - 1);
+    sift_up(m_entries.size() - 1);
+}
+
+HeapChunkSelector::VChunk HeapChunkSelector::IndexedChunkHeap::pop() {
+    if (m_entries.empty()) { return VChunk(nullptr); }
+    return erase_at(0);
+}
+
+HeapChunkSelector::VChunk HeapChunkSelector::IndexedChunkHeap::erase(chunk_num_t chunk_id) {
+    auto it = m_pos.find(chunk_id);
+    if (it == m_pos.end()) { return VChunk(nullptr); }
+    return erase_at(it->second);
+}
+
+std::optional< HeapChunkSelector::chunk_num_t > HeapChunkSelector::IndexedChunkHeap::top() const {
+    if (m_entries.empty()) { return std::nullopt; }
+    return m_entries.front().chunk.get_chunk_id();
+}
+
+void HeapChunkSelector::IndexedChunkHeap::reprioritize(std::function< uint64_t(VChunk const&) > const& priority) {
+    for (auto& e : m_entries) {
+        e.priority = priority(e.chunk);
+    }
+    // bottom-up heapify, O(n).
+    for (size_t pos = m_entries.size() / 2; pos-- > 0;) {
+        sift_down(pos);
+    }
+}
+
+void HeapChunkSelector::IndexedChunkHeap::swap_entries(size_t a, size_t b) {
+    std::swap(m_entries[a], m_entries[b]);
+    m_pos[m_entries[a].chunk.get_chunk_id()] = a;
+    m_pos[m_entries[b].chunk.get_chunk_id()] = b;
+}
+
+void HeapChunkSelector::IndexedChunkHeap::sift_up(size_t pos) {
+    while (pos > 0) {
+        auto const parent = (pos - 1) / 2;
+        if (m_entries[parent].priority >= m_entries[pos].priority) { break; }
+        swap_entries(parent, pos);
+        pos = parent;
+    }
+}
+
+void HeapChunkSelector::IndexedChunkHeap::sift_down(size_t pos) {
+    auto const n = m_entries.size();
+    while (true) {
+        auto largest = pos;
+        auto const left = 2 * pos + 1;
+        auto const right = left + 1;
+        if (left < n && m_entries[left].priority > m_entries[largest].priority) { largest = left; }
+        if (right < n && m_entries[right].priority > m_entries[largest].priority) { largest = right; }
+        if (largest == pos) { break; }
+        swap_entries(pos, largest);
+        pos = largest;
+    }
+}
+
+HeapChunkSelector::VChunk HeapChunkSelector::IndexedChunkHeap::erase_at(size_t pos) {
+    auto const last = m_entries.size() - 1;
+    if (pos != last) { swap_entries(pos, last); }
+    auto chunk = std::move(m_entries.back().chunk);
+    m_entries.pop_back();
+    m_pos.erase(chunk.get_chunk_id());
+    if (pos < m_entries.size()) {
+        // the entry moved in from the back may belong either above or below.
+        sift_up(pos);
+        sift_down(pos);
+    }
+    return chunk;
+}
+
 uint64_t HeapChunkSelector::avail_blks(std::optional< uint32_t > dev_it) const {
     if (!dev_it.has_value()) {
         uint64_t max_avail_blks = 0ull;
@@ -256,6 +376,54 @@ uint64_t HeapChunkSelector::avail_blks(std::optional< uint32_t > dev_it) const {
     }
 }
 
+std::optional< uint32_t >
+HeapChunkSelector::select_pdev_for_pg(std::unordered_map< uint32_t, uint32_t > const& pg_open_shards,
+                                      uint32_t min_avail_pct) const {
+    std::optional< uint32_t > best;
+    std::tuple< uint32_t, uint64_t, uint64_t > best_load;
+    for (auto const& [pdevID, dev_heap] : m_per_dev_heap) {
+        if (dev_heap->size() == 0) { continue; }
+        auto const avail = static_cast< uint64_t >(dev_heap->available_blk_count.load());
+        if (avail * 100 < dev_heap->m_total_blks * min_avail_pct) { continue; }
+        auto const it = pg_open_shards.find(pdevID);
+        // the more available blocks the better, so they are compared negated.
+        auto const load = std::make_tuple(it == pg_open_shards.end() ? 0u : it->second,
+                                          recent_write_bytes(*dev_heap), ~avail);
+        if (!best || load < best_load || (load == best_load && pdevID < *best)) {
+            best = pdevID;
+            best_load = load;
+        }
+    }
+    return best;
+}
+
+void HeapChunkSelector::record_write(chunk_num_t chunk_id, uint64_t bytes) {
+    auto const chunk_it = m_chunks.find(chunk_id);
+    if (chunk_it == m_chunks.end()) { return; }
+    auto const it = m_per_dev_heap.find(VChunk(chunk_it->second).get_pdev_id());
+    if (it == m_per_dev_heap.end()) { return; }
+    it->second->recent_write_bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+uint64_t HeapChunkSelector::recent_write_bytes(PerDevHeap& dev_heap) {
+    auto const now_ms = static_cast< uint64_t >(std::chrono::duration_cast< std::chrono::milliseconds >(
+                                                    std::chrono::steady_clock::now().time_since_epoch())
+                                                    .count());
+    auto last_ms = dev_heap.last_decay_ms.load(std::memory_order_relaxed);
+    if (last_ms == 0) {
+        // the first look at the device starts its clock.
+        dev_heap.last_decay_ms.compare_exchange_strong(last_ms, now_ms);
+        return dev_heap.recent_write_bytes.load(std::memory_order_relaxed);
+    }
+    auto const secs = now_ms > last_ms ? (now_ms - last_ms) / 1000 : 0;
+    // only the thread winning the exchange decays the count, so every second halves it once.
+    if (secs > 0 && dev_heap.last_decay_ms.compare_exchange_strong(last_ms, last_ms + secs * 1000)) {
+        auto bytes = dev_heap.recent_write_bytes.load(std::memory_order_relaxed);
+        while (!dev_heap.recent_write_bytes.compare_exchange_weak(bytes, secs >= 64 ? 0 : bytes >> secs)) {}
+    }
+    return dev_heap.recent_write_bytes.load(std::memory_order_relaxed);
+}
+
 uint64_t HeapChunkSelector::total_blks(uint32_t dev_id) const {
     auto it = m_per_dev_heap.find(dev_id);
     if (it == m_per_dev_heap.end()) {
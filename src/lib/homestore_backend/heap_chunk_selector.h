@@ -7,11 +7,12 @@
 #include <homestore/homestore_decl.hpp>
 #include <homestore/blk.h>
 
-#include <queue>
 #include <vector>
 #include <mutex>
 #include <functional>
 #include <atomic>
+#include <unordered_map>
+#include <optional>
 
 namespace homeobject {
 
@@ -23,25 +24,45 @@ public:
     ~HeapChunkSelector() = default;
 
     using VChunk = homestore::VChunk;
-    class VChunkComparator {
-    public:
-        bool operator()(VChunk& lhs, VChunk& rhs) { return lhs.available_blks() < rhs.available_blks(); }
-    };
+    using chunk_num_t = homestore::chunk_num_t;
 
-    class VChunkDefragComparator {
+    // Binary max heap of chunks, ordered by a priority taken when the chunk is pushed. The position of every chunk
+    // is kept by its id, so taking a given chunk out is O(log n) like taking the top. Not thread safe.
+    class IndexedChunkHeap {
     public:
-        bool operator()(VChunk& lhs, VChunk& rhs) { return lhs.get_defrag_nblks() < rhs.get_defrag_nblks(); }
+        void push(VChunk const& chunk, uint64_t priority);
+        // Both return a VChunk without internal chunk if there is none to take.
+        VChunk pop();
+        VChunk erase(chunk_num_t chunk_id);
+        std::optional< chunk_num_t > top() const;
+        // Takes a fresh priority for every chunk, O(n).
+        void reprioritize(std::function< uint64_t(VChunk const&) > const& priority);
+        bool contains(chunk_num_t chunk_id) const { return m_pos.contains(chunk_id); }
+        bool empty() const { return m_entries.empty(); }
+        uint32_t size() const { return m_entries.size(); }
+
+    private:
+        struct Entry {
+            uint64_t priority;
+            VChunk chunk;
+        };
+        void swap_entries(size_t a, size_t b);
+        void sift_up(size_t pos);
+        void sift_down(size_t pos);
+        VChunk erase_at(size_t pos);
+
+        std::vector< Entry > m_entries;
+        std::unordered_map< chunk_num_t, size_t > m_pos;
     };
 
-    using VChunkHeap = std::priority_queue< VChunk, std::vector< VChunk >, VChunkComparator >;
-    using VChunkDefragHeap = std::priority_queue< VChunk, std::vector< VChunk >, VChunkDefragComparator >;
-    using chunk_num_t = homestore::chunk_num_t;
-
     struct PerDevHeap {
         std::mutex mtx;
-        VChunkHeap m_heap;
+        IndexedChunkHeap m_heap; // ordered by available blks.
         std::atomic_size_t available_blk_count;
         uint64_t m_total_blks{0}; // initlized during boot, and will not change during runtime;
+        // bytes allocated for writes on this device, halved for every second gone by since last_decay_ms.
+        std::atomic< uint64_t > recent_write_bytes{0};
+        std::atomic< uint64_t > last_decay_ms{0};
         uint32_t size() const { return m_heap.size(); }
     };
 
@@ -57,8 +78,12 @@ public:
     csharedChunk most_defrag_chunk();
 
     // this function is used to return a chunk back to ChunkSelector when sealing a shard, and will only be used by
-    // Homeobject.
-    void release_chunk(const chunk_num_t);
+    // Homeobject. GC passes defrag_candidate = false for a chunk it reset, so it is not picked by GC again.
+    void release_chunk(const chunk_num_t, bool defrag_candidate = true);
+
+    // this function is used by GC to rewind the block allocator of a chunk it emptied, so all of its blocks can be
+    // allocated again. The caller holds the chunk selected, all of its blocks are freed and no index entry points into it.
+    bool reset_chunk(const chunk_num_t);
 
     // this should be called after ShardManager is initialized and get all the open shards
     void build_per_dev_chunk_heap(const std::unordered_set< chunk_num_t >& excludingChunks);
@@ -71,6 +96,27 @@ public:
      */
     homestore::blk_alloc_hints chunk_to_hints(chunk_num_t chunk_id) const;
 
+    /**
+     * Picks the device for a new open shard of a PG, given the number of open shards the PG already has on each
+     * device: the one with the fewest of them, then the one with the fewest bytes written recently, then the one
+     * with the most available blocks. Devices without an available chunk or with less than min_avail_pct percent of
+     * their blocks available are left out.
+     *
+     * @param pg_open_shards The open shards of the PG by device ID.
+     * @param min_avail_pct The percentage of available blocks a device needs to keep to be picked.
+     * @return The device ID, or std::nullopt if no device qualifies.
+     */
+    std::optional< uint32_t > select_pdev_for_pg(std::unordered_map< uint32_t, uint32_t > const& pg_open_shards,
+                                                 uint32_t min_avail_pct) const;
+
+    /**
+     * Accounts bytes about to be written to the given chunk to the recent load of its device.
+     *
+     * @param chunk_id The ID of the chunk written to.
+     * @param bytes The number of bytes written.
+     */
+    void record_write(chunk_num_t chunk_id, uint64_t bytes);
+
     /**
      * Returns the number of available blocks of the given device id.
      *
@@ -118,11 +164,12 @@ private:
     // hold all the chunks , selected or not
     std::unordered_map< chunk_num_t, csharedChunk > m_chunks;
 
-    void add_chunk_internal(const chunk_num_t, bool add_to_heap = true);
+    void add_chunk_internal(const chunk_num_t, bool add_to_heap = true, bool add_to_defrag_heap = true);
 
-    VChunkDefragHeap m_defrag_heap;
+    IndexedChunkHeap m_defrag_heap; // ordered by defrag blks, which grow while the chunk sits in the heap.
     std::mutex m_defrag_mtx;
 
     void remove_chunk_from_defrag_heap(const chunk_num_t);
+    static uint64_t recent_write_bytes(PerDevHeap& dev_heap);
 };
 } // namespace homeobject
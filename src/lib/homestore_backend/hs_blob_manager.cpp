@@ -4,33 +4,483 @@
 #include "lib/homeobject_impl.hpp"
 #include "lib/blob_route.hpp"
 #include "hs_hmobj_cp.hpp"
+#include "hs_backend_config.hpp"
+#include <array>
+#include <limits>
+#include <set>
+#include <tuple>
+
 #include <homestore/homestore.hpp>
+#include <lz4.h>
+#include <xxhash.h>
 
 SISL_LOGGING_DECL(blobmgr)
 
 namespace homeobject {
 static constexpr uint64_t io_align{512};
 
-BlobManager::AsyncResult< blob_id_t > HSHomeObject::_put_blob(ShardInfo const& shard, Blob&& blob) {
+// Alignment of the parts of the records of packed blobs, just enough to keep the headers word aligned.
+static constexpr uint64_t pack_align{8};
+
+// Largest single read get_batch merges the payloads of blobs adjacent on disk into.
+static constexpr uint64_t max_merged_read_size{1 * Mi};
+
+// Only ranged gets of blobs spanning more than this are served by reading just the blocks covering the range.
+static constexpr uint64_t partial_read_min_size{4 * HSHomeObject::BlobHeader::blob_segment_size};
+
+// Per thread, direct mapped shard -> chunk bindings looked up by the blk alloc hints of puts ahead of the shard map.
+// Shard ids are never reused and only GC moves a shard, once it is sealed and takes no more puts, so an entry can only
+// go stale with the HSHomeObject it was filled by; the instance id tells those apart.
+struct ShardChunkHint {
+    uint64_t instance_id{0};
+    shard_id_t shard_id{0};
+    homestore::chunk_num_t chunk_id{0};
+};
+static constexpr size_t shard_chunk_hint_slots{64};
+static thread_local std::array< ShardChunkHint, shard_chunk_hint_slots > shard_chunk_hints;
+
+static uint32_t segment_crc(const uint8_t* bytes, size_t size) {
+    return crc32_iscsi(const_cast< uint8_t* >(bytes), s_cast< int >(size), init_crc32);
+}
+
+// Falls back to v2, which every replica reads, if the configured version is not one new blobs can be written with.
+static uint8_t blob_header_version() {
+    auto const version = HS_BACKEND_DYNAMIC_CONFIG(blob_header_version);
+    if (version >= 0x02 && version <= HSHomeObject::BlobHeader::blob_header_version) { return version; }
+    LOGW("Unsupported blob_header_version {}, using 2", version);
+    return 0x02;
+}
+
+// Falls back to CRC32 if the configured algorithm is not one new blobs can be written with.
+static HSHomeObject::BlobHeader::HashAlgorithm blob_hash_algorithm() {
+    using HashAlgorithm = HSHomeObject::BlobHeader::HashAlgorithm;
+    auto const algorithm = HashAlgorithm{HS_BACKEND_DYNAMIC_CONFIG(blob_hash_algorithm)};
+    switch (algorithm) {
+    case HashAlgorithm::NONE:
+    case HashAlgorithm::CRC32:
+    case HashAlgorithm::CRC32C:
+    case HashAlgorithm::XXH3:
+        return algorithm;
+    default:
+        LOGW("Unsupported blob_hash_algorithm {}, using CRC32", s_cast< uint8_t >(algorithm));
+        return HashAlgorithm::CRC32;
+    }
+}
+
+// Body of a blob compressed frame by frame into a buffer of bufs, for blobs of more than one frame the compressed size
+// of each of them.
+struct CompressedBody {
+    uint8_t* bytes;
+    uint32_t size;
+    std::vector< uint32_t > frame_sizes;
+};
+
+// Compresses the body with the configured codec if the blob header can record it and it saves space.
+static std::optional< CompressedBody > compress_blob_body(Blob const& blob, uint8_t version, IOBufPool::BufList& bufs) {
+    using Codec = HSHomeObject::BlobHeader::Codec;
+    auto const codec = Codec{HS_BACKEND_DYNAMIC_CONFIG(blob_compression)};
+    auto const body_size = blob.body.size();
+    if (codec == Codec::NONE || version < 0x04 || body_size == 0 ||
+        body_size < HS_BACKEND_DYNAMIC_CONFIG(blob_compression_min_size)) {
+        return std::nullopt;
+    }
+    if (codec != Codec::LZ4) {
+        LOGW("Unsupported blob_compression {}, writing blobs uncompressed", s_cast< uint8_t >(codec));
+        return std::nullopt;
+    }
+
+    auto const frame_size = HSHomeObject::BlobHeader::blob_segment_size;
+    auto const num_frames = sisl::round_up(body_size, frame_size) / frame_size;
+    auto const buf_size = s_cast< uint32_t >(sisl::round_up(
+        uint64_t(num_frames) * LZ4_compressBound(s_cast< int >(std::min(body_size, frame_size))), io_align));
+    auto buf = IOBufPool::alloc(buf_size);
+    CompressedBody out{buf.bytes, 0, {}};
+    for (uint32_t i = 0; i < num_frames; ++i) {
+        auto const offset = uint64_t(i) * frame_size;
+        auto const len = std::min< uint64_t >(frame_size, body_size - offset);
+        auto const n = LZ4_compress_default(r_cast< const char* >(blob.body.cbytes() + offset),
+                                            r_cast< char* >(out.bytes + out.size), s_cast< int >(len),
+                                            s_cast< int >(buf_size - out.size));
+        if (n <= 0) {
+            IOBufPool::free(buf);
+            return std::nullopt;
+        }
+        if (num_frames > 1) { out.frame_sizes.push_back(s_cast< uint32_t >(n)); }
+        out.size += n;
+    }
+    // Not worth it unless the data ends up in fewer io_align units.
+    if (sisl::round_up(out.size, io_align) >= sisl::round_up(body_size, io_align)) {
+        IOBufPool::free(buf);
+        return std::nullopt;
+    }
+    std::memset(out.bytes + out.size, 0, sisl::round_up(out.size, io_align) - out.size);
+    bufs.push_back(std::move(buf));
+    return out;
+}
+
+// Decompresses the frames first to last of a compressed blob, starting at data, into dst.
+static bool decompress_blob_frames(HSHomeObject::BlobHeader const* header, uint8_t const* data, uint32_t first,
+                                   uint32_t last, uint8_t* dst) {
+    auto const frame_size = HSHomeObject::BlobHeader::blob_segment_size;
+    for (auto frame = first; frame <= last; ++frame) {
+        auto const len = std::min< uint64_t >(frame_size, header->blob_size - uint64_t(frame) * frame_size);
+        auto const n = LZ4_decompress_safe(r_cast< const char* >(data), r_cast< char* >(dst),
+                                           s_cast< int >(header->frame_size(frame)), s_cast< int >(len));
+        if (n < 0 || s_cast< uint64_t >(n) != len) { return false; }
+        data += header->frame_size(frame);
+        dst += len;
+    }
+    return true;
+}
+
+// Narrows a view of a whole blob to the requested range, a len of 0 meaning up to the end of the blob.
+static BlobManager::Result< BlobView > slice_blob_view(BlobView view, uint64_t req_offset, uint64_t req_len) {
+    auto const blob_size = view.body.size();
+    if (req_offset + req_len > blob_size) {
+        LOGE_RATE_LIMITED("Invalid offset length request in get blob offset {} len {} size {}", req_offset, req_len,
+                          blob_size);
+        return folly::makeUnexpected(BlobError::INVALID_ARG);
+    }
+    auto res_len = req_len == 0 ? blob_size - req_offset : req_len;
+    view.body = sisl::blob{view.body.bytes() + req_offset, s_cast< uint32_t >(res_len)};
+    return view;
+}
+
+std::optional< BlobDataCache::epoch_t > HSHomeObject::data_cache_epoch(BlobRoute const& route,
+                                                                       Blob const& blob) const {
+    if (!data_cache_ || blob.body.size() > HS_BACKEND_DYNAMIC_CONFIG(blob_data_cache_max_blob_size)) {
+        return std::nullopt;
+    }
+    return data_cache_->epoch(route);
+}
+
+void HSHomeObject::add_to_data_cache(BlobRoute const& route, Blob&& blob, BlobDataCache::epoch_t epoch) const {
+    auto cached = std::make_shared< Blob >(std::move(blob));
+    auto const charge = sizeof(Blob) + cached->body.size() + cached->user_key.size();
+    auto view = BlobView{.body = sisl::blob{cached->body.bytes(), cached->body.size()},
+                         .user_key = std::string_view{cached->user_key},
+                         .object_off = cached->object_off};
+    view.holder = std::move(cached);
+    data_cache_->fill(route, std::move(view), charge, epoch);
+}
+
+uint32_t HSHomeObject::add_blob_payload(sisl::sg_list& sgs, IOBufPool::BufList& bufs, Blob const& blob,
+                                        shard_id_t shard_id, blob_id_t blob_id, uint32_t dev_block_size) const {
+    auto const start_size = sgs.size;
+
+    // Create blob header, followed by the segment checksum table for large blobs and, from v3, a user key that fits
+    // in the same block.
+    auto const version = blob_header_version();
+    auto const compressed = compress_blob_body(blob, version, bufs);
+    auto const num_segments = BlobHeader::num_segments_for(blob.body.size());
+    auto const table_size = BlobHeader::table_size(num_segments, compressed.has_value());
+    auto const layout = BlobHeader::layout(version, table_size, blob.user_key.size(), dev_block_size);
+    auto const blob_header_size = layout.size;
+    auto blob_header = r_cast< BlobHeader* >(bufs.emplace_back(IOBufPool::alloc(blob_header_size)).bytes);
+    std::memset(blob_header, 0, blob_header_size);
+    new (blob_header) BlobHeader();
+    blob_header->version = version;
+    blob_header->data_offset = blob_header_size;
+    blob_header->shard_id = shard_id;
+    blob_header->blob_id = blob_id;
+    blob_header->hash_algorithm = blob_hash_algorithm();
+    blob_header->blob_size = blob.body.size();
+    blob_header->user_key_size = blob.user_key.size();
+    blob_header->object_offset = blob.object_off;
+    if (compressed) {
+        blob_header->codec = BlobHeader::Codec::LZ4;
+        blob_header->stored_size = compressed->size;
+    }
+    if (layout.key_inline) {
+        blob_header->user_key_offset = BlobHeader::fixed_size(version) + table_size;
+        std::memcpy(r_cast< uint8_t* >(blob_header) + blob_header->user_key_offset, blob.user_key.data(),
+                    blob.user_key.size());
+    }
+    sgs.iovs.emplace_back(iovec{.iov_base = blob_header, .iov_len = blob_header_size});
+    sgs.size += blob_header_size;
+
+    // Append blob bytes. An aligned body is written straight from the caller's buffer (see Blob::make_aligned), only
+    // the unaligned tail, if any, is copied into a zero padded buffer. A compressed body is already padded.
+    auto const body_bytes = compressed ? compressed->bytes : const_cast< uint8_t* >(blob.body.cbytes());
+    auto const body_size = compressed ? compressed->size : blob.body.size();
+    auto const aligned_body_size = sisl::round_up(body_size, io_align);
+    if (compressed) {
+        sgs.iovs.emplace_back(iovec{.iov_base = body_bytes, .iov_len = aligned_body_size});
+    } else if (reinterpret_cast< uintptr_t >(body_bytes) % io_align == 0) {
+        auto const prefix_size = sisl::round_down(body_size, io_align);
+        if (prefix_size != 0) { sgs.iovs.emplace_back(iovec{.iov_base = body_bytes, .iov_len = prefix_size}); }
+        if (auto const tail_size = body_size - prefix_size; tail_size != 0) {
+            auto tail = bufs.emplace_back(IOBufPool::alloc(io_align)).bytes;
+            std::memcpy(tail, body_bytes + prefix_size, tail_size);
+            std::memset(tail + tail_size, 0, io_align - tail_size);
+            sgs.iovs.emplace_back(iovec{.iov_base = tail, .iov_len = io_align});
+        }
+    } else if (body_size != 0) {
+        // Unaligned address, the whole body has to be copied.
+        COUNTER_INCREMENT(metrics_, blob_unaligned_copy_count, 1);
+        auto blob_bytes = bufs.emplace_back(IOBufPool::alloc(aligned_body_size)).bytes;
+        std::memcpy(blob_bytes, body_bytes, body_size);
+        std::memset(blob_bytes + body_size, 0, aligned_body_size - body_size);
+        sgs.iovs.emplace_back(iovec{.iov_base = blob_bytes, .iov_len = aligned_body_size});
+    }
+    sgs.size += aligned_body_size;
+
+    // Append metadata if present and not inline and update the offsets and total size.
+    if (!blob.user_key.empty() && !layout.key_inline) {
+        auto const user_key_size = sisl::round_up(blob.user_key.size(), io_align);
+        auto user_key_bytes = bufs.emplace_back(IOBufPool::alloc(user_key_size)).bytes;
+        std::memcpy(user_key_bytes, blob.user_key.data(), blob.user_key.size());
+        std::memset(user_key_bytes + blob.user_key.size(), 0, user_key_size - blob.user_key.size());
+
+        sgs.iovs.emplace_back(iovec{.iov_base = user_key_bytes, .iov_len = user_key_size});
+        sgs.size += user_key_size;
+        // Set offset of user meta data is after blob bytes.
+        blob_header->user_key_offset = (version >= 0x03) ? blob_header_size + aligned_body_size : aligned_body_size;
+    }
+
+    // Check if any padding of zeroes needs to be added to be aligned to device block size.
+    auto pad_len = sisl::round_up(sgs.size, dev_block_size) - sgs.size;
+    if (pad_len != 0) {
+        auto pad_zeroes = const_cast< uint8_t* >(IOBufPool::zeroes(pad_len));
+        sgs.iovs.emplace_back(iovec{.iov_base = pad_zeroes, .iov_len = pad_len});
+        sgs.size += pad_len;
+    }
+
+    // Compute the checksum of blob and metadata, over the data as stored.
+    compute_blob_payload_hash(blob_header->hash_algorithm, body_bytes, body_size,
+                              r_cast< const uint8_t* >(blob.user_key.data()), blob.user_key.size(), blob_header->hash,
+                              BlobHeader::blob_max_hash_len);
+    if (num_segments != 0) {
+        blob_header->segment_size = BlobHeader::blob_segment_size;
+        blob_header->num_segments = num_segments;
+        auto crcs = blob_header->segment_crcs();
+        if (compressed) {
+            std::copy(compressed->frame_sizes.begin(), compressed->frame_sizes.end(), blob_header->frame_sizes());
+            for (uint32_t i = 0; i < num_segments; ++i) {
+                crcs[i] = segment_crc(body_bytes + blob_header->frame_start(i), compressed->frame_sizes[i]);
+            }
+        } else {
+            for (uint32_t i = 0; i < num_segments; ++i) {
+                crcs[i] = segment_crc(blob.body.cbytes() + (uint64_t)i * BlobHeader::blob_segment_size,
+                                      std::min(blob.body.size() - i * BlobHeader::blob_segment_size,
+                                               BlobHeader::blob_segment_size));
+            }
+        }
+        crcs[num_segments] = segment_crc(r_cast< const uint8_t* >(blob.user_key.data()), blob.user_key.size());
+    }
+    return sgs.size - start_size;
+}
+
+uint32_t HSHomeObject::add_packed_blob_record(uint8_t* dst, Blob const& blob, shard_id_t shard_id,
+                                              blob_id_t blob_id) const {
+    // dst is zeroed by the caller, which takes care of the padding. From v3 the user key goes ahead of the data.
+    auto const version = blob_header_version();
+    auto const key_inline = (version >= 0x03);
+    auto const fixed_size = sisl::round_up(BlobHeader::fixed_size(version), pack_align);
+    auto const header_size = fixed_size + (key_inline ? sisl::round_up(blob.user_key.size(), pack_align) : 0);
+    auto blob_header = new (dst) BlobHeader();
+    blob_header->version = version;
+    blob_header->data_offset = header_size;
+    blob_header->shard_id = shard_id;
+    blob_header->blob_id = blob_id;
+    blob_header->hash_algorithm = blob_hash_algorithm();
+    blob_header->blob_size = blob.body.size();
+    blob_header->user_key_size = blob.user_key.size();
+    blob_header->object_offset = blob.object_off;
+
+    auto const aligned_body_size = sisl::round_up(blob.body.size(), pack_align);
+    if (blob.body.size() != 0) { std::memcpy(dst + header_size, blob.body.cbytes(), blob.body.size()); }
+    uint64_t record_size = header_size + aligned_body_size;
+    if (!blob.user_key.empty() && key_inline) {
+        blob_header->user_key_offset = fixed_size;
+        std::memcpy(dst + blob_header->user_key_offset, blob.user_key.data(), blob.user_key.size());
+    } else if (!blob.user_key.empty()) {
+        std::memcpy(dst + record_size, blob.user_key.data(), blob.user_key.size());
+        blob_header->user_key_offset = aligned_body_size;
+        record_size += sisl::round_up(blob.user_key.size(), pack_align);
+    }
+
+    compute_blob_payload_hash(blob_header->hash_algorithm, blob.body.cbytes(), blob.body.size(),
+                              r_cast< const uint8_t* >(blob.user_key.data()), blob.user_key.size(), blob_header->hash,
+                              BlobHeader::blob_max_hash_len);
+    return s_cast< uint32_t >(record_size);
+}
+
+void HSHomeObject::write_blob_pack(ShardInfo const& shard, std::vector< BlobPacker::Pending >&& blobs) {
     auto& pg_id = shard.placement_group;
+    auto const num_blobs = static_cast< uint32_t >(blobs.size());
     shared< homestore::ReplDev > repl_dev;
-    blob_id_t new_blob_id;
+    blob_id_t start_blob_id;
     {
-        std::shared_lock lock_guard(_pg_lock);
         auto iter = _pg_map.find(pg_id);
-        RELEASE_ASSERT(iter != _pg_map.end(), "PG not found");
+        RELEASE_ASSERT(iter != _pg_map.cend(), "PG not found");
         auto hs_pg = static_cast< HS_PG* >(iter->second.get());
         repl_dev = hs_pg->repl_dev_;
-        new_blob_id = hs_pg->blob_sequence_num_.fetch_add(1, std::memory_order_relaxed);
+        start_blob_id = hs_pg->blob_sequence_num_.fetch_add(num_blobs, std::memory_order_relaxed);
+
+        hs_pg->mark_dirty();
+
+        RELEASE_ASSERT(start_blob_id < stream_blob_bit - num_blobs, "exhausted all available blob ids");
+    }
+
+    RELEASE_ASSERT(repl_dev != nullptr, "Repl dev instance null");
+
+    auto req = repl_result_ctx< BlobManager::Result< std::vector< BlobInfo > > >::make(BlobPackKey::size(num_blobs),
+                                                                                      io_align);
+    req->header_.msg_type = ReplicationMessageType::PUT_BLOB_PACK_MSG;
+    req->header_.payload_size = 0;
+    req->header_.payload_crc = 0;
+    req->header_.shard_id = shard.id;
+    req->header_.pg_id = pg_id;
+    req->header_.seal();
+    sisl::blob header;
+    header.set_bytes(r_cast< uint8_t* >(&req->header_));
+    header.set_size(sizeof(req->header_));
+
+    // The records of the blobs go back to back into a single buffer padded out to the device block size.
+    auto const header_size = sisl::round_up(sizeof(BlobHeader), pack_align);
+    uint64_t max_size{0};
+    for (auto const& pending : blobs) {
+        max_size += header_size + sisl::round_up(pending.blob.body.size(), pack_align) +
+            sisl::round_up(pending.blob.user_key.size(), pack_align);
+    }
+    auto const dev_block_size = repl_dev->get_blk_size();
+    auto const buf_size = s_cast< uint32_t >(sisl::round_up(max_size, dev_block_size));
+    auto pack_buf = IOBufPool::alloc(buf_size);
+    auto buf = pack_buf.bytes;
+    std::memset(buf, 0, buf_size);
+    auto pack_key = r_cast< BlobPackKey* >(req->hdr_buf_.bytes());
+    pack_key->start_blob_id = start_blob_id;
+    pack_key->num_blobs = num_blobs;
+    uint32_t offset{0};
+    for (uint32_t i = 0; i < num_blobs; ++i) {
+        auto const size = add_packed_blob_record(buf + offset, blobs[i].blob, shard.id, start_blob_id + i);
+        pack_key->records[i] = BlobPackKey::Record{offset, size};
+        offset += size;
+    }
+    sisl::sg_list sgs;
+    sgs.size = sisl::round_up(offset, dev_block_size);
+    sgs.iovs.emplace_back(iovec{.iov_base = buf, .iov_len = sgs.size});
+
+    std::vector< std::optional< BlobDataCache::epoch_t > > cache_epochs;
+    cache_epochs.reserve(num_blobs);
+    for (uint32_t i = 0; i < num_blobs; ++i) {
+        cache_epochs.push_back(data_cache_epoch(BlobRoute{shard.id, start_blob_id + i}, blobs[i].blob));
+    }
+
+    repl_dev->async_alloc_write(header, sisl::blob{req->hdr_buf_.bytes(), BlobPackKey::size(num_blobs)}, sgs, req);
+    // Nobody waits on the write itself, the puts of the pack complete through their promises.
+    req->result()
+        .via(executor_)
+        .thenValue([this, shard_id = shard.id, start_blob_id, pack_buf = std::move(pack_buf),
+                    cache_epochs = std::move(cache_epochs), blobs = std::move(blobs)](auto&& result) mutable {
+            IOBufPool::free(pack_buf);
+            if (result.hasError()) {
+                for (auto& pending : blobs) {
+                    pending.promise.setValue(folly::makeUnexpected(result.error()));
+                }
+                return;
+            }
+            for (size_t i = 0; i < blobs.size(); ++i) {
+                auto const blob_id = start_blob_id + i;
+                LOGTRACEMOD(blobmgr, "Put packed blob success shard {} blob {} pbas {}", shard_id, blob_id,
+                            result.value()[i].pbas.to_string());
+                if (cache_epochs[i]) {
+                    add_to_data_cache(BlobRoute{shard_id, blob_id}, std::move(blobs[i].blob), *cache_epochs[i]);
+                }
+                blobs[i].promise.setValue(blob_id);
+            }
+        });
+}
+
+// A budget of 0 has no limit. With nothing in flight a put goes through whatever its size, so none is refused forever.
+static bool within_budget(uint64_t in_flight, uint64_t added, uint64_t limit) {
+    return limit == 0 || in_flight == 0 || in_flight + added <= limit;
+}
+
+bool HSHomeObject::admit_put(HS_PG& pg, uint32_t ops, uint64_t bytes) {
+    auto const pg_ops = pg.inflight_puts_.fetch_add(ops, std::memory_order_relaxed);
+    auto const pg_bytes = pg.inflight_put_bytes_.fetch_add(bytes, std::memory_order_relaxed);
+    auto const node_ops = inflight_puts_.fetch_add(ops, std::memory_order_relaxed);
+    auto const node_bytes = inflight_put_bytes_.fetch_add(bytes, std::memory_order_relaxed);
+    if (within_budget(pg_ops, ops, HS_BACKEND_DYNAMIC_CONFIG(pg_put_max_inflight_ops)) &&
+        within_budget(pg_bytes, bytes, HS_BACKEND_DYNAMIC_CONFIG(pg_put_max_inflight_bytes)) &&
+        within_budget(node_ops, ops, HS_BACKEND_DYNAMIC_CONFIG(put_max_inflight_ops)) &&
+        within_budget(node_bytes, bytes, HS_BACKEND_DYNAMIC_CONFIG(put_max_inflight_bytes))) {
+        GAUGE_UPDATE(metrics_, inflight_puts, node_ops + ops);
+        GAUGE_UPDATE(metrics_, inflight_put_bytes, node_bytes + bytes);
+        return true;
+    }
+    release_put(pg, ops, bytes);
+    COUNTER_INCREMENT(metrics_, put_retry_later_count, ops);
+    LOGW_RATE_LIMITED("Put of {} blobs with {} bytes to pg {} over budget, pg {} puts {} bytes, node {} puts {} bytes",
+                      ops, bytes, pg.pg_info_.id, pg_ops, pg_bytes, node_ops, node_bytes);
+    return false;
+}
+
+void HSHomeObject::release_put(HS_PG& pg, uint32_t ops, uint64_t bytes) {
+    pg.inflight_puts_.fetch_sub(ops, std::memory_order_relaxed);
+    pg.inflight_put_bytes_.fetch_sub(bytes, std::memory_order_relaxed);
+    auto const node_ops = inflight_puts_.fetch_sub(ops, std::memory_order_relaxed) - ops;
+    auto const node_bytes = inflight_put_bytes_.fetch_sub(bytes, std::memory_order_relaxed) - bytes;
+    GAUGE_UPDATE(metrics_, inflight_puts, node_ops);
+    GAUGE_UPDATE(metrics_, inflight_put_bytes, node_bytes);
+}
 
-        hs_pg->cache_pg_sb_->blob_sequence_num = hs_pg->blob_sequence_num_.load();
-        auto cur_cp = homestore::HomeStore::instance()->cp_mgr().cp_guard();
-        auto cp_ctx = s_cast< HomeObjCPContext* >(cur_cp->context(homestore::cp_consumer_t::HS_CLIENT));
-        cp_ctx->add_pg_to_dirty_list(hs_pg->cache_pg_sb_);
+blob_id_t HSHomeObject::_new_blob_id(ShardInfo const& shard) {
+    auto hs_pg = static_cast< HS_PG* >(_get_pg(shard.placement_group));
+    RELEASE_ASSERT(hs_pg != nullptr, "PG not found");
+    auto const new_blob_id = hs_pg->blob_sequence_num_.fetch_add(1, std::memory_order_relaxed);
+    hs_pg->mark_dirty();
+    RELEASE_ASSERT(new_blob_id < stream_blob_bit, "exhausted all available blob ids");
+    return new_blob_id;
+}
 
-        RELEASE_ASSERT(new_blob_id < std::numeric_limits< decltype(new_blob_id) >::max(),
-                       "exhausted all available blob ids");
+BlobManager::AsyncResult< blob_id_t > HSHomeObject::_put_blob(ShardInfo const& shard, Blob&& blob) {
+    auto const bytes = blob.body.size() + blob.user_key.size();
+    auto hs_pg = static_cast< HS_PG* >(_get_pg(shard.placement_group));
+    RELEASE_ASSERT(hs_pg != nullptr, "PG not found");
+    if (blob_packer_ && bytes <= HS_BACKEND_DYNAMIC_CONFIG(blob_pack_max_blob_size)) {
+        if (!admit_put(*hs_pg, 1, bytes)) { return folly::makeUnexpected(BlobError::RETRY_LATER); }
+        auto const start_time = HomeObjectMetrics::clock::now();
+        COUNTER_INCREMENT(metrics_, put_blob_bytes, bytes);
+        return blob_packer_->add(shard, std::move(blob)).deferValue([this, hs_pg, bytes, start_time](auto&& r) {
+            release_put(*hs_pg, 1, bytes);
+            HISTOGRAM_OBSERVE(metrics_, put_blob_latency, HomeObjectMetrics::elapsed_us(start_time));
+            return std::move(r);
+        });
+    }
+    if (hs_pg->dedup_table_ && blob.body.size() >= HS_BACKEND_DYNAMIC_CONFIG(blob_dedup_min_size)) {
+        return put_blob_dedup(shard, std::move(blob));
+    }
+    return _put_blob_with_id(shard, _new_blob_id(shard), std::move(blob));
+}
+
+BlobManager::AsyncResult< blob_id_t > HSHomeObject::_put_blob_with_id(ShardInfo const& shard, blob_id_t new_blob_id,
+                                                                      Blob&& blob) {
+    auto hs_pg = static_cast< HS_PG* >(_get_pg(shard.placement_group));
+    RELEASE_ASSERT(hs_pg != nullptr, "PG not found");
+    // Refused before any buffer is taken for it.
+    if (!admit_put(*hs_pg, 1, blob.body.size() + blob.user_key.size())) {
+        return folly::makeUnexpected(BlobError::RETRY_LATER);
+    }
+    return write_admitted_blob(shard, new_blob_id, std::move(blob));
+}
+
+BlobManager::AsyncResult< blob_id_t > HSHomeObject::write_admitted_blob(ShardInfo const& shard, blob_id_t new_blob_id,
+                                                                        Blob&& blob) {
+    auto const start_time = HomeObjectMetrics::clock::now();
+    auto const bytes = blob.body.size() + blob.user_key.size();
+    auto& pg_id = shard.placement_group;
+    shared< homestore::ReplDev > repl_dev;
+    HS_PG* hs_pg{nullptr};
+    {
+        auto iter = _pg_map.find(pg_id);
+        RELEASE_ASSERT(iter != _pg_map.cend(), "PG not found");
+        hs_pg = static_cast< HS_PG* >(iter->second.get());
+        repl_dev = hs_pg->repl_dev_;
     }
+    COUNTER_INCREMENT(metrics_, put_blob_bytes, bytes);
 
     RELEASE_ASSERT(repl_dev != nullptr, "Repl dev instance null");
 
@@ -46,99 +496,120 @@ BlobManager::AsyncResult< blob_id_t > HSHomeObject::_put_blob(ShardInfo const& s
     header->pg_id = pg_id;
     header->header_crc = header->calculate_crc();
 
-    auto dev_block_size = repl_dev->get_blk_size();
-    bool blob_copied = false, user_key_copied = false;
     sisl::sg_list sgs;
     sgs.size = 0;
+    IOBufPool::BufList bufs;
+    add_blob_payload(sgs, bufs, blob, shard.id, new_blob_id, repl_dev->get_blk_size());
 
-    // Create blob header.
-    auto blob_header_size = sisl::round_up(sizeof(BlobHeader), io_align);
-    auto blob_header = r_cast< BlobHeader* >(iomanager.iobuf_alloc(io_align, blob_header_size));
-    blob_header->magic = BlobHeader::blob_header_magic;
-    blob_header->version = BlobHeader::blob_header_version;
-    blob_header->shard_id = shard.id;
-    blob_header->blob_id = new_blob_id;
-    blob_header->hash_algorithm = BlobHeader::HashAlgorithm::CRC32;
-    blob_header->blob_size = blob.body.size();
-    blob_header->user_key_size = blob.user_key.size();
-    blob_header->object_offset = blob.object_off;
-    sgs.iovs.emplace_back(iovec{.iov_base = blob_header, .iov_len = blob_header_size});
-    sgs.size += blob_header_size;
+    // serialize blob_id as key
+    auto key_blob = sisl::blob(bufs.emplace_back(IOBufPool::alloc(sizeof(blob_id_t))).bytes, sizeof(blob_id_t));
+    *(reinterpret_cast< blob_id_t* >(key_blob.bytes())) = new_blob_id;
 
-    // Append blob bytes.
-    auto blob_bytes = blob.body.bytes();
-    auto blob_size = blob.body.size();
-    if ((reinterpret_cast< uintptr_t >(blob.body.cbytes()) % io_align != 0) || (blob_size % io_align != 0)) {
-        // If address or size is not aligned, align it and create a separate buffer
-        // and do expensive memcpy.
-        blob_size = sisl::round_up(blob_size, io_align);
-        blob_bytes = iomanager.iobuf_alloc(io_align, blob_size);
-        std::memcpy(blob_bytes, blob.body.cbytes(), blob.body.size());
-        blob_copied = true;
-    }
+    // Small blobs are moved into the data cache once written. The epoch is taken before the write so a delete of
+    // the blob committing before the put returns keeps it out of the cache.
+    auto const route = BlobRoute{shard.id, new_blob_id};
+    auto const cache_epoch = data_cache_epoch(route, blob);
 
-    sgs.iovs.emplace_back(iovec{.iov_base = blob_bytes, .iov_len = blob_size});
-    sgs.size += blob_size;
+    repl_dev->async_alloc_write(req->hdr_buf_, key_blob, sgs, req);
+    return req->result().deferValue(
+        [this, header, route, cache_epoch, start_time, hs_pg, bytes, blob = std::move(blob),
+         bufs = std::move(bufs)](const auto& result) mutable -> BlobManager::AsyncResult< blob_id_t > {
+            header->~ReplicationMessageHeader();
+            IOBufPool::free(bufs);
+            release_put(*hs_pg, 1, bytes);
+            HISTOGRAM_OBSERVE(metrics_, put_blob_latency, HomeObjectMetrics::elapsed_us(start_time));
 
-    // Append metadata if present and update the offsets and total size.
-    size_t user_key_size = 0;
-    uint8_t* user_key_bytes = nullptr;
-    if (!blob.user_key.empty()) {
-        user_key_size = blob.user_key.size();
-        user_key_bytes = r_cast< uint8_t* >(blob.user_key.data());
-        if ((reinterpret_cast< uintptr_t >(user_key_bytes) % io_align != 0) || (user_key_size % io_align != 0)) {
-            // If address or size is not aligned, create a separate buffer and do expensive memcpy.
-            user_key_size = sisl::round_up(user_key_size, io_align);
-            user_key_bytes = r_cast< uint8_t* >(iomanager.iobuf_alloc(io_align, user_key_size));
-            std::memcpy(user_key_bytes, blob.user_key.data(), blob.user_key.size());
-            user_key_copied = true;
-        }
+            if (result.hasError()) { return folly::makeUnexpected(result.error()); }
+            auto blob_info = result.value();
+            LOGTRACEMOD(blobmgr, "Put blob success shard {} blob {} pbas {}", blob_info.shard_id, blob_info.blob_id,
+                        blob_info.pbas.to_string());
+            if (cache_epoch) { add_to_data_cache(route, std::move(blob), *cache_epoch); }
 
-        sgs.iovs.emplace_back(iovec{.iov_base = user_key_bytes, .iov_len = user_key_size});
-        sgs.size += user_key_size;
-        // Set offset of user meta data is after blob bytes.
-        blob_header->user_key_offset = blob_size;
+            return blob_info.blob_id;
+        });
+}
+
+BlobManager::AsyncResult< std::vector< blob_id_t > > HSHomeObject::_put_blob_batch(ShardInfo const& shard,
+                                                                                   std::vector< Blob >&& blobs) {
+    auto& pg_id = shard.placement_group;
+    auto const num_blobs = static_cast< uint32_t >(blobs.size());
+    uint64_t bytes{0};
+    for (auto const& blob : blobs) {
+        bytes += blob.body.size() + blob.user_key.size();
     }
+    shared< homestore::ReplDev > repl_dev;
+    blob_id_t start_blob_id;
+    HS_PG* hs_pg{nullptr};
+    {
+        auto iter = _pg_map.find(pg_id);
+        RELEASE_ASSERT(iter != _pg_map.cend(), "PG not found");
+        hs_pg = static_cast< HS_PG* >(iter->second.get());
+        if (!admit_put(*hs_pg, num_blobs, bytes)) { return folly::makeUnexpected(BlobError::RETRY_LATER); }
+        repl_dev = hs_pg->repl_dev_;
+        start_blob_id = hs_pg->blob_sequence_num_.fetch_add(num_blobs, std::memory_order_relaxed);
 
-    // Check if any padding of zeroes needs to be added to be aligned to device block size.
-    auto pad_len = sisl::round_up(sgs.size, dev_block_size) - sgs.size;
-    uint8_t* pad_zeroes = nullptr;
-    if (pad_len != 0) {
-        // TODO reuse a single pad zero buffer of len dev_block_size
-        pad_zeroes = r_cast< uint8_t* >(iomanager.iobuf_alloc(io_align, pad_len));
-        std::memset(pad_zeroes, 0, pad_len);
-        sgs.iovs.emplace_back(iovec{.iov_base = pad_zeroes, .iov_len = pad_len});
-        sgs.size += pad_len;
+        hs_pg->mark_dirty();
+
+        RELEASE_ASSERT(start_blob_id < stream_blob_bit - num_blobs, "exhausted all available blob ids");
     }
 
-    // Compute the checksum of blob and metadata.
-    compute_blob_payload_hash(blob_header->hash_algorithm, blob.body.cbytes(), blob.body.size(),
-                              (uint8_t*)blob.user_key.data(), blob.user_key.size(), blob_header->hash,
-                              BlobHeader::blob_max_hash_len);
+    RELEASE_ASSERT(repl_dev != nullptr, "Repl dev instance null");
 
-    // serialize blob_id as key
-    auto key_blob = sisl::blob(iomanager.iobuf_alloc(sizeof(blob_id_t), io_align), sizeof(blob_id_t));
-    *(reinterpret_cast< blob_id_t* >(key_blob.bytes())) = new_blob_id;
-    // TODO: too many captures in a lambda is not good for performance, find a way to move all the captures to a context
-    // struct
-    repl_dev->async_alloc_write(req->hdr_buf_, key_blob, sgs, req);
-    return req->result().deferValue([this, header, blob_header, blob = std::move(blob), blob_bytes, blob_copied,
-                                     user_key_bytes, user_key_copied, pad_zeroes,
-                                     key_blob](const auto& result) -> BlobManager::AsyncResult< blob_id_t > {
-        header->~ReplicationMessageHeader();
-        iomanager.iobuf_free(r_cast< uint8_t* >(blob_header));
-        if (blob_copied) { iomanager.iobuf_free(blob_bytes); }
-        if (user_key_copied) { iomanager.iobuf_free(r_cast< uint8_t* >(user_key_bytes)); }
-        if (pad_zeroes) { iomanager.iobuf_free(r_cast< uint8_t* >(pad_zeroes)); }
-        iomanager.iobuf_free(r_cast< uint8_t* >(const_cast< uint8_t* >(key_blob.cbytes())));
+    auto req = repl_result_ctx< BlobManager::Result< std::vector< BlobInfo > > >::make(BlobBatchKey::size(num_blobs),
+                                                                                      io_align);
+    req->header_.msg_type = ReplicationMessageType::PUT_BLOB_BATCH_MSG;
+    req->header_.payload_size = 0;
+    req->header_.payload_crc = 0;
+    req->header_.shard_id = shard.id;
+    req->header_.pg_id = pg_id;
+    req->header_.seal();
+    sisl::blob header;
+    header.set_bytes(r_cast< uint8_t* >(&req->header_));
+    header.set_size(sizeof(req->header_));
 
-        if (result.hasError()) { return folly::makeUnexpected(result.error()); }
-        auto blob_info = result.value();
-        LOGTRACEMOD(blobmgr, "Put blob success shard {} blob {} pbas {}", blob_info.shard_id, blob_info.blob_id,
-                    blob_info.pbas.to_string());
+    // Each blob is laid out exactly like a single put and aligned to the device block size, so the blocks allocated
+    // for the whole batch can be split back into per blob blkids on commit.
+    auto const dev_block_size = repl_dev->get_blk_size();
+    sisl::sg_list sgs;
+    sgs.size = 0;
+    IOBufPool::BufList bufs;
+    auto batch_key = r_cast< BlobBatchKey* >(req->hdr_buf_.bytes());
+    batch_key->start_blob_id = start_blob_id;
+    batch_key->num_blobs = num_blobs;
+    for (uint32_t i = 0; i < num_blobs; ++i) {
+        auto const payload_size = add_blob_payload(sgs, bufs, blobs[i], shard.id, start_blob_id + i, dev_block_size);
+        batch_key->blk_counts[i] = payload_size / dev_block_size;
+        COUNTER_INCREMENT(metrics_, put_blob_bytes, blobs[i].body.size() + blobs[i].user_key.size());
+    }
 
-        return blob_info.blob_id;
-    });
+    std::vector< std::optional< BlobDataCache::epoch_t > > cache_epochs;
+    cache_epochs.reserve(num_blobs);
+    for (uint32_t i = 0; i < num_blobs; ++i) {
+        cache_epochs.push_back(data_cache_epoch(BlobRoute{shard.id, start_blob_id + i}, blobs[i]));
+    }
+
+    repl_dev->async_alloc_write(header, sisl::blob{req->hdr_buf_.bytes(), BlobBatchKey::size(num_blobs)}, sgs, req);
+    return req->result().deferValue(
+        [this, shard_id = shard.id, start_blob_id, hs_pg, num_blobs, bytes, cache_epochs = std::move(cache_epochs),
+         blobs = std::move(blobs),
+         bufs = std::move(bufs)](const auto& result) mutable -> BlobManager::AsyncResult< std::vector< blob_id_t > > {
+            IOBufPool::free(bufs);
+            release_put(*hs_pg, num_blobs, bytes);
+
+            if (result.hasError()) { return folly::makeUnexpected(result.error()); }
+            for (size_t i = 0; i < blobs.size(); ++i) {
+                if (!cache_epochs[i]) { continue; }
+                add_to_data_cache(BlobRoute{shard_id, start_blob_id + i}, std::move(blobs[i]), *cache_epochs[i]);
+            }
+            auto blob_ids = std::vector< blob_id_t >();
+            blob_ids.reserve(result.value().size());
+            for (auto const& blob_info : result.value()) {
+                LOGTRACEMOD(blobmgr, "Put blob success shard {} blob {} pbas {}", blob_info.shard_id,
+                            blob_info.blob_id, blob_info.pbas.to_string());
+                blob_ids.push_back(blob_info.blob_id);
+            }
+            return blob_ids;
+        });
 }
 
 void HSHomeObject::on_blob_put_commit(int64_t lsn, sisl::blob const& header, sisl::blob const& key,
@@ -149,6 +620,9 @@ void HSHomeObject::on_blob_put_commit(int64_t lsn, sisl::blob const& header, sis
         ctx = boost::static_pointer_cast< repl_result_ctx< BlobManager::Result< BlobInfo > > >(hs_ctx).get();
     }
 
+    auto const commit_time = HomeObjectMetrics::clock::now();
+    if (ctx) { HISTOGRAM_OBSERVE(metrics_, blob_alloc_write_latency, HomeObjectMetrics::elapsed_us(ctx->start_time_)); }
+
     auto msg_header = r_cast< ReplicationMessageHeader* >(const_cast< uint8_t* >(header.cbytes()));
     if (msg_header->corrupted()) {
         LOGE("replication message header is corrupted with crc error, lsn:{}", lsn);
@@ -157,21 +631,17 @@ void HSHomeObject::on_blob_put_commit(int64_t lsn, sisl::blob const& header, sis
     }
 
     auto const blob_id = *(reinterpret_cast< blob_id_t* >(const_cast< uint8_t* >(key.cbytes())));
-    shared< BlobIndexTable > index_table;
+    shared< BlobIndexQueue > index_queue;
+    HS_PG* hs_pg{nullptr};
     {
-        std::shared_lock lock_guard(_pg_lock);
         auto iter = _pg_map.find(msg_header->pg_id);
-        RELEASE_ASSERT(iter != _pg_map.end(), "PG not found");
-        auto hs_pg = static_cast< HS_PG* >(iter->second.get());
-        index_table = hs_pg->index_table_;
-        RELEASE_ASSERT(index_table != nullptr, "Index table not intialized");
-        if (hs_pg->blob_sequence_num_.load() <= blob_id) {
-            hs_pg->blob_sequence_num_.store(blob_id + 1);
-            hs_pg->cache_pg_sb_->blob_sequence_num = hs_pg->blob_sequence_num_.load();
-
-            auto cur_cp = homestore::HomeStore::instance()->cp_mgr().cp_guard();
-            auto cp_ctx = s_cast< HomeObjCPContext* >(cur_cp->context(homestore::cp_consumer_t::HS_CLIENT));
-            cp_ctx->add_pg_to_dirty_list(hs_pg->cache_pg_sb_);
+        RELEASE_ASSERT(iter != _pg_map.cend(), "PG not found");
+        hs_pg = static_cast< HS_PG* >(iter->second.get());
+        RELEASE_ASSERT(hs_pg->index_table_ != nullptr, "Index table not intialized");
+        index_queue = hs_pg->index_queue_;
+        if (auto const sequence = blob_sequence_of(blob_id); hs_pg->blob_sequence_num_.load() <= sequence) {
+            hs_pg->blob_sequence_num_.store(sequence + 1);
+            hs_pg->mark_dirty();
         }
     }
 
@@ -180,40 +650,612 @@ void HSHomeObject::on_blob_put_commit(int64_t lsn, sisl::blob const& header, sis
     blob_info.blob_id = blob_id;
     blob_info.pbas = pbas;
 
-    // Write to index table with key {shard id, blob id } and value {pba}.
-    auto r = add_to_index_table(index_table, blob_info);
-    if (r.hasError()) {
-        LOGE("Failed to insert into index table for blob {} err {}", lsn, r.error());
-        if (ctx) { ctx->promise_.setValue(folly::makeUnexpected(r.error())); }
+    // Write to index table with key {shard id, blob id } and value {pba}. The put is applied by the index queue of
+    // the PG, the request holds on to hs_ctx until the result is set.
+    std::vector< BlobIndexQueue::put_t > puts{{BlobRoute{blob_info.shard_id, blob_info.blob_id}, blob_info.pbas}};
+    index_queue->enqueue(std::move(puts), [this, hs_pg, ctx, req = hs_ctx, blob_info, lsn,
+                                           commit_time](BlobManager::NullResult r) {
+        HISTOGRAM_OBSERVE(metrics_, blob_commit_latency, HomeObjectMetrics::elapsed_us(commit_time));
+        // Ahead of the state machine, so the read token taken once the put returns covers it.
+        hs_pg->advance_applied_lsn(lsn);
+        if (r.hasError()) {
+            LOGE("Failed to insert into index table for blob {} err {}", lsn, r.error());
+            if (ctx) { ctx->promise_.setValue(folly::makeUnexpected(r.error())); }
+            return;
+        }
+        if (ctx) { ctx->promise_.setValue(BlobManager::Result< BlobInfo >(blob_info)); }
+    });
+}
+
+homestore::MultiBlkId HSHomeObject::sub_blkids(homestore::MultiBlkId const& blkids, uint32_t blk_offset,
+                                              uint32_t nblks) {
+    homestore::MultiBlkId out;
+    auto it = blkids.iterate();
+    while (auto const b = it.next()) {
+        if (nblks == 0) { break; }
+        uint32_t const count = b->blk_count();
+        if (blk_offset >= count) {
+            blk_offset -= count;
+            continue;
+        }
+        auto const take = std::min(count - blk_offset, nblks);
+        out.add(b->blk_num() + blk_offset, s_cast< homestore::blk_count_t >(take), b->chunk_num());
+        blk_offset = 0;
+        nblks -= take;
+    }
+    RELEASE_ASSERT(nblks == 0, "Requested blocks beyond the end of blkids {}", blkids.to_string());
+    return out;
+}
+
+void HSHomeObject::on_blob_put_batch_commit(int64_t lsn, sisl::blob const& header, sisl::blob const& key,
+                                            const homestore::MultiBlkId& pbas,
+                                            cintrusive< homestore::repl_req_ctx >& hs_ctx) {
+    repl_result_ctx< BlobManager::Result< std::vector< BlobInfo > > >* ctx{nullptr};
+    if (hs_ctx && hs_ctx->is_proposer) {
+        ctx = boost::static_pointer_cast< repl_result_ctx< BlobManager::Result< std::vector< BlobInfo > > > >(hs_ctx)
+                  .get();
+    }
+
+    auto const commit_time = HomeObjectMetrics::clock::now();
+    if (ctx) { HISTOGRAM_OBSERVE(metrics_, blob_alloc_write_latency, HomeObjectMetrics::elapsed_us(ctx->start_time_)); }
+
+    auto msg_header = r_cast< ReplicationMessageHeader* >(const_cast< uint8_t* >(header.cbytes()));
+    if (msg_header->corrupted()) {
+        LOGE("replication message header is corrupted with crc error, lsn:{}", lsn);
+        if (ctx) { ctx->promise_.setValue(folly::makeUnexpected(BlobError::CHECKSUM_MISMATCH)); }
+        return;
+    }
+
+    auto const batch_key = r_cast< const BlobBatchKey* >(key.cbytes());
+    auto const end_blob_id = batch_key->start_blob_id + batch_key->num_blobs;
+    shared< BlobIndexQueue > index_queue;
+    HS_PG* hs_pg{nullptr};
+    {
+        auto iter = _pg_map.find(msg_header->pg_id);
+        RELEASE_ASSERT(iter != _pg_map.cend(), "PG not found");
+        hs_pg = static_cast< HS_PG* >(iter->second.get());
+        RELEASE_ASSERT(hs_pg->index_table_ != nullptr, "Index table not intialized");
+        index_queue = hs_pg->index_queue_;
+        if (hs_pg->blob_sequence_num_.load() < end_blob_id) {
+            hs_pg->blob_sequence_num_.store(end_blob_id);
+            hs_pg->mark_dirty();
+        }
+    }
+
+    std::vector< BlobInfo > blob_infos;
+    blob_infos.reserve(batch_key->num_blobs);
+    uint32_t blk_offset = 0;
+    for (uint32_t i = 0; i < batch_key->num_blobs; ++i) {
+        BlobInfo blob_info;
+        blob_info.shard_id = msg_header->shard_id;
+        blob_info.blob_id = batch_key->start_blob_id + i;
+        blob_info.pbas = sub_blkids(pbas, blk_offset, batch_key->blk_counts[i]);
+        blk_offset += batch_key->blk_counts[i];
+        blob_infos.push_back(std::move(blob_info));
+    }
+
+    std::vector< BlobIndexQueue::put_t > puts;
+    puts.reserve(blob_infos.size());
+    for (auto const& blob_info : blob_infos) {
+        puts.emplace_back(BlobRoute{blob_info.shard_id, blob_info.blob_id}, blob_info.pbas);
+    }
+    index_queue->enqueue(std::move(puts), [this, hs_pg, ctx, req = hs_ctx, blob_infos = std::move(blob_infos), lsn,
+                                           commit_time](BlobManager::NullResult r) mutable {
+        HISTOGRAM_OBSERVE(metrics_, blob_commit_latency, HomeObjectMetrics::elapsed_us(commit_time));
+        hs_pg->advance_applied_lsn(lsn);
+        if (r.hasError()) {
+            LOGE("Failed to insert into index table for blob batch {} err {}", lsn, r.error());
+            if (ctx) { ctx->promise_.setValue(folly::makeUnexpected(r.error())); }
+            return;
+        }
+        if (ctx) { ctx->promise_.setValue(BlobManager::Result< std::vector< BlobInfo > >(std::move(blob_infos))); }
+    });
+}
+
+void HSHomeObject::on_blob_put_pack_commit(int64_t lsn, sisl::blob const& header, sisl::blob const& key,
+                                           const homestore::MultiBlkId& pbas,
+                                           cintrusive< homestore::repl_req_ctx >& hs_ctx) {
+    repl_result_ctx< BlobManager::Result< std::vector< BlobInfo > > >* ctx{nullptr};
+    if (hs_ctx && hs_ctx->is_proposer) {
+        ctx = boost::static_pointer_cast< repl_result_ctx< BlobManager::Result< std::vector< BlobInfo > > > >(hs_ctx)
+                  .get();
+    }
+
+    auto const commit_time = HomeObjectMetrics::clock::now();
+    if (ctx) { HISTOGRAM_OBSERVE(metrics_, blob_alloc_write_latency, HomeObjectMetrics::elapsed_us(ctx->start_time_)); }
+
+    auto msg_header = r_cast< ReplicationMessageHeader* >(const_cast< uint8_t* >(header.cbytes()));
+    if (msg_header->corrupted()) {
+        LOGE("replication message header is corrupted with crc error, lsn:{}", lsn);
+        if (ctx) { ctx->promise_.setValue(folly::makeUnexpected(BlobError::CHECKSUM_MISMATCH)); }
+        return;
+    }
+
+    auto const pack_key = r_cast< const BlobPackKey* >(key.cbytes());
+    auto const end_blob_id = pack_key->start_blob_id + pack_key->num_blobs;
+    shared< BlobIndexQueue > index_queue;
+    HS_PG* hs_pg{nullptr};
+    uint32_t block_size{0};
+    {
+        auto iter = _pg_map.find(msg_header->pg_id);
+        RELEASE_ASSERT(iter != _pg_map.cend(), "PG not found");
+        hs_pg = static_cast< HS_PG* >(iter->second.get());
+        RELEASE_ASSERT(hs_pg->index_table_ != nullptr, "Index table not intialized");
+        index_queue = hs_pg->index_queue_;
+        block_size = hs_pg->repl_dev_->get_blk_size();
+        // The flag is persisted with the blob sequence number, by the CP covering the blobs at the latest.
+        auto const first_pack = !hs_pg->has_packed_blobs_.exchange(true, std::memory_order_acq_rel);
+        if (hs_pg->blob_sequence_num_.load() < end_blob_id) {
+            hs_pg->blob_sequence_num_.store(end_blob_id);
+            hs_pg->mark_dirty();
+        } else if (first_pack) {
+            hs_pg->mark_dirty();
+        }
+    }
+
+    // Each blob points at the blocks its record spans, the first and last of them possibly shared with its
+    // neighbours in the pack.
+    std::vector< BlobInfo > blob_infos;
+    blob_infos.reserve(pack_key->num_blobs);
+    for (uint32_t i = 0; i < pack_key->num_blobs; ++i) {
+        auto const& record = pack_key->records[i];
+        auto const first_blk = record.offset / block_size;
+        auto const end_blk = sisl::round_up(record.offset + record.size, block_size) / block_size;
+        auto const blkids = sub_blkids(pbas, first_blk, end_blk - first_blk);
+        blob_infos.push_back(BlobInfo{msg_header->shard_id, pack_key->start_blob_id + i,
+                                      BlobLocation{blkids, record.offset - first_blk * block_size, record.size}});
+    }
+
+    std::vector< BlobIndexQueue::put_t > puts;
+    puts.reserve(blob_infos.size());
+    for (auto const& blob_info : blob_infos) {
+        puts.emplace_back(BlobRoute{blob_info.shard_id, blob_info.blob_id}, blob_info.pbas);
+    }
+    index_queue->enqueue(std::move(puts), [this, hs_pg, ctx, req = hs_ctx, blob_infos = std::move(blob_infos), lsn,
+                                           commit_time](BlobManager::NullResult r) mutable {
+        HISTOGRAM_OBSERVE(metrics_, blob_commit_latency, HomeObjectMetrics::elapsed_us(commit_time));
+        hs_pg->advance_applied_lsn(lsn);
+        if (r.hasError()) {
+            LOGE("Failed to insert into index table for blob pack {} err {}", lsn, r.error());
+            if (ctx) { ctx->promise_.setValue(folly::makeUnexpected(r.error())); }
+            return;
+        }
+        if (ctx) { ctx->promise_.setValue(BlobManager::Result< std::vector< BlobInfo > >(std::move(blob_infos))); }
+    });
+}
+
+// Content key of a blob for dedup. object_off goes in along with the body and the user key, a blob read back
+// carries it too.
+static BlobDedupKey blob_dedup_key(shard_id_t shard_id, Blob const& blob) {
+    XXH3_state_t state;
+    XXH3_128bits_reset(&state);
+    XXH3_128bits_update(&state, blob.body.cbytes(), blob.body.size());
+    XXH3_128bits_update(&state, blob.user_key.data(), blob.user_key.size());
+    XXH3_128bits_update(&state, &blob.object_off, sizeof(blob.object_off));
+    auto const hash = XXH3_128bits_digest(&state);
+    return BlobDedupKey{shard_id, hash.low64, hash.high64};
+}
+
+BlobManager::AsyncResult< blob_id_t > HSHomeObject::put_blob_dedup(ShardInfo const& shard, Blob&& blob) {
+    auto hs_pg = static_cast< HS_PG* >(_get_pg(shard.placement_group));
+    RELEASE_ASSERT(hs_pg != nullptr, "PG not found");
+    // Admitted before it takes an id and holds on to the body while the candidate is read, the put keeps the slot
+    // until the blob is written or referenced.
+    auto const bytes = blob.body.size() + blob.user_key.size();
+    if (!admit_put(*hs_pg, 1, bytes)) { return folly::makeUnexpected(BlobError::RETRY_LATER); }
+    auto const key = blob_dedup_key(shard.id, blob);
+    auto const new_blob_id = _new_blob_id(shard);
+
+    // A blob written anew is the candidate of its key from then on.
+    auto write_new = [this, hs_pg, shard, key, new_blob_id](Blob&& b) -> BlobManager::AsyncResult< blob_id_t > {
+        return write_admitted_blob(shard, new_blob_id, std::move(b)).deferValue([hs_pg, key](auto&& r) {
+            if (r) { hs_pg->dedup_table_->put(key, r.value()); }
+            return std::move(r);
+        });
+    };
+
+    auto const candidate = hs_pg->dedup_table_->get(key);
+    if (!candidate) { return write_new(std::move(blob)); }
+
+    // The candidate is read back and compared, a colliding key or a candidate deleted since only costs the read.
+    auto const source_blob_id = *candidate;
+    return do_get_blob_view(shard, source_blob_id, 0, 0)
+        .deferValue([this, hs_pg, bytes, shard, new_blob_id, source_blob_id, write_new,
+                     blob = std::move(blob)](auto&& r) mutable -> BlobManager::AsyncResult< blob_id_t > {
+            bool const same = r && r.value().body.size() == blob.body.size() && r.value().user_key == blob.user_key &&
+                r.value().object_off == blob.object_off &&
+                std::memcmp(r.value().body.cbytes(), blob.body.cbytes(), blob.body.size()) == 0;
+            if (!same) {
+                if (r) { COUNTER_INCREMENT(metrics_, blob_dedup_mismatch_count, 1); }
+                return write_new(std::move(blob));
+            }
+            return replicate_dedup_ref(shard, new_blob_id, source_blob_id)
+                .deferValue([this, hs_pg, bytes, write_new,
+                             blob = std::move(blob)](auto&& ref) mutable -> BlobManager::AsyncResult< blob_id_t > {
+                    // The source was deleted before the reference committed, nothing took the new id yet.
+                    if (!ref && ref.error() == BlobError::UNKNOWN_BLOB) { return write_new(std::move(blob)); }
+                    release_put(*hs_pg, 1, bytes);
+                    if (!ref) { return folly::makeUnexpected(ref.error()); }
+                    COUNTER_INCREMENT(metrics_, blob_dedup_hit_count, 1);
+                    COUNTER_INCREMENT(metrics_, blob_dedup_bytes, bytes);
+                    return ref.value();
+                });
+        });
+}
+
+BlobManager::AsyncResult< blob_id_t > HSHomeObject::replicate_dedup_ref(ShardInfo const& shard, blob_id_t new_blob_id,
+                                                                        blob_id_t source_blob_id) {
+    auto const start_time = HomeObjectMetrics::clock::now();
+    auto& pg_id = shard.placement_group;
+    shared< homestore::ReplDev > repl_dev;
+    HS_PG* hs_pg{nullptr};
+    {
+        auto iter = _pg_map.find(pg_id);
+        RELEASE_ASSERT(iter != _pg_map.cend(), "PG not found");
+        hs_pg = static_cast< HS_PG* >(iter->second.get());
+        repl_dev = hs_pg->repl_dev_;
+    }
+    RELEASE_ASSERT(repl_dev != nullptr, "Repl dev instance null");
+
+    auto req = repl_result_ctx< BlobManager::Result< BlobInfo > >::make(sizeof(BlobDedupRefKey), io_align);
+    req->header_.msg_type = ReplicationMessageType::PUT_BLOB_DEDUP_MSG;
+    req->header_.payload_size = 0;
+    req->header_.payload_crc = 0;
+    req->header_.shard_id = shard.id;
+    req->header_.pg_id = pg_id;
+    req->header_.seal();
+    sisl::blob header;
+    header.set_bytes(r_cast< uint8_t* >(&req->header_));
+    header.set_size(sizeof(req->header_));
+
+    auto ref_key = r_cast< BlobDedupRefKey* >(req->hdr_buf_.bytes());
+    ref_key->blob_id = new_blob_id;
+    ref_key->source_blob_id = source_blob_id;
+
+    repl_dev->async_alloc_write(header, req->hdr_buf_, sisl::sg_list{}, req);
+    return req->result().deferValue(
+        [this, start_time](const auto& result) -> BlobManager::Result< blob_id_t > {
+            HISTOGRAM_OBSERVE(metrics_, put_blob_latency, HomeObjectMetrics::elapsed_us(start_time));
+            if (result.hasError()) { return folly::makeUnexpected(result.error()); }
+            auto const& blob_info = result.value();
+            LOGTRACEMOD(blobmgr, "Put blob dedup success shard {} blob {} pbas {}", blob_info.shard_id,
+                        blob_info.blob_id, blob_info.pbas.to_string());
+            return blob_info.blob_id;
+        });
+}
+
+void HSHomeObject::on_blob_put_dedup_commit(int64_t lsn, sisl::blob const& header, sisl::blob const& key,
+                                            cintrusive< homestore::repl_req_ctx >& hs_ctx) {
+    repl_result_ctx< BlobManager::Result< BlobInfo > >* ctx{nullptr};
+    if (hs_ctx && hs_ctx->is_proposer) {
+        ctx = boost::static_pointer_cast< repl_result_ctx< BlobManager::Result< BlobInfo > > >(hs_ctx).get();
+    }
+
+    auto msg_header = r_cast< ReplicationMessageHeader* >(const_cast< uint8_t* >(header.cbytes()));
+    if (msg_header->corrupted()) {
+        LOGE("replication message header is corrupted with crc error, lsn:{}", lsn);
+        if (ctx) { ctx->promise_.setValue(folly::makeUnexpected(BlobError::CHECKSUM_MISMATCH)); }
         return;
     }
 
-    if (ctx) { ctx->promise_.setValue(BlobManager::Result< BlobInfo >(blob_info)); }
+    auto const ref_key = r_cast< const BlobDedupRefKey* >(key.cbytes());
+    shared< BlobIndexTable > index_table;
+    shared< homestore::ReplDev > repl_dev;
+    HS_PG* pg{nullptr};
+    {
+        auto iter = _pg_map.find(msg_header->pg_id);
+        RELEASE_ASSERT(iter != _pg_map.cend(), "PG not found");
+        pg = static_cast< HS_PG* >(iter->second.get());
+        index_table = pg->index_table_;
+        repl_dev = pg->repl_dev_;
+        RELEASE_ASSERT(index_table != nullptr, "Index table not intialized");
+        if (auto const sequence = blob_sequence_of(ref_key->blob_id); pg->blob_sequence_num_.load() <= sequence) {
+            pg->blob_sequence_num_.store(sequence + 1);
+            pg->mark_dirty();
+        }
+    }
+
+    // Applied by the index queue like a delete: the source may still wait in it, and the count of references to its
+    // extent changes along with the new entry, out of the way of GC moving the source and of its deletes.
+    auto blob_info = std::make_shared< BlobInfo >(BlobInfo{msg_header->shard_id, ref_key->blob_id, {}});
+    auto const source_blob_id = ref_key->source_blob_id;
+    pg->index_queue_->enqueue_mutation(
+        [this, pg, repl_dev, blob_info, source_blob_id, lsn]() -> BlobManager::NullResult {
+            std::scoped_lock gc_guard(pg->gc_mtx_);
+            // the reference and the stats it changes are persisted by the same CP;
+            auto cur_cp = homestore::HomeStore::instance()->cp_mgr().cp_guard();
+            auto source = get_blob_from_index_table(*pg, blob_info->shard_id, source_blob_id);
+            if (!source || source.value().packed()) {
+                LOGW("dedup source blob {} of blob {} in shard {} is gone, lsn {}", source_blob_id,
+                     blob_info->blob_id, blob_info->shard_id, lsn);
+                return folly::makeUnexpected(source ? BlobError::UNKNOWN_BLOB : source.error());
+            }
+            blob_info->pbas = source.value();
+            auto inserted = add_dedup_ref_to_index_table(*pg, *blob_info);
+            if (!inserted) {
+                LOGE("Failed to insert into index table for blob {} err {}", lsn, inserted.error());
+                return folly::makeUnexpected(inserted.error());
+            }
+            // a put replayed after restart may already be in the index;
+            if (inserted.value()) {
+                on_blob_added(*pg, blob_info->shard_id, blob_info->blob_id,
+                              blob_info->pbas.bytes(repl_dev->get_blk_size()));
+            }
+            return folly::Unit();
+        },
+        [pg, ctx, req = hs_ctx, blob_info, lsn](BlobManager::NullResult r) {
+            pg->advance_applied_lsn(lsn);
+            if (!ctx) { return; }
+            if (r.hasError()) {
+                ctx->promise_.setValue(folly::makeUnexpected(r.error()));
+                return;
+            }
+            ctx->promise_.setValue(BlobManager::Result< BlobInfo >(*blob_info));
+        });
 }
 
 BlobManager::AsyncResult< Blob > HSHomeObject::_get_blob(ShardInfo const& shard, blob_id_t blob_id, uint64_t req_offset,
                                                          uint64_t req_len) const {
+    return _get_blob_view(shard, blob_id, req_offset, req_len)
+        .deferValue([](auto const& r) -> BlobManager::Result< Blob > {
+            if (!r) { return folly::makeUnexpected(r.error()); }
+            return r.value().clone();
+        });
+}
+
+BlobManager::AsyncResult< BlobView > HSHomeObject::_get_blob_view(ShardInfo const& shard, blob_id_t blob_id,
+                                                                  uint64_t req_offset, uint64_t req_len) const {
+    auto const start_time = HomeObjectMetrics::clock::now();
+    return do_get_blob_view(shard, blob_id, req_offset, req_len)
+        .deferValue([this, start_time](auto&& r) -> BlobManager::Result< BlobView > {
+            HISTOGRAM_OBSERVE(metrics_, get_blob_latency, HomeObjectMetrics::elapsed_us(start_time));
+            if (r) { COUNTER_INCREMENT(metrics_, get_blob_bytes, r.value().body.size() + r.value().user_key.size()); }
+            return std::move(r);
+        });
+}
+
+BlobManager::AsyncResult< BlobView > HSHomeObject::do_get_blob_view(ShardInfo const& shard, blob_id_t blob_id,
+                                                                    uint64_t req_offset, uint64_t req_len) const {
+    auto const route = BlobRoute{shard.id, blob_id};
+    BlobDataCache::epoch_t data_epoch{0};
+    if (data_cache_) {
+        auto view = data_cache_->get(route);
+        if (view) { return slice_blob_view(std::move(*view), req_offset, req_len); }
+        data_epoch = data_cache_->epoch(route);
+    }
+
     auto& pg_id = shard.placement_group;
     shared< BlobIndexTable > index_table;
     shared< homestore::ReplDev > repl_dev;
+    BlobIndexCache* index_cache{nullptr};
+    BlobIndexQueue* index_queue{nullptr};
+    HS_PG const* hs_pg{nullptr};
     {
-        std::shared_lock lock_guard(_pg_lock);
         auto iter = _pg_map.find(pg_id);
-        RELEASE_ASSERT(iter != _pg_map.end(), "PG not found");
-        repl_dev = static_cast< HS_PG* >(iter->second.get())->repl_dev_;
-        index_table = static_cast< HS_PG* >(iter->second.get())->index_table_;
+        RELEASE_ASSERT(iter != _pg_map.cend(), "PG not found");
+        hs_pg = static_cast< HS_PG const* >(iter->second.get());
+        repl_dev = hs_pg->repl_dev_;
+        index_table = hs_pg->index_table_;
+        index_cache = hs_pg->index_cache_.get();
+        index_queue = hs_pg->index_queue_.get();
+    }
+
+    RELEASE_ASSERT(repl_dev != nullptr, "Repl dev instance null");
+    RELEASE_ASSERT(index_table != nullptr, "Index table instance null");
+
+    // Blobs committed but not yet in the index are only found in the index queue.
+    auto cached_blkids = index_queue->get(route);
+    BlobIndexCache::epoch_t cache_epoch{0};
+    if (!cached_blkids && index_cache) {
+        cached_blkids = index_cache->get(route);
+        if (cached_blkids) {
+            COUNTER_INCREMENT(metrics_, blob_index_cache_hit_count, 1);
+        } else {
+            cache_epoch = index_cache->epoch(route);
+        }
+    }
+    if (!cached_blkids) {
+        COUNTER_INCREMENT(metrics_, blob_index_cache_miss_count, 1);
+        auto r = get_blob_from_index_table(*hs_pg, shard.id, blob_id);
+        if (!r) {
+            LOGW_RATE_LIMITED("Blob not found in index [route={}]", route);
+            return folly::makeUnexpected(r.error());
+        }
+        cached_blkids = r.value();
+        if (index_cache) { index_cache->fill(route, r.value(), 1, cache_epoch); }
+    }
+
+    auto multi_blkids = *cached_blkids;
+    auto const block_size = repl_dev->get_blk_size();
+    // Packed blobs are small and are always read whole.
+    if ((req_offset != 0 || req_len != 0) && !multi_blkids.packed() &&
+        (multi_blkids.blk_count() * block_size > partial_read_min_size)) {
+        return read_blob_range(repl_dev, shard.id, blob_id, multi_blkids, req_offset, req_len);
+    }
+    if (!data_cache_) { return read_blob(repl_dev, shard.id, blob_id, multi_blkids, req_offset, req_len); }
+
+    // read_blob reads and verifies the whole blob anyway, so keep all of it in the data cache if it is small enough
+    // and hand out the requested range.
+    auto const read_size = multi_blkids.packed() ? multi_blkids.size : multi_blkids.blk_count() * block_size;
+    return read_blob(repl_dev, shard.id, blob_id, multi_blkids, 0, 0)
+        .deferValue([this, route, data_epoch, read_size, req_offset,
+                     req_len](auto&& r) -> BlobManager::Result< BlobView > {
+            if (!r) { return folly::makeUnexpected(r.error()); }
+            if (r.value().body.size() <= HS_BACKEND_DYNAMIC_CONFIG(blob_data_cache_max_blob_size)) {
+                data_cache_->fill(route, r.value(), read_size, data_epoch);
+            }
+            return slice_blob_view(std::move(r.value()), req_offset, req_len);
+        });
+}
+
+BlobManager::AsyncResult< std::vector< BlobManager::Result< Blob > > >
+HSHomeObject::_get_blob_batch(ShardInfo const& shard, std::vector< blob_id_t > const& blob_ids) const {
+    shared< BlobIndexTable > index_table;
+    shared< homestore::ReplDev > repl_dev;
+    BlobIndexCache* index_cache{nullptr};
+    BlobIndexQueue* index_queue{nullptr};
+    HS_PG const* hs_pg{nullptr};
+    {
+        auto iter = _pg_map.find(shard.placement_group);
+        RELEASE_ASSERT(iter != _pg_map.cend(), "PG not found");
+        hs_pg = static_cast< HS_PG const* >(iter->second.get());
+        repl_dev = hs_pg->repl_dev_;
+        index_table = hs_pg->index_table_;
+        index_cache = hs_pg->index_cache_.get();
+        index_queue = hs_pg->index_queue_.get();
     }
 
     RELEASE_ASSERT(repl_dev != nullptr, "Repl dev instance null");
     RELEASE_ASSERT(index_table != nullptr, "Index table instance null");
 
-    auto r = get_blob_from_index_table(index_table, shard.id, blob_id);
-    if (!r) {
-        LOGW("Blob not found in index [route={}]", BlobRoute{blob_id, shard.id});
-        return folly::makeUnexpected(r.error());
+    // Results are filled in place by index as blobs are found, read and verified.
+    using results_t = std::vector< BlobManager::Result< Blob > >;
+    auto results = std::make_shared< results_t >();
+    results->reserve(blob_ids.size());
+    for (size_t i = 0; i < blob_ids.size(); ++i) {
+        results->push_back(folly::makeUnexpected(BlobError::UNKNOWN_BLOB));
+    }
+
+    // Resolve the blkids from the index queue and the caches first and the rest with one index lookup.
+    struct BlobRead {
+        size_t idx;
+        blob_id_t blob_id;
+        BlobLocation blkids;
+    };
+    std::vector< BlobRead > reads;
+    reads.reserve(blob_ids.size());
+    std::vector< size_t > lookup_idx;
+    std::vector< blob_id_t > lookup_ids;
+    std::vector< BlobIndexCache::epoch_t > lookup_epochs;
+    for (size_t i = 0; i < blob_ids.size(); ++i) {
+        auto const route = BlobRoute{shard.id, blob_ids[i]};
+        if (data_cache_) {
+            if (auto view = data_cache_->get(route); view) {
+                (*results)[i] = view->clone();
+                continue;
+            }
+        }
+        if (auto blkids = index_queue->get(route); blkids) {
+            reads.push_back(BlobRead{i, blob_ids[i], *blkids});
+            continue;
+        }
+        if (index_cache) {
+            if (auto blkids = index_cache->get(route); blkids) {
+                COUNTER_INCREMENT(metrics_, blob_index_cache_hit_count, 1);
+                reads.push_back(BlobRead{i, blob_ids[i], *blkids});
+                continue;
+            }
+            lookup_epochs.push_back(index_cache->epoch(route));
+        }
+        lookup_idx.push_back(i);
+        lookup_ids.push_back(blob_ids[i]);
+    }
+    COUNTER_INCREMENT(metrics_, blob_index_cache_miss_count, lookup_ids.size());
+    auto found = get_blobs_from_index_table(*hs_pg, shard.id, lookup_ids);
+    for (size_t j = 0; j < found.size(); ++j) {
+        if (!found[j]) {
+            (*results)[lookup_idx[j]] = folly::makeUnexpected(found[j].error());
+            continue;
+        }
+        auto const route = BlobRoute{shard.id, lookup_ids[j]};
+        if (index_cache) { index_cache->fill(route, found[j].value(), 1, lookup_epochs[j]); }
+        reads.push_back(BlobRead{lookup_idx[j], lookup_ids[j], found[j].value()});
+    }
+    if (reads.empty()) { return std::move(*results); }
+
+    // Sort by location on the device and merge blobs whose blocks follow each other into a single read. Packed blobs
+    // of the same extent share blocks, so their reads overlap.
+    std::sort(reads.begin(), reads.end(), [](BlobRead const& a, BlobRead const& b) {
+        return std::make_tuple(a.blkids.chunk_num(), a.blkids.blk_num(), a.blkids.offset) <
+            std::make_tuple(b.blkids.chunk_num(), b.blkids.blk_num(), b.blkids.offset);
+    });
+    auto const block_size = repl_dev->get_blk_size();
+    auto const max_merged_blks = std::min(max_merged_read_size / block_size,
+                                          uint64_t(std::numeric_limits< homestore::blk_count_t >::max()));
+    struct ReadGroup {
+        homestore::chunk_num_t chunk_num;
+        homestore::blk_num_t start_blk;
+        homestore::blk_num_t end_blk;
+        std::vector< BlobRead > reads;
+    };
+    std::vector< ReadGroup > groups;
+    for (auto& read : reads) {
+        auto const start_blk = read.blkids.blk_num();
+        auto const end_blk = start_blk + read.blkids.blk_count();
+        if (!groups.empty()) {
+            auto& last = groups.back();
+            if (last.chunk_num == read.blkids.chunk_num() && start_blk <= last.end_blk &&
+                std::max(last.end_blk, end_blk) - last.start_blk <= max_merged_blks) {
+                last.end_blk = std::max(last.end_blk, end_blk);
+                last.reads.push_back(std::move(read));
+                continue;
+            }
+        }
+        groups.push_back(ReadGroup{read.blkids.chunk_num(), start_blk, end_blk, {}});
+        groups.back().reads.push_back(std::move(read));
+    }
+
+    // Issue all the reads at once, each one verified on the compute executor as soon as it completes.
+    std::vector< folly::Future< folly::Unit > > futs;
+    futs.reserve(groups.size());
+    for (auto& group : groups) {
+        auto const nblks = group.end_blk - group.start_blk;
+        auto const total_size = uint64_t(nblks) * block_size;
+        shared< uint8_t > buf(iomanager.iobuf_alloc(block_size, total_size),
+                              [](uint8_t* b) { iomanager.iobuf_free(b); });
+        sisl::sg_list sgs;
+        sgs.size = total_size;
+        sgs.iovs.emplace_back(iovec{.iov_base = buf.get(), .iov_len = total_size});
+        auto const merged =
+            homestore::MultiBlkId{group.start_blk, s_cast< homestore::blk_count_t >(nblks), group.chunk_num};
+        auto const read_time = HomeObjectMetrics::clock::now();
+        futs.push_back(repl_dev->async_read(merged, sgs, total_size)
+                           .via(compute_executor_)
+                           .thenValue([this, shard_id = shard.id, results, buf, block_size, read_time,
+                                       group = std::move(group)](auto&& err) {
+                               HISTOGRAM_OBSERVE(metrics_, blob_read_latency, HomeObjectMetrics::elapsed_us(read_time));
+                               for (auto const& read : group.reads) {
+                                   auto const blob_id = read.blob_id;
+                                   auto const offset =
+                                       uint64_t(read.blkids.blk_num() - group.start_blk) * block_size +
+                                       read.blkids.offset;
+                                   if (err) {
+                                       LOGE_RATE_LIMITED("Failed to read blob {} shard {} err {}", blob_id, shard_id,
+                                                         err.value());
+                                       (*results)[read.idx] = folly::makeUnexpected(BlobError::READ_FAILED);
+                                   } else if (auto v = verify_blob(buf, buf.get() + offset, shard_id, blob_id); !v) {
+                                       (*results)[read.idx] = folly::makeUnexpected(v.error());
+                                   } else {
+                                       (*results)[read.idx] = v.value().clone();
+                                   }
+                               }
+                           }));
+    }
+    return folly::collectAll(std::move(futs)).deferValue([results](auto&&) -> BlobManager::Result< results_t > {
+        return std::move(*results);
+    });
+}
+
+BlobManager::Result< HSHomeObject::BlobHeader const* >
+HSHomeObject::verify_blob_header(uint8_t const* buf, shard_id_t shard_id, blob_id_t blob_id) const {
+    auto const b_route = BlobRoute{shard_id, blob_id};
+    auto header = r_cast< BlobHeader* >(const_cast< uint8_t* >(buf));
+    if (!header->valid()) {
+        LOGE_RATE_LIMITED("Invalid header found for [route={}] [header={}]", b_route, header->to_string());
+        return folly::makeUnexpected(BlobError::READ_FAILED);
     }
 
-    auto multi_blkids = r.value();
+    if (header->shard_id != shard_id) {
+        LOGE_RATE_LIMITED("Invalid shard id found in header for [route={}] [header={}]", b_route, header->to_string());
+        return folly::makeUnexpected(BlobError::READ_FAILED);
+    }
+    return header;
+}
+
+BlobManager::AsyncResult< BlobView > HSHomeObject::read_blob(shared< homestore::ReplDev > repl_dev,
+                                                             shard_id_t shard_id, blob_id_t blob_id,
+                                                             BlobLocation const& multi_blkids,
+                                                             uint64_t req_offset, uint64_t req_len) const {
     auto block_size = repl_dev->get_blk_size();
     sisl::sg_list sgs;
     auto total_size = multi_blkids.blk_count() * block_size;
@@ -222,68 +1264,250 @@ BlobManager::AsyncResult< Blob > HSHomeObject::_get_blob(ShardInfo const& shard,
     sgs.size = total_size;
     sgs.iovs.emplace_back(iovec{.iov_base = iov_base.get(), .iov_len = total_size});
 
+    auto const read_time = HomeObjectMetrics::clock::now();
     return repl_dev->async_read(multi_blkids, sgs, total_size)
-        .thenValue([this, blob_id, req_len, req_offset, shard, multi_blkids,
-                    iov_base](auto&& result) mutable -> BlobManager::AsyncResult< Blob > {
+        .via(compute_executor_)
+        .thenValue([this, blob_id, req_len, req_offset, shard_id, multi_blkids, iov_base,
+                    read_time](auto&& result) mutable -> BlobManager::AsyncResult< BlobView > {
+            HISTOGRAM_OBSERVE(metrics_, blob_read_latency, HomeObjectMetrics::elapsed_us(read_time));
             if (result) {
-                LOGE("Failed to read blob {} shard {} err {}", blob_id, shard.id, result.value());
+                LOGE_RATE_LIMITED("Failed to read blob {} shard {} err {}", blob_id, shard_id, result.value());
                 return folly::makeUnexpected(BlobError::READ_FAILED);
             }
 
-            auto const b_route = BlobRoute{blob_id, shard.id};
-            BlobHeader* header = (BlobHeader*)iov_base.get();
-            if (!header->valid()) {
-                LOGE("Invalid header found for [route={}] [header={}]", b_route, header->to_string());
-                return folly::makeUnexpected(BlobError::READ_FAILED);
-            }
+            // A packed blob starts at its offset into its first block.
+            auto v = verify_blob(iov_base, iov_base.get() + multi_blkids.offset, shard_id, blob_id);
+            if (!v) { return folly::makeUnexpected(v.error()); }
 
-            if (header->shard_id != shard.id) {
-                LOGE("Invalid shard id found in header for [route={}] [header={}]", b_route, header->to_string());
-                return folly::makeUnexpected(BlobError::READ_FAILED);
-            }
+            LOGTRACEMOD(blobmgr, "Blob get success for blob {} shard {} blkid {}", blob_id, shard_id,
+                        multi_blkids.to_string());
+            return slice_blob_view(std::move(v.value()), req_offset, req_len);
+        });
+}
+
+BlobManager::Result< BlobView > HSHomeObject::verify_blob(std::shared_ptr< const void > holder, uint8_t const* buf,
+                                                          shard_id_t shard_id, blob_id_t blob_id) const {
+    auto const b_route = BlobRoute{shard_id, blob_id};
+    auto h = verify_blob_header(buf, shard_id, blob_id);
+    if (!h) { return folly::makeUnexpected(h.error()); }
+    auto header = const_cast< BlobHeader* >(h.value());
 
-            // Metadata start offset is just after blob.
-            size_t blob_size = header->blob_size;
-            auto blob_header_size = sisl::round_up(sizeof(BlobHeader), io_align);
-            uint8_t* blob_bytes = (uint8_t*)iov_base.get() + blob_header_size;
-            uint8_t* user_key_bytes = nullptr;
-            size_t user_key_size = 0;
-            if (header->user_key_offset != 0) {
-                user_key_bytes = blob_bytes + header->user_key_offset;
-                user_key_size = header->user_key_size;
+    // Metadata is just after the blob, or just after the header from v3 if it fit.
+    size_t blob_size = header->blob_size;
+    uint8_t* blob_bytes = const_cast< uint8_t* >(buf) + header->data_start();
+    uint8_t* user_key_bytes = nullptr;
+    size_t user_key_size = 0;
+    if (header->user_key_size != 0) {
+        user_key_bytes = const_cast< uint8_t* >(buf) + header->user_key_start();
+        user_key_size = header->user_key_size;
+    }
+
+    uint8_t computed_hash[BlobHeader::blob_max_hash_len]{};
+    compute_blob_payload_hash(header->hash_algorithm, blob_bytes, header->data_size(), user_key_bytes, user_key_size,
+                              computed_hash, BlobHeader::blob_max_hash_len);
+    if (std::memcmp(computed_hash, header->hash, BlobHeader::blob_max_hash_len) != 0) {
+        LOGE_RATE_LIMITED("Hash mismatch for [route={}] [header={}] [computed={}]", b_route, header->to_string(),
+                          spdlog::to_hex(computed_hash, computed_hash + BlobHeader::blob_max_hash_len));
+        COUNTER_INCREMENT(metrics_, blob_checksum_mismatch_count, 1);
+        return folly::makeUnexpected(BlobError::CHECKSUM_MISMATCH);
+    }
+
+    if (header->compressed()) {
+        // The view keeps the read buffer alive for the user key along with the decompressed body.
+        auto body = std::make_shared_for_overwrite< uint8_t[] >(blob_size);
+        auto const num_frames = std::max(header->num_segments, 1u);
+        if (!decompress_blob_frames(header, blob_bytes, 0, num_frames - 1, body.get())) {
+            LOGE_RATE_LIMITED("Failed to decompress [route={}] [header={}]", b_route, header->to_string());
+            return folly::makeUnexpected(BlobError::READ_FAILED);
+        }
+        blob_bytes = body.get();
+        holder = std::make_shared< std::pair< std::shared_ptr< const void >, std::shared_ptr< uint8_t[] > > >(
+            std::move(holder), std::move(body));
+    }
+
+    return BlobView{.holder = std::move(holder),
+                    .body = sisl::blob{blob_bytes, s_cast< uint32_t >(blob_size)},
+                    .user_key = std::string_view{r_cast< const char* >(user_key_bytes), user_key_size},
+                    .object_off = header->object_offset};
+}
+
+BlobManager::AsyncResult< BlobView >
+HSHomeObject::read_blob_range(shared< homestore::ReplDev > repl_dev, shard_id_t shard_id, blob_id_t blob_id,
+                              homestore::MultiBlkId const& multi_blkids, uint64_t req_offset, uint64_t req_len) const {
+    // The checksum table can not be larger than what a blob filling all the blocks would need, so read that much of
+    // the head of the blob to get the header and the table in a single I/O.
+    auto const block_size = repl_dev->get_blk_size();
+    auto const total_blks = multi_blkids.blk_count();
+    auto const max_segments = BlobHeader::num_segments_for(total_blks * block_size);
+    auto const max_header_size = sizeof(BlobHeader) + (max_segments + 1) * sizeof(uint32_t);
+    auto const header_blks =
+        std::min< uint32_t >(sisl::round_up(max_header_size, block_size) / block_size, total_blks);
+    auto const header_size = header_blks * block_size;
+    shared< uint8_t > header_buf(iomanager.iobuf_alloc(block_size, header_size),
+                                 [](uint8_t* buf) { iomanager.iobuf_free(buf); });
+    sisl::sg_list sgs;
+    sgs.size = header_size;
+    sgs.iovs.emplace_back(iovec{.iov_base = header_buf.get(), .iov_len = header_size});
+
+    auto const header_blkids = sub_blkids(multi_blkids, 0, header_blks);
+    return repl_dev->async_read(header_blkids, sgs, header_size)
+        .thenValue([this, repl_dev, shard_id, blob_id, multi_blkids, req_offset, req_len, header_buf,
+                    block_size](auto&& result) mutable -> BlobManager::AsyncResult< BlobView > {
+            if (result) {
+                LOGE_RATE_LIMITED("Failed to read blob header {} shard {} err {}", blob_id, shard_id, result.value());
+                return folly::makeUnexpected(BlobError::READ_FAILED);
             }
 
-            uint8_t computed_hash[BlobHeader::blob_max_hash_len]{};
-            compute_blob_payload_hash(header->hash_algorithm, blob_bytes, blob_size, user_key_bytes, user_key_size,
-                                      computed_hash, BlobHeader::blob_max_hash_len);
-            if (std::memcmp(computed_hash, header->hash, BlobHeader::blob_max_hash_len) != 0) {
-                LOGE("Hash mismatch for [route={}] [header={}] [computed={}]", b_route, header->to_string(),
-                     spdlog::to_hex(computed_hash, computed_hash + BlobHeader::blob_max_hash_len));
-                return folly::makeUnexpected(BlobError::CHECKSUM_MISMATCH);
+            auto h = verify_blob_header(header_buf.get(), shard_id, blob_id);
+            if (!h) { return folly::makeUnexpected(h.error()); }
+            auto header = h.value();
+            // Blobs written without segment checksums can only be verified as a whole, and the tables of compressed
+            // blobs may not fit in what was sized by the blocks of the blob.
+            if (!header->has_segment_crcs() || header->data_start() > header_size) {
+                return read_blob(repl_dev, shard_id, blob_id, multi_blkids, req_offset, req_len);
             }
 
+            uint64_t const blob_size = header->blob_size;
             if (req_offset + req_len > blob_size) {
-                LOGE("Invalid offset length request in get blob {} offset {} len {} size {}", blob_id, req_offset,
-                     req_len, blob_size);
+                LOGE_RATE_LIMITED("Invalid offset length request in get blob {} offset {} len {} size {}", blob_id,
+                                  req_offset, req_len, blob_size);
                 return folly::makeUnexpected(BlobError::INVALID_ARG);
             }
+            // An empty read at the end of the blob covers no segment, it is served like a whole blob read would.
+            if (req_offset == blob_size) {
+                return read_blob(repl_dev, shard_id, blob_id, multi_blkids, req_offset, req_len);
+            }
+            auto const res_len = (req_len == 0) ? blob_size - req_offset : req_len;
 
-            // Copy the blob bytes from the offset. If request len is 0, take the
-            // whole blob size else copy only the request length.
-            auto res_len = req_len == 0 ? blob_size - req_offset : req_len;
-            auto body = sisl::io_blob_safe(res_len);
-            std::memcpy(body.bytes(), blob_bytes + req_offset, res_len);
-
-            // Copy the metadata if its present.
-            std::string user_key{};
-            if (header->user_key_offset != 0) {
-                user_key.resize(user_key_size);
-                std::memcpy(user_key.data(), user_key_bytes, user_key_size);
+            // Expand the requested range to whole segments, then to whole device blocks. The segments of compressed
+            // blobs are the compressed frames.
+            auto const segment_size = header->segment_size;
+            auto const first_segment = req_offset / segment_size;
+            auto const last_segment = (req_offset + res_len - 1) / segment_size;
+            auto const data_offset = header->data_start();
+            auto const compressed = header->compressed();
+            // Offsets from the first one read and sizes of the read segments as stored.
+            std::vector< std::pair< uint64_t, uint64_t > > segs;
+            segs.reserve(last_segment - first_segment + 1);
+            for (auto seg = first_segment, offset = uint64_t{0}; seg <= last_segment; ++seg) {
+                auto const len = compressed ? header->frame_size(seg)
+                                            : std::min< uint64_t >(segment_size, blob_size - seg * segment_size);
+                segs.emplace_back(offset, len);
+                offset += len;
             }
+            auto const seg_start =
+                data_offset + (compressed ? header->frame_start(first_segment) : first_segment * segment_size);
+            auto const seg_end = seg_start + segs.back().first + segs.back().second;
+            auto const data_start_blk = s_cast< uint32_t >(seg_start / block_size);
+            auto const data_end_blk = s_cast< uint32_t >(sisl::round_up(seg_end, block_size) / block_size);
 
-            LOGTRACEMOD(blobmgr, "Blob get success for blob {} shard {} blkid {}", blob_id, shard.id,
-                        multi_blkids.to_string());
-            return Blob(std::move(body), std::move(user_key), header->object_offset);
+            auto const key_start = header->user_key_start();
+            auto const key_end = key_start + header->user_key_size;
+            auto const key_start_blk = s_cast< uint32_t >(key_start / block_size);
+            auto const key_end_blk = s_cast< uint32_t >(sisl::round_up(key_end, block_size) / block_size);
+
+            auto read_blks = [this, repl_dev, &multi_blkids, block_size](uint32_t start_blk, uint32_t end_blk) {
+                auto const size = (end_blk - start_blk) * block_size;
+                shared< uint8_t > buf(iomanager.iobuf_alloc(block_size, size),
+                                      [](uint8_t* b) { iomanager.iobuf_free(b); });
+                sisl::sg_list sgs;
+                sgs.size = size;
+                sgs.iovs.emplace_back(iovec{.iov_base = buf.get(), .iov_len = size});
+                auto const read_time = HomeObjectMetrics::clock::now();
+                return repl_dev->async_read(sub_blkids(multi_blkids, start_blk, end_blk - start_blk), sgs, size)
+                    .thenValue([this, buf, read_time](auto&& err) -> std::pair< std::error_code, shared< uint8_t > > {
+                        HISTOGRAM_OBSERVE(metrics_, blob_read_latency, HomeObjectMetrics::elapsed_us(read_time));
+                        return {err, buf};
+                    });
+            };
+
+            std::vector< folly::Future< std::pair< std::error_code, shared< uint8_t > > > > reads;
+            reads.emplace_back(read_blks(data_start_blk, data_end_blk));
+            bool const read_key = (header->user_key_size != 0);
+            if (read_key) { reads.emplace_back(read_blks(key_start_blk, key_end_blk)); }
+
+            // Copy out what we still need of the header before its buffer goes away.
+            std::vector< uint32_t > crcs(header->segment_crcs(), header->segment_crcs() + header->num_segments + 1);
+            auto const object_offset = header->object_offset;
+            auto const user_key_size = header->user_key_size;
+            return folly::collectAll(std::move(reads))
+                .via(compute_executor_)
+                .thenValue([this, blob_id, shard_id, req_offset, res_len, crcs = std::move(crcs),
+                            segs = std::move(segs), compressed, object_offset, user_key_size, blob_size,
+                            segment_size, first_segment, last_segment, seg_start, data_start_blk, key_start,
+                            key_start_blk, read_key, block_size](auto&& results) -> BlobManager::Result< BlobView > {
+                    for (auto const& t : results) {
+                        if (t.hasException() || t.value().first) {
+                            LOGE_RATE_LIMITED("Failed to read blob range {} shard {}", blob_id, shard_id);
+                            return folly::makeUnexpected(BlobError::READ_FAILED);
+                        }
+                    }
+
+                    auto const b_route = BlobRoute{shard_id, blob_id};
+                    // Offset of the first read segment within the data read buffer.
+                    auto data_buf = results[0].value().second.get();
+                    auto const buf_seg_start = seg_start - data_start_blk * block_size;
+                    for (auto seg = first_segment; seg <= last_segment; ++seg) {
+                        auto const& [offset, len] = segs[seg - first_segment];
+                        if (segment_crc(data_buf + buf_seg_start + offset, len) != crcs[seg]) {
+                            LOGE_RATE_LIMITED("Segment checksum mismatch for [route={}] segment {}", b_route, seg);
+                            COUNTER_INCREMENT(metrics_, blob_checksum_mismatch_count, 1);
+                            return folly::makeUnexpected(BlobError::CHECKSUM_MISMATCH);
+                        }
+                    }
+
+                    // Compressed frames are decompressed into a buffer of their own, which the body then points at.
+                    uint8_t* body_bytes = data_buf + buf_seg_start;
+                    shared< uint8_t[] > decompressed;
+                    if (compressed) {
+                        auto const raw_size = std::min< uint64_t >((last_segment + 1) * segment_size, blob_size) -
+                            first_segment * segment_size;
+                        decompressed = std::make_shared_for_overwrite< uint8_t[] >(raw_size);
+                        auto src = body_bytes;
+                        uint64_t decompressed_size{0};
+                        for (auto const& [_, len] : segs) {
+                            auto const dst = decompressed.get() + decompressed_size;
+                            auto const raw_len = std::min< uint64_t >(segment_size, raw_size - decompressed_size);
+                            auto const n = LZ4_decompress_safe(r_cast< const char* >(src), r_cast< char* >(dst),
+                                                               s_cast< int >(len), s_cast< int >(raw_len));
+                            if (n < 0 || s_cast< uint64_t >(n) != raw_len) {
+                                LOGE_RATE_LIMITED("Failed to decompress [route={}] segments {}-{}", b_route,
+                                                  first_segment, last_segment);
+                                return folly::makeUnexpected(BlobError::READ_FAILED);
+                            }
+                            src += len;
+                            decompressed_size += raw_len;
+                        }
+                        body_bytes = decompressed.get();
+                    }
+
+                    std::string_view user_key{};
+                    if (read_key) {
+                        auto const key_bytes =
+                            results[1].value().second.get() + (key_start - key_start_blk * block_size);
+                        if (segment_crc(key_bytes, user_key_size) != crcs.back()) {
+                            LOGE_RATE_LIMITED("User key checksum mismatch for [route={}]", b_route);
+                            COUNTER_INCREMENT(metrics_, blob_checksum_mismatch_count, 1);
+                            return folly::makeUnexpected(BlobError::CHECKSUM_MISMATCH);
+                        }
+                        user_key = std::string_view{r_cast< const char* >(key_bytes), user_key_size};
+                    }
+
+                    // The view keeps both the data and the user key read buffers alive.
+                    auto holder = std::make_shared< std::vector< std::shared_ptr< void > > >();
+                    for (auto& t : results) {
+                        holder->push_back(std::move(t.value().second));
+                    }
+                    if (decompressed) { holder->push_back(std::move(decompressed)); }
+                    LOGTRACEMOD(blobmgr, "Blob ranged get success for blob {} shard {} offset {} len {}", blob_id,
+                                shard_id, req_offset, res_len);
+                    return BlobView{
+                        .holder = std::move(holder),
+                        .body = sisl::blob{body_bytes + (req_offset - first_segment * segment_size),
+                                           s_cast< uint32_t >(res_len)},
+                        .user_key = user_key,
+                        .object_off = object_offset};
+                });
         });
 }
 
@@ -301,14 +1525,17 @@ homestore::blk_alloc_hints HSHomeObject::blob_put_get_blk_alloc_hints(sisl::blob
         return {};
     }
 
-    std::scoped_lock lock_guard(_shard_lock);
-    auto shard_iter = _shard_map.find(msg_header->shard_id);
-    RELEASE_ASSERT(shard_iter != _shard_map.end(), "Couldnt find shard id");
-    auto hs_shard = d_cast< HS_Shard* >((*shard_iter->second).get());
-    auto chunk_id = hs_shard->sb_->chunk_id;
-    LOGI("Got shard id {} chunk id {}", msg_header->shard_id, chunk_id);
     homestore::blk_alloc_hints hints;
-    hints.chunk_id_hint = chunk_id;
+    auto& hint = shard_chunk_hints[msg_header->shard_id % shard_chunk_hint_slots];
+    if (hint.instance_id == instance_id_ && hint.shard_id == msg_header->shard_id) {
+        hints.chunk_id_hint = hint.chunk_id;
+        return hints;
+    }
+
+    auto chunk_id = get_shard_chunk(msg_header->shard_id);
+    RELEASE_ASSERT(chunk_id.has_value(), "Couldnt find shard id");
+    hint = ShardChunkHint{instance_id_, msg_header->shard_id, chunk_id.value()};
+    hints.chunk_id_hint = chunk_id.value();
     return hints;
 }
 
@@ -316,9 +1543,8 @@ BlobManager::NullAsyncResult HSHomeObject::_del_blob(ShardInfo const& shard, blo
     auto& pg_id = shard.placement_group;
     shared< homestore::ReplDev > repl_dev;
     {
-        std::shared_lock lock_guard(_pg_lock);
         auto iter = _pg_map.find(pg_id);
-        RELEASE_ASSERT(iter != _pg_map.end(), "PG not found");
+        RELEASE_ASSERT(iter != _pg_map.cend(), "PG not found");
         repl_dev = static_cast< HS_PG* >(iter->second.get())->repl_dev_;
     }
 
@@ -339,7 +1565,9 @@ BlobManager::NullAsyncResult HSHomeObject::_del_blob(ShardInfo const& shard, blo
     memcpy(req->hdr_buf_.bytes(), &blob_id, sizeof(blob_id_t));
 
     repl_dev->async_alloc_write(header, req->hdr_buf_, sisl::sg_list{}, req);
-    return req->result().deferValue([](const auto& result) -> folly::Expected< folly::Unit, BlobError > {
+    return req->result().deferValue([this, start_time = req->start_time_](
+                                        const auto& result) -> folly::Expected< folly::Unit, BlobError > {
+        HISTOGRAM_OBSERVE(metrics_, del_blob_latency, HomeObjectMetrics::elapsed_us(start_time));
         if (result.hasError()) { return folly::makeUnexpected(result.error()); }
         auto blob_info = result.value();
         LOGTRACEMOD(blobmgr, "Delete blob success,  shard_id {} , blob_id {}", blob_info.shard_id, blob_info.blob_id);
@@ -364,42 +1592,286 @@ void HSHomeObject::on_blob_del_commit(int64_t lsn, sisl::blob const& header, sis
 
     shared< BlobIndexTable > index_table;
     shared< homestore::ReplDev > repl_dev;
+    BlobIndexCache* index_cache{nullptr};
+    BlobIndexQueue* index_queue{nullptr};
+    std::mutex* gc_mtx{nullptr};
+    HS_PG* pg{nullptr};
     {
-        std::shared_lock lock_guard(_pg_lock);
         auto iter = _pg_map.find(msg_header->pg_id);
-        RELEASE_ASSERT(iter != _pg_map.end(), "PG not found");
-        index_table = static_cast< HS_PG* >(iter->second.get())->index_table_;
-        repl_dev = static_cast< HS_PG* >(iter->second.get())->repl_dev_;
+        RELEASE_ASSERT(iter != _pg_map.cend(), "PG not found");
+        pg = static_cast< HS_PG* >(iter->second.get());
+        index_table = pg->index_table_;
+        repl_dev = pg->repl_dev_;
+        index_cache = pg->index_cache_.get();
+        index_queue = pg->index_queue_.get();
+        gc_mtx = &pg->gc_mtx_;
         RELEASE_ASSERT(index_table != nullptr, "Index table not intialized");
         RELEASE_ASSERT(repl_dev != nullptr, "Repl dev instance null");
     }
 
-    BlobInfo blob_info;
-    blob_info.shard_id = msg_header->shard_id;
-    blob_info.blob_id = *r_cast< blob_id_t* >(const_cast< uint8_t* >(key.cbytes()));
-
-    auto r = move_to_tombstone(index_table, blob_info);
-    if (!r) {
-        if (recovery_done_) {
-            LOGE("fail to move blob to tombstone,  blob_id {}, shard_id {}, {}", blob_info.blob_id, blob_info.shard_id,
-                 r.error());
-            if (ctx) ctx->promise_.setValue(folly::makeUnexpected(r.error()));
-            return;
-        } else {
-            if (ctx) { ctx->promise_.setValue(BlobManager::Result< BlobInfo >(blob_info)); }
-            return;
-        }
+    auto deleted = std::make_shared< BlobInfo >();
+    deleted->shard_id = msg_header->shard_id;
+    deleted->blob_id = *r_cast< blob_id_t* >(const_cast< uint8_t* >(key.cbytes()));
+
+    // The delete is applied by the index queue of the PG after any put of the blob still waiting in it, the request
+    // holds on to hs_ctx until the result is set.
+    bool const replayed = !recovery_done_;
+    index_queue->enqueue_mutation(
+        [this, pg, repl_dev, index_cache, gc_mtx, deleted, lsn, replayed]() -> BlobManager::NullResult {
+            auto& blob_info = *deleted;
+            // GC may not move the blob in between tombstoning it and freeing the blocks it pointed at.
+            std::scoped_lock gc_guard(*gc_mtx);
+            // the tombstone and the stats it changes are persisted by the same CP;
+            auto cur_cp = homestore::HomeStore::instance()->cp_mgr().cp_guard();
+            auto r = move_to_tombstone(*pg, blob_info);
+            if (!r) {
+                if (replayed) { return folly::Unit(); }
+                LOGE("fail to move blob to tombstone,  blob_id {}, shard_id {}, {}", blob_info.blob_id,
+                     blob_info.shard_id, r.error());
+                return folly::makeUnexpected(r.error());
+            }
+
+            // Drop the cached blkids once the index no longer points at them and before they are freed.
+            if (index_cache) { index_cache->remove(BlobRoute{blob_info.shard_id, blob_info.blob_id}); }
+            if (data_cache_) { data_cache_->remove(BlobRoute{blob_info.shard_id, blob_info.blob_id}); }
+            blob_info.pbas = r.value();
+            // a delete replayed after restart finds the tombstone it wrote before;
+            if (blob_info.pbas != tombstone_pbas) {
+                on_blob_deleted(*pg, blob_info.shard_id, blob_info.blob_id,
+                                blob_info.pbas.bytes(repl_dev->get_blk_size()));
+            }
+            // Deduplicated blobs keep the blocks they share until the last of them is deleted. The blob is
+            // tombstoned either way, if its count can not be told the blocks leak and the delete fails.
+            std::vector< BlobInfo > to_free{blob_info};
+            auto unshared = unshare_extents(*pg, to_free);
+            for (auto const& blkids : blks_to_free(*pg, to_free)) {
+                repl_dev->async_free_blks(lsn, blkids);
+            }
+            return unshared;
+        },
+        [ctx, req = hs_ctx, deleted](BlobManager::NullResult r) {
+            if (!ctx) { return; }
+            if (r.hasError()) {
+                ctx->promise_.setValue(folly::makeUnexpected(r.error()));
+                return;
+            }
+            ctx->promise_.setValue(BlobManager::Result< BlobInfo >(*deleted));
+        });
+}
+
+BlobManager::AsyncResult< BlobList > HSHomeObject::_list_blobs(ShardInfo const& shard, blob_id_t start,
+                                                               uint32_t limit, BlobState filter) const {
+    shared< BlobIndexTable > index_table;
+    shared< homestore::ReplDev > repl_dev;
+    BlobIndexQueue* index_queue{nullptr};
+    HS_PG const* hs_pg{nullptr};
+    {
+        auto iter = _pg_map.find(shard.placement_group);
+        RELEASE_ASSERT(iter != _pg_map.cend(), "PG not found");
+        hs_pg = static_cast< HS_PG const* >(iter->second.get());
+        index_table = hs_pg->index_table_;
+        repl_dev = hs_pg->repl_dev_;
+        index_queue = hs_pg->index_queue_.get();
     }
 
-    auto& multiBlks = r.value();
-    if (multiBlks != tombstone_pbas) { repl_dev->async_free_blks(lsn, multiBlks); }
+    RELEASE_ASSERT(repl_dev != nullptr, "Repl dev instance null");
+    RELEASE_ASSERT(index_table != nullptr, "Index table instance null");
+
+    auto const blk_size = repl_dev->get_blk_size();
+    auto blobs = list_blobs_from_index_table(*hs_pg, shard.id, start, limit, filter, blk_size);
+    if (!blobs || filter == BlobState::DELETED) { return blobs; }
 
-    if (ctx) { ctx->promise_.setValue(BlobManager::Result< BlobInfo >(blob_info)); }
+    // Blobs committed before the listing are included whether or not their index puts were applied yet, those still
+    // queued are merged into the page from the overlay. A full page only takes those up to its last blob, the rest
+    // belong to the pages after it.
+    auto& page = blobs.value();
+    auto last = std::numeric_limits< blob_id_t >::max();
+    if (page.size() == limit && !page.empty()) { last = page.back().id; }
+    auto const pending = index_queue->pending(BlobRoute{shard.id, start}, BlobRoute{shard.id, last});
+    if (pending.empty()) { return blobs; }
+    std::set< blob_id_t > listed;
+    for (auto const& entry : page) {
+        listed.insert(entry.id);
+    }
+    // A put replayed after restart may already be in the index, which keeps the entry it has.
+    for (auto const& [route, blkids] : pending) {
+        if (listed.contains(route.blob)) { continue; }
+        page.push_back(BlobListEntry{.id = route.blob, .state = BlobState::ALIVE, .size = blkids.bytes(blk_size)});
+    }
+    std::sort(page.begin(), page.end(), [](auto const& a, auto const& b) { return a.id < b.id; });
+    if (page.size() > limit) { page.resize(limit); }
+    return blobs;
+}
+
+BlobManager::NullAsyncResult HSHomeObject::_del_blob_batch(ShardInfo const& shard,
+                                                           std::vector< blob_id_t > const& blob_ids) {
+    return replicate_del_blob_batch(shard, 0, 0, blob_ids);
+}
+
+BlobManager::NullAsyncResult HSHomeObject::_del_blob_range(ShardInfo const& shard, blob_id_t from, blob_id_t to) {
+    return replicate_del_blob_batch(shard, from, to, {});
+}
+
+// The manifest and the segments of the stream are deleted with one replicated write.
+BlobManager::NullAsyncResult HSHomeObject::_del_blob_stream(ShardInfo const& shard, blob_id_t blob) {
+    return replicate_del_blob_batch(shard, stream_segments_begin(blob), stream_segments_end(blob), {blob});
+}
+
+BlobManager::NullAsyncResult HSHomeObject::replicate_del_blob_batch(ShardInfo const& shard, blob_id_t range_start,
+                                                                    blob_id_t range_end,
+                                                                    std::vector< blob_id_t > const& blob_ids) {
+    auto& pg_id = shard.placement_group;
+    shared< homestore::ReplDev > repl_dev;
+    {
+        auto iter = _pg_map.find(pg_id);
+        RELEASE_ASSERT(iter != _pg_map.cend(), "PG not found");
+        repl_dev = static_cast< HS_PG* >(iter->second.get())->repl_dev_;
+    }
+
+    RELEASE_ASSERT(repl_dev != nullptr, "Repl dev instance null");
+
+    auto const num_blobs = static_cast< uint32_t >(blob_ids.size());
+    auto const key_size = BlobDelBatchKey::size(num_blobs);
+    auto req = repl_result_ctx< BlobManager::NullResult >::make(key_size, io_align);
+
+    req->header_.msg_type = ReplicationMessageType::DEL_BLOB_BATCH_MSG;
+    req->header_.payload_size = 0;
+    req->header_.payload_crc = 0;
+    req->header_.shard_id = shard.id;
+    req->header_.pg_id = pg_id;
+    req->header_.seal();
+    sisl::blob header;
+    header.set_bytes(r_cast< uint8_t* >(&req->header_));
+    header.set_size(sizeof(req->header_));
+
+    auto batch_key = r_cast< BlobDelBatchKey* >(req->hdr_buf_.bytes());
+    batch_key->range_start = range_start;
+    batch_key->range_end = range_end;
+    batch_key->num_blobs = num_blobs;
+    if (num_blobs != 0) { std::memcpy(batch_key->blob_ids, blob_ids.data(), num_blobs * sizeof(blob_id_t)); }
+
+    repl_dev->async_alloc_write(header, sisl::blob{req->hdr_buf_.bytes(), key_size}, sisl::sg_list{}, req);
+    return req->result().deferValue(
+        [shard_id = shard.id, num_blobs](const auto& result) -> BlobManager::NullResult {
+            if (result.hasError()) { return folly::makeUnexpected(result.error()); }
+            LOGTRACEMOD(blobmgr, "Delete blob batch success, shard_id {}, num_blobs {}", shard_id, num_blobs);
+            return folly::Unit();
+        });
+}
+
+void HSHomeObject::on_blob_del_batch_commit(int64_t lsn, sisl::blob const& header, sisl::blob const& key,
+                                            cintrusive< homestore::repl_req_ctx >& hs_ctx) {
+    repl_result_ctx< BlobManager::NullResult >* ctx{nullptr};
+    if (hs_ctx && hs_ctx->is_proposer) {
+        ctx = boost::static_pointer_cast< repl_result_ctx< BlobManager::NullResult > >(hs_ctx).get();
+    }
+
+    auto msg_header = r_cast< ReplicationMessageHeader* >(const_cast< uint8_t* >(header.cbytes()));
+    if (msg_header->corrupted()) {
+        LOGERROR("replication message header is corrupted with crc error, lsn:{}", lsn);
+        if (ctx) { ctx->promise_.setValue(folly::makeUnexpected(BlobError::CHECKSUM_MISMATCH)); }
+        return;
+    }
+
+    shared< BlobIndexTable > index_table;
+    shared< homestore::ReplDev > repl_dev;
+    BlobIndexCache* index_cache{nullptr};
+    BlobIndexQueue* index_queue{nullptr};
+    std::mutex* gc_mtx{nullptr};
+    HS_PG* pg{nullptr};
+    {
+        auto iter = _pg_map.find(msg_header->pg_id);
+        RELEASE_ASSERT(iter != _pg_map.cend(), "PG not found");
+        pg = static_cast< HS_PG* >(iter->second.get());
+        index_table = pg->index_table_;
+        repl_dev = pg->repl_dev_;
+        index_cache = pg->index_cache_.get();
+        index_queue = pg->index_queue_.get();
+        gc_mtx = &pg->gc_mtx_;
+        RELEASE_ASSERT(index_table != nullptr, "Index table not intialized");
+        RELEASE_ASSERT(repl_dev != nullptr, "Repl dev instance null");
+    }
+
+    // The key goes away with the commit, the queue applies the batch later.
+    shard_id_t const shard_id = msg_header->shard_id;
+    auto const batch_key = r_cast< const BlobDelBatchKey* >(key.cbytes());
+    auto const range_start = batch_key->range_start;
+    auto const range_end = batch_key->range_end;
+    auto const has_range = batch_key->has_range();
+    std::vector< blob_id_t > blob_ids(batch_key->blob_ids, batch_key->blob_ids + batch_key->num_blobs);
+
+    // Like a single delete, applied by the index queue after any put of the blobs still waiting in it.
+    bool const replayed = !recovery_done_;
+    index_queue->enqueue_mutation(
+        [this, pg, repl_dev, index_cache, gc_mtx, lsn, shard_id, range_start, range_end, has_range,
+         blob_ids = std::move(blob_ids), replayed]() -> BlobManager::NullResult {
+            // Kept from racing with GC moving the blobs.
+            std::scoped_lock gc_guard(*gc_mtx);
+            // the tombstones and the stats they change are persisted by the same CP;
+            auto cur_cp = homestore::HomeStore::instance()->cp_mgr().cp_guard();
+            std::vector< BlobInfo > deleted;
+            BlobManager::NullResult result = folly::Unit();
+            if (has_range) {
+                auto r = move_range_to_tombstone(*pg, shard_id, range_start, range_end);
+                if (r) {
+                    deleted = std::move(r.value());
+                } else {
+                    result = folly::makeUnexpected(r.error());
+                }
+            }
+            if (!blob_ids.empty()) {
+                std::vector< BlobInfo > blob_infos;
+                blob_infos.reserve(blob_ids.size());
+                for (auto const blob_id : blob_ids) {
+                    blob_infos.push_back(BlobInfo{shard_id, blob_id, {}});
+                }
+                auto results = move_to_tombstone(*pg, blob_infos);
+                deleted.reserve(deleted.size() + blob_infos.size());
+                for (size_t i = 0; i < results.size(); ++i) {
+                    if (results[i]) {
+                        blob_infos[i].pbas = results[i].value();
+                        deleted.push_back(std::move(blob_infos[i]));
+                        continue;
+                    }
+                    // Blobs already gone are skipped, the batch only fails on index errors.
+                    if (results[i].error() != BlobError::UNKNOWN_BLOB && result) {
+                        result = folly::makeUnexpected(results[i].error());
+                    }
+                }
+            }
+            if (!result) {
+                LOGE("fail to move blob batch to tombstone, shard_id {}, lsn {}, {}", shard_id, lsn, result.error());
+                // Replay before recovery completes may find the blobs already gone, the same as for a single delete.
+                if (replayed) { result = folly::Unit(); }
+            }
+
+            // The blocks of all the blobs that were tombstoned are freed in one pass.
+            for (auto const& blob_info : deleted) {
+                auto const route = BlobRoute{blob_info.shard_id, blob_info.blob_id};
+                if (index_cache) { index_cache->remove(route); }
+                if (data_cache_) { data_cache_->remove(route); }
+                if (blob_info.pbas != tombstone_pbas) {
+                    on_blob_deleted(*pg, blob_info.shard_id, blob_info.blob_id,
+                                    blob_info.pbas.bytes(repl_dev->get_blk_size()));
+                }
+            }
+            if (auto unshared = unshare_extents(*pg, deleted); !unshared && result) {
+                result = folly::makeUnexpected(unshared.error());
+            }
+            for (auto const& blkids : blks_to_free(*pg, deleted)) {
+                repl_dev->async_free_blks(lsn, blkids);
+            }
+            return result;
+        },
+        [ctx, req = hs_ctx](BlobManager::NullResult r) {
+            if (ctx) { ctx->promise_.setValue(std::move(r)); }
+        });
 }
 
 void HSHomeObject::compute_blob_payload_hash(BlobHeader::HashAlgorithm algorithm, const uint8_t* blob_bytes,
                                              size_t blob_size, const uint8_t* user_key_bytes, size_t user_key_size,
                                              uint8_t* hash_bytes, size_t hash_len) const {
+    auto const start_time = HomeObjectMetrics::clock::now();
     std::memset(hash_bytes, 0, hash_len);
     switch (algorithm) {
     case HSHomeObject::BlobHeader::HashAlgorithm::NONE: {
@@ -412,9 +1884,34 @@ void HSHomeObject::compute_blob_payload_hash(BlobHeader::HashAlgorithm algorithm
         std::memcpy(hash_bytes, r_cast< uint8_t* >(&hash32), sizeof(uint32_t));
         break;
     }
+    case HSHomeObject::BlobHeader::HashAlgorithm::CRC32C: {
+        auto hash32 = segment_crc(blob_bytes, blob_size);
+        if (user_key_size != 0) {
+            hash32 = crc32_iscsi(const_cast< uint8_t* >(user_key_bytes), s_cast< int >(user_key_size), hash32);
+        }
+        RELEASE_ASSERT(sizeof(uint32_t) <= hash_len, "Hash length invalid");
+        std::memcpy(hash_bytes, r_cast< uint8_t* >(&hash32), sizeof(uint32_t));
+        break;
+    }
+    case HSHomeObject::BlobHeader::HashAlgorithm::XXH3: {
+        XXH64_hash_t hash64;
+        if (user_key_size == 0) {
+            hash64 = XXH3_64bits(blob_bytes, blob_size);
+        } else {
+            XXH3_state_t state;
+            XXH3_64bits_reset(&state);
+            XXH3_64bits_update(&state, blob_bytes, blob_size);
+            XXH3_64bits_update(&state, user_key_bytes, user_key_size);
+            hash64 = XXH3_64bits_digest(&state);
+        }
+        RELEASE_ASSERT(sizeof(XXH64_hash_t) <= hash_len, "Hash length invalid");
+        std::memcpy(hash_bytes, r_cast< uint8_t* >(&hash64), sizeof(XXH64_hash_t));
+        break;
+    }
     default:
         RELEASE_ASSERT(false, "Hash not implemented");
     }
+    HISTOGRAM_OBSERVE(metrics_, blob_hash_latency, HomeObjectMetrics::elapsed_us(start_time));
 }
 
 } // namespace homeobject
@@ -13,7 +13,12 @@
  * specific language governing permissions and limitations under the License.
  *
  *********************************************************************************/
+#include <algorithm>
+#include <functional>
+
+#include <folly/futures/Future.h>
 #include <homestore/homestore.hpp>
+#include "hs_backend_config.hpp"
 #include "hs_hmobj_cp.hpp"
 
 namespace homeobject {
@@ -22,13 +27,16 @@ std::unique_ptr< CPContext > HomeObjCPCallbacks::on_switchover_cp(CP* cur_cp, CP
     return std::make_unique< HomeObjCPContext >(new_cp);
 }
 
-// when cp_flush is called, it means that all the dirty candidates are already in the dirty list.
-// new dirty candidates will arrive on next cp's context.
+// when cp_flush is called, all io of this cp has marked its pgs dirty; the pg superblks are snapshotted into the
+// dirty list here, once per cp, instead of on every put. The superblk writes are then issued from
+// cp_flush_parallelism tasks on the executor, and the returned future completes once all of them are done.
 folly::Future< bool > HomeObjCPCallbacks::cp_flush(CP* cp) {
     auto cp_ctx = s_cast< HomeObjCPContext* >(cp->context(homestore::cp_consumer_t::HS_CLIENT));
+    home_obj_->collect_dirty_pgs(*cp_ctx, cp->id());
 
+    std::vector< std::function< void() > > writes;
     // start to flush all dirty candidates.
-    // no need to take the lock as no more dirty candidate is going to be added to this context when we are here;
+    // no need to take the lock as the dirty list is only filled by collect_dirty_pgs above;
     for (auto it = cp_ctx->pg_dirty_list_.begin(); it != cp_ctx->pg_dirty_list_.end(); ++it) {
         auto id = it->first;
         // auto pg_sb = it->second.get();
@@ -49,23 +57,51 @@ folly::Future< bool > HomeObjCPCallbacks::cp_flush(CP* cp) {
         // copy the dirty buffer to the superblk;
         cp_ctx->pg_sb_[id].get()->copy(*pg_sb);
 
-        // write to disk;
-        cp_ctx->pg_sb_[id].write();
+        // write to disk; elements of pg_sb_ stay where they are while other pgs are added.
+        writes.emplace_back([sb = &cp_ctx->pg_sb_[id]] { sb->write(); });
     }
 
-    cp_ctx->complete(true);
+    home_obj_->collect_dirty_shards(*cp_ctx, cp->id(), writes);
+
+    flush_done_.store(0, std::memory_order_relaxed);
+    flush_total_.store(writes.size(), std::memory_order_relaxed);
+    if (writes.empty()) {
+        cp_ctx->complete(true);
+        return folly::makeFuture< bool >(true);
+    }
 
-    return folly::makeFuture< bool >(true);
+    auto const parallelism =
+        std::clamp< size_t >(HS_BACKEND_DYNAMIC_CONFIG(cp_flush_parallelism), 1, writes.size());
+    auto shared_writes = std::make_shared< std::vector< std::function< void() > > >(std::move(writes));
+    auto executor = home_obj_->cp_flush_executor();
+    std::vector< folly::Future< folly::Unit > > futs;
+    futs.reserve(parallelism);
+    for (size_t i = 0; i < parallelism; ++i) {
+        futs.emplace_back(folly::via(executor, [this, shared_writes, i, parallelism] {
+            for (auto w = i; w < shared_writes->size(); w += parallelism) {
+                (*shared_writes)[w]();
+                flush_done_.fetch_add(1, std::memory_order_relaxed);
+            }
+        }));
+    }
+    return folly::collectAll(std::move(futs)).via(executor).thenValue([cp_ctx](auto&&) {
+        cp_ctx->complete(true);
+        return true;
+    });
 }
 
 void HomeObjCPCallbacks::cp_cleanup(CP* cp) {}
 
-int HomeObjCPCallbacks::cp_progress_percent() { return 0; }
+int HomeObjCPCallbacks::cp_progress_percent() {
+    auto const total = flush_total_.load(std::memory_order_relaxed);
+    if (total == 0) { return 100; }
+    return s_cast< int >(flush_done_.load(std::memory_order_relaxed) * 100 / total);
+}
 
 HomeObjCPContext::HomeObjCPContext(CP* cp) : CPContext(cp) { pg_dirty_list_.clear(); }
 
 void HomeObjCPContext::add_pg_to_dirty_list(HSHomeObject::pg_info_superblk* pg_sb) {
-    // this will be called in io path, so take the lock to protect the dirty list;
+    // called once per dirty pg from cp_flush; the lock keeps direct callers safe;
     std::scoped_lock lock_guard(dl_mtx_);
     HSHomeObject::pg_info_superblk* sb_copy{nullptr};
     if (pg_dirty_list_.find(pg_sb->id) == pg_dirty_list_.end()) {
@@ -74,11 +110,16 @@ void HomeObjCPContext::add_pg_to_dirty_list(HSHomeObject::pg_info_superblk* pg_s
         sb_copy = pg_dirty_list_[pg_sb->id];
     }
 
-    // here we do copy instead of using caller's pg_sb directly because we don't want to every I/O to allocate the same
-    // piece of memory. Instead, choose to copy the pg_sb which is a very small size;
+    // here we do copy instead of using caller's pg_sb directly so the caller is free to update its pg_sb while this cp
+    // is being flushed. The pg_sb is a very small size;
     sb_copy->copy(*pg_sb);
     pg_dirty_list_.emplace(pg_sb->id, sb_copy);
 }
+void HomeObjCPContext::add_shard_to_dirty_list(HSHomeObject::HS_Shard* shard) {
+    std::scoped_lock lock_guard(dl_mtx_);
+    shard_dirty_list_.push_back(shard);
+}
+
 std::mutex HomeObjCPContext::s_mtx_;
 std::unordered_map< pg_id_t, homestore::superblk< HSHomeObject::pg_info_superblk > > HomeObjCPContext::pg_sb_;
 } // namespace homeobject
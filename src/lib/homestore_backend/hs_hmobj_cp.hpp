@@ -48,6 +48,10 @@ public:
 private:
     HSHomeObject* home_obj_{nullptr}; // it is a raw pointer because HSHomeObject triggers shutdown in its destructor,
                                       // holding a shared_ptr will cause a shutdown deadlock.
+
+    // superblk writes issued by the flushing cp and how many of them completed, for cp_progress_percent();
+    std::atomic< uint64_t > flush_total_{0};
+    std::atomic< uint64_t > flush_done_{0};
 };
 
 //
@@ -81,6 +85,16 @@ public:
      */
     void add_pg_to_dirty_list(HSHomeObject::pg_info_superblk* pg_sb);
 
+    /**
+     * @brief Adds the shard to the dirty list, to have its superblk written when this CP is flushed.
+     *
+     * Called by HS_Shard::mark_dirty at most once per shard and CP, so the io path doesn't take the lock on every
+     * update to the shard.
+     *
+     * @param shard The shard to be added to the dirty list.
+     */
+    void add_shard_to_dirty_list(HSHomeObject::HS_Shard* shard);
+
     static void init_pg_sb(homestore::superblk< HSHomeObject::pg_info_superblk >&& sb) {
         std::scoped_lock lock_guard(s_mtx_);
         pg_sb_[sb->id] = std::move(sb); // move the sb to the map;
@@ -89,6 +103,7 @@ public:
     //////////////// Per-CP instance members ////////////////
     std::mutex dl_mtx_; // mutex to protect dirty list
     std::unordered_map< pg_id_t, HSHomeObject::pg_info_superblk* > pg_dirty_list_;
+    std::vector< HSHomeObject::HS_Shard* > shard_dirty_list_; // shards are never freed while homeobject is alive;
 
     //////////////// Shared by all CPs ////////////////
     static std::mutex s_mtx_; // mutex to protect pg_sb_
@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <chrono>
 #include <latch>
 #include <optional>
 #include <spdlog/fmt/bin_to_hex.h>
@@ -28,12 +30,18 @@ struct svc_info_superblk_t {
     peer_id_t svc_id_;
 };
 
+static uint64_t get_elapsed_ms(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast< std::chrono::milliseconds >(std::chrono::steady_clock::now() - start).count();
+}
+
 extern std::shared_ptr< HomeObject > init_homeobject(std::weak_ptr< HomeObjectApplication >&& application) {
     LOGI("Initializing HomeObject");
     auto instance = std::make_shared< HSHomeObject >(std::move(application));
     instance->init_homestore();
     // instance->init_timer_thread();
     instance->init_cp();
+    instance->init_gc();
+    instance->init_blob_packer();
     return instance;
 }
 
@@ -110,13 +118,18 @@ void HSHomeObject::init_homestore() {
     }
 
     chunk_selector_ = std::make_shared< HeapChunkSelector >();
+    if (auto const cache_bytes = HS_BACKEND_DYNAMIC_CONFIG(blob_data_cache_bytes); cache_bytes != 0) {
+        data_cache_ = std::make_unique< BlobDataCache >(cache_bytes, HS_BACKEND_DYNAMIC_CONFIG(blob_data_cache_shards));
+    }
     using namespace homestore;
     auto repl_app = std::make_shared< HSReplApplication >(repl_impl_type::server_side, false, this, app);
+    auto const start_time = std::chrono::steady_clock::now();
     bool need_format = HomeStore::instance()
                            ->with_index_service(std::make_unique< BlobIndexServiceCallbacks >(this))
                            .with_repl_data_service(repl_app, chunk_selector_)
                            .start(hs_input_params{.devices = device_info, .app_mem_size = app_mem_size},
                                   [this]() { register_homestore_metablk_callback(); });
+    LOGI("HomeStore started in {}ms, need_format={}", get_elapsed_ms(start_time), need_format);
 
     // We either recoverd a UUID and no FORMAT is needed, or we need one for a later superblock
     if (need_format) {
@@ -147,6 +160,7 @@ void HSHomeObject::init_homestore() {
         RELEASE_ASSERT(new_id == _our_id, "Received new SvcId [{}] AFTER recovery of [{}]?!", to_string(new_id),
                        to_string(_our_id));
     }
+    recount_legacy_stats();
     recovery_done_ = true;
     LOGI("Initialize and start HomeStore is successfully");
 }
@@ -177,6 +191,21 @@ void HSHomeObject::init_cp() {
                                                       std::move(std::make_unique< HomeObjCPCallbacks >(this)));
 }
 
+void HSHomeObject::init_gc() {
+    if (!HS_BACKEND_DYNAMIC_CONFIG(gc_enabled)) { return; }
+    gc_manager_ = std::make_unique< GCManager >(*this);
+    gc_manager_->start();
+}
+
+void HSHomeObject::init_blob_packer() {
+    if (!HS_BACKEND_DYNAMIC_CONFIG(blob_pack_enabled)) { return; }
+    blob_packer_ = std::make_shared< BlobPacker >(
+        [this](ShardInfo const& shard, std::vector< BlobPacker::Pending >&& blobs) {
+            write_blob_pack(shard, std::move(blobs));
+        },
+        executor_);
+}
+
 // void HSHomeObject::trigger_timed_events() { persist_pg_sb(); }
 
 void HSHomeObject::register_homestore_metablk_callback() {
@@ -215,6 +244,16 @@ HSHomeObject::~HSHomeObject() {
     }
     trigger_timed_events();
 #endif
+    // Let the PG workers finish what they have queued while everything they use is still up.
+    _join_pg_executors();
+    // Write out the packs still waiting for their window to close.
+    if (blob_packer_) { blob_packer_->stop(); }
+    // GC goes next, it drains the index queues and writes to the index itself.
+    if (gc_manager_) { gc_manager_->stop(); }
+    // Apply what is left in the index queues while the index is still up, later commits are applied inline.
+    for (auto const& [_, pg] : _pg_map) {
+        static_cast< HS_PG* >(pg.get())->index_queue_->stop();
+    }
     homestore::HomeStore::instance()->shutdown();
     homestore::HomeStore::reset_instance();
     iomanager.stop();
@@ -223,21 +262,44 @@ HSHomeObject::~HSHomeObject() {
 void HSHomeObject::on_shard_meta_blk_found(homestore::meta_blk* mblk, sisl::byte_view buf) {
     homestore::superblk< shard_info_superblk > sb(_shard_meta_name);
     sb.load(buf, mblk);
-    add_new_shard_to_map(std::make_unique< HS_Shard >(std::move(sb)));
+    if (!sb->is_current(buf.size())) {
+        // Written before the used bytes were persisted, upgraded in place by the next CP writing it. They are
+        // recounted from the index along with the stats of the PG.
+        auto const legacy_size = offsetof(shard_info_superblk, version);
+        auto const bytes = r_cast< uint8_t const* >(sb.get());
+        std::vector< uint8_t > legacy(bytes, bytes + legacy_size);
+        sb.create(sizeof(shard_info_superblk));
+        std::memcpy(sb.get(), legacy.data(), legacy_size);
+        sb->version = shard_info_superblk::current_version;
+        sb->used_bytes = 0;
+        legacy_stats_pgs_.insert(sb->placement_group);
+    }
+    // the shards are added to their pg in one go once all of them are found;
+    auto const pg_id = sb->placement_group;
+    recovered_shards_[pg_id].emplace_back(std::make_unique< HS_Shard >(std::move(sb)));
 }
 
 void HSHomeObject::on_shard_meta_blk_recover_completed(bool success) {
+    auto const start_time = std::chrono::steady_clock::now();
     std::unordered_set< homestore::chunk_num_t > excluding_chunks;
-    std::scoped_lock lock_guard(_pg_lock);
-    for (auto& pair : _pg_map) {
-        for (auto& shard : pair.second->shards_) {
+    size_t num_shards{0};
+    for (auto& [pg_id, shards] : recovered_shards_) {
+        std::sort(shards.begin(), shards.end(), [](auto const& l, auto const& r) { return l->info.id < r->info.id; });
+        for (auto const& shard : shards) {
             if (shard->info.state == ShardInfo::State::OPEN) {
                 excluding_chunks.emplace(d_cast< HS_Shard* >(shard.get())->sb_->chunk_id);
             }
         }
+        num_shards += shards.size();
+        add_new_shards_to_map(pg_id, std::move(shards));
     }
+    auto const num_pgs = recovered_shards_.size();
+    recovered_shards_.clear();
+    auto const map_time = get_elapsed_ms(start_time);
 
     chunk_selector_->build_per_dev_chunk_heap(excluding_chunks);
+    LOGI("Recovered {} shards of {} pgs in {}ms, chunk heaps built in {}ms", num_shards, num_pgs, map_time,
+         get_elapsed_ms(start_time) - map_time);
 }
 
 HomeObjectStats HSHomeObject::_get_stats() const {
@@ -247,10 +309,8 @@ HomeObjectStats HSHomeObject::_get_stats() const {
     stats.used_capacity_bytes = repl_svc.get_cap_stats().used_capacity;
 
     uint32_t num_open_shards = 0ul;
-    std::scoped_lock lock_guard(_pg_lock);
     for (auto const& [_, pg] : _pg_map) {
-        auto hs_pg = static_cast< HS_PG* >(pg.get());
-        num_open_shards += hs_pg->open_shards();
+        num_open_shards += static_cast< HS_PG* >(pg.get())->open_shards();
     }
 
     stats.num_open_shards = num_open_shards;
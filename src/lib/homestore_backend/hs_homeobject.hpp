@@ -1,16 +1,32 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <limits>
 #include <memory>
 #include <mutex>
+#include <optional>
+#include <unordered_set>
 
+#include <homestore/checkpoint/cp_mgr.hpp>
 #include <homestore/homestore.hpp>
 #include <homestore/index/index_table.hpp>
 #include <homestore/superblk_handler.hpp>
 #include <homestore/replication/repl_dev.h>
 
+#include "blob_dedup.hpp"
+#include "blob_index_queue.hpp"
+#include "blob_location.hpp"
+#include "blob_packer.hpp"
+#include "gc_manager.hpp"
 #include "heap_chunk_selector.h"
+#include "hs_metrics.hpp"
+#include "iobuf_pool.hpp"
+#include "lib/blob_route.hpp"
 #include "lib/homeobject_impl.hpp"
 #include "replication_message.hpp"
+#include "sharded_lru_cache.hpp"
 
 namespace homestore {
 struct meta_blk;
@@ -22,9 +38,17 @@ namespace homeobject {
 class BlobRouteKey;
 class BlobRouteValue;
 using BlobIndexTable = homestore::IndexTable< BlobRouteKey, BlobRouteValue >;
+// Locations of blobs, kept in front of the BlobIndexTable of a PG.
+using BlobIndexCache = ShardedLRUCache< BlobRoute, BlobLocation >;
+// Whole verified payloads of small blobs, charged by their size in bytes.
+using BlobDataCache = ShardedLRUCache< BlobRoute, BlobView >;
+// A blob put through this replica for each content key, the candidate a put with the same key is deduplicated against.
+using BlobDedupTable = ShardedLRUCache< BlobDedupKey, blob_id_t >;
 class HomeObjCPContext;
 
 class HSHomeObject : public HomeObjectImpl {
+    friend class GCManager;
+
     /// NOTE: Be wary to change these as they effect on-disk format!
     inline static auto const _svc_meta_name = std::string("HomeObject");
     inline static auto const _pg_meta_name = std::string("PGManager");
@@ -33,12 +57,28 @@ class HSHomeObject : public HomeObjectImpl {
 
     /// Overridable Helpers
     ShardManager::AsyncResult< ShardInfo > _create_shard(pg_id_t, uint64_t size_bytes) override;
+    ShardManager::AsyncResult< InfoList > _create_shards(pg_id_t, uint32_t count, uint64_t size_bytes) override;
     ShardManager::AsyncResult< ShardInfo > _seal_shard(ShardInfo const&) override;
 
+    blob_id_t _new_blob_id(ShardInfo const&) override;
     BlobManager::AsyncResult< blob_id_t > _put_blob(ShardInfo const&, Blob&&) override;
+    BlobManager::AsyncResult< blob_id_t > _put_blob_with_id(ShardInfo const&, blob_id_t, Blob&&) override;
+    BlobManager::AsyncResult< std::vector< blob_id_t > > _put_blob_batch(ShardInfo const&,
+                                                                         std::vector< Blob >&&) override;
     BlobManager::AsyncResult< Blob > _get_blob(ShardInfo const&, blob_id_t, uint64_t off = 0,
                                                uint64_t len = 0) const override;
+    BlobManager::AsyncResult< BlobView > _get_blob_view(ShardInfo const&, blob_id_t, uint64_t off = 0,
+                                                        uint64_t len = 0) const override;
+    BlobManager::AsyncResult< std::vector< BlobManager::Result< Blob > > >
+    _get_blob_batch(ShardInfo const&, std::vector< blob_id_t > const&) const override;
     BlobManager::NullAsyncResult _del_blob(ShardInfo const&, blob_id_t) override;
+    BlobManager::NullAsyncResult _del_blob_batch(ShardInfo const&, std::vector< blob_id_t > const&) override;
+    BlobManager::NullAsyncResult _del_blob_range(ShardInfo const&, blob_id_t from, blob_id_t to) override;
+    BlobManager::NullAsyncResult _del_blob_stream(ShardInfo const&, blob_id_t) override;
+    read_token_t _read_token(pg_id_t) const override;
+    std::optional< peer_id_t > _current_leader(pg_id_t) const override;
+    BlobManager::AsyncResult< BlobList > _list_blobs(ShardInfo const&, blob_id_t start, uint32_t limit,
+                                                     BlobState filter) const override;
 
     PGManager::NullAsyncResult _create_pg(PGInfo&& pg_info, std::set< peer_id_t > const& peers) override;
     PGManager::NullAsyncResult _replace_member(pg_id_t id, peer_id_t const& old_member,
@@ -57,6 +97,9 @@ class HSHomeObject : public HomeObjectImpl {
     };
     std::unordered_map< std::string, PgIndexTable > index_table_pg_map_;
 
+    // Null if disabled by blob_data_cache_bytes.
+    std::unique_ptr< BlobDataCache > data_cache_;
+
 public:
 #pragma pack(1)
     struct pg_members {
@@ -66,6 +109,18 @@ public:
         int32_t priority{0};
     };
 
+    // Appended to pg_info_superblk after its members, a superblk without it is of version 0. It has no packed blobs.
+    struct pg_info_superblk_ext {
+        static constexpr uint8_t current_version = 1;
+        uint8_t version{current_version};
+        // Set once a pack is committed to the PG, see HS_PG::has_packed_blobs_.
+        uint8_t has_packed_blobs{0};
+        // The stats of the blobs of the PG as of the index persisted along with the superblk.
+        uint64_t num_blobs{0};
+        uint64_t used_bytes{0};
+        uint64_t deleted_bytes{0};
+    };
+
     struct pg_info_superblk {
         pg_id_t id;
         uint32_t num_members;
@@ -74,9 +129,24 @@ public:
         blob_id_t blob_sequence_num;
         pg_members members[1]; // ISO C++ forbids zero-size array
 
-        uint32_t size() const { return sizeof(pg_info_superblk) + ((num_members - 1) * sizeof(pg_members)); }
+        // Size of a version 0 superblk, which ends with its members.
+        static uint32_t legacy_size(uint32_t num_members) {
+            return sizeof(pg_info_superblk) + ((num_members - 1) * sizeof(pg_members));
+        }
+        uint32_t size() const { return legacy_size(num_members) + sizeof(pg_info_superblk_ext); }
         static std::string name() { return _pg_meta_name; }
 
+        pg_info_superblk_ext* ext() {
+            return r_cast< pg_info_superblk_ext* >(r_cast< uint8_t* >(this) + legacy_size(num_members));
+        }
+        pg_info_superblk_ext const* ext() const {
+            return r_cast< pg_info_superblk_ext const* >(r_cast< uint8_t const* >(this) + legacy_size(num_members));
+        }
+        // Whether the superblk loaded from sb_size bytes carries the current ext.
+        bool is_current(uint64_t sb_size) const {
+            return sb_size >= size() && ext()->version == pg_info_superblk_ext::current_version;
+        }
+
         pg_info_superblk() = default;
         pg_info_superblk(pg_info_superblk const& rhs) { *this = rhs; }
 
@@ -87,6 +157,7 @@ public:
             index_table_uuid = rhs.index_table_uuid;
             blob_sequence_num = rhs.blob_sequence_num;
             memcpy(members, rhs.members, sizeof(pg_members) * num_members);
+            *ext() = *rhs.ext();
             return *this;
         }
 
@@ -94,6 +165,7 @@ public:
     };
 
     struct shard_info_superblk {
+        static constexpr uint8_t current_version = 1;
         shard_id_t id;
         pg_id_t placement_group;
         ShardInfo::State state;
@@ -103,22 +175,67 @@ public:
         uint64_t total_capacity_bytes;
         uint64_t deleted_capacity_bytes;
         homestore::chunk_num_t chunk_id;
+        // Appended in version 1, a superblk that ends with chunk_id is of version 0.
+        uint8_t version;
+        // Bytes taken up by the live blobs of the shard as of the index persisted along with the superblk.
+        uint64_t used_bytes;
+
+        // Whether the superblk loaded from sb_size bytes carries the current fields.
+        bool is_current(uint64_t sb_size) const {
+            return sb_size >= sizeof(shard_info_superblk) && version == current_version;
+        }
     };
 #pragma pack()
 
     struct HS_PG : public PG {
         // Only accessible during PG creation, after that it is not accessible.
         homestore::superblk< pg_info_superblk > pg_sb_;
-        pg_info_superblk* cache_pg_sb_{nullptr}; // always up-to-date;
+        pg_info_superblk* cache_pg_sb_{nullptr}; // only touched by cp_flush, up-to-date as of the last CP;
+        // Set by the io path whenever blob_sequence_num_ moves, cleared when cp_flush snapshots the PG.
+        std::atomic< bool > is_dirty_{false};
         shared< homestore::ReplDev > repl_dev_;
 
         std::optional< homestore::chunk_num_t > any_allocated_chunk_id_{};
         std::shared_ptr< BlobIndexTable > index_table_;
+        // Null if disabled by blob_index_cache_entries.
+        std::unique_ptr< BlobIndexCache > index_cache_;
+        // Applies the index puts of committed blobs off the commit path, set up by add_pg_to_map.
+        shared< BlobIndexQueue > index_queue_;
+        // Held by GC to swap the blkids of a blob it moved and by deletes to tombstone and free them, so a delete
+        // always frees the blocks the index points at.
+        std::mutex gc_mtx_;
+        // Highest lsn of the log of the PG this replica has applied, the read token get_local() checks. Starts over
+        // from the logs replayed at restart, until then the reads of older tokens go to the leader.
+        std::atomic< int64_t > applied_lsn_{0};
+        // Puts to the PG admitted and not completed yet, and the bytes of their bodies and user keys.
+        std::atomic< uint32_t > inflight_puts_{0};
+        std::atomic< uint64_t > inflight_put_bytes_{0};
+        // Null unless blob_dedup_enabled.
+        std::unique_ptr< BlobDedupTable > dedup_table_;
+        // Set for good by the first pack committed to the PG, before any of its blobs reach the index. Until then no
+        // blob of the PG has a packed range to look up.
+        std::atomic< bool > has_packed_blobs_{false};
+        // Changes to the blob stats made under a CP, by the parity of its id, folded into the superblk when that CP
+        // flushes. A CP flushes once its io is done and before the CP after the next one starts, so two slots do.
+        struct StatsDelta {
+            std::atomic< int64_t > num_blobs{0};
+            std::atomic< int64_t > used_bytes{0};
+            std::atomic< uint64_t > deleted_bytes{0};
+        };
+        std::array< StatsDelta, 2 > cp_stats_;
 
         HS_PG(PGInfo info, shared< homestore::ReplDev > rdev, shared< BlobIndexTable > index_table);
         HS_PG(homestore::superblk< pg_info_superblk >&& sb, shared< homestore::ReplDev > rdev);
 
         void init_cp();
+        void init_index_cache();
+        void init_dedup_table();
+
+        // Marks the PG to be persisted by the current CP. Costs a single atomic store on the io path.
+        void mark_dirty();
+        // Moves applied_lsn_ up to lsn if it is behind.
+        void advance_applied_lsn(int64_t lsn);
+        bool has_packed_blobs() const { return has_packed_blobs_.load(std::memory_order_acquire); }
 
         virtual ~HS_PG() {
             if (cache_pg_sb_) {
@@ -130,10 +247,8 @@ public:
         static PGInfo pg_info_from_sb(homestore::superblk< pg_info_superblk > const& sb);
 
         ///////////////// PG stats APIs /////////////////
-        /// Note: Caller needs to hold the _pg_lock before calling these apis
         /**
          * Returns the total number of created shards on this PG.
-         * It is caller's responsibility to hold the _pg_lock.
          */
         uint32_t total_shards() const;
 
@@ -144,6 +259,7 @@ public:
 
         /**
          * Retrieves the device hint associated with this PG(if any shard is created).
+         * It is caller's responsibility to hold mtx_.
          *
          * @param selector The HeapChunkSelector object.
          * @return An optional uint32_t value representing the device hint, or std::nullopt if no hint is available.
@@ -152,30 +268,62 @@ public:
     };
 
     struct HS_Shard : public Shard {
-        homestore::superblk< shard_info_superblk > sb_;
+        homestore::superblk< shard_info_superblk > sb_; // written by cp_flush only;
+        // Set by the parity of the id of a CP once the shard is queued in its dirty list, cleared when that CP copies
+        // the info and its used bytes into sb_. A shard queued for a CP still to flush can be queued for the next one.
+        std::array< std::atomic< bool >, 2 > is_dirty_{};
+        // Bytes the live blobs of the shard take up on the device, which is what it keeps once sealed. Kept by the
+        // commits of its puts and deletes, persisted in sb_ like the stats of the PG.
+        std::atomic< uint64_t > used_bytes_{0};
+        // Changes to used_bytes_ by the parity of the id of the CP they were made under, see HS_PG::cp_stats_.
+        std::array< std::atomic< int64_t >, 2 > cp_used_bytes_{};
         HS_Shard(ShardInfo info, homestore::chunk_num_t chunk_id);
         HS_Shard(homestore::superblk< shard_info_superblk >&& sb);
         ~HS_Shard() override = default;
 
+        // Caller needs to hold the mtx_ of the PG.
         void update_info(const ShardInfo& info);
-        void write_sb();
+        // Queues the shard to have its superblk written by the current CP, or by cp whose guard the caller holds.
+        void mark_dirty();
+        void mark_dirty(homestore::CP& cp);
+        bool is_dirty() const { return is_dirty_[0].load() || is_dirty_[1].load(); }
+        // Copies info into sb_ without writing it; caller needs to hold the mtx_ of the PG.
+        void update_sb();
         auto chunk_id() const { return sb_->chunk_id; }
+        // Moves the shard onto chunk_id once GC copied its blobs there; caller needs to hold the mtx_ of the PG.
+        void set_chunk_id(homestore::chunk_num_t chunk_id);
         static ShardInfo shard_info_from_sb(homestore::superblk< shard_info_superblk > const& sb);
     };
 
 #pragma pack(1)
     // Every blob payload stored in disk as blob header | blob data | blob metadata(optional) | padding.
     // Padding of zeroes is added to make sure the whole payload be aligned to device block size.
+    // Since v2, blobs larger than blob_segment_size carry a CRC32C table right after the header with one entry per
+    // segment of blob data followed by one for the user key, so a ranged get can verify only the blocks it reads.
+    // Since v3, a user key that fits in the first block together with the header and the table is stored right after
+    // them, ahead of the blob data, and user_key_offset is from the start of the header.
+    // Since v4, the blob data may be compressed with codec in independent frames of blob_segment_size bytes of the
+    // blob. The hash and the checksum table then cover the compressed frames, and blobs of more than one frame list
+    // the compressed size of each frame after the checksum table.
     struct BlobHeader {
         static constexpr uint64_t blob_max_hash_len = 32;
-        static constexpr uint8_t blob_header_version = 0x01;
+        static constexpr uint8_t blob_header_version = 0x04;
+        static constexpr uint64_t blob_io_align = 512;
         static constexpr uint64_t blob_header_magic = 0x21fdffdba8d68fc6; // echo "BlobHeader" | md5sum
+        static constexpr uint32_t blob_segment_size = 32 * Ki;
 
         enum class HashAlgorithm : uint8_t {
             NONE = 0,
             CRC32 = 1,
             MD5 = 2,
             SHA1 = 3,
+            CRC32C = 4, // crc32_iscsi, uses the SSE4.2 / ARMv8 crc32 instructions when available.
+            XXH3 = 5,   // 64 bit XXH3.
+        };
+
+        enum class Codec : uint8_t {
+            NONE = 0,
+            LZ4 = 1,
         };
 
         uint64_t magic{blob_header_magic};
@@ -184,16 +332,130 @@ public:
         uint8_t hash[blob_max_hash_len]{};
         shard_id_t shard_id;
         blob_id_t blob_id;
-        uint32_t blob_size{};
+        uint32_t blob_size{}; // Size of the blob, before compression.
         uint64_t object_offset{};   // Offset of this blob in the object. Provided by GW.
-        uint32_t user_key_offset{}; // Offset of metadata stored after the blob data.
+        uint32_t user_key_offset{}; // Offset of metadata, from the blob data before v3.
         uint32_t user_key_size{};
+        // v2 fields, not present in v1 headers.
+        uint32_t data_offset{};  // Offset of the blob data from the start of the header.
+        uint32_t segment_size{}; // Segment size of the checksum table, 0 if the blob has none.
+        uint32_t num_segments{}; // Number of data segments in the checksum table.
+        uint8_t flags{};
+        // v4 fields, not present in earlier headers.
+        Codec codec{Codec::NONE};
+        uint32_t stored_size{}; // Size of the compressed blob data, 0 unless compressed.
+
+        // Size of the header of version, the tables start right after it.
+        static uint32_t fixed_size(uint8_t version) {
+            return (version >= 0x04) ? sizeof(BlobHeader) : offsetof(BlobHeader, codec);
+        }
+        bool valid() const { return magic == blob_header_magic && version <= blob_header_version; }
+        bool has_segment_crcs() const { return version >= 0x02 && segment_size != 0; }
+        bool compressed() const { return version >= 0x04 && codec != Codec::NONE; }
+        // Bytes of blob data stored on disk.
+        uint64_t data_size() const { return compressed() ? stored_size : blob_size; }
+        const uint32_t* segment_crcs() const {
+            return r_cast< const uint32_t* >(r_cast< const uint8_t* >(this) + fixed_size(version));
+        }
+        uint32_t* segment_crcs() { return r_cast< uint32_t* >(r_cast< uint8_t* >(this) + fixed_size(version)); }
+        // Compressed sizes of the frames, for compressed blobs with a checksum table.
+        const uint32_t* frame_sizes() const { return segment_crcs() + num_segments + 1; }
+        uint32_t* frame_sizes() { return segment_crcs() + num_segments + 1; }
+        // Offset of a compressed frame from the start of the blob data.
+        uint64_t frame_start(uint32_t frame) const {
+            uint64_t start{0};
+            for (uint32_t i = 0; i < frame; ++i) {
+                start += frame_sizes()[i];
+            }
+            return start;
+        }
+        uint32_t frame_size(uint32_t frame) const { return (num_segments == 0) ? stored_size : frame_sizes()[frame]; }
+        // Offsets of the blob data and of the user key from the start of the header. v1 headers do not record the
+        // data offset, their data always starts at the next blob_io_align boundary.
+        uint64_t data_start() const {
+            return (version >= 0x02) ? data_offset : sisl::round_up(fixed_size(version), blob_io_align);
+        }
+        uint64_t user_key_start() const { return (version >= 0x03) ? user_key_offset : data_start() + user_key_offset; }
+        static uint32_t num_segments_for(uint64_t blob_size) {
+            return blob_size > blob_segment_size ? sisl::round_up(blob_size, blob_segment_size) / blob_segment_size : 0;
+        }
+        // Sizes of the checksum table and of it together with the frame sizes of a compressed blob.
+        static uint32_t segment_table_size(uint32_t num_segments) {
+            return (num_segments == 0) ? 0 : (num_segments + 1) * sizeof(uint32_t);
+        }
+        static uint32_t table_size(uint32_t num_segments, bool compressed) {
+            return segment_table_size(num_segments) + (compressed ? num_segments * sizeof(uint32_t) : 0);
+        }
 
-        bool valid() const { return magic == blob_header_magic || version <= blob_header_version; }
+        // Space taken ahead of the blob data by a header of version, its tables and, from v3, the user key if all of
+        // them fit in one device block. The user key follows the blob data otherwise.
+        struct Layout {
+            uint32_t size;
+            bool key_inline;
+        };
+        static Layout layout(uint8_t version, uint32_t table_size, uint64_t user_key_size, uint32_t dev_block_size) {
+            auto const fixed_size = BlobHeader::fixed_size(version) + table_size;
+            auto const inline_size = sisl::round_up(fixed_size + user_key_size, blob_io_align);
+            if (version >= 0x03 && user_key_size != 0 && inline_size <= dev_block_size) {
+                return Layout{.size = s_cast< uint32_t >(inline_size), .key_inline = true};
+            }
+            return Layout{.size = s_cast< uint32_t >(sisl::round_up(fixed_size, blob_io_align)), .key_inline = false};
+        }
         std::string to_string() {
-            return fmt::format("magic={:#x} version={} shard={} blob_size={} user_size={} algo={} hash={}\n", magic,
-                               version, shard_id, blob_size, user_key_size, (uint8_t)hash_algorithm,
-                               spdlog::to_hex(hash, hash + blob_max_hash_len));
+            return fmt::format(
+                "magic={:#x} version={} shard={} blob_size={} user_size={} algo={} codec={} stored_size={} hash={}\n",
+                magic, version, shard_id, blob_size, user_key_size, (uint8_t)hash_algorithm,
+                (version >= 0x04) ? (uint8_t)codec : 0, (version >= 0x04) ? stored_size : 0,
+                spdlog::to_hex(hash, hash + blob_max_hash_len));
+        }
+    };
+
+    // Key of a PUT_BLOB_BATCH_MSG. Blobs of the batch are stored back to back in the allocated blocks, each one
+    // occupying blk_counts[i] device blocks, and get consecutive blob ids starting at start_blob_id.
+    struct BlobBatchKey {
+        blob_id_t start_blob_id;
+        uint32_t num_blobs;
+        uint32_t blk_counts[1]; // ISO C++ forbids zero-size array
+
+        static uint32_t size(uint32_t num_blobs) {
+            return sizeof(BlobBatchKey) + ((num_blobs - 1) * sizeof(uint32_t));
+        }
+    };
+
+    // Key of a PUT_BLOB_PACK_MSG. The payloads of the small blobs of a pack are stored back to back in the allocated
+    // blocks, records[i] giving the byte range of the i-th one from the start of the first block, and get
+    // consecutive blob ids starting at start_blob_id.
+    struct BlobPackKey {
+        struct Record {
+            uint32_t offset;
+            uint32_t size;
+        };
+        blob_id_t start_blob_id;
+        uint32_t num_blobs;
+        Record records[1]; // ISO C++ forbids zero-size array
+
+        static uint32_t size(uint32_t num_blobs) {
+            return sizeof(BlobPackKey) + ((num_blobs - 1) * sizeof(Record));
+        }
+    };
+
+    // Key of a PUT_BLOB_DEDUP_MSG: blob_id takes the blocks of source_blob_id, a blob of the same shard.
+    struct BlobDedupRefKey {
+        blob_id_t blob_id;
+        blob_id_t source_blob_id;
+    };
+
+    // Key of a DEL_BLOB_BATCH_MSG. Carries the range [range_start, range_end) of blob ids to delete, empty for none,
+    // and num_blobs more blob ids to delete.
+    struct BlobDelBatchKey {
+        blob_id_t range_start;
+        blob_id_t range_end;
+        uint32_t num_blobs;
+        blob_id_t blob_ids[1]; // ISO C++ forbids zero-size array
+
+        bool has_range() const { return range_start < range_end; }
+        static uint32_t size(uint32_t num_blobs) {
+            return sizeof(BlobDelBatchKey) + ((std::max(num_blobs, 1u) - 1) * sizeof(blob_id_t));
         }
     };
 #pragma pack()
@@ -201,20 +463,36 @@ public:
     struct BlobInfo {
         shard_id_t shard_id;
         blob_id_t blob_id;
-        homestore::MultiBlkId pbas;
-    };
-
-    enum class BlobState : uint8_t {
-        ALIVE = 0,
-        TOMBSTONE = 1,
-        ALL = 2,
+        BlobLocation pbas;
     };
 
     inline const static homestore::MultiBlkId tombstone_pbas{0, 0, 0};
 
+    enum class ShardPlacementPolicy : uint8_t {
+        PG_AFFINITY = 0, // every shard of a PG on the device of its first shard.
+        STRIPE = 1,      // open shards of a PG spread across devices, see HeapChunkSelector::select_pdev_for_pg.
+    };
+
 private:
     shared< HeapChunkSelector > chunk_selector_;
     bool recovery_done_{false};
+    // Null unless gc_enabled.
+    std::unique_ptr< GCManager > gc_manager_;
+    // Null unless blob_pack_enabled.
+    shared< BlobPacker > blob_packer_;
+    // Unique among the instances of the process, tells apart the thread local caches filled by each of them.
+    inline static std::atomic< uint64_t > next_instance_id_{1};
+    uint64_t const instance_id_{next_instance_id_.fetch_add(1, std::memory_order_relaxed)};
+    // Updated from the const read paths as well.
+    mutable HomeObjectMetrics metrics_{std::to_string(instance_id_)};
+    // Puts admitted on this node and not completed yet, and the bytes of their bodies and user keys.
+    std::atomic< uint32_t > inflight_puts_{0};
+    std::atomic< uint64_t > inflight_put_bytes_{0};
+    // shards found by meta blk recovery, only accessed by the meta blk recovery callbacks;
+    std::unordered_map< pg_id_t, std::vector< ShardPtr > > recovered_shards_;
+    // pgs with a superblk of theirs or of a shard written before the blob stats were persisted, recounted once the
+    // log is replayed;
+    std::unordered_set< pg_id_t > legacy_stats_pgs_;
 
 private:
     static homestore::ReplicationService& hs_repl_service() { return homestore::hs()->repl_service(); }
@@ -226,23 +504,94 @@ private:
     void add_pg_to_map(unique< HS_PG > hs_pg);
 
     // create shard related
-    shard_id_t generate_new_shard_id(pg_id_t pg);
+    // Reserves count consecutive shard ids in pg and returns the first of them.
+    shard_id_t generate_new_shard_id(pg_id_t pg, uint32_t count = 1);
+    ShardManager::AsyncResult< ShardInfo > replicate_create_shard(shared< homestore::ReplDev > repl_dev,
+                                                                  ShardInfo const& info);
     uint64_t get_sequence_num_from_shard_id(uint64_t shard_id_t);
 
+    // delete blob related
+    // Replicates a DEL_BLOB_BATCH_MSG for the range [range_start, range_end) and blob_ids, either may be empty.
+    BlobManager::NullAsyncResult replicate_del_blob_batch(ShardInfo const& shard, blob_id_t range_start,
+                                                          blob_id_t range_end,
+                                                          std::vector< blob_id_t > const& blob_ids);
+
     static ShardInfo deserialize_shard_info(const char* shard_info_str, size_t size);
-    static std::string serialize_shard_info(const ShardInfo& info);
+    static ShardInfoMessage serialize_shard_info(const ShardInfo& info);
     void add_new_shard_to_map(ShardPtr&& shard);
+    // Adds shards of one pg to the maps under a single acquisition of the pg lock.
+    void add_new_shards_to_map(pg_id_t pg_id, std::vector< ShardPtr >&& shards);
     void update_shard_in_map(const ShardInfo& shard_info);
     void do_shard_message_commit(int64_t lsn, ReplicationMessageHeader& header, homestore::MultiBlkId const& blkids,
                                  sisl::blob value, cintrusive< homestore::repl_req_ctx >& hs_ctx);
+    // Accounts a blob of shard_id added to or deleted from the index, in the stats of the shard and of its PG. The
+    // caller holds a CP guard over the index update, so the change is persisted by the same CP as the update.
+    void on_blob_added(HS_PG& pg, shard_id_t shard_id, blob_id_t blob_id, uint64_t bytes);
+    void on_blob_deleted(HS_PG& pg, shard_id_t shard_id, blob_id_t blob_id, uint64_t bytes);
+    // Tells from the header alone whether a replayed shard message is already reflected by the recovered shards.
+    bool is_shard_message_applied(ReplicationMessageHeader const& header) const;
     // recover part
     void register_homestore_metablk_callback();
     void on_pg_meta_blk_found(sisl::byte_view const& buf, void* meta_cookie);
     void on_shard_meta_blk_found(homestore::meta_blk* mblk, sisl::byte_view buf);
     void on_shard_meta_blk_recover_completed(bool success);
-
     void persist_pg_sb();
 
+    // blob dedup related
+    // Puts blob as a reference to the blocks of an identical blob of the shard if there is one, as a new blob
+    // otherwise.
+    BlobManager::AsyncResult< blob_id_t > put_blob_dedup(ShardInfo const& shard, Blob&& blob);
+    // Replicates a PUT_BLOB_DEDUP_MSG for a new blob with the content of source_blob_id. The put is admitted by the
+    // caller.
+    BlobManager::AsyncResult< blob_id_t > replicate_dedup_ref(ShardInfo const& shard, blob_id_t new_blob_id,
+                                                              blob_id_t source_blob_id);
+    // The number of index entries pointing at an extent shared by several blobs is kept in the index, at
+    // extent_refs_route() of its first block, an extent without one has a single blob on it. All changes to the
+    // counts are made under gc_mtx_.
+    // Adds refs (removes -refs) index entries pointing at the extent of pbas, returns how many there were before.
+    static BlobManager::Result< uint64_t > add_extent_refs(HS_PG& pg, homestore::MultiBlkId const& pbas, int64_t refs);
+    // Adds the entry of a blob deduplicated onto the extent of blob_info.pbas and counts the reference, Ok(false) if
+    // the blob is already in the index, live or tombstoned.
+    BlobManager::Result< bool > add_dedup_ref_to_index_table(HS_PG& pg, BlobInfo const& blob_info);
+    // Drops the references of the blobs going away to the extents they share, leaving out of blob_infos those whose
+    // extent is still referenced so its blocks are not freed. On error blob_infos is left empty, so nothing is freed.
+    static BlobManager::NullResult unshare_extents(HS_PG& pg, std::vector< BlobInfo >& blob_infos);
+
+    // blob put related
+    // Takes ops puts carrying bytes of bodies and user keys out of the in-flight budgets of the node and the PG,
+    // false if that would take either over its limit. Admitted puts are handed back with release_put().
+    bool admit_put(HS_PG& pg, uint32_t ops, uint64_t bytes);
+    void release_put(HS_PG& pg, uint32_t ops, uint64_t bytes);
+    // The write of _put_blob_with_id() for a put already admitted, released once the write completes.
+    BlobManager::AsyncResult< blob_id_t > write_admitted_blob(ShardInfo const& shard, blob_id_t new_blob_id,
+                                                              Blob&& blob);
+    uint32_t add_blob_payload(sisl::sg_list& sgs, IOBufPool::BufList& bufs, Blob const& blob, shard_id_t shard_id,
+                              blob_id_t blob_id, uint32_t dev_block_size) const;
+    static homestore::MultiBlkId sub_blkids(homestore::MultiBlkId const& blkids, uint32_t blk_offset, uint32_t nblks);
+    // Lays a small blob out at dst as a packed record: blob header | blob data | blob metadata(optional), each part
+    // aligned to pack_align only. Returns the size of the record.
+    uint32_t add_packed_blob_record(uint8_t* dst, Blob const& blob, shard_id_t shard_id, blob_id_t blob_id) const;
+    // Flush function of the BlobPacker, writes the blobs of a pack as one PUT_BLOB_PACK_MSG.
+    void write_blob_pack(ShardInfo const& shard, std::vector< BlobPacker::Pending >&& blobs);
+    std::optional< BlobDataCache::epoch_t > data_cache_epoch(BlobRoute const& route, Blob const& blob) const;
+    void add_to_data_cache(BlobRoute const& route, Blob&& blob, BlobDataCache::epoch_t epoch) const;
+
+    // blob get related
+    // _get_blob_view without its metrics: looks the blob up in the caches and the index and reads it.
+    BlobManager::AsyncResult< BlobView > do_get_blob_view(ShardInfo const& shard, blob_id_t blob_id,
+                                                          uint64_t req_offset, uint64_t req_len) const;
+    BlobManager::Result< BlobHeader const* > verify_blob_header(uint8_t const* buf, shard_id_t shard_id,
+                                                                blob_id_t blob_id) const;
+    // Verifies the header and hash of a whole blob payload at buf, returning a view of all of the blob.
+    BlobManager::Result< BlobView > verify_blob(std::shared_ptr< const void > holder, uint8_t const* buf,
+                                                shard_id_t shard_id, blob_id_t blob_id) const;
+    BlobManager::AsyncResult< BlobView > read_blob(shared< homestore::ReplDev > repl_dev, shard_id_t shard_id,
+                                               blob_id_t blob_id, BlobLocation const& multi_blkids,
+                                               uint64_t req_offset, uint64_t req_len) const;
+    BlobManager::AsyncResult< BlobView > read_blob_range(shared< homestore::ReplDev > repl_dev, shard_id_t shard_id,
+                                                     blob_id_t blob_id, homestore::MultiBlkId const& multi_blkids,
+                                                     uint64_t req_offset, uint64_t req_len) const;
+
 public:
     using HomeObjectImpl::HomeObjectImpl;
     ~HSHomeObject() override;
@@ -266,6 +615,47 @@ public:
      */
     void init_cp();
 
+    /**
+     * @brief Starts the background compaction of fragmented chunks, if enabled by gc_enabled.
+     *
+     */
+    void init_gc();
+
+    /**
+     * @brief Sets up the packing of small blob puts, if enabled by blob_pack_enabled.
+     *
+     */
+    void init_blob_packer();
+
+    /**
+     * @brief Recounts from the index the blob stats of the PGs whose superblks, or those of their shards, were
+     * written before the stats were persisted. Runs once the log is replayed.
+     *
+     */
+    void recount_legacy_stats();
+
+    /**
+     * @brief Adds the superblk of every PG marked dirty or with its blob stats changed by the flushing CP to the
+     * dirty list of that CP.
+     *
+     * @param cp_ctx The context of the CP being flushed.
+     * @param cp_id The id of the CP being flushed.
+     */
+    void collect_dirty_pgs(HomeObjCPContext& cp_ctx, homestore::cp_id_t cp_id);
+
+    /**
+     * @brief Copies the info and the used bytes of every shard in the dirty list of the flushing CP into its superblk.
+     *
+     * @param cp_ctx The context of the CP being flushed.
+     * @param cp_id The id of the CP being flushed.
+     * @param writes Gets one write of a shard superblk appended per dirty shard, to be issued by the caller.
+     */
+    void collect_dirty_shards(HomeObjCPContext& cp_ctx, homestore::cp_id_t cp_id,
+                              std::vector< std::function< void() > >& writes);
+
+    // Runs the superblk writes of a CP flush.
+    folly::Executor::KeepAlive<> cp_flush_executor() const { return executor_; }
+
     /**
      * @brief Callback function invoked when createPG message is committed on a shard.
      *
@@ -306,6 +696,7 @@ public:
     std::optional< homestore::chunk_num_t > get_any_chunk_id(pg_id_t const pg);
 
     cshared< HeapChunkSelector > chunk_selector() const { return chunk_selector_; }
+    BlobDataCache const* data_cache() const { return data_cache_.get(); }
 
     bool on_pre_commit_shard_msg(int64_t lsn, sisl::blob const& header, sisl::blob const& key,
                                  cintrusive< homestore::repl_req_ctx >&);
@@ -314,13 +705,27 @@ public:
     void on_shard_message_commit(int64_t lsn, sisl::blob const& header, sisl::blob const& key,
                                  cintrusive< homestore::repl_req_ctx >& hs_ctx);
 
+    // Called by the state machine once the log entry at lsn of the PG is applied; puts call advance_applied_lsn()
+    // themselves before returning, so the token of a put covers it.
+    void on_log_applied(pg_id_t pg_id, int64_t lsn);
+
     // Blob manager related.
     void on_blob_put_commit(int64_t lsn, sisl::blob const& header, sisl::blob const& key,
                             const homestore::MultiBlkId& pbas, cintrusive< homestore::repl_req_ctx >& hs_ctx);
+    void on_blob_put_batch_commit(int64_t lsn, sisl::blob const& header, sisl::blob const& key,
+                                  const homestore::MultiBlkId& pbas, cintrusive< homestore::repl_req_ctx >& hs_ctx);
+    void on_blob_put_pack_commit(int64_t lsn, sisl::blob const& header, sisl::blob const& key,
+                                 const homestore::MultiBlkId& pbas, cintrusive< homestore::repl_req_ctx >& hs_ctx);
     void on_blob_del_commit(int64_t lsn, sisl::blob const& header, sisl::blob const& key,
                             cintrusive< homestore::repl_req_ctx >& hs_ctx);
+    void on_blob_put_dedup_commit(int64_t lsn, sisl::blob const& header, sisl::blob const& key,
+                                  cintrusive< homestore::repl_req_ctx >& hs_ctx);
+    void on_blob_del_batch_commit(int64_t lsn, sisl::blob const& header, sisl::blob const& key,
+                                  cintrusive< homestore::repl_req_ctx >& hs_ctx);
     homestore::blk_alloc_hints blob_put_get_blk_alloc_hints(sisl::blob const& header,
                                                             cintrusive< homestore::repl_req_ctx >& ctx);
+    // Picks the device of the chunk a new shard of the PG binds, as set by shard_placement_policy.
+    homestore::blk_alloc_hints shard_create_get_blk_alloc_hints(pg_id_t pg_id);
     void compute_blob_payload_hash(BlobHeader::HashAlgorithm algorithm, const uint8_t* blob_bytes, size_t blob_size,
                                    const uint8_t* user_key_bytes, size_t user_key_size, uint8_t* hash_bytes,
                                    size_t hash_len) const;
@@ -329,13 +734,43 @@ public:
 
     std::shared_ptr< BlobIndexTable > recover_index_table(homestore::superblk< homestore::index_table_sb >&& sb);
 
-    BlobManager::NullResult add_to_index_table(shared< BlobIndexTable > index_table, const BlobInfo& blob_info);
-
-    BlobManager::Result< homestore::MultiBlkId >
-    get_blob_from_index_table(shared< BlobIndexTable > index_table, shard_id_t shard_id, blob_id_t blob_id) const;
-
-    BlobManager::Result< homestore::MultiBlkId > move_to_tombstone(shared< BlobIndexTable > index_table,
-                                                                   const BlobInfo& blob_info);
+    // Ok(false) if the blob is already in the index, live or tombstoned.
+    BlobManager::Result< bool > add_to_index_table(shared< BlobIndexTable > index_table, const BlobInfo& blob_info);
+    BlobManager::NullResult add_to_index_table(shared< BlobIndexTable > index_table,
+                                               std::vector< BlobInfo > const& blob_infos);
+
+    // The lookups below only look for packed ranges in a PG that has packed blobs, the others take one btree walk
+    // per blob.
+    BlobManager::Result< BlobLocation > get_blob_from_index_table(HS_PG const& pg, shard_id_t shard_id,
+                                                                  blob_id_t blob_id) const;
+    // Results are in the order of blob_ids. Dense ids are resolved with a single range query.
+    std::vector< BlobManager::Result< BlobLocation > >
+    get_blobs_from_index_table(HS_PG const& pg, shard_id_t shard_id, std::vector< blob_id_t > const& blob_ids) const;
+
+    BlobManager::Result< BlobLocation > move_to_tombstone(HS_PG const& pg, const BlobInfo& blob_info);
+    // Results are in the order of blob_infos, each holding the blkids the blob pointed at before.
+    std::vector< BlobManager::Result< BlobLocation > > move_to_tombstone(HS_PG const& pg,
+                                                                         std::vector< BlobInfo > const& blob_infos);
+    // Pages through the index entries of the shard from start on, sizes are taken from the blkids.
+    BlobManager::Result< BlobList > list_blobs_from_index_table(HS_PG const& pg, shard_id_t shard_id, blob_id_t start,
+                                                                uint32_t limit, BlobState filter,
+                                                                uint32_t blk_size) const;
+    // Tombstones every live blob of the shard with an id in [from, to) using a single range update. Returns the
+    // blobs that were live along with the blkids they pointed at.
+    BlobManager::Result< std::vector< BlobInfo > > move_range_to_tombstone(HS_PG const& pg, shard_id_t shard_id,
+                                                                           blob_id_t from, blob_id_t to);
+    // Every index entry of the shard with a blob id in [from, to], tombstones included.
+    BlobManager::Result< std::vector< BlobInfo > >
+    get_shard_blob_infos(HS_PG const& pg, shard_id_t shard_id, blob_id_t from = 0,
+                         blob_id_t to = std::numeric_limits< blob_id_t >::max()) const;
+    // The blocks to free once the blobs are no longer in the index. The first and last blocks of a packed blob are
+    // left out while a live blob packed with it still shares them, the blob removed last frees them.
+    std::vector< homestore::MultiBlkId > blks_to_free(HS_PG const& pg, std::vector< BlobInfo > const& blob_infos) const;
+    // Points the blob at new_pbas if it still is at blob_info.pbas, keeping its packed range, UNKNOWN_BLOB otherwise.
+    // Caller holds gc_mtx_.
+    BlobManager::NullResult replace_blob_pbas(HS_PG const& pg, const BlobInfo& blob_info,
+                                              homestore::MultiBlkId const& new_pbas);
+    BlobManager::NullResult remove_from_index_table(HS_PG const& pg, BlobRoute const& route);
     void print_btree_index(pg_id_t pg_id);
 
     // void trigger_timed_events();
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+
+#include <sisl/metrics/metrics.hpp>
+
+namespace homeobject {
+
+///
+// Latencies and counters of the blob operations of an HSHomeObject, registered with the sisl MetricsFarm so they are
+// reported along with the HomeStore metrics, e.g. by the Prometheus exporter of the application.
+//
+// put, get and del are timed end to end, and their phases separately: put from the alloc and write of its data until
+// its commit, then from the commit until its index entry is applied; the index puts and gets, the device reads and
+// the payload hash computation on both the write and the read path. All latencies are in microseconds. The gauges
+// follow the puts admitted on the node and not completed yet.
+class HomeObjectMetrics : public sisl::MetricsGroup {
+public:
+    explicit HomeObjectMetrics(std::string const& instance_name) : sisl::MetricsGroup("HomeObject", instance_name) {
+        REGISTER_HISTOGRAM(put_blob_latency, "Put blob latency", HistogramBucketsType(OpLatecyBuckets));
+        REGISTER_HISTOGRAM(get_blob_latency, "Get blob latency", HistogramBucketsType(OpLatecyBuckets));
+        REGISTER_HISTOGRAM(del_blob_latency, "Delete blob latency", HistogramBucketsType(OpLatecyBuckets));
+        REGISTER_HISTOGRAM(blob_alloc_write_latency, "Put blob alloc and write until commit latency",
+                           HistogramBucketsType(OpLatecyBuckets));
+        REGISTER_HISTOGRAM(blob_commit_latency, "Put blob commit until indexed latency",
+                           HistogramBucketsType(OpLatecyBuckets));
+        REGISTER_HISTOGRAM(blob_index_put_latency, "Blob index put latency", HistogramBucketsType(OpLatecyBuckets));
+        REGISTER_HISTOGRAM(blob_index_get_latency, "Blob index get latency", HistogramBucketsType(OpLatecyBuckets));
+        REGISTER_HISTOGRAM(blob_read_latency, "Blob device read latency", HistogramBucketsType(OpLatecyBuckets));
+        REGISTER_HISTOGRAM(blob_hash_latency, "Blob payload hash latency", HistogramBucketsType(OpLatecyBuckets));
+
+        REGISTER_COUNTER(put_blob_bytes, "Bytes of blob bodies and user keys put");
+        REGISTER_COUNTER(get_blob_bytes, "Bytes of blob bodies and user keys returned by gets");
+        REGISTER_COUNTER(blob_checksum_mismatch_count, "Blob reads failing their checksum");
+        REGISTER_COUNTER(blob_unaligned_copy_count, "Blob puts copying a body not aligned to io_align");
+        REGISTER_COUNTER(blob_index_cache_hit_count, "Blob locations found in the index cache");
+        REGISTER_COUNTER(blob_index_cache_miss_count, "Blob locations looked up in the index table");
+        REGISTER_COUNTER(put_retry_later_count, "Puts refused with RETRY_LATER by admission control");
+        REGISTER_COUNTER(blob_dedup_hit_count, "Puts referring to the blocks of an identical blob");
+        REGISTER_COUNTER(blob_dedup_bytes, "Bytes of blob bodies and user keys not written thanks to dedup");
+        REGISTER_COUNTER(blob_dedup_mismatch_count, "Dedup candidates found to differ from the put blob");
+
+        REGISTER_GAUGE(inflight_puts, "Puts admitted and not completed yet");
+        REGISTER_GAUGE(inflight_put_bytes, "Bytes of blob bodies and user keys of the puts in flight");
+
+        register_me_to_farm();
+    }
+
+    HomeObjectMetrics(HomeObjectMetrics const&) = delete;
+    HomeObjectMetrics& operator=(HomeObjectMetrics const&) = delete;
+
+    ~HomeObjectMetrics() { deregister_me_from_farm(); }
+
+    using clock = std::chrono::steady_clock;
+    static uint64_t elapsed_us(clock::time_point start) {
+        return std::chrono::duration_cast< std::chrono::microseconds >(clock::now() - start).count();
+    }
+};
+
+} // namespace homeobject
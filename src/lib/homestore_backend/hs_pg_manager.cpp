@@ -4,6 +4,7 @@
 #include "hs_homeobject.hpp"
 #include "replication_state_machine.hpp"
 #include "hs_hmobj_cp.hpp"
+#include "hs_backend_config.hpp"
 
 using namespace homestore;
 namespace homeobject {
@@ -59,12 +60,12 @@ PGError toPgError(ReplServiceError const& e) {
 
 PGManager::NullAsyncResult HSHomeObject::_create_pg(PGInfo&& pg_info, std::set< peer_id_t > const& peers) {
     auto pg_id = pg_info.id;
-    if (auto lg = std::shared_lock(_pg_lock); _pg_map.end() != _pg_map.find(pg_id)) return folly::Unit();
+    if (_get_pg(pg_id)) return folly::Unit();
 
     pg_info.replica_set_uuid = boost::uuids::random_generator()();
     return hs_repl_service()
         .create_repl_dev(pg_info.replica_set_uuid, peers)
-        .via(executor_)
+        .via(_pg_executor(pg_id))
         .thenValue([this, pg_info = std::move(pg_info)](auto&& v) mutable -> PGManager::NullAsyncResult {
             if (v.hasError()) { return folly::makeUnexpected(toPgError(v.error())); }
             // we will write a PGHeader across the raft group and when it is committed
@@ -130,7 +131,7 @@ void HSHomeObject::on_create_pg_message_commit(int64_t lsn, sisl::blob const& he
 
     auto pg_info = deserialize_pg_info(serailized_pg_info_buf, serailized_pg_info_size);
     auto pg_id = pg_info.id;
-    if (auto lg = std::shared_lock(_pg_lock); _pg_map.end() != _pg_map.find(pg_id)) {
+    if (_get_pg(pg_id)) {
         LOGW("PG already exists, lsn:{}, pg_id {}", lsn, pg_id);
         if (ctx) { ctx->promise_.setValue(folly::Unit()); }
         return;
@@ -163,31 +164,80 @@ void HSHomeObject::add_pg_to_map(unique< HS_PG > hs_pg) {
     RELEASE_ASSERT(hs_pg->pg_info_.replica_set_uuid == hs_pg->repl_dev_->group_id(),
                    "PGInfo replica set uuid mismatch with ReplDev instance for {}",
                    boost::uuids::to_string(hs_pg->pg_info_.replica_set_uuid));
-    auto lg = std::scoped_lock(_pg_lock);
+    auto pg = hs_pg.get();
+    hs_pg->index_queue_ = std::make_shared< BlobIndexQueue >(
+        [this, pg](BlobRoute const& route, BlobLocation const& blkids) -> BlobManager::NullResult {
+            // the put and the stats it changes are persisted by the same CP;
+            auto cur_cp = homestore::HomeStore::instance()->cp_mgr().cp_guard();
+            auto r = add_to_index_table(pg->index_table_, BlobInfo{route.shard, route.blob, blkids});
+            if (!r) { return folly::makeUnexpected(r.error()); }
+            // a put replayed after restart may already be in the index, it was counted by the CP that persisted it;
+            if (r.value()) { on_blob_added(*pg, route.shard, route.blob, blkids.bytes(pg->repl_dev_->get_blk_size())); }
+            if (pg->index_cache_) { pg->index_cache_->put(route, blkids); }
+            return folly::Unit();
+        },
+        executor_);
     auto id = hs_pg->pg_info_.id;
     auto [it1, _] = _pg_map.try_emplace(id, std::move(hs_pg));
-    RELEASE_ASSERT(_pg_map.end() != it1, "Unknown map insert error!");
+    RELEASE_ASSERT(_pg_map.cend() != it1, "Unknown map insert error!");
 }
 
 std::string HSHomeObject::serialize_pg_info(const PGInfo& pginfo) {
-    nlohmann::json j;
-    j["pg_info"]["pg_id_t"] = pginfo.id;
-    j["pg_info"]["repl_uuid"] = boost::uuids::to_string(pginfo.replica_set_uuid);
+    auto total_size = sizeof(PGInfoMessage);
+    for (auto const& member : pginfo.members) {
+        RELEASE_ASSERT(member.name.size() <= std::numeric_limits< uint16_t >::max(), "pg member name too long");
+        total_size += sizeof(PGMemberMessage) + member.name.size();
+    }
+
+    std::string buf(total_size, '\0');
+    auto ptr = buf.data();
+    PGInfoMessage msg;
+    msg.id = pginfo.id;
+    msg.replica_set_uuid = pginfo.replica_set_uuid;
+    msg.num_members = pginfo.members.size();
+    std::memcpy(ptr, &msg, sizeof(msg));
+    ptr += sizeof(msg);
 
-    nlohmann::json members_j{};
     for (auto const& member : pginfo.members) {
-        nlohmann::json member_j;
-        member_j["member_id"] = boost::uuids::to_string(member.id);
-        member_j["name"] = member.name;
-        member_j["priority"] = member.priority;
-        members_j.push_back(member_j);
+        PGMemberMessage member_msg;
+        member_msg.id = member.id;
+        member_msg.priority = member.priority;
+        member_msg.name_len = static_cast< uint16_t >(member.name.size());
+        std::memcpy(ptr, &member_msg, sizeof(member_msg));
+        ptr += sizeof(member_msg);
+        std::memcpy(ptr, member.name.data(), member.name.size());
+        ptr += member.name.size();
     }
-    j["pg_info"]["members"] = members_j;
-    return j.dump();
+    return buf;
 }
 
-PGInfo HSHomeObject::deserialize_pg_info(const unsigned char* json_str, size_t size) {
-    auto pg_json = nlohmann::json::parse(json_str, json_str + size);
+PGInfo HSHomeObject::deserialize_pg_info(const unsigned char* buf, size_t size) {
+    if (size >= sizeof(PGInfoMessage)) {
+        auto const msg = r_cast< PGInfoMessage const* >(buf);
+        if (msg->magic == PG_INFO_MESSAGE_MAGIC) {
+            RELEASE_ASSERT(msg->version == INFO_MESSAGE_VERSION_V1, "unknown pg info message version {}", msg->version);
+            PGInfo pg_info(msg->id);
+            pg_info.replica_set_uuid = msg->replica_set_uuid;
+
+            auto ptr = buf + sizeof(PGInfoMessage);
+            auto const end = buf + size;
+            for (uint32_t i = 0; i < msg->num_members; ++i) {
+                RELEASE_ASSERT(ptr + sizeof(PGMemberMessage) <= end, "truncated pg info message");
+                auto const member_msg = r_cast< PGMemberMessage const* >(ptr);
+                ptr += sizeof(PGMemberMessage);
+                RELEASE_ASSERT(ptr + member_msg->name_len <= end, "truncated pg info message");
+                PGMember member(member_msg->id, std::string(r_cast< const char* >(ptr), member_msg->name_len),
+                                member_msg->priority);
+                ptr += member_msg->name_len;
+                pg_info.members.emplace(std::move(member));
+            }
+            return pg_info;
+        }
+    }
+
+    // legacy json encoding;
+    RELEASE_ASSERT(size > 0 && buf[0] == '{', "unknown pg info message encoding");
+    auto pg_json = nlohmann::json::parse(buf, buf + size);
 
     PGInfo pg_info(pg_json["pg_info"]["pg_id_t"].get< pg_id_t >());
     pg_info.replica_set_uuid = boost::uuids::string_generator()(pg_json["pg_info"]["repl_uuid"].get< std::string >());
@@ -205,6 +255,19 @@ PGInfo HSHomeObject::deserialize_pg_info(const unsigned char* json_str, size_t s
 void HSHomeObject::on_pg_meta_blk_found(sisl::byte_view const& buf, void* meta_cookie) {
     homestore::superblk< pg_info_superblk > pg_sb(_pg_meta_name);
     pg_sb.load(buf, meta_cookie);
+    if (!pg_sb->is_current(buf.size())) {
+        // Written before the blob stats and the packed blobs flag were persisted, upgraded in place by the next CP
+        // writing it. No blob of it is packed, the stats start out empty and are recounted from the index once the
+        // log is replayed.
+        LOGI("pg={} superblk predates its blob stats, recounting them", pg_sb->id);
+        auto const legacy_size = pg_info_superblk::legacy_size(pg_sb->num_members);
+        auto const bytes = r_cast< uint8_t const* >(pg_sb.get());
+        std::vector< uint8_t > legacy(bytes, bytes + legacy_size);
+        pg_sb.create(legacy_size + sizeof(pg_info_superblk_ext));
+        std::memcpy(pg_sb.get(), legacy.data(), legacy_size);
+        *pg_sb->ext() = pg_info_superblk_ext{};
+        legacy_stats_pgs_.insert(pg_sb->id);
+    }
 
     auto v = hs_repl_service().get_repl_dev(pg_sb->replica_set_uuid);
     if (v.hasError()) {
@@ -237,9 +300,10 @@ PGInfo HSHomeObject::HS_PG::pg_info_from_sb(homestore::superblk< pg_info_superbl
 
 HSHomeObject::HS_PG::HS_PG(PGInfo info, shared< homestore::ReplDev > rdev, shared< BlobIndexTable > index_table) :
         PG{std::move(info)}, pg_sb_{_pg_meta_name}, repl_dev_{std::move(rdev)}, index_table_(index_table) {
-    pg_sb_.create(sizeof(pg_info_superblk) + ((pg_info_.members.size() - 1) * sizeof(pg_members)));
+    pg_sb_.create(pg_info_superblk::legacy_size(pg_info_.members.size()) + sizeof(pg_info_superblk_ext));
     pg_sb_->id = pg_info_.id;
     pg_sb_->num_members = pg_info_.members.size();
+    *pg_sb_->ext() = pg_info_superblk_ext{};
     pg_sb_->replica_set_uuid = repl_dev_->group_id();
     pg_sb_->index_table_uuid = index_table_->uuid();
 
@@ -252,6 +316,8 @@ HSHomeObject::HS_PG::HS_PG(PGInfo info, shared< homestore::ReplDev > rdev, share
     }
     pg_sb_.write();
     init_cp();
+    init_index_cache();
+    init_dedup_table();
 }
 
 void HSHomeObject::HS_PG::init_cp() {
@@ -266,15 +332,38 @@ HSHomeObject::HS_PG::HS_PG(homestore::superblk< HSHomeObject::pg_info_superblk >
                            shared< homestore::ReplDev > rdev) :
         PG{pg_info_from_sb(sb)}, pg_sb_{std::move(sb)}, repl_dev_{std::move(rdev)} {
     blob_sequence_num_ = pg_sb_->blob_sequence_num;
+    has_packed_blobs_ = pg_sb_->ext()->has_packed_blobs != 0;
+    num_blobs_ = pg_sb_->ext()->num_blobs;
+    used_bytes_ = pg_sb_->ext()->used_bytes;
+    deleted_bytes_ = pg_sb_->ext()->deleted_bytes;
     init_cp();
+    init_index_cache();
+    init_dedup_table();
+}
+
+void HSHomeObject::HS_PG::mark_dirty() {
+    // Holding the guard keeps the current CP from flushing until the store is visible, so the new blob sequence
+    // number is persisted no later than the CP covering the blobs it was taken for.
+    auto cur_cp = homestore::HomeStore::instance()->cp_mgr().cp_guard();
+    is_dirty_.store(true, std::memory_order_release);
 }
 
-uint32_t HSHomeObject::HS_PG::total_shards() const { return shards_.size(); }
+void HSHomeObject::HS_PG::init_index_cache() {
+    auto const entries = HS_BACKEND_DYNAMIC_CONFIG(blob_index_cache_entries);
+    if (entries == 0) { return; }
+    index_cache_ = std::make_unique< BlobIndexCache >(entries, HS_BACKEND_DYNAMIC_CONFIG(blob_index_cache_shards));
+}
 
-uint32_t HSHomeObject::HS_PG::open_shards() const {
-    return std::count_if(shards_.begin(), shards_.end(), [](auto const& s) { return s->is_open(); });
+void HSHomeObject::HS_PG::init_dedup_table() {
+    auto const entries = HS_BACKEND_DYNAMIC_CONFIG(blob_dedup_table_entries);
+    if (!HS_BACKEND_DYNAMIC_CONFIG(blob_dedup_enabled) || entries == 0) { return; }
+    dedup_table_ = std::make_unique< BlobDedupTable >(entries, HS_BACKEND_DYNAMIC_CONFIG(blob_index_cache_shards));
 }
 
+uint32_t HSHomeObject::HS_PG::total_shards() const { return total_shards_.load(std::memory_order_relaxed); }
+
+uint32_t HSHomeObject::HS_PG::open_shards() const { return open_shards_.load(std::memory_order_relaxed); }
+
 std::optional< uint32_t > HSHomeObject::HS_PG::dev_hint(cshared< HeapChunkSelector > chunk_sel) const {
     if (shards_.empty()) { return std::nullopt; }
     auto const hs_shard = d_cast< HS_Shard* >(shards_.front().get());
@@ -282,10 +371,81 @@ std::optional< uint32_t > HSHomeObject::HS_PG::dev_hint(cshared< HeapChunkSelect
     return hint.pdev_id_hint;
 }
 
+void HSHomeObject::recount_legacy_stats() {
+    for (auto const pg_id : legacy_stats_pgs_) {
+        auto hs_pg = static_cast< HS_PG* >(_get_pg(pg_id));
+        if (!hs_pg) { continue; }
+        // the puts committed by the replay have to be in the index to be counted;
+        hs_pg->index_queue_->drain();
+        std::vector< HS_Shard* > shards;
+        {
+            std::shared_lock lock_guard(hs_pg->mtx_);
+            for (auto const& shard : hs_pg->shards_) {
+                shards.push_back(d_cast< HS_Shard* >(shard.get()));
+            }
+        }
+
+        auto const blk_size = hs_pg->repl_dev_->get_blk_size();
+        // The counts are set through the deltas of the current CP, which persists them in the superblks along with
+        // the index they were counted from.
+        auto cur_cp = homestore::HomeStore::instance()->cp_mgr().cp_guard();
+        auto const slot = cur_cp->id() % 2;
+        int64_t num_blobs{0};
+        int64_t used_bytes{0};
+        for (auto hs_shard : shards) {
+            auto blob_infos = get_shard_blob_infos(*hs_pg, hs_shard->info.id);
+            if (!blob_infos) {
+                LOGW("failed to count blobs of shard {} in pg {}, its stats are short", hs_shard->info.id, pg_id);
+                continue;
+            }
+            int64_t shard_bytes{0};
+            for (auto const& blob_info : blob_infos.value()) {
+                if (blob_info.pbas == tombstone_pbas) { continue; }
+                if (!is_stream_segment(blob_info.blob_id)) { ++num_blobs; }
+                shard_bytes += blob_info.pbas.bytes(blk_size);
+            }
+            used_bytes += shard_bytes;
+            auto const shard_delta = shard_bytes - static_cast< int64_t >(hs_shard->used_bytes_.load());
+            hs_shard->used_bytes_.fetch_add(shard_delta, std::memory_order_relaxed);
+            hs_shard->cp_used_bytes_[slot].fetch_add(shard_delta, std::memory_order_relaxed);
+            hs_shard->mark_dirty(*cur_cp);
+        }
+        auto const blobs_delta = num_blobs - static_cast< int64_t >(hs_pg->num_blobs_.load());
+        auto const bytes_delta = used_bytes - static_cast< int64_t >(hs_pg->used_bytes_.load());
+        hs_pg->num_blobs_.fetch_add(blobs_delta, std::memory_order_relaxed);
+        hs_pg->used_bytes_.fetch_add(bytes_delta, std::memory_order_relaxed);
+        hs_pg->cp_stats_[slot].num_blobs.fetch_add(blobs_delta, std::memory_order_relaxed);
+        hs_pg->cp_stats_[slot].used_bytes.fetch_add(bytes_delta, std::memory_order_relaxed);
+        hs_pg->mark_dirty();
+        LOGI("pg {} has {} blobs taking {} bytes", pg_id, num_blobs, used_bytes);
+    }
+    legacy_stats_pgs_.clear();
+}
+
+void HSHomeObject::collect_dirty_pgs(HomeObjCPContext& cp_ctx, homestore::cp_id_t cp_id) {
+    for (auto const& [_, pg] : _pg_map) {
+        auto hs_pg = static_cast< HS_PG* >(pg.get());
+        // the io of this CP is done, its stats changes are all in and those of the next CP go to the other slot;
+        auto& delta = hs_pg->cp_stats_[cp_id % 2];
+        auto const num_blobs = delta.num_blobs.exchange(0, std::memory_order_relaxed);
+        auto const used_bytes = delta.used_bytes.exchange(0, std::memory_order_relaxed);
+        auto const deleted_bytes = delta.deleted_bytes.exchange(0, std::memory_order_relaxed);
+        bool const dirty = hs_pg->is_dirty_.exchange(false, std::memory_order_acq_rel);
+        if (!dirty && num_blobs == 0 && used_bytes == 0 && deleted_bytes == 0) { continue; }
+        // a put racing with this marks the PG again, so its sequence number is picked up by the next CP at the latest;
+        hs_pg->cache_pg_sb_->blob_sequence_num = hs_pg->blob_sequence_num_.load();
+        auto ext = hs_pg->cache_pg_sb_->ext();
+        ext->has_packed_blobs = hs_pg->has_packed_blobs();
+        ext->num_blobs += num_blobs;
+        ext->used_bytes += used_bytes;
+        ext->deleted_bytes += deleted_bytes;
+        cp_ctx.add_pg_to_dirty_list(hs_pg->cache_pg_sb_);
+    }
+}
+
 void HSHomeObject::persist_pg_sb() {
 #if 0
-    auto lg = std::shared_lock(_pg_lock);
-    for (auto& [_, pg] : _pg_map) {
+    for (auto const& [_, pg] : _pg_map) {
         auto hs_pg = static_cast< HS_PG* >(pg.get());
         hs_pg->pg_sb_->blob_sequence_num = hs_pg->blob_sequence_num_;
         hs_pg->pg_sb_.write();
@@ -293,12 +453,32 @@ void HSHomeObject::persist_pg_sb() {
 #endif
 }
 
+void HSHomeObject::HS_PG::advance_applied_lsn(int64_t lsn) {
+    auto applied = applied_lsn_.load(std::memory_order_relaxed);
+    while (applied < lsn && !applied_lsn_.compare_exchange_weak(applied, lsn, std::memory_order_release)) {}
+}
+
+void HSHomeObject::on_log_applied(pg_id_t pg_id, int64_t lsn) {
+    if (auto hs_pg = static_cast< HS_PG* >(_get_pg(pg_id)); hs_pg) { hs_pg->advance_applied_lsn(lsn); }
+}
+
+read_token_t HSHomeObject::_read_token(pg_id_t pg_id) const {
+    auto hs_pg = static_cast< HS_PG* >(_get_pg(pg_id));
+    return hs_pg ? hs_pg->applied_lsn_.load(std::memory_order_acquire) : 0;
+}
+
+std::optional< peer_id_t > HSHomeObject::_current_leader(pg_id_t pg_id) const {
+    auto hs_pg = static_cast< HS_PG* >(_get_pg(pg_id));
+    if (!hs_pg || !hs_pg->repl_dev_) { return std::nullopt; }
+    if (hs_pg->repl_dev_->is_leader()) { return _our_id; }
+    auto const leader = hs_pg->repl_dev_->get_leader_id();
+    if (leader.is_nil()) { return std::nullopt; }
+    return leader;
+}
+
 bool HSHomeObject::_get_stats(pg_id_t id, PGStats& stats) const {
-    auto lg = std::shared_lock(_pg_lock);
-    auto it = _pg_map.find(id);
-    if (_pg_map.end() == it) { return false; }
-    auto const& pg = it->second;
-    auto hs_pg = static_cast< HS_PG* >(pg.get());
+    auto hs_pg = static_cast< HS_PG* >(_get_pg(id));
+    if (!hs_pg) { return false; }
     auto const blk_size = hs_pg->repl_dev_->get_blk_size();
 
     stats.id = hs_pg->pg_info_.id;
@@ -306,25 +486,28 @@ bool HSHomeObject::_get_stats(pg_id_t id, PGStats& stats) const {
     stats.num_members = hs_pg->pg_info_.members.size();
     stats.total_shards = hs_pg->total_shards();
     stats.open_shards = hs_pg->open_shards();
+    stats.used_bytes = hs_pg->used_bytes_.load(std::memory_order_relaxed);
+    stats.num_blobs = hs_pg->num_blobs_.load(std::memory_order_relaxed);
+    stats.deleted_bytes = hs_pg->deleted_bytes_.load(std::memory_order_relaxed);
 
     for (auto const& m : hs_pg->pg_info_.members) {
         // TODO: get last commit lsn from repl_dev when it is ready;
         stats.members.emplace_back(std::make_tuple(m.id, m.name, 0 /* last commit lsn */));
     }
 
-    auto const pdev_id_hint = hs_pg->dev_hint(chunk_selector());
+    std::optional< uint32_t > pdev_id_hint;
+    {
+        auto lg = std::shared_lock(hs_pg->mtx_);
+        pdev_id_hint = hs_pg->dev_hint(chunk_selector());
+    }
     if (pdev_id_hint.has_value()) {
         stats.avail_open_shards = chunk_selector()->avail_num_chunks(pdev_id_hint.value());
         stats.avail_bytes = chunk_selector()->avail_blks(pdev_id_hint) * blk_size;
-        stats.used_bytes = chunk_selector()->total_blks(pdev_id_hint.value()) * blk_size - stats.avail_bytes;
     } else {
         // if no shard has been created on this PG yet, it means this PG could arrive on any drive that has the most
         // available open shards;
         stats.avail_open_shards = chunk_selector()->most_avail_num_chunks();
 
-        // if no shards is created yet on this PG, set used bytes to zero;
-        stats.used_bytes = 0ul;
-
         // if no shard has been created on this PG yet, it means this PG could arrive on any drive that has the most
         // available space;
         stats.avail_bytes = chunk_selector()->avail_blks(std::nullopt) * blk_size;
@@ -334,11 +517,8 @@ bool HSHomeObject::_get_stats(pg_id_t id, PGStats& stats) const {
 }
 
 void HSHomeObject::_get_pg_ids(std::vector< pg_id_t >& pg_ids) const {
-    {
-        auto lg = std::shared_lock(_pg_lock);
-        for (auto& [id, _] : _pg_map) {
-            pg_ids.push_back(id);
-        }
+    for (auto const& [id, _] : _pg_map) {
+        pg_ids.push_back(id);
     }
 }
 
@@ -1,12 +1,18 @@
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
 #include <homestore/homestore.hpp>
 #include <homestore/blkdata_service.hpp>
 #include <homestore/meta_service.hpp>
 #include <homestore/replication_service.hpp>
 
+#include "hs_backend_config.hpp"
 #include "hs_homeobject.hpp"
 #include "replication_message.hpp"
 #include "replication_state_machine.hpp"
 #include "lib/homeobject_impl.hpp"
+#include "hs_hmobj_cp.hpp"
 
 namespace homeobject {
 
@@ -14,12 +20,13 @@ uint64_t ShardManager::max_shard_size() { return Gi; }
 
 uint64_t ShardManager::max_shard_num_in_pg() { return ((uint64_t)0x01) << shard_width; }
 
-shard_id_t HSHomeObject::generate_new_shard_id(pg_id_t pgid) {
-    std::scoped_lock lock_guard(_pg_lock);
-    auto iter = _pg_map.find(pgid);
-    RELEASE_ASSERT(iter != _pg_map.end(), "Missing pg info");
-    auto new_sequence_num = ++(iter->second->shard_sequence_num_);
-    RELEASE_ASSERT(new_sequence_num < ShardManager::max_shard_num_in_pg(),
+shard_id_t HSHomeObject::generate_new_shard_id(pg_id_t pgid, uint32_t count) {
+    auto pg = _get_pg(pgid);
+    RELEASE_ASSERT(pg, "Missing pg info");
+    std::scoped_lock lock_guard(pg->mtx_);
+    auto new_sequence_num = pg->shard_sequence_num_ + 1;
+    pg->shard_sequence_num_ += count;
+    RELEASE_ASSERT(pg->shard_sequence_num_ < ShardManager::max_shard_num_in_pg(),
                    "new shard id must be less than ShardManager::max_shard_num_in_pg()");
     return make_new_shard_id(pgid, new_sequence_num);
 }
@@ -28,22 +35,42 @@ uint64_t HSHomeObject::get_sequence_num_from_shard_id(uint64_t shard_id_t) {
     return shard_id_t & (max_shard_num_in_pg() - 1);
 }
 
-std::string HSHomeObject::serialize_shard_info(const ShardInfo& info) {
-    nlohmann::json j;
-    j["shard_info"]["shard_id_t"] = info.id;
-    j["shard_info"]["pg_id_t"] = info.placement_group;
-    j["shard_info"]["state"] = info.state;
-    j["shard_info"]["created_time"] = info.created_time;
-    j["shard_info"]["modified_time"] = info.last_modified_time;
-    j["shard_info"]["total_capacity"] = info.total_capacity_bytes;
-    j["shard_info"]["available_capacity"] = info.available_capacity_bytes;
-    j["shard_info"]["deleted_capacity"] = info.deleted_capacity_bytes;
-    return j.dump();
+ShardInfoMessage HSHomeObject::serialize_shard_info(const ShardInfo& info) {
+    ShardInfoMessage msg;
+    msg.state = static_cast< uint8_t >(info.state);
+    msg.id = info.id;
+    msg.placement_group = info.placement_group;
+    msg.created_time = info.created_time;
+    msg.last_modified_time = info.last_modified_time;
+    msg.total_capacity_bytes = info.total_capacity_bytes;
+    msg.available_capacity_bytes = info.available_capacity_bytes;
+    msg.deleted_capacity_bytes = info.deleted_capacity_bytes;
+    return msg;
 }
 
-ShardInfo HSHomeObject::deserialize_shard_info(const char* json_str, size_t str_size) {
+ShardInfo HSHomeObject::deserialize_shard_info(const char* buf, size_t size) {
     ShardInfo shard_info;
-    auto shard_json = nlohmann::json::parse(json_str, json_str + str_size);
+    if (size >= sizeof(ShardInfoMessage)) {
+        auto const msg = r_cast< ShardInfoMessage const* >(buf);
+        if (msg->magic == SHARD_INFO_MESSAGE_MAGIC) {
+            RELEASE_ASSERT(msg->version == INFO_MESSAGE_VERSION_V1, "unknown shard info message version {}",
+                           msg->version);
+            shard_info.id = msg->id;
+            shard_info.placement_group = msg->placement_group;
+            shard_info.state = static_cast< ShardInfo::State >(msg->state);
+            shard_info.created_time = msg->created_time;
+            shard_info.last_modified_time = msg->last_modified_time;
+            shard_info.available_capacity_bytes = msg->available_capacity_bytes;
+            shard_info.total_capacity_bytes = msg->total_capacity_bytes;
+            shard_info.deleted_capacity_bytes = msg->deleted_capacity_bytes;
+            return shard_info;
+        }
+    }
+
+    // legacy json encoding, the value is zero padded up to the block size;
+    RELEASE_ASSERT(size > 0 && buf[0] == '{', "unknown shard info message encoding");
+    auto const json_end = std::find(buf, buf + size, '\0');
+    auto shard_json = nlohmann::json::parse(buf, json_end);
     shard_info.id = shard_json["shard_info"]["shard_id_t"].get< shard_id_t >();
     shard_info.placement_group = shard_json["shard_info"]["pg_id_t"].get< pg_id_t >();
     shard_info.state = static_cast< ShardInfo::State >(shard_json["shard_info"]["state"].get< int >());
@@ -56,16 +83,12 @@ ShardInfo HSHomeObject::deserialize_shard_info(const char* json_str, size_t str_
 }
 
 ShardManager::AsyncResult< ShardInfo > HSHomeObject::_create_shard(pg_id_t pg_owner, uint64_t size_bytes) {
-    shared< homestore::ReplDev > repl_dev;
-    {
-        std::shared_lock lock_guard(_pg_lock);
-        auto iter = _pg_map.find(pg_owner);
-        if (iter == _pg_map.end()) {
-            LOGW("failed to create shard with non-exist pg [{}]", pg_owner);
-            return folly::makeUnexpected(ShardError::UNKNOWN_PG);
-        }
-        repl_dev = static_cast< HS_PG* >(iter->second.get())->repl_dev_;
+    auto pg = _get_pg(pg_owner);
+    if (!pg) {
+        LOGW("failed to create shard with non-exist pg [{}]", pg_owner);
+        return folly::makeUnexpected(ShardError::UNKNOWN_PG);
     }
+    auto repl_dev = static_cast< HS_PG* >(pg)->repl_dev_;
 
     if (!repl_dev) {
         LOGW("failed to get repl dev instance for pg [{}]", pg_owner);
@@ -74,17 +97,72 @@ ShardManager::AsyncResult< ShardInfo > HSHomeObject::_create_shard(pg_id_t pg_ow
 
     auto new_shard_id = generate_new_shard_id(pg_owner);
     auto create_time = get_current_timestamp();
-    std::string const create_shard_message = serialize_shard_info(
+    return replicate_create_shard(
+        repl_dev,
         ShardInfo(new_shard_id, pg_owner, ShardInfo::State::OPEN, create_time, create_time, size_bytes, size_bytes, 0));
-    const auto msg_size = sisl::round_up(create_shard_message.size(), repl_dev->get_blk_size());
+}
+
+ShardManager::AsyncResult< InfoList > HSHomeObject::_create_shards(pg_id_t pg_owner, uint32_t count,
+                                                                   uint64_t size_bytes) {
+    auto pg = _get_pg(pg_owner);
+    if (!pg) {
+        LOGW("failed to create shards with non-exist pg [{}]", pg_owner);
+        return folly::makeUnexpected(ShardError::UNKNOWN_PG);
+    }
+    auto repl_dev = static_cast< HS_PG* >(pg)->repl_dev_;
+
+    if (!repl_dev) {
+        LOGW("failed to get repl dev instance for pg [{}]", pg_owner);
+        return folly::makeUnexpected(ShardError::PG_NOT_READY);
+    }
+
+    // every shard binds the chunk its create message is written to, so each shard still needs a message of its own.
+    // The ids are reserved at once and the messages are kept in flight together instead of one round trip each.
+    auto const first_shard_id = generate_new_shard_id(pg_owner, count);
+    auto const create_time = get_current_timestamp();
+    auto replicate = [this, repl_dev, pg_owner, size_bytes, first_shard_id, create_time](uint32_t i) {
+        return replicate_create_shard(repl_dev,
+                                      ShardInfo(first_shard_id + i, pg_owner, ShardInfo::State::OPEN, create_time,
+                                                create_time, size_bytes, size_bytes, 0));
+    };
+    auto replicate_from = [replicate, count](uint32_t start, InfoList infos) {
+        std::vector< ShardManager::AsyncResult< ShardInfo > > futs;
+        futs.reserve(count - start);
+        for (auto i = start; count > i; ++i) {
+            futs.emplace_back(replicate(i));
+        }
+        return folly::collectAll(std::move(futs))
+            .deferValue([infos = std::move(infos)](auto&& results) mutable -> ShardManager::Result< InfoList > {
+                for (auto& r : results) {
+                    if (r.hasException()) { return folly::makeUnexpected(ShardError::UNKNOWN); }
+                    if (!r.value()) { return folly::makeUnexpected(r.value().error()); }
+                    infos.push_back(std::move(r.value().value()));
+                }
+                return infos;
+            });
+    };
+
+    if (get_any_chunk_id(pg_owner).has_value()) { return replicate_from(0, InfoList()); }
+
+    // the pdev of an empty pg is picked when its first shard is allocated, the others follow once it is committed;
+    return replicate(0).deferValue([replicate_from](auto&& e) mutable -> ShardManager::AsyncResult< InfoList > {
+        if (!e) { return folly::makeUnexpected(e.error()); }
+        return replicate_from(1, InfoList{std::move(e.value())});
+    });
+}
+
+ShardManager::AsyncResult< ShardInfo > HSHomeObject::replicate_create_shard(shared< homestore::ReplDev > repl_dev,
+                                                                            ShardInfo const& info) {
+    auto const create_shard_message = serialize_shard_info(info);
+    const auto msg_size = sisl::round_up(sizeof(create_shard_message), repl_dev->get_blk_size());
     auto req = repl_result_ctx< ShardManager::Result< ShardInfo > >::make(msg_size, 512 /*alignment*/);
     auto buf_ptr = req->hdr_buf_.bytes();
     std::memset(buf_ptr, 0, msg_size);
-    std::memcpy(buf_ptr, create_shard_message.c_str(), create_shard_message.size());
+    std::memcpy(buf_ptr, &create_shard_message, sizeof(create_shard_message));
     // preapre msg header;
     req->header_.msg_type = ReplicationMessageType::CREATE_SHARD_MSG;
-    req->header_.pg_id = pg_owner;
-    req->header_.shard_id = new_shard_id;
+    req->header_.pg_id = info.placement_group;
+    req->header_.shard_id = info.id;
     req->header_.payload_size = msg_size;
     req->header_.payload_crc = crc32_ieee(init_crc32, buf_ptr, msg_size);
     req->header_.seal();
@@ -107,22 +185,21 @@ ShardManager::AsyncResult< ShardInfo > HSHomeObject::_seal_shard(ShardInfo const
     auto& shard_id = info.id;
     ShardInfo shard_info = info;
 
-    shared< homestore::ReplDev > repl_dev;
-    {
-        std::shared_lock lock_guard(_pg_lock);
-        auto iter = _pg_map.find(pg_id);
-        RELEASE_ASSERT(iter != _pg_map.end(), "PG not found");
-        repl_dev = static_cast< HS_PG* >(iter->second.get())->repl_dev_;
-        RELEASE_ASSERT(repl_dev != nullptr, "Repl dev null");
-    }
+    auto pg = _get_pg(pg_id);
+    RELEASE_ASSERT(pg, "PG not found");
+    auto repl_dev = static_cast< HS_PG* >(pg)->repl_dev_;
+    RELEASE_ASSERT(repl_dev != nullptr, "Repl dev null");
+
+    // Blobs still waiting in a pack were put before the seal, their extent is proposed ahead of it.
+    if (blob_packer_) { blob_packer_->flush(shard_id); }
 
     shard_info.state = ShardInfo::State::SEALED;
-    auto seal_shard_message = serialize_shard_info(shard_info);
-    const auto msg_size = sisl::round_up(seal_shard_message.size(), repl_dev->get_blk_size());
+    auto const seal_shard_message = serialize_shard_info(shard_info);
+    const auto msg_size = sisl::round_up(sizeof(seal_shard_message), repl_dev->get_blk_size());
     auto req = repl_result_ctx< ShardManager::Result< ShardInfo > >::make(msg_size, 512 /*alignment*/);
     auto buf_ptr = req->hdr_buf_.bytes();
     std::memset(buf_ptr, 0, msg_size);
-    std::memcpy(buf_ptr, seal_shard_message.c_str(), seal_shard_message.size());
+    std::memcpy(buf_ptr, &seal_shard_message, sizeof(seal_shard_message));
 
     req->header_.msg_type = ReplicationMessageType::SEAL_SHARD_MSG;
     req->header_.pg_id = pg_id;
@@ -157,14 +234,22 @@ void HSHomeObject::on_shard_message_commit(int64_t lsn, sisl::blob const& header
     // is already be written into metablk, so we need to do nothing in this case to avoid duplication when replay this
     // journal log. but there is still a smaller chance that HO is stopped/crashed before writing metablk is called or
     // completed and we need to recover shard info from journal log in such case.
+    // header will be released when this function returns, but we still need the header when async_read() finished.
+    auto msg_header = *r_cast< const ReplicationMessageHeader* >(header.cbytes());
+    // the header tells which shard the message is for, so the payload only needs to be read if the recovered shard is
+    // missing or stale;
+    if (!msg_header.corrupted() && is_shard_message_applied(msg_header)) {
+        shard_id_t const shard_id = msg_header.shard_id;
+        LOGD("shard message of shard {} is already applied, skip replaying it, lsn:{}", shard_id, lsn);
+        return;
+    }
+
     sisl::sg_list value;
     value.size = blkids.blk_count() * repl_dev->get_blk_size();
     auto value_buf = iomanager.iobuf_alloc(512, value.size);
     value.iovs.push_back(iovec{.iov_base = value_buf, .iov_len = value.size});
-    // header will be released when this function returns, but we still need the header when async_read() finished.
-    auto header_ptr = r_cast< const ReplicationMessageHeader* >(header.cbytes());
     repl_dev->async_read(blkids, value, value.size)
-        .thenValue([this, lsn, msg_header = *header_ptr, blkids, value](auto&& err) mutable {
+        .thenValue([this, lsn, msg_header, blkids, value](auto&& err) mutable {
             if (err) {
                 LOGW("failed to read data from homestore pba, lsn:{}", lsn);
             } else {
@@ -199,11 +284,7 @@ void HSHomeObject::do_shard_message_commit(int64_t lsn, ReplicationMessageHeader
     auto shard_info = deserialize_shard_info(r_cast< const char* >(value.cbytes()), value.size());
     switch (header.msg_type) {
     case ReplicationMessageType::CREATE_SHARD_MSG: {
-        bool shard_exist = false;
-        {
-            std::scoped_lock lock_guard(_shard_lock);
-            shard_exist = (_shard_map.find(shard_info.id) != _shard_map.end());
-        }
+        bool const shard_exist = (_shard_map.find(shard_info.id) != _shard_map.cend());
 
         if (!shard_exist) {
             add_new_shard_to_map(std::make_unique< HS_Shard >(shard_info, blkids.chunk_num()));
@@ -218,17 +299,39 @@ void HSHomeObject::do_shard_message_commit(int64_t lsn, ReplicationMessageHeader
     case ReplicationMessageType::SEAL_SHARD_MSG: {
         ShardInfo::State state;
         {
-            std::scoped_lock lock_guard(_shard_lock);
             auto iter = _shard_map.find(shard_info.id);
-            RELEASE_ASSERT(iter != _shard_map.end(), "Missing shard info");
-            state = (*iter->second)->info.state;
+            RELEASE_ASSERT(iter != _shard_map.cend(), "Missing shard info");
+            std::shared_lock lock_guard(_get_pg(shard_info.placement_group)->mtx_);
+            state = iter->second->info.state;
         }
 
         if (state == ShardInfo::State::OPEN) {
+            // sealed right away so no put gets in after this message, and the rest of the chunk goes back to the
+            // chunk selector for the next shard created on the device;
             auto chunk_id = get_shard_chunk(shard_info.id);
             RELEASE_ASSERT(chunk_id.has_value(), "Chunk id not found");
             chunk_selector()->release_chunk(chunk_id.value());
             update_shard_in_map(shard_info);
+
+            // a sealed shard keeps only the blocks of its blobs, its capacity shrinks to those once the index queue
+            // applied the puts and deletes committed ahead of this message. The commit path does not wait for them,
+            // the proposer is answered once the capacity is set.
+            auto hs_pg = static_cast< HS_PG* >(_get_pg(shard_info.placement_group));
+            auto sealed = std::make_shared< ShardInfo >(shard_info);
+            hs_pg->index_queue_->enqueue_mutation(
+                [this, sealed]() -> BlobManager::NullResult {
+                    auto iter = _shard_map.find(sealed->id);
+                    RELEASE_ASSERT(iter != _shard_map.cend(), "Missing shard info");
+                    sealed->total_capacity_bytes =
+                        d_cast< HS_Shard* >(iter->second)->used_bytes_.load(std::memory_order_relaxed);
+                    sealed->available_capacity_bytes = 0;
+                    update_shard_in_map(*sealed);
+                    return folly::Unit();
+                },
+                [ctx, req = hs_ctx, sealed](BlobManager::NullResult) {
+                    if (ctx) { ctx->promise_.setValue(ShardManager::Result< ShardInfo >(*sealed)); }
+                });
+            return;
         }
 
         break;
@@ -241,44 +344,139 @@ void HSHomeObject::do_shard_message_commit(int64_t lsn, ReplicationMessageHeader
     if (ctx) { ctx->promise_.setValue(ShardManager::Result< ShardInfo >(shard_info)); }
 }
 
+void HSHomeObject::on_blob_added(HS_PG& pg, shard_id_t shard_id, blob_id_t blob_id, uint64_t bytes) {
+    // the caller holds a guard of the CP that persists the index change, it persists the stats change too.
+    auto cur_cp = homestore::HomeStore::instance()->cp_mgr().cp_guard();
+    auto const slot = cur_cp->id() % 2;
+    pg.on_blob_added(blob_id, bytes);
+    auto& delta = pg.cp_stats_[slot];
+    if (!is_stream_segment(blob_id)) { delta.num_blobs.fetch_add(1, std::memory_order_relaxed); }
+    delta.used_bytes.fetch_add(bytes, std::memory_order_relaxed);
+    if (auto iter = _shard_map.find(shard_id); iter != _shard_map.cend()) {
+        auto hs_shard = d_cast< HS_Shard* >(iter->second);
+        hs_shard->used_bytes_.fetch_add(bytes, std::memory_order_relaxed);
+        hs_shard->cp_used_bytes_[slot].fetch_add(bytes, std::memory_order_relaxed);
+        hs_shard->mark_dirty(*cur_cp);
+    }
+}
+
+void HSHomeObject::on_blob_deleted(HS_PG& pg, shard_id_t shard_id, blob_id_t blob_id, uint64_t bytes) {
+    auto cur_cp = homestore::HomeStore::instance()->cp_mgr().cp_guard();
+    auto const slot = cur_cp->id() % 2;
+    pg.on_blob_deleted(blob_id, bytes);
+    auto& delta = pg.cp_stats_[slot];
+    if (!is_stream_segment(blob_id)) { delta.num_blobs.fetch_sub(1, std::memory_order_relaxed); }
+    delta.used_bytes.fetch_sub(bytes, std::memory_order_relaxed);
+    delta.deleted_bytes.fetch_add(bytes, std::memory_order_relaxed);
+    if (auto iter = _shard_map.find(shard_id); iter != _shard_map.cend()) {
+        auto hs_shard = d_cast< HS_Shard* >(iter->second);
+        hs_shard->used_bytes_.fetch_sub(bytes, std::memory_order_relaxed);
+        hs_shard->cp_used_bytes_[slot].fetch_sub(bytes, std::memory_order_relaxed);
+        hs_shard->mark_dirty(*cur_cp);
+    }
+}
+
+bool HSHomeObject::is_shard_message_applied(ReplicationMessageHeader const& header) const {
+    shard_id_t const shard_id = header.shard_id;
+    auto iter = _shard_map.find(shard_id);
+    if (iter == _shard_map.cend()) { return false; }
+    switch (header.msg_type) {
+    case ReplicationMessageType::CREATE_SHARD_MSG:
+        return true;
+    case ReplicationMessageType::SEAL_SHARD_MSG: {
+        std::shared_lock lock_guard(_get_pg(header.pg_id)->mtx_);
+        return iter->second->info.state == ShardInfo::State::SEALED;
+    }
+    default:
+        return false;
+    }
+}
+
 void HSHomeObject::add_new_shard_to_map(ShardPtr&& shard) {
-    // TODO: We are taking a global lock for all pgs to create shard. Is it really needed??
-    // We need to have fine grained per PG lock and take only that.
-    std::scoped_lock lock_guard(_pg_lock, _shard_lock);
-    auto pg_iter = _pg_map.find(shard->info.placement_group);
-    RELEASE_ASSERT(pg_iter != _pg_map.end(), "Missing PG info");
-    auto& shards = pg_iter->second->shards_;
-    auto shard_id = shard->info.id;
-    auto iter = shards.emplace(shards.end(), std::move(shard));
-    auto [_, happened] = _shard_map.emplace(shard_id, iter);
-    RELEASE_ASSERT(happened, "duplicated shard info");
-
-    // following part gives follower members a chance to catch up shard sequence num;
-    auto sequence_num = get_sequence_num_from_shard_id(shard_id);
-    if (sequence_num > pg_iter->second->shard_sequence_num_) { pg_iter->second->shard_sequence_num_ = sequence_num; }
+    auto const pg_id = shard->info.placement_group;
+    std::vector< ShardPtr > shards;
+    shards.emplace_back(std::move(shard));
+    add_new_shards_to_map(pg_id, std::move(shards));
+}
+
+void HSHomeObject::add_new_shards_to_map(pg_id_t pg_id, std::vector< ShardPtr >&& new_shards) {
+    auto pg = _get_pg(pg_id);
+    RELEASE_ASSERT(pg, "Missing PG info");
+    std::scoped_lock lock_guard(pg->mtx_);
+    auto& shards = pg->shards_;
+    shards.reserve(shards.size() + new_shards.size());
+    for (auto& new_shard : new_shards) {
+        RELEASE_ASSERT(new_shard->info.placement_group == pg_id, "shard of another pg");
+        auto shard_id = new_shard->info.id;
+        // shards mostly arrive in id order, a create committed after one with a larger id is put in its place;
+        auto pos = shards.end();
+        if (!shards.empty() && shard_id < shards.back()->info.id) {
+            pos = std::upper_bound(shards.begin(), shards.end(), shard_id,
+                                   [](shard_id_t id, auto const& shard) { return id < shard->info.id; });
+        }
+        auto const& shard = *shards.insert(pos, std::move(new_shard));
+        auto [_, happened] = _shard_map.emplace(shard_id, shard.get());
+        RELEASE_ASSERT(happened, "duplicated shard info");
+        pg->on_shard_added(shard->is_open());
+
+        // following part gives follower members a chance to catch up shard sequence num;
+        auto sequence_num = get_sequence_num_from_shard_id(shard_id);
+        if (sequence_num > pg->shard_sequence_num_) { pg->shard_sequence_num_ = sequence_num; }
+    }
 }
 
 void HSHomeObject::update_shard_in_map(const ShardInfo& shard_info) {
-    std::scoped_lock lock_guard(_shard_lock);
     auto shard_iter = _shard_map.find(shard_info.id);
-    RELEASE_ASSERT(shard_iter != _shard_map.end(), "Missing shard info");
-    auto hs_shard = d_cast< HS_Shard* >((*shard_iter->second).get());
+    RELEASE_ASSERT(shard_iter != _shard_map.cend(), "Missing shard info");
+    auto pg = _get_pg(shard_info.placement_group);
+    std::scoped_lock lock_guard(pg->mtx_);
+    auto hs_shard = d_cast< HS_Shard* >(shard_iter->second);
+    if (hs_shard->is_open() && shard_info.state != ShardInfo::State::OPEN) { pg->on_shard_sealed(); }
     hs_shard->update_info(shard_info);
 }
 
 std::optional< homestore::chunk_num_t > HSHomeObject::get_shard_chunk(shard_id_t id) const {
-    std::scoped_lock lock_guard(_shard_lock);
     auto shard_iter = _shard_map.find(id);
-    if (shard_iter == _shard_map.end()) { return std::nullopt; }
-    auto hs_shard = d_cast< HS_Shard* >((*shard_iter->second).get());
+    if (shard_iter == _shard_map.cend()) { return std::nullopt; }
+    // The chunk of a shard only changes when GC moves it after it is sealed.
+    auto hs_shard = d_cast< HS_Shard* >(shard_iter->second);
     return std::make_optional< homestore::chunk_num_t >(hs_shard->sb_->chunk_id);
 }
 
+homestore::blk_alloc_hints HSHomeObject::shard_create_get_blk_alloc_hints(pg_id_t pg_id) {
+    if (HS_BACKEND_DYNAMIC_CONFIG(shard_placement_policy) == static_cast< uint8_t >(ShardPlacementPolicy::STRIPE)) {
+        std::unordered_map< uint32_t, uint32_t > open_shards;
+        {
+            auto pg = _get_pg(pg_id);
+            RELEASE_ASSERT(pg, "Missing PG info");
+            std::shared_lock lock_guard(pg->mtx_);
+            for (auto const& shard : pg->shards_) {
+                if (!shard->is_open()) { continue; }
+                auto const hints = chunk_selector_->chunk_to_hints(d_cast< HS_Shard* >(shard.get())->chunk_id());
+                if (hints.pdev_id_hint) { ++open_shards[*hints.pdev_id_hint]; }
+            }
+        }
+        if (auto pdev_id = chunk_selector_->select_pdev_for_pg(
+                open_shards, HS_BACKEND_DYNAMIC_CONFIG(shard_placement_min_avail_pct));
+            pdev_id) {
+            homestore::blk_alloc_hints hints;
+            hints.pdev_id_hint = pdev_id;
+            return hints;
+        }
+        // every device is over its capacity limit, stay with the device of the pg.
+    }
+
+    auto any_allocated_chunk_id = get_any_chunk_id(pg_id);
+    // pg is empty without any shards, we leave the decision the HeapChunkSelector to select a pdev with most available
+    // space and then select one chunk based on that pdev
+    if (!any_allocated_chunk_id.has_value()) { return homestore::blk_alloc_hints(); }
+    return chunk_selector_->chunk_to_hints(any_allocated_chunk_id.value());
+}
+
 std::optional< homestore::chunk_num_t > HSHomeObject::get_any_chunk_id(pg_id_t const pg_id) {
-    std::scoped_lock lock_guard(_pg_lock);
-    auto pg_iter = _pg_map.find(pg_id);
-    RELEASE_ASSERT(pg_iter != _pg_map.end(), "Missing PG info");
-    HS_PG* pg = static_cast< HS_PG* >(pg_iter->second.get());
+    HS_PG* pg = static_cast< HS_PG* >(_get_pg(pg_id));
+    RELEASE_ASSERT(pg, "Missing PG info");
+    std::scoped_lock lock_guard(pg->mtx_);
     if (pg->any_allocated_chunk_id_.has_value()) {
         // it is already cached and use it;
         return pg->any_allocated_chunk_id_;
@@ -296,18 +494,42 @@ HSHomeObject::HS_Shard::HS_Shard(ShardInfo shard_info, homestore::chunk_num_t ch
         Shard(std::move(shard_info)), sb_(_shard_meta_name) {
     sb_.create(sizeof(shard_info_superblk));
     sb_->chunk_id = chunk_id;
-    write_sb();
+    sb_->version = shard_info_superblk::current_version;
+    sb_->used_bytes = 0;
+    // the shard is recovered from the journal if we crash before the next cp writes its superblk;
+    mark_dirty();
 }
 
 HSHomeObject::HS_Shard::HS_Shard(homestore::superblk< shard_info_superblk >&& sb) :
-        Shard(shard_info_from_sb(sb)), sb_(std::move(sb)) {}
+        Shard(shard_info_from_sb(sb)), sb_(std::move(sb)) {
+    used_bytes_ = sb_->used_bytes;
+}
 
 void HSHomeObject::HS_Shard::update_info(const ShardInfo& shard_info) {
     info = shard_info;
-    write_sb();
+    mark_dirty();
+}
+
+void HSHomeObject::HS_Shard::mark_dirty() {
+    // the guard keeps the current cp from flushing until the shard is in its dirty list;
+    auto cur_cp = homestore::HomeStore::instance()->cp_mgr().cp_guard();
+    mark_dirty(*cur_cp);
+}
+
+void HSHomeObject::HS_Shard::mark_dirty(homestore::CP& cp) {
+    // a shard already queued for cp picks up this change when its flush copies the info and the used bytes.
+    if (is_dirty_[cp.id() % 2].exchange(true, std::memory_order_acq_rel)) { return; }
+    auto cp_ctx = s_cast< HomeObjCPContext* >(cp.context(homestore::cp_consumer_t::HS_CLIENT));
+    cp_ctx->add_shard_to_dirty_list(this);
 }
 
-void HSHomeObject::HS_Shard::write_sb() {
+void HSHomeObject::HS_Shard::set_chunk_id(homestore::chunk_num_t chunk_id) {
+    // update_sb() leaves the chunk alone, the next CP writes it out along with the info.
+    sb_->chunk_id = chunk_id;
+    mark_dirty();
+}
+
+void HSHomeObject::HS_Shard::update_sb() {
     sb_->id = info.id;
     sb_->placement_group = info.placement_group;
     sb_->state = info.state;
@@ -316,7 +538,22 @@ void HSHomeObject::HS_Shard::write_sb() {
     sb_->available_capacity_bytes = info.available_capacity_bytes;
     sb_->total_capacity_bytes = info.total_capacity_bytes;
     sb_->deleted_capacity_bytes = info.deleted_capacity_bytes;
-    sb_.write();
+}
+
+void HSHomeObject::collect_dirty_shards(HomeObjCPContext& cp_ctx, homestore::cp_id_t cp_id,
+                                        std::vector< std::function< void() > >& writes) {
+    auto const slot = cp_id % 2;
+    // a blob put or deleted under this CP queued its shard along with the change to its used bytes;
+    for (auto hs_shard : cp_ctx.shard_dirty_list_) {
+        {
+            std::shared_lock lock_guard(_get_pg(hs_shard->info.placement_group)->mtx_);
+            hs_shard->is_dirty_[slot].store(false, std::memory_order_release);
+            hs_shard->update_sb();
+            hs_shard->sb_->used_bytes += hs_shard->cp_used_bytes_[slot].exchange(0, std::memory_order_relaxed);
+        }
+        // the io path only updates info, sb_ stays as copied here until the next cp, which starts after this one.
+        writes.emplace_back([hs_shard] { hs_shard->sb_.write(); });
+    }
 }
 
 ShardInfo HSHomeObject::HS_Shard::shard_info_from_sb(homestore::superblk< shard_info_superblk > const& sb) {
@@ -1,3 +1,10 @@
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <numeric>
+#include <set>
+#include <unordered_map>
+
 #include <boost/uuid/uuid.hpp>
 #include <boost/uuid/random_generator.hpp>
 #include "hs_homeobject.hpp"
@@ -40,70 +47,554 @@ HSHomeObject::recover_index_table(homestore::superblk< homestore::index_table_sb
     return index_table;
 }
 
-BlobManager::NullResult HSHomeObject::add_to_index_table(shared< BlobIndexTable > index_table,
-                                                         const BlobInfo& blob_info) {
-    BlobRouteKey index_key{BlobRoute{blob_info.shard_id, blob_info.blob_id}};
+// The word at the route of an entry that is not a blob, see meta_route(); nullopt when there is no entry there.
+static BlobManager::Result< std::optional< uint64_t > > get_meta_word(shared< BlobIndexTable > const& index_table,
+                                                                      BlobRoute const& route) {
+    BlobRouteKey index_key{route};
+    BlobRouteValue index_value;
+    homestore::BtreeSingleGetRequest get_req{&index_key, &index_value};
+    auto const status = index_table->get(get_req);
+    if (status == homestore::btree_status_t::not_found) { return std::nullopt; }
+    if (status != homestore::btree_status_t::success) {
+        LOGE("Failed to get from index table [route={}] error {}", index_key, status);
+        return folly::makeUnexpected(BlobError::INDEX_ERROR);
+    }
+    return index_value.word();
+}
+
+static BlobManager::NullResult put_meta_word(shared< BlobIndexTable > const& index_table, BlobRoute const& route,
+                                             uint64_t word) {
+    BlobRouteKey index_key{route};
+    BlobRouteValue index_value{word}, existing_value;
+    homestore::BtreeSinglePutRequest put_req{&index_key, &index_value, homestore::btree_put_type::UPSERT,
+                                             &existing_value};
+    if (auto status = index_table->put(put_req); status != homestore::btree_status_t::success) {
+        LOGE("Failed to put to index table [route={}] error {}", index_key, status);
+        return folly::makeUnexpected(BlobError::INDEX_ERROR);
+    }
+    return folly::Unit();
+}
+
+static void remove_meta_word(shared< BlobIndexTable > const& index_table, BlobRoute const& route) {
+    BlobRouteKey index_key{route};
+    BlobRouteValue existing_value;
+    homestore::BtreeSingleRemoveRequest remove_req{&index_key, &existing_value};
+    if (auto status = index_table->remove(remove_req);
+        status != homestore::btree_status_t::success && status != homestore::btree_status_t::not_found) {
+        // Left behind it only takes up an entry, nothing reads it without the blob.
+        LOGW("Failed to remove from index table [route={}] error {}", index_key, status);
+    }
+}
+
+// The packed ranges of the blobs [from, to] of a shard by blob id, a sweep that finds nothing unless some are packed.
+static BlobManager::Result< std::unordered_map< blob_id_t, uint64_t > >
+get_packed_ranges(shared< BlobIndexTable > const& index_table, shard_id_t shard_id, blob_id_t from, blob_id_t to) {
+    std::unordered_map< blob_id_t, uint64_t > ranges;
+    homestore::BtreeQueryRequest< BlobRouteKey > query_req{
+        homestore::BtreeKeyRange< BlobRouteKey >{BlobRouteKey{meta_route(BlobRoute{shard_id, from})}, true,
+                                                 BlobRouteKey{meta_route(BlobRoute{shard_id, to})}, true},
+        homestore::BtreeQueryType::SWEEP_NON_INTRUSIVE_PAGINATION_QUERY, 1024};
+    auto status = homestore::btree_status_t::has_more;
+    while (status == homestore::btree_status_t::has_more) {
+        std::vector< std::pair< BlobRouteKey, BlobRouteValue > > out;
+        status = index_table->query(query_req, out);
+        if (status != homestore::btree_status_t::success && status != homestore::btree_status_t::has_more) {
+            LOGE("Failed to query the packed ranges of shard {} blobs [{}, {}] error {}", shard_id, from, to, status);
+            return folly::makeUnexpected(BlobError::INDEX_ERROR);
+        }
+        for (auto const& [k, v] : out) {
+            ranges.emplace(k.key().blob, v.word());
+        }
+    }
+    return ranges;
+}
+
+static BlobManager::NullResult add_packed_ranges(shared< BlobIndexTable > const& index_table, bool packed_blobs,
+                                                 shard_id_t shard_id,
+                                                 std::vector< HSHomeObject::BlobInfo >& blob_infos) {
+    if (!packed_blobs || blob_infos.empty()) { return folly::Unit(); }
+    auto ranges = get_packed_ranges(index_table, shard_id, blob_infos.front().blob_id, blob_infos.back().blob_id);
+    if (!ranges) { return folly::makeUnexpected(ranges.error()); }
+    if (ranges.value().empty()) { return folly::Unit(); }
+    for (auto& blob_info : blob_infos) {
+        if (blob_info.pbas == HSHomeObject::tombstone_pbas) { continue; }
+        if (auto it = ranges.value().find(blob_info.blob_id); it != ranges.value().end()) {
+            blob_info.pbas = with_packed_range(blob_info.pbas, it->second);
+        }
+    }
+    return folly::Unit();
+}
+
+BlobManager::Result< bool > HSHomeObject::add_to_index_table(shared< BlobIndexTable > index_table,
+                                                             const BlobInfo& blob_info) {
+    BlobRoute const route{blob_info.shard_id, blob_info.blob_id};
+    // The packed range goes in first, a blob is never found without it even if only the first put is checkpointed.
+    if (blob_info.pbas.packed()) {
+        if (auto r = put_meta_word(index_table, meta_route(route), packed_range_word(blob_info.pbas)); !r) {
+            return folly::makeUnexpected(r.error());
+        }
+    }
+    BlobRouteKey index_key{route};
     BlobRouteValue index_value{blob_info.pbas}, existing_value;
     homestore::BtreeSinglePutRequest put_req{&index_key, &index_value, homestore::btree_put_type::INSERT,
                                              &existing_value};
+    auto const start_time = HomeObjectMetrics::clock::now();
     auto status = index_table->put(put_req);
+    HISTOGRAM_OBSERVE(metrics_, blob_index_put_latency, HomeObjectMetrics::elapsed_us(start_time));
     if (status != homestore::btree_status_t::success) {
         if (existing_value.pbas().is_valid() || existing_value.pbas() == tombstone_pbas) {
-            // Check if the blob id already exists in the index or its tombstone.
-            return folly::Unit();
+            // Check if the blob id already exists in the index or its tombstone. A replay after the delete of the
+            // blob must not bring its packed range back.
+            if (blob_info.pbas.packed() && existing_value.pbas() != blob_info.pbas) {
+                remove_meta_word(index_table, meta_route(route));
+            }
+            return false;
         }
         LOGE("Failed to put to index table error {}", status);
         return folly::makeUnexpected(BlobError::INDEX_ERROR);
     }
 
+    return true;
+}
+
+BlobManager::NullResult HSHomeObject::add_to_index_table(shared< BlobIndexTable > index_table,
+                                                         std::vector< BlobInfo > const& blob_infos) {
+    // Blob ids of a batch are consecutive within one shard, so the inserts walk the same leaf nodes in key order.
+    // A btree range put is not usable here as it applies one value to the whole key range.
+    for (auto const& blob_info : blob_infos) {
+        if (auto r = add_to_index_table(index_table, blob_info); !r) { return folly::makeUnexpected(r.error()); }
+    }
     return folly::Unit();
 }
 
-BlobManager::Result< homestore::MultiBlkId >
-HSHomeObject::get_blob_from_index_table(shared< BlobIndexTable > index_table, shard_id_t shard_id,
-                                        blob_id_t blob_id) const {
+BlobManager::Result< BlobLocation >
+HSHomeObject::get_blob_from_index_table(HS_PG const& pg, shard_id_t shard_id, blob_id_t blob_id) const {
+    auto const& index_table = pg.index_table_;
     BlobRouteKey index_key{BlobRoute{shard_id, blob_id}};
     BlobRouteValue index_value;
     homestore::BtreeSingleGetRequest get_req{&index_key, &index_value};
 
-    if (homestore::btree_status_t::success != index_table->get(get_req)) {
+    auto const start_time = HomeObjectMetrics::clock::now();
+    auto const status = index_table->get(get_req);
+    HISTOGRAM_OBSERVE(metrics_, blob_index_get_latency, HomeObjectMetrics::elapsed_us(start_time));
+    if (homestore::btree_status_t::success != status) {
         LOGDEBUG("Failed to get from index table [route={}]", index_key);
         return folly::makeUnexpected(BlobError::UNKNOWN_BLOB);
     }
 
     // blob get API
-    if (const auto& pbas = index_value.pbas(); pbas != tombstone_pbas) return pbas;
-    return folly::makeUnexpected(BlobError::UNKNOWN_BLOB);
+    auto const pbas = index_value.pbas();
+    if (pbas == tombstone_pbas) { return folly::makeUnexpected(BlobError::UNKNOWN_BLOB); }
+    // Read after the get, the flag is set before a packed blob can be found.
+    if (!pg.has_packed_blobs()) { return BlobLocation{pbas}; }
+    auto range = get_meta_word(index_table, meta_route(index_key.key()));
+    if (!range) { return folly::makeUnexpected(range.error()); }
+    return range.value() ? with_packed_range(pbas, *range.value()) : BlobLocation{pbas};
 }
 
-BlobManager::Result< homestore::MultiBlkId > HSHomeObject::move_to_tombstone(shared< BlobIndexTable > index_table,
-                                                                             const BlobInfo& blob_info) {
-    BlobRouteKey index_key{BlobRoute{blob_info.shard_id, blob_info.blob_id}};
-    BlobRouteValue index_value_get;
-    homestore::BtreeSingleGetRequest get_req{&index_key, &index_value_get};
-    auto status = index_table->get(get_req);
-    if (status != homestore::btree_status_t::success) {
-        LOGE("Failed to get from index table [route={}]", index_key);
+std::vector< BlobManager::Result< BlobLocation > >
+HSHomeObject::get_blobs_from_index_table(HS_PG const& pg, shard_id_t shard_id,
+                                         std::vector< blob_id_t > const& blob_ids) const {
+    auto const& index_table = pg.index_table_;
+    std::vector< BlobManager::Result< BlobLocation > > results;
+    results.reserve(blob_ids.size());
+    if (blob_ids.empty()) { return results; }
+
+    auto const [min_it, max_it] = std::minmax_element(blob_ids.begin(), blob_ids.end());
+    auto const span = *max_it - *min_it + 1;
+    // Sweeping the range only pays off if most of the keys in it are wanted.
+    if (blob_ids.size() == 1 || span > 2 * blob_ids.size()) {
+        for (auto const blob_id : blob_ids) {
+            results.push_back(get_blob_from_index_table(pg, shard_id, blob_id));
+        }
+        return results;
+    }
+
+    homestore::BtreeQueryRequest< BlobRouteKey > query_req{
+        homestore::BtreeKeyRange< BlobRouteKey >{BlobRouteKey{BlobRoute{shard_id, *min_it}}, true,
+                                                 BlobRouteKey{BlobRoute{shard_id, *max_it}}, true},
+        homestore::BtreeQueryType::SWEEP_NON_INTRUSIVE_PAGINATION_QUERY, s_cast< uint32_t >(span)};
+    std::unordered_map< blob_id_t, BlobLocation > found;
+    found.reserve(span);
+    auto status = homestore::btree_status_t::has_more;
+    while (status == homestore::btree_status_t::has_more) {
+        std::vector< std::pair< BlobRouteKey, BlobRouteValue > > out;
+        status = index_table->query(query_req, out);
+        if (status != homestore::btree_status_t::success && status != homestore::btree_status_t::has_more) {
+            LOGE("Failed to query index table shard {} blobs [{}, {}] error {}", shard_id, *min_it, *max_it, status);
+            for (size_t i = 0; i < blob_ids.size(); ++i) {
+                results.push_back(folly::makeUnexpected(BlobError::INDEX_ERROR));
+            }
+            return results;
+        }
+        for (auto const& [k, v] : out) {
+            found.emplace(k.key().blob, v.pbas());
+        }
+    }
+    if (pg.has_packed_blobs()) {
+        auto ranges = get_packed_ranges(index_table, shard_id, *min_it, *max_it);
+        if (!ranges) {
+            for (size_t i = 0; i < blob_ids.size(); ++i) {
+                results.push_back(folly::makeUnexpected(ranges.error()));
+            }
+            return results;
+        }
+        for (auto const& [blob_id, range] : ranges.value()) {
+            if (auto it = found.find(blob_id); it != found.end()) { it->second = with_packed_range(it->second, range); }
+        }
+    }
+
+    for (auto const blob_id : blob_ids) {
+        auto it = found.find(blob_id);
+        if (it == found.end() || it->second == tombstone_pbas) {
+            results.push_back(folly::makeUnexpected(BlobError::UNKNOWN_BLOB));
+            continue;
+        }
+        results.push_back(it->second);
+    }
+    return results;
+}
+
+BlobManager::Result< BlobLocation > HSHomeObject::move_to_tombstone(HS_PG const& pg, const BlobInfo& blob_info) {
+    // A single update walks the tree once and hands back the value it replaced. In a PG with packed blobs the packed
+    // range is looked up first and removed after, so a blob that is still there always has it.
+    auto const& index_table = pg.index_table_;
+    BlobRoute const route{blob_info.shard_id, blob_info.blob_id};
+    std::optional< uint64_t > range;
+    if (pg.has_packed_blobs()) {
+        auto r = get_meta_word(index_table, meta_route(route));
+        if (!r) { return folly::makeUnexpected(r.error()); }
+        range = r.value();
+    }
+    BlobRouteKey index_key{route};
+    BlobRouteValue index_value_put{tombstone_pbas}, existing_value;
+    homestore::BtreeSinglePutRequest put_req{&index_key, &index_value_put, homestore::btree_put_type::UPDATE,
+                                             &existing_value};
+    auto status = index_table->put(put_req);
+    if (status == homestore::btree_status_t::not_found || status == homestore::btree_status_t::put_failed) {
+        LOGE_RATE_LIMITED("Blob not found in index table [route={}]", index_key);
         return folly::makeUnexpected(BlobError::UNKNOWN_BLOB);
     }
+    if (status != homestore::btree_status_t::success) {
+        LOGDEBUG("Failed to move blob to tombstone in index table [route={}]", index_key);
+        return folly::makeUnexpected(BlobError::INDEX_ERROR);
+    }
+    if (!range) { return BlobLocation{existing_value.pbas()}; }
+    remove_meta_word(index_table, meta_route(route));
+    if (existing_value.pbas() == tombstone_pbas) { return BlobLocation{tombstone_pbas}; }
+    return with_packed_range(existing_value.pbas(), *range);
+}
+
+std::vector< BlobManager::Result< BlobLocation > >
+HSHomeObject::move_to_tombstone(HS_PG const& pg, std::vector< BlobInfo > const& blob_infos) {
+    // Updated in key order so consecutive blobs walk the same leaf nodes, results stay in the order of blob_infos.
+    std::vector< size_t > order(blob_infos.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&blob_infos](size_t a, size_t b) {
+        return BlobRoute{blob_infos[a].shard_id, blob_infos[a].blob_id} <
+            BlobRoute{blob_infos[b].shard_id, blob_infos[b].blob_id};
+    });
 
-    BlobRouteValue index_value_put{tombstone_pbas};
-    homestore::BtreeSinglePutRequest put_req{&index_key, &index_value_put, homestore::btree_put_type::UPDATE};
+    std::vector< BlobManager::Result< BlobLocation > > results(
+        blob_infos.size(), folly::makeUnexpected(BlobError::UNKNOWN_BLOB));
+    for (auto const i : order) {
+        results[i] = move_to_tombstone(pg, blob_infos[i]);
+    }
+    return results;
+}
+
+BlobManager::Result< BlobList > HSHomeObject::list_blobs_from_index_table(HS_PG const& pg, shard_id_t shard_id,
+                                                                          blob_id_t start, uint32_t limit,
+                                                                          BlobState filter, uint32_t blk_size) const {
+    auto const& index_table = pg.index_table_;
+    BlobList blobs;
+    BlobRouteKey const first{BlobRoute{shard_id, start}};
+    BlobRouteKey const last{BlobRoute{shard_id, std::numeric_limits< blob_id_t >::max()}};
+    homestore::BtreeQueryRequest< BlobRouteKey > query_req{
+        homestore::BtreeKeyRange< BlobRouteKey >{first, true, last, true},
+        homestore::BtreeQueryType::SWEEP_NON_INTRUSIVE_PAGINATION_QUERY, limit};
+    auto status = homestore::btree_status_t::has_more;
+    while (status == homestore::btree_status_t::has_more && blobs.size() < limit) {
+        std::vector< std::pair< BlobRouteKey, BlobRouteValue > > out;
+        status = index_table->query(query_req, out);
+        if (status != homestore::btree_status_t::success && status != homestore::btree_status_t::has_more) {
+            LOGE("Failed to query index table shard {} from blob {} error {}", shard_id, start, status);
+            return folly::makeUnexpected(BlobError::INDEX_ERROR);
+        }
+        for (auto const& [k, v] : out) {
+            auto const pbas = v.pbas();
+            auto const state = pbas == tombstone_pbas ? BlobState::DELETED : BlobState::ALIVE;
+            if (filter != BlobState::ALL && filter != state) { continue; }
+            auto entry = BlobListEntry{.id = k.key().blob, .state = state};
+            if (state == BlobState::ALIVE) {
+                entry.size = pbas.bytes(blk_size);
+            }
+            blobs.push_back(std::move(entry));
+            if (blobs.size() == limit) { break; }
+        }
+    }
+    if (!pg.has_packed_blobs() || blobs.empty()) { return blobs; }
+    auto ranges = get_packed_ranges(index_table, shard_id, blobs.front().id, blobs.back().id);
+    if (!ranges) { return folly::makeUnexpected(ranges.error()); }
+    for (auto& entry : blobs) {
+        auto it = ranges.value().find(entry.id);
+        if (entry.state == BlobState::ALIVE && it != ranges.value().end()) {
+            entry.size = with_packed_range(homestore::MultiBlkId{}, it->second).bytes(blk_size);
+        }
+    }
+    return blobs;
+}
+
+BlobManager::Result< std::vector< HSHomeObject::BlobInfo > >
+HSHomeObject::move_range_to_tombstone(HS_PG const& pg, shard_id_t shard_id, blob_id_t from, blob_id_t to) {
+    auto const& index_table = pg.index_table_;
+    std::vector< BlobInfo > live;
+    if (from >= to) { return live; }
+    homestore::BtreeKeyRange< BlobRouteKey > const range{BlobRouteKey{BlobRoute{shard_id, from}}, true,
+                                                         BlobRouteKey{BlobRoute{shard_id, to - 1}}, true};
+
+    // The blkids to free are collected with one sweep, the tombstones then written with one range update which
+    // only touches keys already in the tree.
+    homestore::BtreeQueryRequest< BlobRouteKey > query_req{
+        homestore::BtreeKeyRange< BlobRouteKey >{range},
+        homestore::BtreeQueryType::SWEEP_NON_INTRUSIVE_PAGINATION_QUERY,
+        s_cast< uint32_t >(std::min< uint64_t >(to - from, 1024))};
+    auto status = homestore::btree_status_t::has_more;
+    while (status == homestore::btree_status_t::has_more) {
+        std::vector< std::pair< BlobRouteKey, BlobRouteValue > > out;
+        status = index_table->query(query_req, out);
+        if (status != homestore::btree_status_t::success && status != homestore::btree_status_t::has_more) {
+            LOGE("Failed to query index table shard {} blobs [{}, {}) error {}", shard_id, from, to, status);
+            return folly::makeUnexpected(BlobError::INDEX_ERROR);
+        }
+        for (auto const& [k, v] : out) {
+            if (v.pbas() == tombstone_pbas) { continue; }
+            live.push_back(BlobInfo{shard_id, k.key().blob, v.pbas()});
+        }
+    }
+    if (live.empty()) { return live; }
+    if (auto r = add_packed_ranges(index_table, pg.has_packed_blobs(), shard_id, live); !r) {
+        return folly::makeUnexpected(r.error());
+    }
+
+    BlobRouteValue tombstone_value{tombstone_pbas};
+    homestore::BtreeRangePutRequest< BlobRouteKey > put_req{homestore::BtreeKeyRange< BlobRouteKey >{range},
+                                                            homestore::btree_put_type::UPDATE, &tombstone_value};
     status = index_table->put(put_req);
     if (status != homestore::btree_status_t::success) {
-        LOGDEBUG("Failed to move blob to tombstone in index table [route={}]", index_key);
+        LOGE("Failed to move blobs to tombstone in index table shard {} blobs [{}, {}) error {}", shard_id, from, to,
+             status);
+        return folly::makeUnexpected(BlobError::INDEX_ERROR);
+    }
+    for (auto const& blob_info : live) {
+        if (blob_info.pbas.packed()) { remove_meta_word(index_table, meta_route({shard_id, blob_info.blob_id})); }
+    }
+    return live;
+}
+
+BlobManager::Result< std::vector< HSHomeObject::BlobInfo > >
+HSHomeObject::get_shard_blob_infos(HS_PG const& pg, shard_id_t shard_id, blob_id_t from, blob_id_t to) const {
+    auto const& index_table = pg.index_table_;
+    std::vector< BlobInfo > blob_infos;
+    BlobRouteKey const first{BlobRoute{shard_id, from}};
+    BlobRouteKey const last{BlobRoute{shard_id, to}};
+    homestore::BtreeQueryRequest< BlobRouteKey > query_req{
+        homestore::BtreeKeyRange< BlobRouteKey >{first, true, last, true},
+        homestore::BtreeQueryType::SWEEP_NON_INTRUSIVE_PAGINATION_QUERY, 1024};
+    auto status = homestore::btree_status_t::has_more;
+    while (status == homestore::btree_status_t::has_more) {
+        std::vector< std::pair< BlobRouteKey, BlobRouteValue > > out;
+        status = index_table->query(query_req, out);
+        if (status != homestore::btree_status_t::success && status != homestore::btree_status_t::has_more) {
+            LOGE("Failed to query index table shard {} error {}", shard_id, status);
+            return folly::makeUnexpected(BlobError::INDEX_ERROR);
+        }
+        for (auto const& [k, v] : out) {
+            blob_infos.push_back(BlobInfo{shard_id, k.key().blob, v.pbas()});
+        }
+    }
+    if (auto r = add_packed_ranges(index_table, pg.has_packed_blobs(), shard_id, blob_infos); !r) {
+        return folly::makeUnexpected(r.error());
+    }
+    return blob_infos;
+}
+
+BlobManager::NullResult HSHomeObject::replace_blob_pbas(HS_PG const& pg, const BlobInfo& blob_info,
+                                                        homestore::MultiBlkId const& new_pbas) {
+    auto const& index_table = pg.index_table_;
+    auto r = get_blob_from_index_table(pg, blob_info.shard_id, blob_info.blob_id);
+    if (!r) { return folly::makeUnexpected(r.error()); }
+    if (r.value() != blob_info.pbas) { return folly::makeUnexpected(BlobError::UNKNOWN_BLOB); }
+
+    BlobRouteKey index_key{BlobRoute{blob_info.shard_id, blob_info.blob_id}};
+    // The packed range is kept as it is, a move copies the whole blocks of the blob.
+    BlobRouteValue index_value{new_pbas}, existing_value;
+    homestore::BtreeSinglePutRequest put_req{&index_key, &index_value, homestore::btree_put_type::UPDATE,
+                                             &existing_value};
+    if (auto status = index_table->put(put_req); status != homestore::btree_status_t::success) {
+        LOGE("Failed to update blkids in index table [route={}] error {}", index_key, status);
         return folly::makeUnexpected(BlobError::INDEX_ERROR);
     }
+    return folly::Unit();
+}
+
+std::vector< homestore::MultiBlkId > HSHomeObject::blks_to_free(HS_PG const& pg,
+                                                               std::vector< BlobInfo > const& blob_infos) const {
+    std::vector< homestore::MultiBlkId > blks;
+    std::vector< BlobInfo const* > packed;
+    for (auto const& blob_info : blob_infos) {
+        if (blob_info.pbas == tombstone_pbas) { continue; }
+        if (blob_info.pbas.packed()) {
+            packed.push_back(&blob_info);
+        } else {
+            blks.push_back(blob_info.pbas);
+        }
+    }
+    if (packed.empty()) { return blks; }
+
+    // Blobs sharing a block were packed together, so their ids are at most max_pack_blobs apart. The windows around
+    // the packed blobs are merged to look the neighbours up with as few sweeps as possible.
+    std::sort(packed.begin(), packed.end(), [](BlobInfo const* a, BlobInfo const* b) {
+        return BlobRoute{a->shard_id, a->blob_id} < BlobRoute{b->shard_id, b->blob_id};
+    });
+    struct Window {
+        shard_id_t shard_id;
+        blob_id_t from;
+        blob_id_t to;
+    };
+    std::vector< Window > windows;
+    for (auto const blob_info : packed) {
+        auto const id = blob_info->blob_id;
+        auto const from = id - std::min< blob_id_t >(id, BlobPacker::max_pack_blobs);
+        auto const to = id + std::min< blob_id_t >(std::numeric_limits< blob_id_t >::max() - id,
+                                                   BlobPacker::max_pack_blobs);
+        if (!windows.empty() && windows.back().shard_id == blob_info->shard_id && from <= windows.back().to) {
+            windows.back().to = to;
+            continue;
+        }
+        windows.push_back(Window{blob_info->shard_id, from, to});
+    }
+
+    // A block shared with a neighbour is the first or the last block of both, those of the live neighbours stay.
+    std::set< std::pair< homestore::chunk_num_t, uint32_t > > live_edges;
+    for (auto const& w : windows) {
+        auto neighbours = get_shard_blob_infos(pg, w.shard_id, w.from, w.to);
+        if (!neighbours) {
+            LOGW("Failed to look up the neighbours of packed blobs in shard {}, keeping their blocks", w.shard_id);
+            return blks;
+        }
+        for (auto const& n : neighbours.value()) {
+            if (n.pbas == tombstone_pbas || !n.pbas.packed()) { continue; }
+            live_edges.emplace(n.pbas.chunk_num(), n.pbas.blk_num());
+            live_edges.emplace(n.pbas.chunk_num(), n.pbas.blk_num() + n.pbas.blk_count() - 1);
+        }
+    }
+
+    // Block ranges [start, end) to free per chunk, merged so a block shared by two of the blobs is freed once.
+    std::map< homestore::chunk_num_t, std::vector< std::pair< uint32_t, uint32_t > > > ranges;
+    for (auto const blob_info : packed) {
+        auto const& pbas = blob_info->pbas;
+        auto const chunk = pbas.chunk_num();
+        uint32_t start = pbas.blk_num();
+        uint32_t end = start + pbas.blk_count();
+        bool const first_shared = live_edges.contains({chunk, start});
+        bool const last_shared = live_edges.contains({chunk, end - 1});
+        if (first_shared) { ++start; }
+        if (last_shared && end > start) { --end; }
+        if (start < end) { ranges[chunk].emplace_back(start, end); }
+    }
+    for (auto& [chunk, chunk_ranges] : ranges) {
+        std::sort(chunk_ranges.begin(), chunk_ranges.end());
+        auto add = [&blks, chunk = chunk](uint32_t start, uint32_t end) {
+            while (start < end) {
+                auto const count =
+                    std::min< uint32_t >(end - start, std::numeric_limits< homestore::blk_count_t >::max());
+                blks.emplace_back(start, s_cast< homestore::blk_count_t >(count), chunk);
+                start += count;
+            }
+        };
+        auto [start, end] = chunk_ranges.front();
+        for (auto const& [s, e] : chunk_ranges) {
+            if (s <= end) {
+                end = std::max(end, e);
+                continue;
+            }
+            add(start, end);
+            start = s;
+            end = e;
+        }
+        add(start, end);
+    }
+    return blks;
+}
+
+BlobManager::Result< uint64_t > HSHomeObject::add_extent_refs(HS_PG& pg, homestore::MultiBlkId const& pbas,
+                                                               int64_t refs) {
+    auto const route = extent_refs_route(pg.pg_info_.id, pbas.chunk_num(), pbas.blk_num());
+    auto const count = get_meta_word(pg.index_table_, route);
+    if (!count) { return folly::makeUnexpected(count.error()); }
+    // An extent without a count has the one index entry of the blob written to it.
+    auto const before = count.value().value_or(1);
+    auto const after = int64_t(before) + refs;
+    if (after > 1) {
+        if (auto r = put_meta_word(pg.index_table_, route, uint64_t(after)); !r) {
+            return folly::makeUnexpected(r.error());
+        }
+    } else if (count.value()) {
+        remove_meta_word(pg.index_table_, route);
+    }
+    return before;
+}
 
-    return index_value_get.pbas();
+BlobManager::Result< bool > HSHomeObject::add_dedup_ref_to_index_table(HS_PG& pg, BlobInfo const& blob_info) {
+    // Like add_to_index_table(), a blob already in the index is a replayed put whose reference was counted before.
+    auto existing = get_meta_word(pg.index_table_, BlobRoute{blob_info.shard_id, blob_info.blob_id});
+    if (!existing) { return folly::makeUnexpected(existing.error()); }
+    if (existing.value()) { return false; }
+    // Counted before the entry is added, a crash in between leaves the extent counted once more than it is shared
+    // and its blocks leak, rather than being freed under the new blob.
+    if (auto r = add_extent_refs(pg, blob_info.pbas, 1); !r) { return folly::makeUnexpected(r.error()); }
+    return add_to_index_table(pg.index_table_, blob_info);
+}
+
+BlobManager::NullResult HSHomeObject::unshare_extents(HS_PG& pg, std::vector< BlobInfo >& blob_infos) {
+    BlobManager::NullResult result = folly::Unit();
+    std::erase_if(blob_infos, [&pg, &result](BlobInfo const& blob_info) {
+        if (!result) { return true; }
+        if (blob_info.pbas == tombstone_pbas || blob_info.pbas.packed()) { return false; }
+        auto before = add_extent_refs(pg, blob_info.pbas, -1);
+        if (!before) {
+            LOGE("Failed to drop the reference of blob {} in shard {} to its extent in pg {}, {}", blob_info.blob_id,
+                 blob_info.shard_id, pg.pg_info_.id, before.error());
+            result = folly::makeUnexpected(before.error());
+            return true;
+        }
+        return before.value() > 1;
+    });
+    // Blocks whose count could not be told are kept rather than freed under another blob, leaking them at worst.
+    if (!result) { blob_infos.clear(); }
+    return result;
+}
+
+BlobManager::NullResult HSHomeObject::remove_from_index_table(HS_PG const& pg, BlobRoute const& route) {
+    auto const& index_table = pg.index_table_;
+    BlobRouteKey index_key{route};
+    BlobRouteValue existing_value;
+    homestore::BtreeSingleRemoveRequest remove_req{&index_key, &existing_value};
+    if (auto status = index_table->remove(remove_req); status != homestore::btree_status_t::success) {
+        LOGDEBUG("Failed to remove from index table [route={}] error {}", index_key, status);
+        return folly::makeUnexpected(BlobError::UNKNOWN_BLOB);
+    }
+    // A delete cut short by a restart can leave the packed range of the blob behind.
+    if (pg.has_packed_blobs()) { remove_meta_word(index_table, meta_route(route)); }
+    return folly::Unit();
 }
 
 void HSHomeObject::print_btree_index(pg_id_t pg_id) {
     shared< BlobIndexTable > index_table;
     {
-        std::shared_lock lock_guard(_pg_lock);
         auto iter = _pg_map.find(pg_id);
-        RELEASE_ASSERT(iter != _pg_map.end(), "Unknown PG");
+        RELEASE_ASSERT(iter != _pg_map.cend(), "Unknown PG");
         index_table = static_cast< HS_PG* >(iter->second.get())->index_table_;
         RELEASE_ASSERT(index_table != nullptr, "Index table not intialized");
     }
@@ -1,9 +1,15 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <limits>
+
 #include <homestore/btree/btree_kv.hpp>
 #include <homestore/index/index_internal.hpp>
 #include <homestore/index_service.hpp>
 #include <homestore/blk.h>
+#include "blob_location.hpp"
 #include "lib/blob_route.hpp"
 
 namespace homeobject {
@@ -52,38 +58,72 @@ public:
 
 class BlobRouteValue : public homestore::BtreeValue {
 public:
-    BlobRouteValue() = default;
-    BlobRouteValue(const homestore::MultiBlkId& pbas) : pbas_(pbas) {}
-    BlobRouteValue(const BlobRouteValue& other) : homestore::BtreeValue() { pbas_ = other.pbas_; };
+    BlobRouteValue() : BlobRouteValue(homestore::MultiBlkId{}) {}
+    BlobRouteValue(const homestore::MultiBlkId& pbas) : homestore::BtreeValue() {
+        auto& pba = const_cast< homestore::MultiBlkId& >(pbas);
+        auto const pba_blob = pba.serialize();
+        RELEASE_ASSERT_LE(pba_blob.size(), get_fixed_size(), "Blkids of an index value span more than one piece");
+        std::memcpy(buf_.data(), pba_blob.cbytes(), pba_blob.size());
+    }
+    // The value of an entry that is not a blob, see meta_route().
+    explicit BlobRouteValue(uint64_t word) : homestore::BtreeValue() {
+        RELEASE_ASSERT_GE(get_fixed_size(), sizeof(word), "Index values are too small to hold a word");
+        std::memcpy(buf_.data(), &word, sizeof(word));
+    }
+    BlobRouteValue(const BlobRouteValue& other) : homestore::BtreeValue() { buf_ = other.buf_; };
     BlobRouteValue(const sisl::blob& b, bool copy) : homestore::BtreeValue() { deserialize(b, copy); }
     virtual ~BlobRouteValue() = default;
 
     BlobRouteValue& operator=(const BlobRouteValue& other) {
-        pbas_ = other.pbas_;
+        buf_ = other.buf_;
         return *this;
     }
 
-    sisl::blob serialize() const override {
-        auto& pba = const_cast< homestore::MultiBlkId& >(pbas_);
-        return pba.serialize();
-    }
-
-    uint32_t serialized_size() const override { return pbas_.serialized_size(); }
+    // The entries of blobs and all others are the serialized blkids of one piece, the on-disk stride of the index.
+    sisl::blob serialize() const override { return sisl::blob{buf_.data(), get_fixed_size()}; }
+    uint32_t serialized_size() const override { return get_fixed_size(); }
     static uint32_t get_fixed_size() { return homestore::MultiBlkId::expected_serialized_size(1 /* num_pieces */); }
 
-    void deserialize(const sisl::blob& b, bool copy) override { pbas_.deserialize(b, copy); }
-    std::string to_string() const override { return fmt::format("{}", pbas_.to_string()); }
+    void deserialize(const sisl::blob& b, bool) override {
+        std::memcpy(buf_.data(), b.cbytes(), std::min< size_t >(b.size(), buf_.size()));
+    }
+    std::string to_string() const override { return fmt::format("{}", pbas().to_string()); }
     friend std::ostream& operator<<(std::ostream& os, const BlobRouteValue& v) {
         os << v.pbas().to_string();
         return os;
     }
 
-    homestore::MultiBlkId pbas() const { return pbas_; }
+    homestore::MultiBlkId pbas() const {
+        homestore::MultiBlkId pbas;
+        pbas.deserialize(sisl::blob{const_cast< uint8_t* >(buf_.data()), get_fixed_size()}, true);
+        return pbas;
+    }
+    uint64_t word() const {
+        uint64_t word;
+        std::memcpy(&word, buf_.data(), sizeof(word));
+        return word;
+    }
 
 private:
-    homestore::MultiBlkId pbas_;
+    std::array< uint8_t, std::max(sizeof(homestore::MultiBlkId), sizeof(uint64_t)) > buf_{};
 };
 
+///
+// Index entries that are not blobs. The index table of a PG only holds the shards of that PG, so a route whose shard
+// id carries another pg id never names a blob; meta_route() flips the pg id of a blob route to give the route of the
+// packed range of a packed blob. Only packed blobs have one, so the value of every blob keeps the size of its blkids.
+// Shard sequence 0 is never given to a shard, in the meta key space it holds the reference counts of shared extents.
+constexpr shard_id_t meta_pg_bits = ~(std::numeric_limits< shard_id_t >::max() >> (sizeof(pg_id_t) * 8));
+inline BlobRoute meta_route(BlobRoute const& route) { return BlobRoute{route.shard ^ meta_pg_bits, route.blob}; }
+inline uint64_t packed_range_word(BlobLocation const& pbas) { return (uint64_t(pbas.offset) << 32) | pbas.size; }
+inline BlobLocation with_packed_range(homestore::MultiBlkId const& pbas, uint64_t word) {
+    return BlobLocation{pbas, uint32_t(word >> 32), uint32_t(word)};
+}
+inline BlobRoute extent_refs_route(pg_id_t pg, homestore::chunk_num_t chunk, homestore::blk_num_t blk) {
+    auto const pg_shard = shard_id_t(pg) << ((sizeof(shard_id_t) - sizeof(pg_id_t)) * 8);
+    return meta_route(BlobRoute{pg_shard, (uint64_t(chunk) << 32) | blk});
+}
+
 } // namespace homeobject
 
 namespace fmt {
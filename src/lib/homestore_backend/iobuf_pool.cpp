@@ -0,0 +1,104 @@
+#include "iobuf_pool.hpp"
+
+#include <cstring>
+#include <mutex>
+
+#include <iomgr/iomgr.hpp>
+#include <sisl/logging/logging.h>
+
+namespace homeobject {
+
+using FreeList = std::array< std::vector< uint8_t* >, IOBufPool::size_classes.size() >;
+
+struct IOBufPool::FreeLists {
+    // Only touched by the owning thread.
+    FreeList local;
+    // Buffers freed by other threads, guarded by mtx. Once the owning thread exited they are freed right away.
+    std::mutex mtx;
+    FreeList returned;
+    bool exited{false};
+};
+
+namespace {
+int size_class(uint32_t size) {
+    for (size_t i = 0; i < IOBufPool::size_classes.size(); ++i) {
+        if (size <= IOBufPool::size_classes[i]) { return static_cast< int >(i); }
+    }
+    return -1;
+}
+
+void free_all(std::vector< uint8_t* >& l) {
+    for (auto buf : l) {
+        iomanager.iobuf_free(buf);
+    }
+    l.clear();
+}
+
+// Buffers of an exited thread still in flight keep its free lists alive until they are freed.
+struct ThreadFreeLists {
+    std::shared_ptr< IOBufPool::FreeLists > lists{std::make_shared< IOBufPool::FreeLists >()};
+    ~ThreadFreeLists() {
+        std::scoped_lock lock_guard(lists->mtx);
+        lists->exited = true;
+        for (size_t c = 0; c < IOBufPool::size_classes.size(); ++c) {
+            free_all(lists->local[c]);
+            free_all(lists->returned[c]);
+        }
+    }
+};
+
+thread_local ThreadFreeLists t_free_lists;
+} // namespace
+
+IOBufPool::Buf IOBufPool::alloc(uint32_t size) {
+    auto const c = size_class(size);
+    if (c < 0) { return Buf{iomanager.iobuf_alloc(alignment, size), size, nullptr}; }
+
+    auto const& lists = t_free_lists.lists;
+    auto& l = lists->local[c];
+    if (l.empty()) {
+        std::scoped_lock lock_guard(lists->mtx);
+        std::swap(l, lists->returned[c]);
+    }
+    if (l.empty()) { return Buf{iomanager.iobuf_alloc(alignment, size_classes[c]), size, lists}; }
+    auto buf = l.back();
+    l.pop_back();
+    return Buf{buf, size, lists};
+}
+
+void IOBufPool::free(Buf const& buf) {
+    auto const c = size_class(buf.size);
+    if (c < 0 || !buf.owner) {
+        iomanager.iobuf_free(buf.bytes);
+        return;
+    }
+    if (buf.owner == t_free_lists.lists) {
+        auto& l = buf.owner->local[c];
+        if (l.size() >= max_cached_per_class) {
+            iomanager.iobuf_free(buf.bytes);
+        } else {
+            l.push_back(buf.bytes);
+        }
+        return;
+    }
+    std::scoped_lock lock_guard(buf.owner->mtx);
+    auto& l = buf.owner->returned[c];
+    if (buf.owner->exited || l.size() >= max_cached_per_class) {
+        iomanager.iobuf_free(buf.bytes);
+        return;
+    }
+    l.push_back(buf.bytes);
+}
+
+uint8_t const* IOBufPool::zeroes(uint32_t size) {
+    static std::once_flag once;
+    static uint8_t* zero_buf{nullptr};
+    std::call_once(once, [] {
+        zero_buf = iomanager.iobuf_alloc(alignment, max_zero_pad);
+        std::memset(zero_buf, 0, max_zero_pad);
+    });
+    RELEASE_ASSERT(size <= max_zero_pad, "Padding {} larger than the zero buffer", size);
+    return zero_buf;
+}
+
+} // namespace homeobject
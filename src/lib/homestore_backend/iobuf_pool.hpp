@@ -0,0 +1,46 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace homeobject {
+
+///
+// Per thread free lists of small aligned io buffers, used for the blob headers, user keys and keys built for every
+// put so they do not go through the allocator. A buffer goes back to the free lists of the thread it was allocated on
+// wherever it is freed: the completion of a write usually runs on another thread than its submitter, the buffers it
+// frees are handed back through a locked return list the owning thread takes over once its own list runs dry.
+// Larger sizes fall through to iomanager.
+class IOBufPool {
+public:
+    static constexpr uint32_t alignment{512};
+    static constexpr std::array< uint32_t, 4 > size_classes{512, 1024, 2048, 4096};
+    static constexpr size_t max_cached_per_class{1024};
+    // Largest padding zeroes() can provide, should cover any device block size.
+    static constexpr uint32_t max_zero_pad{64 * 1024};
+
+    struct FreeLists;
+    struct Buf {
+        uint8_t* bytes;
+        uint32_t size;
+        // Free lists of the thread the buffer came from, null for sizes the pool does not cache.
+        std::shared_ptr< FreeLists > owner;
+    };
+    using BufList = std::vector< Buf >;
+
+    // Returns an aligned buffer of at least size bytes, to be given back with free() from any thread.
+    static Buf alloc(uint32_t size);
+    static void free(Buf const& buf);
+    static void free(BufList const& bufs) {
+        for (auto const& b : bufs) {
+            free(b);
+        }
+    }
+
+    // Shared read only buffer of zeroes usable as padding in any write.
+    static uint8_t const* zeroes(uint32_t size);
+};
+
+} // namespace homeobject
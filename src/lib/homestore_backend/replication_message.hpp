@@ -8,7 +8,8 @@
 namespace homeobject {
 
 VENUM(ReplicationMessageType, uint16_t, CREATE_PG_MSG = 0, CREATE_SHARD_MSG = 1, SEAL_SHARD_MSG = 2, PUT_BLOB_MSG = 3,
-      DEL_BLOB_MSG = 4, UNKNOWN_MSG = 5);
+      DEL_BLOB_MSG = 4, PUT_BLOB_BATCH_MSG = 5, DEL_BLOB_BATCH_MSG = 6, PUT_BLOB_PACK_MSG = 7,
+      PUT_BLOB_DEDUP_MSG = 8, UNKNOWN_MSG = 9);
 
 // magic num comes from the first 8 bytes of 'echo homeobject_replication | md5sum'
 static constexpr uint64_t HOMEOBJECT_REPLICATION_MAGIC = 0x11153ca24efc8d34;
@@ -49,6 +50,41 @@ struct ReplicationMessageHeader {
     }
 };
 
+// Binary encodings of the shard info carried by CREATE_SHARD_MSG/SEAL_SHARD_MSG and of the pg info carried by
+// CREATE_PG_MSG. Older messages carry a json document instead, which always starts with '{' and so never matches the
+// magic of either.
+static constexpr uint32_t SHARD_INFO_MESSAGE_MAGIC = 0x4d495348; // "HSIM"
+static constexpr uint32_t PG_INFO_MESSAGE_MAGIC = 0x4d494750;    // "PGIM"
+static constexpr uint8_t INFO_MESSAGE_VERSION_V1 = 0x01;
+
+struct ShardInfoMessage {
+    uint32_t magic{SHARD_INFO_MESSAGE_MAGIC};
+    uint8_t version{INFO_MESSAGE_VERSION_V1};
+    uint8_t state;
+    shard_id_t id;
+    pg_id_t placement_group;
+    uint64_t created_time;
+    uint64_t last_modified_time;
+    uint64_t total_capacity_bytes;
+    uint64_t available_capacity_bytes;
+    uint64_t deleted_capacity_bytes;
+};
+
+// Followed by num_members PGMemberMessage, each of them followed by name_len bytes of member name.
+struct PGInfoMessage {
+    uint32_t magic{PG_INFO_MESSAGE_MAGIC};
+    uint8_t version{INFO_MESSAGE_VERSION_V1};
+    pg_id_t id;
+    peer_id_t replica_set_uuid;
+    uint32_t num_members;
+};
+
+struct PGMemberMessage {
+    peer_id_t id;
+    int32_t priority;
+    uint16_t name_len;
+};
+
 #pragma pack()
 
 } // namespace homeobject
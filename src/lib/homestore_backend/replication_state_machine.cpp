@@ -4,7 +4,7 @@
 namespace homeobject {
 void ReplicationStateMachine::on_commit(int64_t lsn, const sisl::blob& header, const sisl::blob& key,
                                         const homestore::MultiBlkId& pbas, cintrusive< homestore::repl_req_ctx >& ctx) {
-    LOGI("applying raft log commit with lsn:{}", lsn);
+    LOGT("applying raft log commit with lsn:{}", lsn);
     const ReplicationMessageHeader* msg_header = r_cast< const ReplicationMessageHeader* >(header.cbytes());
     switch (msg_header->msg_type) {
     case ReplicationMessageType::CREATE_PG_MSG: {
@@ -21,18 +21,33 @@ void ReplicationStateMachine::on_commit(int64_t lsn, const sisl::blob& header, c
         home_object_->on_blob_put_commit(lsn, header, key, pbas, ctx);
         break;
     }
+    case ReplicationMessageType::PUT_BLOB_BATCH_MSG: {
+        home_object_->on_blob_put_batch_commit(lsn, header, key, pbas, ctx);
+        break;
+    }
+    case ReplicationMessageType::PUT_BLOB_PACK_MSG: {
+        home_object_->on_blob_put_pack_commit(lsn, header, key, pbas, ctx);
+        break;
+    }
+    case ReplicationMessageType::PUT_BLOB_DEDUP_MSG:
+        home_object_->on_blob_put_dedup_commit(lsn, header, key, ctx);
+        break;
     case ReplicationMessageType::DEL_BLOB_MSG:
         home_object_->on_blob_del_commit(lsn, header, key, ctx);
         break;
+    case ReplicationMessageType::DEL_BLOB_BATCH_MSG:
+        home_object_->on_blob_del_batch_commit(lsn, header, key, ctx);
+        break;
     default: {
         break;
     }
     }
+    home_object_->on_log_applied(msg_header->pg_id, lsn);
 }
 
 bool ReplicationStateMachine::on_pre_commit(int64_t lsn, sisl::blob const&, sisl::blob const&,
                                             cintrusive< homestore::repl_req_ctx >&) {
-    LOGI("on_pre_commit with lsn:{}", lsn);
+    LOGT("on_pre_commit with lsn:{}", lsn);
     // For shard creation, since homestore repldev inside will write shard header to data service first before this
     // function is called. So there is nothing is needed to do and we can get the binding chunk_id with the newly shard
     // from the blkid in on_commit()
@@ -53,16 +68,8 @@ void ReplicationStateMachine::on_error(ReplServiceError error, const sisl::blob&
 homestore::blk_alloc_hints ReplicationStateMachine::get_blk_alloc_hints(sisl::blob const& header, uint32_t data_size) {
     const ReplicationMessageHeader* msg_header = r_cast< const ReplicationMessageHeader* >(header.cbytes());
     switch (msg_header->msg_type) {
-    case ReplicationMessageType::CREATE_SHARD_MSG: {
-        auto any_allocated_chunk_id = home_object_->get_any_chunk_id(msg_header->pg_id);
-        if (!any_allocated_chunk_id.has_value()) {
-            // pg is empty without any shards, we leave the decision the HeapChunkSelector to select a pdev
-            // with most available space and then select one chunk based on that pdev
-        } else {
-            return home_object_->chunk_selector()->chunk_to_hints(any_allocated_chunk_id.value());
-        }
-        break;
-    }
+    case ReplicationMessageType::CREATE_SHARD_MSG:
+        return home_object_->shard_create_get_blk_alloc_hints(msg_header->pg_id);
 
     case ReplicationMessageType::SEAL_SHARD_MSG: {
         auto chunk_id = home_object_->get_shard_chunk(msg_header->shard_id);
@@ -73,9 +80,17 @@ homestore::blk_alloc_hints ReplicationStateMachine::get_blk_alloc_hints(sisl::bl
     }
 
     case ReplicationMessageType::PUT_BLOB_MSG:
+    case ReplicationMessageType::PUT_BLOB_BATCH_MSG:
+    case ReplicationMessageType::PUT_BLOB_PACK_MSG: {
         // TODO fixme
-        return home_object_->blob_put_get_blk_alloc_hints(header, nullptr);
+        auto hints = home_object_->blob_put_get_blk_alloc_hints(header, nullptr);
+        // the bytes allocated for puts are the recent load striped shard placement balances on.
+        if (hints.chunk_id_hint) { home_object_->chunk_selector()->record_write(*hints.chunk_id_hint, data_size); }
+        return hints;
+    }
+    case ReplicationMessageType::PUT_BLOB_DEDUP_MSG:
     case ReplicationMessageType::DEL_BLOB_MSG:
+    case ReplicationMessageType::DEL_BLOB_BATCH_MSG:
     default: {
         break;
     }
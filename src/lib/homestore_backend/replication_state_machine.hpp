@@ -1,5 +1,7 @@
 #pragma once
 
+#include <chrono>
+
 #include <folly/futures/Future.h>
 #include <homestore/replication/repl_dev.h>
 #include "hs_homeobject.hpp"
@@ -14,6 +16,8 @@ using homestore::ReplServiceError;
 struct ho_repl_ctx : public homestore::repl_req_ctx {
     ReplicationMessageHeader header_;
     sisl::io_blob_safe hdr_buf_;
+    // When the request was made, for the latency of its phases until the commit.
+    std::chrono::steady_clock::time_point const start_time_{std::chrono::steady_clock::now()};
 
     ho_repl_ctx(uint32_t size, uint32_t alignment) : homestore::repl_req_ctx{}, hdr_buf_{size, alignment} {}
     template < typename T >
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace homeobject {
+
+///
+// Bounded LRU cache split over a number of independently locked shards picked by hash of the key. Every entry is
+// charged against the capacity, by 1 for caches bounded in entries or by its size for caches bounded in bytes.
+//
+// Caches filled from a lookup of the backing store that missed use epoch() and fill(): the fill is dropped if the
+// key's shard saw a remove() after the lookup started, so a removal racing with the lookup can not leave a stale
+// entry behind.
+template < typename K, typename V >
+class ShardedLRUCache {
+public:
+    using epoch_t = uint64_t;
+
+    ShardedLRUCache(uint64_t capacity, uint32_t num_shards) :
+            shard_capacity_{std::max(capacity / std::max(num_shards, 1u), uint64_t(1))},
+            shards_(std::max(num_shards, 1u)) {}
+
+    std::optional< V > get(K const& key) {
+        auto& shard = shard_of(key);
+        std::scoped_lock lock_guard(shard.mtx);
+        auto it = shard.map.find(key);
+        if (it == shard.map.end()) {
+            misses_.fetch_add(1, std::memory_order_relaxed);
+            return std::nullopt;
+        }
+        hits_.fetch_add(1, std::memory_order_relaxed);
+        shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+        return it->second->value;
+    }
+
+    // Epoch to pass to fill() for a lookup of this key that missed.
+    epoch_t epoch(K const& key) {
+        auto& shard = shard_of(key);
+        std::scoped_lock lock_guard(shard.mtx);
+        return shard.epoch;
+    }
+
+    void fill(K const& key, V value, uint64_t charge, epoch_t epoch) {
+        auto& shard = shard_of(key);
+        std::scoped_lock lock_guard(shard.mtx);
+        if (shard.epoch != epoch) { return; }
+        put_locked(shard, key, std::move(value), charge);
+    }
+
+    void put(K const& key, V value, uint64_t charge = 1) {
+        auto& shard = shard_of(key);
+        std::scoped_lock lock_guard(shard.mtx);
+        put_locked(shard, key, std::move(value), charge);
+    }
+
+    void remove(K const& key) {
+        auto& shard = shard_of(key);
+        std::scoped_lock lock_guard(shard.mtx);
+        ++shard.epoch;
+        if (auto it = shard.map.find(key); it != shard.map.end()) { erase_locked(shard, it->second); }
+    }
+
+    uint64_t hits() const { return hits_.load(std::memory_order_relaxed); }
+    uint64_t misses() const { return misses_.load(std::memory_order_relaxed); }
+
+    // Number of entries and total charge of the entries, summed over all shards.
+    uint64_t size() const {
+        uint64_t total{0};
+        for (auto const& shard : shards_) {
+            std::scoped_lock lock_guard(shard.mtx);
+            total += shard.map.size();
+        }
+        return total;
+    }
+    uint64_t charge() const {
+        uint64_t total{0};
+        for (auto const& shard : shards_) {
+            std::scoped_lock lock_guard(shard.mtx);
+            total += shard.charge;
+        }
+        return total;
+    }
+
+private:
+    struct Entry {
+        K key;
+        V value;
+        uint64_t charge;
+    };
+    using lru_list_t = std::list< Entry >;
+
+    struct Shard {
+        mutable std::mutex mtx;
+        lru_list_t lru; // most recently used first
+        std::unordered_map< K, typename lru_list_t::iterator > map;
+        uint64_t charge{0};
+        epoch_t epoch{0};
+    };
+
+    Shard& shard_of(K const& key) { return shards_[std::hash< K >{}(key) % shards_.size()]; }
+
+    void erase_locked(Shard& shard, typename lru_list_t::iterator it) {
+        shard.charge -= it->charge;
+        shard.map.erase(it->key);
+        shard.lru.erase(it);
+    }
+
+    void put_locked(Shard& shard, K const& key, V&& value, uint64_t charge) {
+        if (charge > shard_capacity_) { return; }
+        if (auto it = shard.map.find(key); it != shard.map.end()) { erase_locked(shard, it->second); }
+        while (shard.charge + charge > shard_capacity_) {
+            erase_locked(shard, std::prev(shard.lru.end()));
+        }
+        shard.lru.push_front(Entry{key, std::move(value), charge});
+        shard.map.emplace(key, shard.lru.begin());
+        shard.charge += charge;
+    }
+
+    uint64_t const shard_capacity_;
+    std::vector< Shard > shards_;
+    std::atomic< uint64_t > hits_{0};
+    std::atomic< uint64_t > misses_{0};
+};
+
+} // namespace homeobject
@@ -0,0 +1,273 @@
+///
+// Throughput and latency of the blob API and of a few hot helpers of the homestore backend.
+//
+// The put/get/del workload runs for every combination of --blob_sizes and --clients, each client thread working on
+// a shard of its own. Futures are deferred on the executor chosen by --executor, the binary is run once per executor
+// type to compare them. The microbenchmarks time the payload hash of every algorithm, BlobRouteKey::compare and a
+// select_chunk/release_chunk round trip of the HeapChunkSelector.
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <latch>
+#include <list>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/uuid/random_generator.hpp>
+#include <folly/Benchmark.h>
+#include <folly/init/Init.h>
+#include <sisl/logging/logging.h>
+#include <sisl/options/options.h>
+
+#include <homeobject/homeobject.hpp>
+#include <homeobject/blob_manager.hpp>
+#include <homeobject/pg_manager.hpp>
+#include <homeobject/shard_manager.hpp>
+#include "lib/homestore_backend/hs_homeobject.hpp"
+#include "lib/homestore_backend/heap_chunk_selector.h"
+#include "lib/homestore_backend/index_kv.hpp"
+#include "bits_generator.hpp"
+
+SISL_OPTION_GROUP(
+    homeobject_bench,
+    (blob_sizes, "", "blob_sizes", "blob sizes to run the workload with",
+     ::cxxopts::value< std::vector< uint32_t > >()->default_value("4096,65536,1048576"), "size,..."),
+    (clients, "", "clients", "client thread counts to run the workload with",
+     ::cxxopts::value< std::vector< uint32_t > >()->default_value("1,4,16"), "count,..."),
+    (ops, "", "ops", "operations of each kind per run, split among the clients",
+     ::cxxopts::value< uint64_t >()->default_value("4096"), "number"),
+    (max_bytes, "", "max_bytes", "bytes put by a run at most, runs of large blobs do fewer operations",
+     ::cxxopts::value< uint64_t >()->default_value("268435456"), "bytes"),
+    (micro_iters, "", "micro_iters", "iterations of each microbenchmark",
+     ::cxxopts::value< uint64_t >()->default_value("1000000"), "number"),
+    (dev_size_mb, "", "dev_size_mb", "size of the device file", ::cxxopts::value< uint64_t >()->default_value("4096"),
+     "mb"),
+    (workload, "", "workload", "benchmarks to run: api, micro or all",
+     ::cxxopts::value< std::string >()->default_value("all"), "api|micro|all"));
+
+SISL_LOGGING_INIT(HOMEOBJECT_LOG_MODS)
+
+SISL_OPTIONS_ENABLE(logging, iomgr, homeobject, homeobject_bench)
+
+using namespace homeobject;
+using bench_clock = std::chrono::steady_clock;
+
+class BenchApp : public HomeObjectApplication {
+    std::string path_{"/tmp/homeobject_bench.data"};
+
+public:
+    explicit BenchApp(uint64_t dev_size) {
+        clean();
+        std::ofstream ofs{path_, std::ios::binary | std::ios::out | std::ios::trunc};
+        std::filesystem::resize_file(path_, dev_size);
+    }
+    ~BenchApp() override { clean(); }
+
+    void clean() {
+        if (std::filesystem::exists(path_)) std::filesystem::remove(path_);
+    }
+
+    bool spdk_mode() const override { return false; }
+    uint32_t threads() const override { return 2; }
+    std::list< std::filesystem::path > devices() const override {
+        return std::list< std::filesystem::path >{std::filesystem::canonical(path_)};
+    }
+    peer_id_t discover_svcid(std::optional< peer_id_t > const& p) const override {
+        return p.has_value() ? p.value() : boost::uuids::random_generator()();
+    }
+    std::string lookup_peer(peer_id_t const&) const override { return "127.0.0.1:4000"; }
+};
+
+static uint64_t elapsed_ns(bench_clock::time_point start) {
+    return std::chrono::duration_cast< std::chrono::nanoseconds >(bench_clock::now() - start).count();
+}
+
+// Sorts the latencies of all clients and prints the throughput and the percentiles of one phase of a run.
+static void report(std::string_view name, uint32_t blob_size, uint32_t clients, uint64_t wall_ns,
+                   std::vector< std::vector< uint64_t > >&& latencies, uint64_t failed) {
+    std::vector< uint64_t > all;
+    for (auto& l : latencies) {
+        all.insert(all.end(), l.begin(), l.end());
+    }
+    if (all.empty()) { return; }
+    std::sort(all.begin(), all.end());
+    auto const pct = [&all](double p) {
+        return all[std::min(all.size() - 1, static_cast< size_t >(all.size() * p))] / 1000.0;
+    };
+    auto const secs = wall_ns / 1e9;
+    fmt::print("{:<4} size={:<8} clients={:<3} ops={:<7} failed={:<4} ops/s={:<10.0f} MB/s={:<9.1f} "
+               "p50={:.1f}us p99={:.1f}us p99.9={:.1f}us max={:.1f}us\n",
+               name, blob_size, clients, all.size(), failed, all.size() / secs, all.size() * blob_size / secs / Mi,
+               pct(0.5), pct(0.99), pct(0.999), all.back() / 1000.0);
+}
+
+// Runs ops_per_client calls of op(client, i) on each client thread at once and reports them as one phase.
+template < typename Op >
+static void run_phase(std::string_view name, uint32_t blob_size, uint32_t clients, uint64_t ops_per_client, Op&& op) {
+    std::vector< std::vector< uint64_t > > latencies(clients);
+    std::atomic< uint64_t > failed{0};
+    std::latch start{clients + 1};
+    std::vector< std::thread > threads;
+    threads.reserve(clients);
+    for (uint32_t c = 0; c < clients; ++c) {
+        threads.emplace_back([&, c] {
+            latencies[c].reserve(ops_per_client);
+            start.arrive_and_wait();
+            for (uint64_t i = 0; i < ops_per_client; ++i) {
+                auto const t = bench_clock::now();
+                if (!op(c, i)) { failed.fetch_add(1, std::memory_order_relaxed); }
+                latencies[c].push_back(elapsed_ns(t));
+            }
+        });
+    }
+    start.arrive_and_wait();
+    auto const t = bench_clock::now();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    report(name, blob_size, clients, elapsed_ns(t), std::move(latencies), failed.load());
+}
+
+static void run_api_workload(std::shared_ptr< HomeObject > const& obj, pg_id_t pg_id) {
+    auto const ops = SISL_OPTIONS["ops"].as< uint64_t >();
+    auto const max_bytes = SISL_OPTIONS["max_bytes"].as< uint64_t >();
+    for (auto const blob_size : SISL_OPTIONS["blob_sizes"].as< std::vector< uint32_t > >()) {
+        for (auto const clients : SISL_OPTIONS["clients"].as< std::vector< uint32_t > >()) {
+            if (0 == blob_size || 0 == clients) { continue; }
+            auto const ops_per_client = std::max< uint64_t >(1, std::min(ops, max_bytes / blob_size) / clients);
+
+            std::vector< shard_id_t > shards;
+            for (uint32_t c = 0; c < clients; ++c) {
+                auto s = obj->shard_manager()->create_shard(pg_id, ShardManager::max_shard_size()).get();
+                RELEASE_ASSERT(!!s, "failed to create shard: {}", s.error());
+                shards.push_back(s.value().id);
+            }
+
+            // the payloads are generated up front, a put moves its body into the store;
+            auto payload = sisl::io_blob_safe(blob_size, 512u);
+            BitsGenerator::gen_random_bits(payload);
+            std::vector< std::vector< Blob > > blobs(clients);
+            for (auto& client_blobs : blobs) {
+                client_blobs.reserve(ops_per_client);
+                for (uint64_t i = 0; i < ops_per_client; ++i) {
+                    auto body = sisl::io_blob_safe(blob_size, 512u);
+                    std::memcpy(body.bytes(), payload.cbytes(), blob_size);
+                    client_blobs.emplace_back(std::move(body), "bench_blob", i * blob_size);
+                }
+            }
+
+            std::vector< std::vector< blob_id_t > > ids(clients, std::vector< blob_id_t >(ops_per_client));
+            auto const blob_manager = obj->blob_manager();
+            run_phase("put", blob_size, clients, ops_per_client, [&](uint32_t c, uint64_t i) {
+                auto r = blob_manager->put(shards[c], std::move(blobs[c][i])).get();
+                if (r) { ids[c][i] = r.value(); }
+                return !!r;
+            });
+            run_phase("get", blob_size, clients, ops_per_client, [&](uint32_t c, uint64_t i) {
+                return !!blob_manager->get(shards[c], ids[c][i]).get();
+            });
+            run_phase("del", blob_size, clients, ops_per_client, [&](uint32_t c, uint64_t i) {
+                return !!blob_manager->del(shards[c], ids[c][i]).get();
+            });
+
+            // sealing gives back what the shards did not use of their chunks to the next run;
+            for (auto const shard_id : shards) {
+                obj->shard_manager()->seal_shard(shard_id).get();
+            }
+        }
+    }
+}
+
+template < typename Fn >
+static void run_micro(std::string_view name, uint64_t iters, uint64_t bytes_per_iter, Fn&& fn) {
+    if (0 == iters) { return; }
+    auto const t = bench_clock::now();
+    for (uint64_t i = 0; i < iters; ++i) {
+        fn(i);
+    }
+    auto const ns = elapsed_ns(t);
+    if (0 == bytes_per_iter) {
+        fmt::print("{:<28} iters={:<9} ns/op={:.1f}\n", name, iters, double(ns) / iters);
+    } else {
+        fmt::print("{:<28} iters={:<9} ns/op={:.1f} MB/s={:.1f}\n", name, iters, double(ns) / iters,
+                   iters * bytes_per_iter / (ns / 1e9) / Mi);
+    }
+}
+
+static void run_micro_benchmarks(HSHomeObject const& hs_obj) {
+    auto const micro_iters = SISL_OPTIONS["micro_iters"].as< uint64_t >();
+    auto const max_bytes = SISL_OPTIONS["max_bytes"].as< uint64_t >();
+
+    using HashAlgorithm = HSHomeObject::BlobHeader::HashAlgorithm;
+    auto const user_key = std::string("bench_user_key_of_32_bytes_long");
+    uint8_t hash[HSHomeObject::BlobHeader::blob_max_hash_len];
+    for (auto const blob_size : SISL_OPTIONS["blob_sizes"].as< std::vector< uint32_t > >()) {
+        if (0 == blob_size) { continue; }
+        auto body = sisl::io_blob_safe(blob_size, 512u);
+        BitsGenerator::gen_random_bits(body);
+        auto const iters = std::max< uint64_t >(1, std::min(micro_iters, max_bytes / blob_size));
+        for (auto const [algorithm, algorithm_name] :
+             {std::pair{HashAlgorithm::CRC32, "crc32"}, std::pair{HashAlgorithm::CRC32C, "crc32c"},
+              std::pair{HashAlgorithm::XXH3, "xxh3"}, std::pair{HashAlgorithm::MD5, "md5"},
+              std::pair{HashAlgorithm::SHA1, "sha1"}}) {
+            run_micro(fmt::format("hash_{}_{}", algorithm_name, blob_size), iters, blob_size, [&](uint64_t) {
+                hs_obj.compute_blob_payload_hash(algorithm, body.cbytes(), blob_size,
+                                                 r_cast< uint8_t const* >(user_key.data()), user_key.size(), hash,
+                                                 sizeof(hash));
+                folly::doNotOptimizeAway(hash);
+            });
+        }
+    }
+
+    // keys of a few shards in random order, as met by the comparisons of a btree search;
+    static constexpr size_t num_keys{4096};
+    std::vector< BlobRouteKey > keys;
+    keys.reserve(num_keys);
+    std::mt19937_64 rng{42};
+    for (size_t i = 0; i < num_keys; ++i) {
+        keys.emplace_back(BlobRoute{rng() % 8, rng() % (1ul << 20)});
+    }
+    run_micro("blob_route_key_compare", micro_iters, 0, [&](uint64_t i) {
+        folly::doNotOptimizeAway(keys[i % num_keys].compare(keys[(i + 1) % num_keys]));
+    });
+
+    auto const selector = hs_obj.chunk_selector();
+    run_micro("select_release_chunk", micro_iters / 100, 0, [&](uint64_t) {
+        auto chunk = selector->select_chunk(1, homestore::blk_alloc_hints());
+        RELEASE_ASSERT(chunk, "no chunk left to select");
+        selector->release_chunk(chunk->get_chunk_id());
+    });
+}
+
+int main(int argc, char* argv[]) {
+    int parsed_argc = argc;
+    SISL_OPTIONS_LOAD(parsed_argc, argv, logging, iomgr, homeobject, homeobject_bench);
+    sisl::logging::SetLogger(std::string(argv[0]));
+    spdlog::set_pattern("[%D %T.%e] [%n] [%^%l%$] [%t] %v");
+    parsed_argc = 1;
+    auto f = ::folly::Init(&parsed_argc, &argv, true);
+
+    auto const workload = SISL_OPTIONS["workload"].as< std::string >();
+    auto app = std::make_shared< BenchApp >(SISL_OPTIONS["dev_size_mb"].as< uint64_t >() * Mi);
+    auto obj = init_homeobject(std::weak_ptr< HomeObjectApplication >(app));
+
+    pg_id_t const pg_id{1};
+    auto info = PGInfo(pg_id);
+    info.members.insert(PGMember{obj->our_uuid(), "bench", 1});
+    auto p = obj->pg_manager()->create_pg(std::move(info)).get();
+    RELEASE_ASSERT(!!p, "failed to create pg: {}", p.error());
+
+    fmt::print("executor={}\n", SISL_OPTIONS["executor"].as< std::string >());
+    if ("api" == workload || "all" == workload) { run_api_workload(obj, pg_id); }
+    if ("micro" == workload || "all" == workload) {
+        run_micro_benchmarks(*dynamic_cast< HSHomeObject const* >(obj.get()));
+    }
+
+    obj.reset();
+    return 0;
+}
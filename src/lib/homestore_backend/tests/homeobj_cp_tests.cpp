@@ -12,23 +12,17 @@ TEST_F(HomeObjectFixture, HSHomeObjectCPTestBasic) {
     using namespace homestore;
     auto ho = dynamic_cast< HSHomeObject* >(_obj_inst.get());
     {
-        // Step-2: write some dirty pg information and add to dirt list;
-        auto cur_cp = HomeStore::instance()->cp_mgr().cp_guard();
-        auto cp_ctx = s_cast< HomeObjCPContext* >(cur_cp->context(homestore::cp_consumer_t::HS_CLIENT));
-        auto lg = std::unique_lock(ho->_pg_lock);
-        for (auto& [_, pg] : ho->_pg_map) {
+        // Step-2: write some dirty pg information and mark the pg dirty;
+        for (auto const& [_, pg] : ho->_pg_map) {
             auto hs_pg = static_cast< HSHomeObject::HS_PG* >(pg.get());
             hs_pg->blob_sequence_num_ = 54321; // fake some random blob seq number to make it dirty;
-            hs_pg->cache_pg_sb_->blob_sequence_num = hs_pg->blob_sequence_num_;
-            cp_ctx->add_pg_to_dirty_list(hs_pg->cache_pg_sb_);
-            hs_pg->blob_sequence_num_ = 54321; // fake some random blob seq number to make it dirty;
+            hs_pg->mark_dirty();
 
-            // test multiple update to the dirty list;
+            // test multiple update in the same cp;
             // only the last update should be kept;
             hs_pg->blob_sequence_num_ = 12345; // fake some random blob seq number to make it dirty;
-            hs_pg->cache_pg_sb_->blob_sequence_num = hs_pg->blob_sequence_num_;
-            cp_ctx->add_pg_to_dirty_list(hs_pg->cache_pg_sb_);
-            hs_pg->blob_sequence_num_ = 12345; // fake some random blob seq number to make it dirty;
+            hs_pg->mark_dirty();
+            EXPECT_TRUE(hs_pg->is_dirty_.load());
         }
     }
 
@@ -46,10 +40,36 @@ TEST_F(HomeObjectFixture, HSHomeObjectCPTestBasic) {
 
     EXPECT_TRUE(ho->_pg_map.size() == 1);
     {
-        auto lg = std::shared_lock(ho->_pg_lock);
-        for (auto& [_, pg] : ho->_pg_map) {
+        for (auto const& [_, pg] : ho->_pg_map) {
             auto hs_pg = static_cast< HSHomeObject::HS_PG* >(pg.get());
             EXPECT_EQ(hs_pg->cache_pg_sb_->blob_sequence_num, 12345);
+            // the cp consumed the dirty mark;
+            EXPECT_FALSE(hs_pg->is_dirty_.load());
         }
     }
 }
+
+TEST_F(HomeObjectFixture, HSHomeObjectCPShardSuperblk) {
+    create_pg(1 /* pg_id */);
+    auto shard = _obj_inst->shard_manager()->create_shard(1 /* pg_id */, 64 * Mi).get();
+    ASSERT_TRUE(!!shard);
+
+    auto ho = dynamic_cast< HSHomeObject* >(_obj_inst.get());
+    auto get_hs_shard = [ho](shard_id_t id) {
+        return d_cast< HSHomeObject::HS_Shard* >(ho->_shard_map.find(id)->second);
+    };
+
+    // the shard superblk is written by the next cp instead of by create/seal;
+    trigger_cp(true /* wait */);
+    auto hs_shard = get_hs_shard(shard->id);
+    EXPECT_FALSE(hs_shard->is_dirty());
+    EXPECT_EQ(hs_shard->sb_->id, shard->id);
+    EXPECT_EQ(hs_shard->sb_->state, ShardInfo::State::OPEN);
+
+    auto sealed = _obj_inst->shard_manager()->seal_shard(shard->id).get();
+    ASSERT_TRUE(!!sealed);
+
+    trigger_cp(true /* wait */);
+    EXPECT_FALSE(hs_shard->is_dirty());
+    EXPECT_EQ(hs_shard->sb_->state, ShardInfo::State::SEALED);
+}
@@ -1,4 +1,13 @@
+#include <map>
+#include <set>
+#include <thread>
+
+#include <folly/executors/ManualExecutor.h>
+#include <homestore/blkdata_service.hpp>
+
 #include "homeobj_fixture.hpp"
+#include "lib/homestore_backend/hs_backend_config.hpp"
+#include "lib/homestore_backend/index_kv.hpp"
 
 TEST(HomeObject, BasicEquivalence) {
     auto app = std::make_shared< FixtureApp >();
@@ -84,15 +93,14 @@ TEST_F(HomeObjectFixture, BasicPutGetDelBlobWRestart) {
     auto hs_homeobject = dynamic_cast< HSHomeObject* >(_obj_inst.get());
     for (const auto& [id, blob] : blob_map) {
         int64_t pg_id = std::get< 0 >(id), shard_id = std::get< 1 >(id), blob_id = std::get< 2 >(id);
-        shared< BlobIndexTable > index_table;
+        HSHomeObject::HS_PG* hs_pg{nullptr};
         {
-            std::shared_lock lock_guard(hs_homeobject->_pg_lock);
             auto iter = hs_homeobject->_pg_map.find(pg_id);
-            ASSERT_TRUE(iter != hs_homeobject->_pg_map.end());
-            index_table = static_cast< HSHomeObject::HS_PG* >(iter->second.get())->index_table_;
+            ASSERT_TRUE(iter != hs_homeobject->_pg_map.cend());
+            hs_pg = static_cast< HSHomeObject::HS_PG* >(iter->second.get());
         }
 
-        auto g = hs_homeobject->get_blob_from_index_table(index_table, shard_id, blob_id);
+        auto g = hs_homeobject->get_blob_from_index_table(*hs_pg, shard_id, blob_id);
         ASSERT_FALSE(!!g);
         EXPECT_EQ(BlobError::UNKNOWN_BLOB, g.error());
     }
@@ -165,6 +173,84 @@ TEST_F(HomeObjectFixture, SealShardWithRestart) {
     LOGINFO("Put blob {}", b.error());
 }
 
+TEST_F(HomeObjectFixture, RecoveryRebuildsShardsOfEveryPG) {
+    // Shards of two PGs created in turns, some sealed, some only in the log when we restart.
+    std::vector< pg_id_t > const pg_ids{1, 2};
+    for (auto pg_id : pg_ids) {
+        create_pg(pg_id);
+    }
+    std::vector< shard_id_t > shard_ids;
+    for (auto i = 0u; i < 3; ++i) {
+        for (auto pg_id : pg_ids) {
+            auto s = _obj_inst->shard_manager()->create_shard(pg_id, 64 * Mi).get();
+            ASSERT_TRUE(!!s);
+            shard_ids.push_back(s.value().id);
+            auto b = _obj_inst->blob_manager()
+                         ->put(s.value().id, Blob{sisl::io_blob_safe(512u, 512u), "test_blob", 0ul})
+                         .get();
+            ASSERT_TRUE(!!b);
+        }
+    }
+    ASSERT_TRUE(!!_obj_inst->shard_manager()->seal_shard(shard_ids[0]).get());
+    ASSERT_TRUE(!!_obj_inst->shard_manager()->seal_shard(shard_ids[3]).get());
+    trigger_cp(true /* wait */);
+    // replayed on restart, the first from the shard superblk already on disk
+    ASSERT_TRUE(!!_obj_inst->shard_manager()->seal_shard(shard_ids[1]).get());
+    ASSERT_TRUE(!!_obj_inst->shard_manager()->create_shard(pg_ids[0], 64 * Mi).get());
+
+    struct PGState {
+        std::vector< ShardInfo > shards;
+        std::vector< homestore::chunk_num_t > chunks;
+        uint64_t shard_sequence_num;
+        uint32_t total_shards;
+        uint32_t open_shards;
+    };
+    auto snapshot = [this, &pg_ids]() {
+        auto ho = dynamic_cast< HSHomeObject* >(_obj_inst.get());
+        std::map< pg_id_t, PGState > pgs;
+        std::map< uint32_t, uint32_t > heap_chunks;
+        for (auto pg_id : pg_ids) {
+            auto hs_pg = static_cast< HSHomeObject::HS_PG* >(ho->_pg_map.find(pg_id)->second.get());
+            std::shared_lock lock_guard(hs_pg->mtx_);
+            auto& pg = pgs[pg_id];
+            for (auto const& shard : hs_pg->shards_) {
+                auto hs_shard = d_cast< HSHomeObject::HS_Shard* >(shard.get());
+                pg.shards.push_back(hs_shard->info);
+                pg.chunks.push_back(hs_shard->chunk_id());
+                auto const dev = ho->chunk_selector()->chunk_to_hints(hs_shard->chunk_id()).pdev_id_hint.value();
+                heap_chunks[dev] = ho->chunk_selector()->avail_num_chunks(dev);
+            }
+            pg.shard_sequence_num = hs_pg->shard_sequence_num_;
+            pg.total_shards = hs_pg->total_shards();
+            pg.open_shards = hs_pg->open_shards();
+        }
+        return std::make_pair(pgs, heap_chunks);
+    };
+
+    auto const [before, heap_chunks_before] = snapshot();
+    restart();
+    auto const [after, heap_chunks_after] = snapshot();
+
+    for (auto pg_id : pg_ids) {
+        auto const& b = before.at(pg_id);
+        auto const& a = after.at(pg_id);
+        ASSERT_EQ(b.shards.size(), a.shards.size());
+        for (size_t i = 0; i < b.shards.size(); ++i) {
+            EXPECT_EQ(b.shards[i].id, a.shards[i].id);
+            EXPECT_EQ(b.shards[i].placement_group, a.shards[i].placement_group);
+            EXPECT_EQ(b.shards[i].state, a.shards[i].state);
+            EXPECT_EQ(b.shards[i].created_time, a.shards[i].created_time);
+            EXPECT_EQ(b.shards[i].total_capacity_bytes, a.shards[i].total_capacity_bytes);
+        }
+        EXPECT_EQ(b.chunks, a.chunks);
+        EXPECT_EQ(b.shard_sequence_num, a.shard_sequence_num);
+        EXPECT_EQ(b.total_shards, a.total_shards);
+        EXPECT_EQ(b.open_shards, a.open_shards);
+    }
+    // the chunks of the open shards stay out of the heaps rebuilt on recovery
+    EXPECT_EQ(heap_chunks_before, heap_chunks_after);
+}
+
 TEST_F(HomeObjectFixture, PGStatsTest) {
     // Create a pg, shard, put blob should succeed.
     pg_id_t pg_id{1};
@@ -213,7 +299,1143 @@ TEST_F(HomeObjectFixture, PGStatsTest) {
     EXPECT_EQ(pg_stats.open_shards, 1);
     // TODO: EXPECT_EQ(pg_stats.num_members, 1) after having real 3-replica repl dev in test
     EXPECT_EQ(pg_stats.num_members, 1);
+    EXPECT_EQ(pg_stats.num_blobs, 1);
+    EXPECT_GE(pg_stats.used_bytes, 512);
+    auto const used_bytes = pg_stats.used_bytes;
 
     auto stats = _obj_inst->get_stats();
     LOGINFO("HomeObj stats: {}", stats.to_string());
+    EXPECT_EQ(stats.num_open_shards, 1);
+
+    // the blob stats are persisted in the pg superblk by the CP that persists the index
+    trigger_cp(true /* wait */);
+    restart();
+    pg_stats = PGStats{};
+    ASSERT_TRUE(_obj_inst->pg_manager()->get_stats(pg_id, pg_stats));
+    EXPECT_EQ(pg_stats.total_shards, 2);
+    EXPECT_EQ(pg_stats.open_shards, 1);
+    EXPECT_EQ(pg_stats.num_blobs, 1);
+    EXPECT_EQ(pg_stats.used_bytes, used_bytes);
+    EXPECT_EQ(_obj_inst->get_stats().num_open_shards, 1);
+
+    ASSERT_TRUE(!!_obj_inst->blob_manager()->del(shard_id, b.value()).get());
+    pg_stats = PGStats{};
+    ASSERT_TRUE(_obj_inst->pg_manager()->get_stats(pg_id, pg_stats));
+    EXPECT_EQ(pg_stats.num_blobs, 0);
+    EXPECT_EQ(pg_stats.used_bytes, 0);
+    EXPECT_EQ(pg_stats.deleted_bytes, used_bytes);
+
+    // a delete replayed from the log is not counted twice
+    restart();
+    pg_stats = PGStats{};
+    ASSERT_TRUE(_obj_inst->pg_manager()->get_stats(pg_id, pg_stats));
+    EXPECT_EQ(pg_stats.num_blobs, 0);
+    EXPECT_EQ(pg_stats.used_bytes, 0);
+    EXPECT_EQ(pg_stats.deleted_bytes, used_bytes);
+
+    trigger_cp(true /* wait */);
+    restart();
+    pg_stats = PGStats{};
+    ASSERT_TRUE(_obj_inst->pg_manager()->get_stats(pg_id, pg_stats));
+    EXPECT_EQ(pg_stats.num_blobs, 0);
+    EXPECT_EQ(pg_stats.used_bytes, 0);
+    EXPECT_EQ(pg_stats.deleted_bytes, used_bytes);
+}
+
+TEST_F(HomeObjectFixture, RangedGetLargeBlob) {
+    pg_id_t pg_id{1};
+    create_pg(pg_id);
+    auto s = _obj_inst->shard_manager()->create_shard(pg_id, 64 * Mi).get();
+    ASSERT_TRUE(!!s);
+    auto shard_id = s.value().id;
+
+    // Blobs spanning many checksum segments, with one ending in a partial segment.
+    blob_map_t blob_map;
+    for (auto const blob_size : {uint32_t(2 * Mi), uint32_t(Mi + 1234)}) {
+        std::string user_key{"ranged_get_blob"};
+        homeobject::Blob put_blob{sisl::io_blob_safe(blob_size, 512u), user_key, 42ul};
+        BitsGenerator::gen_random_bits(put_blob.body);
+        auto clone = put_blob.clone();
+        auto b = _obj_inst->blob_manager()->put(shard_id, std::move(put_blob)).get();
+        ASSERT_TRUE(!!b);
+        blob_map.insert({{pg_id, shard_id, b.value()}, std::move(clone)});
+    }
+
+    for (auto i = 0; i < 10; ++i) {
+        verify_get_blob(blob_map, true /* use_random_offset */);
+    }
+    verify_get_blob(blob_map);
+
+    // An empty range at the end of the blob reads nothing, ranges past the end of the blob are rejected.
+    auto const& [id, blob] = *blob_map.begin();
+    auto g = _obj_inst->blob_manager()->get(shard_id, std::get< 2 >(id), blob.body.size(), 0).get();
+    ASSERT_TRUE(!!g);
+    EXPECT_EQ(0, g.value().body.size());
+    EXPECT_EQ(blob.user_key, g.value().user_key);
+    g = _obj_inst->blob_manager()->get(shard_id, std::get< 2 >(id), blob.body.size(), 1).get();
+    ASSERT_FALSE(!!g);
+    EXPECT_EQ(BlobError::INVALID_ARG, g.error());
+}
+
+TEST_F(HomeObjectFixture, PutAlignedBlobs) {
+    pg_id_t pg_id{1};
+    create_pg(pg_id);
+    auto s = _obj_inst->shard_manager()->create_shard(pg_id, 64 * Mi).get();
+    ASSERT_TRUE(!!s);
+    auto shard_id = s.value().id;
+
+    // Aligned bodies of aligned and unaligned sizes are written in place, apart from their tail.
+    blob_map_t blob_map;
+    for (auto const blob_size : {uint32_t(512), uint32_t(4 * Ki), uint32_t(4 * Ki + 1), uint32_t(511), uint32_t(1)}) {
+        auto put_blob = homeobject::Blob::make_aligned(blob_size, "aligned_blob", 0ul);
+        BitsGenerator::gen_random_bits(put_blob.body);
+        auto clone = put_blob.clone();
+        auto b = _obj_inst->blob_manager()->put(shard_id, std::move(put_blob)).get();
+        ASSERT_TRUE(!!b);
+        blob_map.insert({{pg_id, shard_id, b.value()}, std::move(clone)});
+    }
+    verify_get_blob(blob_map);
+}
+
+TEST_F(HomeObjectFixture, IOBufPoolReturnsBuffersToTheirThread) {
+    // A buffer freed by another thread, as by the completion of a write, is handed out again by the thread it came
+    // from. Run on a thread of its own, which caches nothing yet.
+    std::thread([] {
+        auto buf = IOBufPool::alloc(1 * Ki);
+        auto const bytes = buf.bytes;
+        std::thread([b = std::move(buf)] { IOBufPool::free(b); }).join();
+        auto again = IOBufPool::alloc(1 * Ki);
+        EXPECT_EQ(bytes, again.bytes);
+        IOBufPool::free(again);
+    }).join();
+}
+
+TEST_F(HomeObjectFixture, PutGetBlobHashAlgorithms) {
+    pg_id_t pg_id{1};
+    create_pg(pg_id);
+    auto s = _obj_inst->shard_manager()->create_shard(pg_id, 64 * Mi).get();
+    ASSERT_TRUE(!!s);
+    auto shard_id = s.value().id;
+
+    // Blobs written with every algorithm stay readable whatever the algorithm configured for new blobs is.
+    blob_map_t blob_map;
+    for (auto const algorithm :
+         {HSHomeObject::BlobHeader::HashAlgorithm::CRC32, HSHomeObject::BlobHeader::HashAlgorithm::CRC32C,
+          HSHomeObject::BlobHeader::HashAlgorithm::XXH3, HSHomeObject::BlobHeader::HashAlgorithm::NONE}) {
+        HS_BACKEND_SETTINGS_FACTORY().modifiable_settings(
+            [algorithm](auto& s) { s.blob_hash_algorithm = static_cast< uint8_t >(algorithm); });
+        HS_BACKEND_SETTINGS_FACTORY().save();
+        for (auto const blob_size : {uint32_t(4 * Ki), uint32_t(Mi + 1234)}) {
+            homeobject::Blob put_blob{sisl::io_blob_safe(blob_size, 512u), "hash_blob", 0ul};
+            BitsGenerator::gen_random_bits(put_blob.body);
+            auto clone = put_blob.clone();
+            auto b = _obj_inst->blob_manager()->put(shard_id, std::move(put_blob)).get();
+            ASSERT_TRUE(!!b);
+            blob_map.insert({{pg_id, shard_id, b.value()}, std::move(clone)});
+        }
+    }
+    HS_BACKEND_SETTINGS_FACTORY().modifiable_settings([](auto& s) {
+        s.blob_hash_algorithm = static_cast< uint8_t >(HSHomeObject::BlobHeader::HashAlgorithm::CRC32);
+    });
+    HS_BACKEND_SETTINGS_FACTORY().save();
+    verify_get_blob(blob_map);
+}
+
+TEST_F(HomeObjectFixture, PutGetBlobHeaderVersions) {
+    pg_id_t pg_id{1};
+    create_pg(pg_id);
+    auto s = _obj_inst->shard_manager()->create_shard(pg_id, 64 * Mi).get();
+    ASSERT_TRUE(!!s);
+    auto shard_id = s.value().id;
+
+    // v2 blobs stay readable once v3 is written, with user keys inline or, too large for the first block, after
+    // the data.
+    blob_map_t blob_map;
+    for (uint8_t const version : {uint8_t(0x02), uint8_t(0x03), uint8_t(0x04)}) {
+        HS_BACKEND_SETTINGS_FACTORY().modifiable_settings([version](auto& s) { s.blob_header_version = version; });
+        HS_BACKEND_SETTINGS_FACTORY().save();
+        for (auto const key_size : {size_t(0), size_t(100), size_t(8 * Ki)}) {
+            for (auto const blob_size : {uint32_t(3 * Ki), uint32_t(Mi + 1234)}) {
+                homeobject::Blob put_blob{sisl::io_blob_safe(blob_size, 512u), std::string(key_size, 'k'), 0ul};
+                BitsGenerator::gen_random_bits(put_blob.body);
+                auto clone = put_blob.clone();
+                auto b = _obj_inst->blob_manager()->put(shard_id, std::move(put_blob)).get();
+                ASSERT_TRUE(!!b);
+                blob_map.insert({{pg_id, shard_id, b.value()}, std::move(clone)});
+            }
+        }
+    }
+    HS_BACKEND_SETTINGS_FACTORY().modifiable_settings([](auto& s) { s.blob_header_version = 0x02; });
+    HS_BACKEND_SETTINGS_FACTORY().save();
+    // Read the small blobs back from disk rather than from the data cache.
+    restart();
+    verify_get_blob(blob_map);
+    verify_get_blob(blob_map, true /* use_random_offset */);
+}
+
+TEST_F(HomeObjectFixture, PutGetCompressedBlobs) {
+    pg_id_t pg_id{1};
+    create_pg(pg_id);
+    auto s = _obj_inst->shard_manager()->create_shard(pg_id, 64 * Mi).get();
+    ASSERT_TRUE(!!s);
+    auto shard_id = s.value().id;
+
+    // Only v4 headers record compressed data.
+    HS_BACKEND_SETTINGS_FACTORY().modifiable_settings([](auto& s) {
+        s.blob_header_version = 0x04;
+        s.blob_compression = static_cast< uint8_t >(HSHomeObject::BlobHeader::Codec::LZ4);
+    });
+    HS_BACKEND_SETTINGS_FACTORY().save();
+
+    // Text compresses in one frame or many, random bits are stored as they are.
+    blob_map_t blob_map;
+    std::map< blob_id_t, uint32_t > text_blobs;
+    for (auto const blob_size : {uint32_t(8 * Ki), uint32_t(100 * Ki + 17), uint32_t(Mi + 1234)}) {
+        for (bool const text : {true, false}) {
+            homeobject::Blob put_blob{sisl::io_blob_safe(blob_size, 512u), text ? "compressed" : "random", 0ul};
+            if (text) {
+                std::string_view const line{"{\"key\": \"value\", \"n\": 12345}\n"};
+                for (uint32_t i = 0; i < blob_size; ++i) {
+                    put_blob.body.bytes()[i] = line[i % line.size()];
+                }
+            } else {
+                BitsGenerator::gen_random_bits(put_blob.body);
+            }
+            auto clone = put_blob.clone();
+            auto b = _obj_inst->blob_manager()->put(shard_id, std::move(put_blob)).get();
+            ASSERT_TRUE(!!b);
+            if (text) { text_blobs.emplace(b.value(), blob_size); }
+            blob_map.insert({{pg_id, shard_id, b.value()}, std::move(clone)});
+        }
+    }
+    HS_BACKEND_SETTINGS_FACTORY().modifiable_settings([](auto& s) {
+        s.blob_header_version = 0x02;
+        s.blob_compression = 0;
+    });
+    HS_BACKEND_SETTINGS_FACTORY().save();
+
+    // Compressed blobs take fewer blocks than their size.
+    auto ho = dynamic_cast< HSHomeObject* >(_obj_inst.get());
+    auto hs_pg = static_cast< HSHomeObject::HS_PG* >(ho->_pg_map.find(pg_id)->second.get());
+    hs_pg->index_queue_->drain();
+    auto const blk_size = hs_pg->repl_dev_->get_blk_size();
+    for (auto const& [blob_id, blob_size] : text_blobs) {
+        auto r = ho->get_blob_from_index_table(*hs_pg, shard_id, blob_id);
+        ASSERT_TRUE(!!r);
+        EXPECT_LT(r.value().blk_count() * blk_size, blob_size) << "blob " << blob_id;
+    }
+
+    restart();
+    verify_get_blob(blob_map);
+    verify_get_blob(blob_map, true /* use_random_offset */);
+}
+
+TEST_F(HomeObjectFixture, BlobIndexCache) {
+    pg_id_t pg_id{1};
+    create_pg(pg_id);
+    auto s = _obj_inst->shard_manager()->create_shard(pg_id, 64 * Mi).get();
+    ASSERT_TRUE(!!s);
+    auto shard_id = s.value().id;
+
+    auto hs_homeobject = dynamic_cast< HSHomeObject* >(_obj_inst.get());
+    BlobIndexCache* index_cache{nullptr};
+    {
+        auto iter = hs_homeobject->_pg_map.find(pg_id);
+        ASSERT_TRUE(iter != hs_homeobject->_pg_map.cend());
+        index_cache = static_cast< HSHomeObject::HS_PG* >(iter->second.get())->index_cache_.get();
+    }
+    ASSERT_TRUE(index_cache != nullptr);
+
+    // A blob is cached on commit of its put, so reading it back does not miss. It is too large for the data cache,
+    // which would serve the gets without looking up the index.
+    auto b =
+        _obj_inst->blob_manager()->put(shard_id, Blob{sisl::io_blob_safe(64 * Ki, 512u), "cached_blob", 0ul}).get();
+    ASSERT_TRUE(!!b);
+    auto const blob_id = b.value();
+    auto const misses = index_cache->misses();
+    for (auto i = 0; i < 3; ++i) {
+        ASSERT_TRUE(!!_obj_inst->blob_manager()->get(shard_id, blob_id).get());
+    }
+    EXPECT_EQ(misses, index_cache->misses());
+    EXPECT_LE(3ul, index_cache->hits());
+    EXPECT_EQ(1ul, index_cache->size());
+
+    // A deleted blob is dropped from the cache and not brought back by a get.
+    ASSERT_TRUE(!!_obj_inst->blob_manager()->del(shard_id, blob_id).get());
+    EXPECT_EQ(0ul, index_cache->size());
+    auto g = _obj_inst->blob_manager()->get(shard_id, blob_id).get();
+    ASSERT_FALSE(!!g);
+    EXPECT_EQ(BlobError::UNKNOWN_BLOB, g.error());
+    EXPECT_EQ(misses + 1, index_cache->misses());
+    EXPECT_EQ(0ul, index_cache->size());
+}
+
+TEST_F(HomeObjectFixture, BlobIndexQueue) {
+    std::vector< BlobRoute > applied;
+    folly::ManualExecutor executor;
+    auto queue = std::make_shared< BlobIndexQueue >(
+        [&applied](BlobRoute const& route, homestore::MultiBlkId const&) -> BlobManager::NullResult {
+            applied.push_back(route);
+            if (route.blob == 3) { return folly::makeUnexpected(BlobError::INDEX_ERROR); }
+            return folly::Unit();
+        },
+        folly::getKeepAliveToken(executor));
+
+    std::vector< BlobManager::NullResult > results;
+    auto const done = [&results](BlobManager::NullResult r) { results.push_back(std::move(r)); };
+    queue->enqueue({{BlobRoute{1, 2}, homestore::MultiBlkId{20, 1, 1}}}, done);
+    queue->enqueue(
+        {{BlobRoute{1, 1}, homestore::MultiBlkId{10, 1, 1}}, {BlobRoute{1, 3}, homestore::MultiBlkId{30, 1, 1}}}, done);
+
+    // Nothing is applied before the worker runs, the puts are read from the overlay meanwhile.
+    EXPECT_TRUE(applied.empty());
+    auto blkids = queue->get(BlobRoute{1, 1});
+    ASSERT_TRUE(blkids.has_value());
+    EXPECT_EQ(10u, blkids->blk_num());
+    EXPECT_FALSE(queue->get(BlobRoute{1, 4}).has_value());
+
+    // Pending puts are applied at once in route order, each request gets the first error of its puts.
+    executor.drain();
+    EXPECT_EQ((std::vector< BlobRoute >{{1, 1}, {1, 2}, {1, 3}}), applied);
+    ASSERT_EQ(2ul, results.size());
+    EXPECT_TRUE(!!results[0]);
+    ASSERT_FALSE(!!results[1]);
+    EXPECT_EQ(BlobError::INDEX_ERROR, results[1].error());
+    EXPECT_FALSE(queue->get(BlobRoute{1, 1}).has_value());
+
+    // A mutation such as a delete runs after the puts enqueued ahead of it and before the ones enqueued after it,
+    // its request gets its result.
+    std::vector< BlobRoute > applied_at_mutation;
+    queue->enqueue({{BlobRoute{1, 7}, homestore::MultiBlkId{70, 1, 1}}}, done);
+    queue->enqueue_mutation(
+        [&]() -> BlobManager::NullResult {
+            applied_at_mutation = applied;
+            EXPECT_FALSE(queue->get(BlobRoute{1, 7}).has_value());
+            return folly::makeUnexpected(BlobError::UNKNOWN_BLOB);
+        },
+        done);
+    queue->enqueue({{BlobRoute{1, 6}, homestore::MultiBlkId{60, 1, 1}}}, done);
+    executor.drain();
+    EXPECT_EQ((std::vector< BlobRoute >{{1, 1}, {1, 2}, {1, 3}, {1, 7}}), applied_at_mutation);
+    EXPECT_EQ((std::vector< BlobRoute >{{1, 1}, {1, 2}, {1, 3}, {1, 7}, {1, 6}}), applied);
+    ASSERT_EQ(5ul, results.size());
+    ASSERT_FALSE(!!results[3]);
+    EXPECT_EQ(BlobError::UNKNOWN_BLOB, results[3].error());
+    EXPECT_TRUE(!!results[4]);
+
+    // drain() applies inline without waiting for the worker, as does every enqueue once stopped.
+    queue->enqueue({{BlobRoute{1, 4}, homestore::MultiBlkId{40, 1, 1}}}, done);
+    queue->drain();
+    EXPECT_EQ(6ul, applied.size());
+    queue->stop();
+    queue->enqueue({{BlobRoute{1, 5}, homestore::MultiBlkId{50, 1, 1}}}, done);
+    EXPECT_EQ(7ul, applied.size());
+    EXPECT_EQ(7ul, results.size());
+    executor.drain();
+}
+
+TEST_F(HomeObjectFixture, BlobDataCache) {
+    pg_id_t pg_id{1};
+    create_pg(pg_id);
+    auto s = _obj_inst->shard_manager()->create_shard(pg_id, 64 * Mi).get();
+    ASSERT_TRUE(!!s);
+    auto shard_id = s.value().id;
+
+    auto data_cache = dynamic_cast< HSHomeObject* >(_obj_inst.get())->data_cache();
+    ASSERT_TRUE(data_cache != nullptr);
+
+    // Small blobs are served from the cache after their put, whole or by range.
+    blob_map_t blob_map;
+    homeobject::Blob put_blob{sisl::io_blob_safe(4 * Ki, 512u), "small_blob", 42ul};
+    BitsGenerator::gen_random_bits(put_blob.body);
+    auto clone = put_blob.clone();
+    auto b = _obj_inst->blob_manager()->put(shard_id, std::move(put_blob)).get();
+    ASSERT_TRUE(!!b);
+    auto const blob_id = b.value();
+    blob_map.insert({{pg_id, shard_id, blob_id}, std::move(clone)});
+
+    auto const hits = data_cache->hits();
+    verify_get_blob(blob_map);
+    verify_get_blob(blob_map, true /* use_random_offset */);
+    EXPECT_EQ(hits + 2, data_cache->hits());
+    auto g = _obj_inst->blob_manager()->get(shard_id, blob_id, 4 * Ki, 1).get();
+    ASSERT_FALSE(!!g);
+    EXPECT_EQ(BlobError::INVALID_ARG, g.error());
+
+    // Deleted blobs are no longer served.
+    ASSERT_TRUE(!!_obj_inst->blob_manager()->del(shard_id, blob_id).get());
+    g = _obj_inst->blob_manager()->get(shard_id, blob_id).get();
+    ASSERT_FALSE(!!g);
+    EXPECT_EQ(BlobError::UNKNOWN_BLOB, g.error());
+}
+
+TEST_F(HomeObjectFixture, GetBatchBlobs) {
+    pg_id_t pg_id{1};
+    create_pg(pg_id);
+    auto s = _obj_inst->shard_manager()->create_shard(pg_id, 64 * Mi).get();
+    ASSERT_TRUE(!!s);
+    auto shard_id = s.value().id;
+
+    // Blobs of a batch sit next to each other on disk and are too large for the data cache, so they are read back
+    // with merged reads.
+    std::vector< Blob > blobs, clones;
+    for (auto i = 0u; i < 16; ++i) {
+        auto const blob_size = uint32_t(64 * Ki + 3 * i);
+        blobs.emplace_back(sisl::io_blob_safe(blob_size, 512u), fmt::format("batch_blob_{}", i), i * Ki);
+        BitsGenerator::gen_random_bits(blobs.back().body);
+        clones.push_back(blobs.back().clone());
+    }
+    auto p = _obj_inst->blob_manager()->put_batch(shard_id, std::move(blobs)).get();
+    ASSERT_TRUE(!!p);
+    auto blob_ids = p.value();
+    ASSERT_TRUE(!!_obj_inst->blob_manager()->del(shard_id, blob_ids[3]).get());
+
+    // Ask in reverse order, with a deleted and an unknown blob in the middle.
+    std::vector< blob_id_t > ids(blob_ids.rbegin(), blob_ids.rend());
+    ids.push_back(blob_ids.back() + 100);
+    auto g = _obj_inst->blob_manager()->get_batch(shard_id, ids).get();
+    ASSERT_TRUE(!!g);
+    auto const& results = g.value();
+    ASSERT_EQ(ids.size(), results.size());
+    for (size_t i = 0; i < ids.size(); ++i) {
+        auto const n = ids.size() - 2 - i;
+        if (i == ids.size() - 1 || n == 3) {
+            ASSERT_FALSE(!!results[i]);
+            EXPECT_EQ(BlobError::UNKNOWN_BLOB, results[i].error());
+            continue;
+        }
+        ASSERT_TRUE(!!results[i]);
+        auto const& blob = results[i].value();
+        auto const& expected = clones[n];
+        EXPECT_EQ(expected.user_key, blob.user_key);
+        EXPECT_EQ(expected.object_off, blob.object_off);
+        ASSERT_EQ(expected.body.size(), blob.body.size());
+        EXPECT_EQ(0, std::memcmp(expected.body.cbytes(), blob.body.cbytes(), blob.body.size()));
+    }
+}
+
+TEST_F(HomeObjectFixture, PackSmallBlobs) {
+    // Read when the packer is set up, so restart to pick it up.
+    HS_BACKEND_SETTINGS_FACTORY().modifiable_settings([](auto& s) {
+        s.blob_pack_enabled = true;
+        s.blob_pack_window_us = 100000;
+    });
+    HS_BACKEND_SETTINGS_FACTORY().save();
+    restart();
+
+    pg_id_t pg_id{1};
+    create_pg(pg_id);
+    auto s = _obj_inst->shard_manager()->create_shard(pg_id, 64 * Mi).get();
+    ASSERT_TRUE(!!s);
+    auto shard_id = s.value().id;
+
+    // Puts issued within the window end up in one pack.
+    std::vector< Blob > clones;
+    std::vector< BlobManager::AsyncResult< blob_id_t > > puts;
+    for (auto i = 0u; i < 16; ++i) {
+        Blob put_blob{sisl::io_blob_safe(100 + 7 * i, 512u), fmt::format("packed_blob_{}", i), i * Ki};
+        BitsGenerator::gen_random_bits(put_blob.body);
+        clones.push_back(put_blob.clone());
+        puts.push_back(_obj_inst->blob_manager()->put(shard_id, std::move(put_blob)));
+    }
+    std::vector< blob_id_t > blob_ids;
+    for (auto& t : folly::collectAll(std::move(puts)).get()) {
+        ASSERT_TRUE(t.hasValue() && !!t.value());
+        blob_ids.push_back(t.value().value());
+    }
+    for (size_t i = 1; i < blob_ids.size(); ++i) {
+        EXPECT_EQ(blob_ids[0] + i, blob_ids[i]);
+    }
+
+    auto ho = dynamic_cast< HSHomeObject* >(_obj_inst.get());
+    auto hs_pg = static_cast< HSHomeObject::HS_PG* >(ho->_pg_map.find(pg_id)->second.get());
+    hs_pg->index_queue_->drain();
+    EXPECT_TRUE(hs_pg->has_packed_blobs());
+    auto const first = ho->get_blob_from_index_table(*hs_pg, shard_id, blob_ids[0]);
+    auto const second = ho->get_blob_from_index_table(*hs_pg, shard_id, blob_ids[1]);
+    ASSERT_TRUE(!!first && !!second);
+    EXPECT_TRUE(first.value().packed());
+    EXPECT_EQ(first.value().blk_num(), second.value().blk_num());
+    EXPECT_NE(first.value().offset, second.value().offset);
+    // The packed ranges live in entries of their own, the index value keeps the on-disk size of the blkids.
+    EXPECT_EQ(homestore::MultiBlkId::expected_serialized_size(1), BlobRouteValue::get_fixed_size());
+
+    auto verify = [&](std::set< size_t > const& deleted) {
+        auto g = _obj_inst->blob_manager()->get_batch(shard_id, blob_ids).get();
+        ASSERT_TRUE(!!g);
+        for (size_t i = 0; i < blob_ids.size(); ++i) {
+            auto single = _obj_inst->blob_manager()->get(shard_id, blob_ids[i]).get();
+            if (deleted.contains(i)) {
+                EXPECT_FALSE(!!g.value()[i]);
+                EXPECT_FALSE(!!single);
+                continue;
+            }
+            for (auto const* r : {&g.value()[i], &single}) {
+                ASSERT_TRUE(!!*r) << "blob " << blob_ids[i];
+                auto const& blob = r->value();
+                EXPECT_EQ(clones[i].user_key, blob.user_key);
+                EXPECT_EQ(clones[i].object_off, blob.object_off);
+                ASSERT_EQ(clones[i].body.size(), blob.body.size());
+                EXPECT_EQ(0, std::memcmp(clones[i].body.cbytes(), blob.body.cbytes(), blob.body.size()));
+            }
+        }
+    };
+    verify({});
+
+    // Neighbours of deleted blobs keep the blocks they share.
+    ASSERT_TRUE(!!_obj_inst->blob_manager()->del(shard_id, blob_ids[0]).get());
+    ASSERT_TRUE(!!_obj_inst->blob_manager()->del_batch(shard_id, {blob_ids[5], blob_ids[6], blob_ids[15]}).get());
+    verify({0, 5, 6, 15});
+
+    trigger_cp(true /* wait */);
+    restart();
+    // Taken back from the pg superblk, or the lookups would miss the packed ranges.
+    ho = dynamic_cast< HSHomeObject* >(_obj_inst.get());
+    EXPECT_TRUE(static_cast< HSHomeObject::HS_PG* >(ho->_pg_map.find(pg_id)->second.get())->has_packed_blobs());
+    verify({0, 5, 6, 15});
+
+    HS_BACKEND_SETTINGS_FACTORY().modifiable_settings([](auto& s) {
+        s.blob_pack_enabled = false;
+        s.blob_pack_window_us = 500;
+    });
+    HS_BACKEND_SETTINGS_FACTORY().save();
+}
+
+TEST_F(HomeObjectFixture, DeleteThenGetTombstone) {
+    pg_id_t pg_id{1};
+    create_pg(pg_id);
+    auto s = _obj_inst->shard_manager()->create_shard(pg_id, 64 * Mi).get();
+    ASSERT_TRUE(!!s);
+    auto shard_id = s.value().id;
+
+    std::vector< blob_id_t > blob_ids;
+    for (auto i = 0u; i < 3; ++i) {
+        auto b = _obj_inst->blob_manager()
+                     ->put(shard_id, Blob{sisl::io_blob_safe(4 * Ki, 512u), fmt::format("blob_{}", i), 0ul})
+                     .get();
+        ASSERT_TRUE(!!b);
+        blob_ids.push_back(b.value());
+    }
+
+    // The delete swaps the blkids of the blob for the tombstone in one update, a get finds the tombstone.
+    ASSERT_TRUE(!!_obj_inst->blob_manager()->del(shard_id, blob_ids[1]).get());
+    auto g = _obj_inst->blob_manager()->get(shard_id, blob_ids[1]).get();
+    ASSERT_FALSE(!!g);
+    EXPECT_EQ(BlobError::UNKNOWN_BLOB, g.error());
+    for (auto const id : {blob_ids[0], blob_ids[2]}) {
+        EXPECT_TRUE(!!_obj_inst->blob_manager()->get(shard_id, id).get());
+    }
+
+    // The update hands back the tombstone it replaces for a blob deleted before, and fails for a blob never put.
+    auto ho = dynamic_cast< HSHomeObject* >(_obj_inst.get());
+    auto hs_pg = static_cast< HSHomeObject::HS_PG* >(ho->_pg_map.find(pg_id)->second.get());
+    auto r = ho->move_to_tombstone(*hs_pg, HSHomeObject::BlobInfo{shard_id, blob_ids[1], {}});
+    ASSERT_TRUE(!!r);
+    EXPECT_TRUE(r.value() == HSHomeObject::tombstone_pbas);
+    r = ho->move_to_tombstone(*hs_pg, HSHomeObject::BlobInfo{shard_id, blob_ids[2] + 100, {}});
+    ASSERT_FALSE(!!r);
+    EXPECT_EQ(BlobError::UNKNOWN_BLOB, r.error());
+
+    // The batch tombstones in key order and answers in the order asked.
+    auto results = ho->move_to_tombstone(*hs_pg,
+                                         std::vector< HSHomeObject::BlobInfo >{{shard_id, blob_ids[2] + 100, {}},
+                                                                               {shard_id, blob_ids[2], {}},
+                                                                               {shard_id, blob_ids[1], {}}});
+    ASSERT_EQ(3u, results.size());
+    EXPECT_FALSE(!!results[0]);
+    ASSERT_TRUE(!!results[1]);
+    EXPECT_TRUE(results[1].value() != HSHomeObject::tombstone_pbas);
+    ASSERT_TRUE(!!results[2]);
+    EXPECT_TRUE(results[2].value() == HSHomeObject::tombstone_pbas);
+
+    // Deleting the blob again through the log does not count it twice.
+    ASSERT_TRUE(!!_obj_inst->blob_manager()->del(shard_id, blob_ids[1]).get());
+    PGStats pg_stats;
+    ASSERT_TRUE(_obj_inst->pg_manager()->get_stats(pg_id, pg_stats));
+    EXPECT_EQ(2, pg_stats.num_blobs);
+
+    trigger_cp(true /* wait */);
+    restart();
+    for (auto const id : {blob_ids[1], blob_ids[2]}) {
+        g = _obj_inst->blob_manager()->get(shard_id, id).get();
+        ASSERT_FALSE(!!g);
+        EXPECT_EQ(BlobError::UNKNOWN_BLOB, g.error());
+    }
+    EXPECT_TRUE(!!_obj_inst->blob_manager()->get(shard_id, blob_ids[0]).get());
+}
+
+TEST_F(HomeObjectFixture, DelBlobBatch) {
+    pg_id_t pg_id{1};
+    create_pg(pg_id);
+    auto s = _obj_inst->shard_manager()->create_shard(pg_id, 64 * Mi).get();
+    ASSERT_TRUE(!!s);
+    auto shard_id = s.value().id;
+
+    std::vector< Blob > blobs;
+    for (auto i = 0u; i < 16; ++i) {
+        blobs.emplace_back(sisl::io_blob_safe(8 * Ki, 512u), fmt::format("blob_{}", i), 0ul);
+    }
+    auto p = _obj_inst->blob_manager()->put_batch(shard_id, std::move(blobs)).get();
+    ASSERT_TRUE(!!p);
+    auto const blob_ids = p.value();
+
+    // One replicated delete for a list of blobs and one for a range, blobs already gone are skipped.
+    ASSERT_TRUE(!!_obj_inst->blob_manager()->del_batch(shard_id, {blob_ids[0], blob_ids[2], blob_ids[4]}).get());
+    ASSERT_TRUE(!!_obj_inst->blob_manager()->del_range(shard_id, blob_ids[4], blob_ids[12]).get());
+    ASSERT_TRUE(!!_obj_inst->blob_manager()->del_range(shard_id, blob_ids[4], blob_ids[12]).get());
+
+    auto hs_homeobject = dynamic_cast< HSHomeObject* >(_obj_inst.get());
+    HSHomeObject::HS_PG* hs_pg{nullptr};
+    {
+        auto iter = hs_homeobject->_pg_map.find(pg_id);
+        ASSERT_TRUE(iter != hs_homeobject->_pg_map.cend());
+        hs_pg = static_cast< HSHomeObject::HS_PG* >(iter->second.get());
+    }
+    // Nothing was packed, so the lookups below take a single walk each.
+    EXPECT_FALSE(hs_pg->has_packed_blobs());
+    for (auto i = 0u; i < blob_ids.size(); ++i) {
+        bool const deleted = i == 0 || i == 2 || (i >= 4 && i < 12);
+        auto g = _obj_inst->blob_manager()->get(shard_id, blob_ids[i]).get();
+        EXPECT_EQ(!deleted, !!g) << "blob " << blob_ids[i];
+        auto r = hs_homeobject->get_blob_from_index_table(*hs_pg, shard_id, blob_ids[i]);
+        EXPECT_EQ(!deleted, !!r) << "blob " << blob_ids[i];
+    }
+}
+
+TEST_F(HomeObjectFixture, ListBlobs) {
+    pg_id_t pg_id{1};
+    create_pg(pg_id);
+    auto s = _obj_inst->shard_manager()->create_shard(pg_id, 64 * Mi).get();
+    ASSERT_TRUE(!!s);
+    auto shard_id = s.value().id;
+
+    std::vector< Blob > blobs;
+    for (auto i = 0u; i < 32; ++i) {
+        blobs.emplace_back(sisl::io_blob_safe(8 * Ki, 512u), fmt::format("blob_{}", i), 0ul);
+    }
+    auto p = _obj_inst->blob_manager()->put_batch(shard_id, std::move(blobs)).get();
+    ASSERT_TRUE(!!p);
+    auto const blob_ids = p.value();
+    ASSERT_TRUE(!!_obj_inst->blob_manager()->del_range(shard_id, blob_ids[8], blob_ids[16]).get());
+
+    // Paging through the live blobs returns each of them once, in order, and sized from its blkids.
+    std::vector< blob_id_t > listed;
+    blob_id_t start{0};
+    while (true) {
+        auto l = _obj_inst->blob_manager()->list_blobs(shard_id, start, 5).get();
+        ASSERT_TRUE(!!l);
+        for (auto const& entry : l.value()) {
+            EXPECT_EQ(BlobState::ALIVE, entry.state);
+            ASSERT_TRUE(entry.size.has_value());
+            EXPECT_LE(8 * Ki, *entry.size);
+            listed.push_back(entry.id);
+        }
+        if (l.value().size() < 5) { break; }
+        start = l.value().back().id + 1;
+    }
+    std::vector< blob_id_t > expected(blob_ids.begin(), blob_ids.begin() + 8);
+    expected.insert(expected.end(), blob_ids.begin() + 16, blob_ids.end());
+    EXPECT_EQ(expected, listed);
+
+    auto l = _obj_inst->blob_manager()->list_blobs(shard_id, 0, 64, BlobState::DELETED).get();
+    ASSERT_TRUE(!!l);
+    ASSERT_EQ(8ul, l.value().size());
+    EXPECT_EQ(blob_ids[8], l.value().front().id);
+    EXPECT_FALSE(l.value().front().size.has_value());
+}
+
+TEST_F(HomeObjectFixture, StreamPutWithRestart) {
+    pg_id_t pg_id{1};
+    create_pg(pg_id);
+    auto s = _obj_inst->shard_manager()->create_shard(pg_id, 64 * Mi).get();
+    ASSERT_TRUE(!!s);
+    auto shard_id = s.value().id;
+
+    // Segments are written as they are appended, the blob is published by the commit.
+    auto o = _obj_inst->blob_manager()->open_stream(shard_id).get();
+    ASSERT_TRUE(!!o);
+    auto const stream = o.value();
+    homeobject::Blob expected{sisl::io_blob_safe(3 * Mi + 64 * Ki, 512u), "stream_blob", 42ul};
+    BitsGenerator::gen_random_bits(expected.body);
+    std::vector< folly::SemiFuture< BlobManager::NullResult > > appends;
+    for (uint32_t off = 0; off < expected.body.size(); off += Mi) {
+        auto const size = std::min(uint32_t(Mi), expected.body.size() - off);
+        sisl::io_blob_safe segment(size, 512u);
+        std::memcpy(segment.bytes(), expected.body.cbytes() + off, size);
+        appends.push_back(_obj_inst->blob_manager()->append_stream(stream, std::move(segment)));
+    }
+    for (auto& append : appends) {
+        ASSERT_TRUE(!!std::move(append).get());
+    }
+    auto c = _obj_inst->blob_manager()->commit_stream(stream, expected.user_key, expected.object_off).get();
+    ASSERT_TRUE(!!c);
+    blob_map_t blob_map;
+    blob_map.insert({{pg_id, shard_id, c.value()}, expected.clone()});
+
+    restart();
+    for (auto i = 0; i < 10; ++i) {
+        verify_get_blob(blob_map, true /* use_random_offset */);
+    }
+    verify_get_blob(blob_map);
+
+    // The segments are neither counted nor listed, and the blob sequence survives the restart.
+    PGStats pg_stats;
+    ASSERT_TRUE(_obj_inst->pg_manager()->get_stats(pg_id, pg_stats));
+    EXPECT_EQ(pg_stats.num_blobs, 1);
+    auto l = _obj_inst->blob_manager()->list_blobs(shard_id, 0, 64, BlobState::ALL).get();
+    ASSERT_TRUE(!!l);
+    ASSERT_EQ(1ul, l.value().size());
+    EXPECT_EQ(stream.blob, l.value().front().id);
+    o = _obj_inst->blob_manager()->open_stream(shard_id).get();
+    ASSERT_TRUE(!!o);
+    EXPECT_LT(stream.blob, o.value().blob);
+    ASSERT_TRUE(!!_obj_inst->blob_manager()->abort_stream(o.value()).get());
+
+    ASSERT_TRUE(!!_obj_inst->blob_manager()->del(shard_id, stream.blob).get());
+    EXPECT_FALSE(!!_obj_inst->blob_manager()->get(shard_id, stream.blob).get());
+    pg_stats = PGStats{};
+    ASSERT_TRUE(_obj_inst->pg_manager()->get_stats(pg_id, pg_stats));
+    EXPECT_EQ(pg_stats.num_blobs, 0);
+    EXPECT_EQ(pg_stats.used_bytes, 0);
+}
+
+TEST_F(HomeObjectFixture, AbandonedStreamsAreReaped) {
+    pg_id_t pg_id{1};
+    create_pg(pg_id);
+    auto s = _obj_inst->shard_manager()->create_shard(pg_id, 64 * Mi).get();
+    ASSERT_TRUE(!!s);
+    auto shard_id = s.value().id;
+    auto used_bytes = [&] {
+        PGStats pg_stats;
+        EXPECT_TRUE(_obj_inst->pg_manager()->get_stats(pg_id, pg_stats));
+        return pg_stats.used_bytes;
+    };
+    // Reaping runs in the background, and only once the PG has a leader after a restart.
+    auto reap_until_empty = [&] {
+        for (auto i = 0; i < 200 && used_bytes() != 0; ++i) {
+            dynamic_cast< HSHomeObject* >(_obj_inst.get())->_reap_streams();
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+        EXPECT_EQ(0ul, used_bytes());
+    };
+    auto append = [&](BlobStream const& stream) {
+        return _obj_inst->blob_manager()->append_stream(stream, sisl::io_blob_safe(64 * Ki, 512u)).get();
+    };
+
+    // The segments of a stream the restart cut off have no manifest.
+    auto o = _obj_inst->blob_manager()->open_stream(shard_id).get();
+    ASSERT_TRUE(!!o);
+    ASSERT_TRUE(!!append(o.value()));
+    ASSERT_TRUE(!!append(o.value()));
+    EXPECT_LT(0ul, used_bytes());
+    restart();
+    reap_until_empty();
+
+    // A stream past its lease is aborted.
+    o = _obj_inst->blob_manager()->open_stream(shard_id).get();
+    ASSERT_TRUE(!!o);
+    ASSERT_TRUE(!!append(o.value()));
+    auto ho = dynamic_cast< HSHomeObject* >(_obj_inst.get());
+    {
+        std::scoped_lock lock_guard(ho->_stream_lock);
+        ho->_streams.at({shard_id, o.value().blob})->touched = 0;
+    }
+    reap_until_empty();
+    EXPECT_EQ(BlobError::UNKNOWN_BLOB, append(o.value()).error());
+}
+
+TEST_F(HomeObjectFixture, LocalReadsWithToken) {
+    pg_id_t pg_id{1};
+    create_pg(pg_id);
+    auto s = _obj_inst->shard_manager()->create_shard(pg_id, 64 * Mi).get();
+    ASSERT_TRUE(!!s);
+    auto shard_id = s.value().id;
+
+    // Tokens follow the log, each put is further along than the one before.
+    auto blob_mgr = _obj_inst->blob_manager();
+    auto p1 = blob_mgr->put_with_token(shard_id, Blob{sisl::io_blob_safe(4 * Ki, 512u), "a", 0ul}).get();
+    ASSERT_TRUE(!!p1);
+    auto p2 = blob_mgr->put_with_token(shard_id, Blob{sisl::io_blob_safe(4 * Ki, 512u), "b", 0ul}).get();
+    ASSERT_TRUE(!!p2);
+    EXPECT_LT(p1.value().token, p2.value().token);
+
+    auto hs_homeobject = dynamic_cast< HSHomeObject* >(_obj_inst.get());
+    {
+        auto iter = hs_homeobject->_pg_map.find(pg_id);
+        ASSERT_TRUE(iter != hs_homeobject->_pg_map.cend());
+        auto hs_pg = static_cast< HSHomeObject::HS_PG* >(iter->second.get());
+        EXPECT_LE(p2.value().token, hs_pg->applied_lsn_.load());
+    }
+
+    // This replica is the leader of the PG, so it serves tokens it has not applied yet too.
+    auto g = blob_mgr->get_local(shard_id, p2.value().blob, p2.value().token + 100).get();
+    ASSERT_TRUE(!!g);
+    EXPECT_EQ("b", g.value().user_key);
+    ASSERT_TRUE(g.value().current_leader.has_value());
+    EXPECT_EQ(_obj_inst->our_uuid(), *g.value().current_leader);
+
+    PGStats pg_stats;
+    ASSERT_TRUE(_obj_inst->pg_manager()->get_stats(pg_id, pg_stats));
+    ASSERT_TRUE(pg_stats.leader.has_value());
+    EXPECT_EQ(_obj_inst->our_uuid(), *pg_stats.leader);
+}
+
+TEST_F(HomeObjectFixture, SealShardShrinksCapacity) {
+    pg_id_t pg_id{1};
+    create_pg(pg_id);
+    auto s = _obj_inst->shard_manager()->create_shard(pg_id, 64 * Mi).get();
+    ASSERT_TRUE(!!s);
+    auto shard_id = s.value().id;
+
+    std::vector< Blob > blobs;
+    for (auto i = 0u; i < 4; ++i) {
+        blobs.emplace_back(sisl::io_blob_safe(8 * Ki, 512u), fmt::format("blob_{}", i), 0ul);
+    }
+    auto p = _obj_inst->blob_manager()->put_batch(shard_id, std::move(blobs)).get();
+    ASSERT_TRUE(!!p);
+    ASSERT_TRUE(!!_obj_inst->blob_manager()->del(shard_id, p.value()[0]).get());
+
+    uint64_t expected{0};
+    auto l = _obj_inst->blob_manager()->list_blobs(shard_id, 0, 16).get();
+    ASSERT_TRUE(!!l);
+    for (auto const& entry : l.value()) {
+        expected += entry.size.value();
+    }
+
+    // The used bytes of the shard come back from its superblk.
+    trigger_cp(true /* wait */);
+    restart();
+
+    // Once sealed the shard only accounts for the blocks of its live blobs.
+    auto sealed = _obj_inst->shard_manager()->seal_shard(shard_id).get();
+    ASSERT_TRUE(!!sealed);
+    auto info = _obj_inst->shard_manager()->get_shard(shard_id).get();
+    ASSERT_TRUE(!!info);
+    EXPECT_EQ(ShardInfo::State::SEALED, info.value().state);
+    EXPECT_EQ(expected, info.value().total_capacity_bytes);
+    EXPECT_EQ(0ul, info.value().available_capacity_bytes);
+}
+
+TEST_F(HomeObjectFixture, GCCompactsSealedChunk) {
+    pg_id_t pg_id{1};
+    create_pg(pg_id);
+    auto s = _obj_inst->shard_manager()->create_shard(pg_id, 64 * Mi).get();
+    ASSERT_TRUE(!!s);
+    auto shard_id = s.value().id;
+
+    // Larger than blob_data_cache_max_blob_size, so the gets below read the moved blocks.
+    std::map< blob_id_t, Blob > blobs;
+    for (auto i = 0u; i < 8; ++i) {
+        Blob put_blob{sisl::io_blob_safe(32 * Ki, 512u), fmt::format("blob_{}", i), 0ul};
+        BitsGenerator::gen_random_bits(put_blob.body);
+        auto clone = put_blob.clone();
+        auto b = _obj_inst->blob_manager()->put(shard_id, std::move(put_blob)).get();
+        ASSERT_TRUE(!!b);
+        blobs.emplace(b.value(), std::move(clone));
+    }
+    std::vector< blob_id_t > deleted;
+    for (auto const& [blob_id, _] : blobs) {
+        if (deleted.size() < 6) { deleted.push_back(blob_id); }
+    }
+    ASSERT_TRUE(!!_obj_inst->blob_manager()->del_batch(shard_id, deleted).get());
+    ASSERT_TRUE(!!_obj_inst->shard_manager()->seal_shard(shard_id).get());
+
+    auto ho = dynamic_cast< HSHomeObject* >(_obj_inst.get());
+    auto const old_chunk = ho->get_shard_chunk(shard_id);
+    ASSERT_TRUE(old_chunk.has_value());
+
+    GCManager gc(*ho);
+    ASSERT_TRUE(gc.run_once(1));
+    auto const stats = gc.stats();
+    EXPECT_EQ(1ul, stats.chunks_reclaimed);
+    EXPECT_EQ(2ul, stats.blobs_moved);
+    EXPECT_EQ(6ul, stats.tombstones_purged);
+    EXPECT_NE(old_chunk, ho->get_shard_chunk(shard_id));
+
+    for (auto const& [blob_id, blob] : blobs) {
+        auto g = _obj_inst->blob_manager()->get(shard_id, blob_id).get();
+        if (std::find(deleted.begin(), deleted.end(), blob_id) != deleted.end()) {
+            ASSERT_FALSE(!!g);
+            EXPECT_EQ(BlobError::UNKNOWN_BLOB, g.error());
+            continue;
+        }
+        ASSERT_TRUE(!!g);
+        EXPECT_EQ(blob.body.size(), g.value().body.size());
+        EXPECT_EQ(0, std::memcmp(blob.body.cbytes(), g.value().body.cbytes(), blob.body.size()));
+        EXPECT_EQ(blob.user_key, g.value().user_key);
+    }
+
+    // Nothing left over the threshold.
+    EXPECT_FALSE(gc.run_once(1));
+
+    // The new chunk of the shard survives a restart.
+    auto const new_chunk = ho->get_shard_chunk(shard_id);
+    restart();
+    ho = dynamic_cast< HSHomeObject* >(_obj_inst.get());
+    EXPECT_EQ(new_chunk, ho->get_shard_chunk(shard_id));
+}
+
+TEST_F(HomeObjectFixture, GCCompactsChunkOfBlobsLeftBehind) {
+    pg_id_t pg_id{1};
+    create_pg(pg_id);
+    auto s = _obj_inst->shard_manager()->create_shard(pg_id, 64 * Mi).get();
+    ASSERT_TRUE(!!s);
+    auto shard_id = s.value().id;
+
+    std::map< blob_id_t, Blob > blobs;
+    for (auto i = 0u; i < 8; ++i) {
+        Blob put_blob{sisl::io_blob_safe(32 * Ki, 512u), fmt::format("blob_{}", i), 0ul};
+        BitsGenerator::gen_random_bits(put_blob.body);
+        auto clone = put_blob.clone();
+        auto b = _obj_inst->blob_manager()->put(shard_id, std::move(put_blob)).get();
+        ASSERT_TRUE(!!b);
+        blobs.emplace(b.value(), std::move(clone));
+    }
+    std::vector< blob_id_t > deleted, live;
+    for (auto const& [blob_id, _] : blobs) {
+        (deleted.size() < 4 ? deleted : live).push_back(blob_id);
+    }
+    ASSERT_TRUE(!!_obj_inst->blob_manager()->del_batch(shard_id, deleted).get());
+    ASSERT_TRUE(!!_obj_inst->shard_manager()->seal_shard(shard_id).get());
+
+    // Zeroing the header of a live blob makes GC leave it behind.
+    auto ho = dynamic_cast< HSHomeObject* >(_obj_inst.get());
+    auto hs_pg = static_cast< HSHomeObject::HS_PG* >(ho->_pg_map.find(pg_id)->second.get());
+    hs_pg->index_queue_->drain();
+    auto const corrupt = live.front();
+    auto pbas = ho->get_blob_from_index_table(*hs_pg, shard_id, corrupt);
+    ASSERT_TRUE(!!pbas);
+    auto const size = pbas.value().blk_count() * hs_pg->repl_dev_->get_blk_size();
+    auto zeros = sisl::io_blob_safe(size, 512u);
+    std::memset(zeros.bytes(), 0, size);
+    sisl::sg_list sgs;
+    sgs.size = size;
+    sgs.iovs.emplace_back(iovec{.iov_base = zeros.bytes(), .iov_len = size});
+    ASSERT_FALSE(homestore::hs()->data_service().async_write(sgs, pbas.value()).get());
+
+    auto const old_chunk = ho->get_shard_chunk(shard_id);
+    ASSERT_TRUE(old_chunk.has_value());
+
+    // The other blobs move, the shard stays on its chunk and so does the chunk with a blob left on it.
+    GCManager gc(*ho);
+    EXPECT_FALSE(gc.run_once(1));
+    auto stats = gc.stats();
+    EXPECT_EQ(0ul, stats.chunks_reclaimed);
+    EXPECT_EQ(3ul, stats.blobs_moved);
+    EXPECT_EQ(old_chunk, ho->get_shard_chunk(shard_id));
+
+    // With the blob left behind deleted the old chunk empties, along with two of the blobs moved off it.
+    ASSERT_TRUE(!!_obj_inst->blob_manager()->del_batch(shard_id, {corrupt, live[1], live[2]}).get());
+    ASSERT_TRUE(gc.run_once(1));
+    EXPECT_EQ(1ul, gc.stats().chunks_reclaimed);
+
+    // The shard still names the old chunk, its last blob is found on the one it was moved to all the same.
+    auto moved = ho->get_blob_from_index_table(*hs_pg, shard_id, live[3]);
+    ASSERT_TRUE(!!moved);
+    EXPECT_NE(old_chunk, moved.value().chunk_num());
+    ASSERT_TRUE(gc.run_once(1));
+    stats = gc.stats();
+    EXPECT_EQ(2ul, stats.chunks_reclaimed);
+    EXPECT_EQ(4ul, stats.blobs_moved);
+    auto again = ho->get_blob_from_index_table(*hs_pg, shard_id, live[3]);
+    ASSERT_TRUE(!!again);
+    EXPECT_NE(moved.value().chunk_num(), again.value().chunk_num());
+
+    restart();
+    auto g = _obj_inst->blob_manager()->get(shard_id, live[3]).get();
+    ASSERT_TRUE(!!g);
+    auto const& blob = blobs.at(live[3]);
+    ASSERT_EQ(blob.body.size(), g.value().body.size());
+    EXPECT_EQ(0, std::memcmp(blob.body.cbytes(), g.value().body.cbytes(), blob.body.size()));
+    EXPECT_EQ(blob.user_key, g.value().user_key);
+}
+
+TEST_F(HomeObjectFixture, GCMovesPackedBlobsOnce) {
+    HS_BACKEND_SETTINGS_FACTORY().modifiable_settings([](auto& s) {
+        s.blob_pack_enabled = true;
+        s.blob_pack_window_us = 100000;
+    });
+    HS_BACKEND_SETTINGS_FACTORY().save();
+    restart();
+
+    pg_id_t pg_id{1};
+    create_pg(pg_id);
+    auto s = _obj_inst->shard_manager()->create_shard(pg_id, 64 * Mi).get();
+    ASSERT_TRUE(!!s);
+    auto shard_id = s.value().id;
+
+    std::vector< Blob > clones;
+    std::vector< BlobManager::AsyncResult< blob_id_t > > puts;
+    for (auto i = 0u; i < 16; ++i) {
+        Blob put_blob{sisl::io_blob_safe(300 + 11 * i, 512u), fmt::format("packed_blob_{}", i), 0ul};
+        BitsGenerator::gen_random_bits(put_blob.body);
+        clones.push_back(put_blob.clone());
+        puts.push_back(_obj_inst->blob_manager()->put(shard_id, std::move(put_blob)));
+    }
+    std::vector< blob_id_t > blob_ids;
+    for (auto& t : folly::collectAll(std::move(puts)).get()) {
+        ASSERT_TRUE(t.hasValue() && !!t.value());
+        blob_ids.push_back(t.value().value());
+    }
+    // Too large to be packed, its blocks give GC something to reclaim.
+    auto large = _obj_inst->blob_manager()->put(shard_id, Blob{sisl::io_blob_safe(32 * Ki, 512u), "large", 0ul}).get();
+    ASSERT_TRUE(!!large);
+    ASSERT_TRUE(!!_obj_inst->blob_manager()
+                      ->del_batch(shard_id, {blob_ids[0], blob_ids[7], blob_ids[15], large.value()})
+                      .get());
+    ASSERT_TRUE(!!_obj_inst->shard_manager()->seal_shard(shard_id).get());
+
+    // The blocks spanned by the blobs left in the pack, which GC has to copy only once.
+    auto ho = dynamic_cast< HSHomeObject* >(_obj_inst.get());
+    auto hs_pg = static_cast< HSHomeObject::HS_PG* >(ho->_pg_map.find(pg_id)->second.get());
+    hs_pg->index_queue_->drain();
+    auto const blk_size = hs_pg->repl_dev_->get_blk_size();
+    uint64_t first_blk{std::numeric_limits< uint64_t >::max()}, end_blk{0}, blobs_blks{0};
+    for (auto i = 1u; i < 15; ++i) {
+        if (i == 7) { continue; }
+        auto r = ho->get_blob_from_index_table(*hs_pg, shard_id, blob_ids[i]);
+        ASSERT_TRUE(!!r && r.value().packed());
+        first_blk = std::min< uint64_t >(first_blk, r.value().blk_num());
+        end_blk = std::max< uint64_t >(end_blk, r.value().blk_num() + r.value().blk_count());
+        blobs_blks += r.value().blk_count();
+    }
+    // Neighbours share blocks, copying each blob on its own would copy those twice.
+    ASSERT_LT(end_blk - first_blk, blobs_blks);
+
+    GCManager gc(*ho);
+    ASSERT_TRUE(gc.run_once(1));
+    auto const stats = gc.stats();
+    EXPECT_EQ(13ul, stats.blobs_moved);
+    EXPECT_EQ((end_blk - first_blk) * blk_size, stats.bytes_moved);
+
+    for (auto i = 0u; i < blob_ids.size(); ++i) {
+        auto g = _obj_inst->blob_manager()->get(shard_id, blob_ids[i]).get();
+        if (i == 0 || i == 7 || i == 15) {
+            EXPECT_FALSE(!!g);
+            continue;
+        }
+        ASSERT_TRUE(!!g) << "blob " << blob_ids[i];
+        ASSERT_EQ(clones[i].body.size(), g.value().body.size());
+        EXPECT_EQ(0, std::memcmp(clones[i].body.cbytes(), g.value().body.cbytes(), clones[i].body.size()));
+        EXPECT_EQ(clones[i].user_key, g.value().user_key);
+    }
+
+    HS_BACKEND_SETTINGS_FACTORY().modifiable_settings([](auto& s) {
+        s.blob_pack_enabled = false;
+        s.blob_pack_window_us = 500;
+    });
+    HS_BACKEND_SETTINGS_FACTORY().save();
+}
+
+TEST_F(HomeObjectFixture, PutsOverBudgetRetryLater) {
+    pg_id_t pg_id{1};
+    create_pg(pg_id);
+    auto s = _obj_inst->shard_manager()->create_shard(pg_id, 64 * Mi).get();
+    ASSERT_TRUE(!!s);
+    auto shard_id = s.value().id;
+
+    HS_BACKEND_SETTINGS_FACTORY().modifiable_settings([](auto& settings) { settings.pg_put_max_inflight_ops = 4; });
+    HS_BACKEND_SETTINGS_FACTORY().save();
+
+    // Puts already in flight on the PG use up its budget.
+    auto ho = dynamic_cast< HSHomeObject* >(_obj_inst.get());
+    auto hs_pg = static_cast< HSHomeObject::HS_PG* >(ho->_pg_map.find(pg_id)->second.get());
+    hs_pg->inflight_puts_.fetch_add(4);
+    auto blob_mgr = _obj_inst->blob_manager();
+    auto p = blob_mgr->put(shard_id, Blob{sisl::io_blob_safe(4 * Ki, 512u), "a", 0ul}).get();
+    ASSERT_FALSE(!!p);
+    EXPECT_EQ(BlobError::RETRY_LATER, p.error());
+    std::vector< Blob > blobs;
+    blobs.emplace_back(sisl::io_blob_safe(4 * Ki, 512u), "b", 0ul);
+    auto b = blob_mgr->put_batch(shard_id, std::move(blobs)).get();
+    ASSERT_FALSE(!!b);
+    EXPECT_EQ(BlobError::RETRY_LATER, b.error());
+    EXPECT_EQ(4u, hs_pg->inflight_puts_.load());
+
+    // Once they complete puts go through again and hand their share back.
+    hs_pg->inflight_puts_.fetch_sub(4);
+    p = blob_mgr->put(shard_id, Blob{sisl::io_blob_safe(4 * Ki, 512u), "a", 0ul}).get();
+    ASSERT_TRUE(!!p);
+    EXPECT_EQ(0u, hs_pg->inflight_puts_.load());
+    EXPECT_EQ(0ul, hs_pg->inflight_put_bytes_.load());
+
+    HS_BACKEND_SETTINGS_FACTORY().modifiable_settings([](auto& settings) { settings.pg_put_max_inflight_ops = 4096; });
+    HS_BACKEND_SETTINGS_FACTORY().save();
+}
+
+TEST_F(HomeObjectFixture, DedupIdenticalBlobs) {
+    // Read at startup, so restart to pick it up.
+    HS_BACKEND_SETTINGS_FACTORY().modifiable_settings([](auto& settings) { settings.blob_dedup_enabled = true; });
+    HS_BACKEND_SETTINGS_FACTORY().save();
+    restart();
+
+    pg_id_t pg_id{1};
+    create_pg(pg_id);
+    auto s = _obj_inst->shard_manager()->create_shard(pg_id, 64 * Mi).get();
+    ASSERT_TRUE(!!s);
+    auto shard_id = s.value().id;
+
+    // Larger than blob_data_cache_max_blob_size, so the gets below read the blocks.
+    Blob original{sisl::io_blob_safe(32 * Ki, 512u), "dedup_blob", 0ul};
+    BitsGenerator::gen_random_bits(original.body);
+    auto const clone = original.clone();
+    auto const put = [&](Blob&& blob) {
+        auto b = _obj_inst->blob_manager()->put(shard_id, std::move(blob)).get();
+        EXPECT_TRUE(!!b);
+        return b.value();
+    };
+    auto const first = put(clone.clone());
+    auto const second = put(clone.clone());
+    auto different = clone.clone();
+    different.user_key = "other_blob";
+    auto const third = put(std::move(different));
+    EXPECT_NE(first, second);
+
+    auto ho = dynamic_cast< HSHomeObject* >(_obj_inst.get());
+    auto hs_pg = static_cast< HSHomeObject::HS_PG* >(ho->_pg_map.find(pg_id)->second.get());
+    hs_pg->index_queue_->drain();
+    auto const first_pbas = ho->get_blob_from_index_table(*hs_pg, shard_id, first);
+    auto const second_pbas = ho->get_blob_from_index_table(*hs_pg, shard_id, second);
+    auto const third_pbas = ho->get_blob_from_index_table(*hs_pg, shard_id, third);
+    ASSERT_TRUE(!!first_pbas && !!second_pbas && !!third_pbas);
+    EXPECT_EQ(first_pbas.value(), second_pbas.value());
+    EXPECT_NE(first_pbas.value(), third_pbas.value());
+    // Adding no reference tells how many blobs are on an extent.
+    auto const refs = [&](BlobLocation const& pbas) {
+        std::scoped_lock gc_guard(hs_pg->gc_mtx_);
+        auto r = HSHomeObject::add_extent_refs(*hs_pg, pbas, 0);
+        EXPECT_TRUE(!!r);
+        return r.value_or(0);
+    };
+    EXPECT_EQ(2ul, refs(first_pbas.value()));
+    EXPECT_EQ(1ul, refs(third_pbas.value()));
+
+    auto verify = [&](blob_id_t blob_id) {
+        auto g = _obj_inst->blob_manager()->get(shard_id, blob_id).get();
+        ASSERT_TRUE(!!g) << "blob " << blob_id;
+        EXPECT_EQ(clone.user_key, g.value().user_key);
+        ASSERT_EQ(clone.body.size(), g.value().body.size());
+        EXPECT_EQ(0, std::memcmp(clone.body.cbytes(), g.value().body.cbytes(), clone.body.size()));
+    };
+    verify(first);
+    verify(second);
+
+    // The counts are in the index, a restart without dedup still keeps the blocks the blob left shares.
+    trigger_cp(true /* wait */);
+    HS_BACKEND_SETTINGS_FACTORY().modifiable_settings([](auto& settings) { settings.blob_dedup_enabled = false; });
+    HS_BACKEND_SETTINGS_FACTORY().save();
+    restart();
+    ho = dynamic_cast< HSHomeObject* >(_obj_inst.get());
+    hs_pg = static_cast< HSHomeObject::HS_PG* >(ho->_pg_map.find(pg_id)->second.get());
+    EXPECT_EQ(2ul, refs(first_pbas.value()));
+    ASSERT_TRUE(!!_obj_inst->blob_manager()->del(shard_id, first).get());
+    EXPECT_EQ(1ul, refs(first_pbas.value()));
+    EXPECT_FALSE(!!_obj_inst->blob_manager()->get(shard_id, first).get());
+    verify(second);
+
+    trigger_cp(true /* wait */);
+    restart();
+    verify(second);
+    ASSERT_TRUE(!!_obj_inst->blob_manager()->del(shard_id, second).get());
+    EXPECT_FALSE(!!_obj_inst->blob_manager()->get(shard_id, second).get());
 }
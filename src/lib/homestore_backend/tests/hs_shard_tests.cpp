@@ -1,3 +1,4 @@
+#include <set>
 #include <string>
 
 #include <boost/uuid/random_generator.hpp>
@@ -72,10 +73,36 @@ TEST_F(TestFixture, CreateMultiShardsOnMultiPG) {
     }
 }
 
+TEST_F(TestFixture, CreateShardsOnNewPG) {
+    auto new_pg_id = static_cast< homeobject::pg_id_t >(_pg_id + 1);
+    auto info = homeobject::PGInfo(new_pg_id);
+    info.members.insert(homeobject::PGMember{homeobj_->our_uuid(), "peer1", 1});
+    EXPECT_TRUE(homeobj_->pg_manager()->create_pg(std::move(info)).get());
+
+    auto e = homeobj_->shard_manager()->create_shards(new_pg_id, 3, Mi).get();
+    ASSERT_TRUE(!!e);
+    ASSERT_EQ(3, e.value().size());
+
+    // all shards of the new pg land on the pdev picked for its first shard, each on a chunk of its own;
+    homeobject::HSHomeObject* ho = dynamic_cast< homeobject::HSHomeObject* >(homeobj_.get());
+    std::set< homestore::chunk_num_t > chunks;
+    std::optional< uint32_t > pdev;
+    for (auto const& shard : e.value()) {
+        auto chunk_num = ho->get_shard_chunk(shard.id);
+        ASSERT_TRUE(chunk_num.has_value());
+        EXPECT_TRUE(chunks.insert(chunk_num.value()).second);
+        auto alloc_hint = ho->chunk_selector()->chunk_to_hints(chunk_num.value());
+        ASSERT_TRUE(alloc_hint.pdev_id_hint.has_value());
+        if (!pdev) { pdev = alloc_hint.pdev_id_hint; }
+        EXPECT_EQ(pdev.value(), alloc_hint.pdev_id_hint.value());
+    }
+}
+
 TEST_F(TestFixture, MockSealShard) {
     ShardInfo shard_info = _shard_1;
     shard_info.state = ShardInfo::State::SEALED;
 
+    // seal message in the legacy json encoding, which replicas still have to accept;
     nlohmann::json j;
     j["shard_info"]["shard_id_t"] = shard_info.id;
     j["shard_info"]["pg_id_t"] = shard_info.placement_group;
@@ -88,7 +115,7 @@ TEST_F(TestFixture, MockSealShard) {
     auto seal_shard_msg = j.dump();
 
     homeobject::HSHomeObject* ho = dynamic_cast< homeobject::HSHomeObject* >(homeobj_.get());
-    auto* pg = s_cast< homeobject::HSHomeObject::HS_PG* >(ho->_pg_map[_pg_id].get());
+    auto* pg = s_cast< homeobject::HSHomeObject::HS_PG* >(ho->_pg_map.find(_pg_id)->second.get());
     auto repl_dev = pg->repl_dev_;
     const auto msg_size = sisl::round_up(seal_shard_msg.size(), repl_dev->get_blk_size());
     auto req = homeobject::repl_result_ctx< ShardManager::Result< ShardInfo > >::make(msg_size, 512 /*alignment*/);
@@ -116,7 +143,7 @@ TEST_F(TestFixture, MockSealShard) {
     EXPECT_EQ(info.value().state, ShardInfo::State::SEALED);
 
     auto pg_iter = ho->_pg_map.find(_pg_id);
-    EXPECT_TRUE(pg_iter != ho->_pg_map.end());
+    EXPECT_TRUE(pg_iter != ho->_pg_map.cend());
     auto& pg_result = pg_iter->second;
     EXPECT_EQ(2, pg_result->shards_.size());
     auto& check_shard = pg_result->shards_.front();
@@ -189,7 +216,7 @@ TEST_F(ShardManagerTestingRecovery, ShardManagerRecovery) {
     // check PG after recovery.
     EXPECT_TRUE(ho->_pg_map.size() == 1);
     auto pg_iter = ho->_pg_map.find(_pg_id);
-    EXPECT_TRUE(pg_iter != ho->_pg_map.end());
+    EXPECT_TRUE(pg_iter != ho->_pg_map.cend());
     auto& pg_result = pg_iter->second;
     EXPECT_EQ(1, pg_result->shards_.size());
     // verify the sequence number is correct after recovery.
@@ -272,7 +299,7 @@ TEST_F(ShardManagerTestingRecovery, SealedShardRecovery) {
     // check the shard info from ShardManager to make sure on_commit() is successfully.
     homeobject::HSHomeObject* ho = dynamic_cast< homeobject::HSHomeObject* >(_home_object.get());
     auto pg_iter = ho->_pg_map.find(_pg_id);
-    EXPECT_TRUE(pg_iter != ho->_pg_map.end());
+    EXPECT_TRUE(pg_iter != ho->_pg_map.cend());
     auto& pg_result = pg_iter->second;
     EXPECT_EQ(1, pg_result->shards_.size());
     auto check_shard = pg_result->shards_.front().get();
@@ -287,7 +314,7 @@ TEST_F(ShardManagerTestingRecovery, SealedShardRecovery) {
     EXPECT_TRUE(ho->_pg_map.size() == 1);
     // check shard internal state;
     pg_iter = ho->_pg_map.find(_pg_id);
-    EXPECT_TRUE(pg_iter != ho->_pg_map.end());
+    EXPECT_TRUE(pg_iter != ho->_pg_map.cend());
     EXPECT_EQ(1, pg_iter->second->shards_.size());
     auto hs_shard = d_cast< homeobject::HSHomeObject::HS_Shard* >(pg_iter->second->shards_.front().get());
     EXPECT_TRUE(hs_shard->info == shard_info);
@@ -7,6 +7,9 @@
 #include <folly/init/Init.h>
 
 #include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
 
 SISL_LOGGING_DEF(HOMEOBJECT_LOG_MODS)
 SISL_LOGGING_INIT(HOMEOBJECT_LOG_MODS)
@@ -35,8 +38,12 @@ public:
 
     uint16_t get_chunk_id() const { return m_chunk_id; }
 
-    blk_num_t get_total_blks() const { return 0; }
+    blk_num_t get_total_blks() const { return 10; }
     void set_chunk_id(uint16_t chunk_id) { m_chunk_id = chunk_id; }
+    void reset() {
+        m_available_blks = get_total_blks();
+        m_defrag_nblks = 0;
+    }
     const std::shared_ptr< Chunk > get_internal_chunk() { return shared_from_this(); }
 
     Chunk(uint32_t pdev_id, uint16_t chunk_id, uint32_t available_blks, uint32_t defrag_nblks) {
@@ -71,6 +78,8 @@ blk_num_t VChunk::get_total_blks() const { return m_internal_chunk->get_total_bl
 
 cshared< Chunk > VChunk::get_internal_chunk() const { return m_internal_chunk->get_internal_chunk(); }
 
+void VChunk::reset() { m_internal_chunk->reset(); }
+
 } // namespace homestore
 
 using homeobject::csharedChunk;
@@ -181,6 +190,86 @@ TEST_F(HeapChunkSelectorTest, test_release_chunk) {
     ASSERT_EQ(chunk2->available_blks(), 2);
 }
 
+TEST_F(HeapChunkSelectorTest, test_total_blks_after_release) {
+    auto const total_blks = HCS.total_blks(1);
+    ASSERT_EQ(30, total_blks);
+    homestore::blk_alloc_hints hints;
+    hints.pdev_id_hint = 1;
+    for (int i = 0; i < 3; i++) {
+        auto chunk = HCS.select_chunk(1, hints);
+        HCS.release_chunk(chunk->get_chunk_id());
+    }
+    // releasing a chunk puts its blocks back in the heap, not in the total of the device once more.
+    ASSERT_EQ(total_blks, HCS.total_blks(1));
+    ASSERT_EQ(6, HCS.avail_blks(1));
+}
+
+TEST_F(HeapChunkSelectorTest, test_reset_chunk) {
+    homestore::blk_alloc_hints hints;
+    hints.pdev_id_hint = 1;
+    auto chunk = HCS.select_chunk(1, hints);
+    ASSERT_EQ(3, chunk->get_chunk_id());
+    ASSERT_EQ(3, HCS.avail_blks(1));
+
+    // a chunk emptied by GC comes back to the heap with all of its blocks.
+    ASSERT_TRUE(HCS.reset_chunk(chunk->get_chunk_id()));
+    ASSERT_EQ(chunk->get_total_blks(), chunk->available_blks());
+    ASSERT_EQ(0, chunk->get_defrag_nblks());
+    HCS.release_chunk(chunk->get_chunk_id(), false /* defrag_candidate */);
+    ASSERT_EQ(13, HCS.avail_blks(1));
+    chunk = HCS.select_chunk(1, hints);
+    ASSERT_EQ(3, chunk->get_chunk_id());
+
+    ASSERT_FALSE(HCS.reset_chunk(100));
+}
+
+TEST_F(HeapChunkSelectorTest, test_select_pdev_for_pg) {
+    // the device with the fewest open shards of the pg comes first.
+    ASSERT_EQ(3, HCS.select_pdev_for_pg({{1, 2}, {2, 1}}, 0));
+
+    // then the one written to the least recently, then the lowest id among equals.
+    HCS.record_write(7, 4096);
+    HCS.record_write(4, 512);
+    ASSERT_EQ(1, HCS.select_pdev_for_pg({}, 0));
+    HCS.record_write(1, 8192);
+    ASSERT_EQ(2, HCS.select_pdev_for_pg({}, 0));
+
+    // a device with no chunk left is skipped.
+    homestore::blk_alloc_hints hints;
+    hints.pdev_id_hint = 2;
+    for (int i = 0; i < 3; i++) {
+        HCS.select_chunk(1, hints);
+    }
+    ASSERT_EQ(3, HCS.select_pdev_for_pg({}, 0));
+
+    // the other devices have 20% of their blocks available.
+    ASSERT_EQ(3, HCS.select_pdev_for_pg({}, 20));
+    ASSERT_EQ(std::nullopt, HCS.select_pdev_for_pg({}, 21));
+}
+
+TEST_F(HeapChunkSelectorTest, test_concurrent_select_chunk) {
+    // every chunk is handed out exactly once however many shards are created at the same time.
+    std::mutex mtx;
+    std::unordered_set< chunk_num_t > selected;
+    std::vector< std::thread > threads;
+    for (uint32_t i = 0; i < 6; i++) {
+        threads.emplace_back([this, i, &mtx, &selected] {
+            homestore::blk_alloc_hints hints;
+            hints.pdev_id_hint = i % 3 + 1;
+            while (auto chunk = HCS.select_chunk(1, hints)) {
+                std::scoped_lock lock_guard(mtx);
+                ASSERT_TRUE(selected.insert(chunk->get_chunk_id()).second);
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    ASSERT_EQ(9, selected.size());
+    ASSERT_EQ(0, HCS.avail_blks(std::nullopt));
+    ASSERT_EQ(nullptr, HCS.most_defrag_chunk());
+}
+
 int main(int argc, char* argv[]) {
     int parsed_argc = argc;
     ::testing::InitGoogleTest(&parsed_argc, argv);
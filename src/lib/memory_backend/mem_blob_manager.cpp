@@ -1,3 +1,5 @@
+#include <algorithm>
+
 #include "mem_homeobject.hpp"
 
 namespace homeobject {
@@ -16,42 +18,163 @@ namespace homeobject {
         LOGD("[route={}] missing", route);                                                                             \
     } else
 
-// Write (move) Blob to new BlobExt on heap and Insert BlobExt to Index
+// Views a range of a stored Blob, a len of 0 meaning up to the end of the Blob. The view holds on to the Blob.
+static BlobManager::Result< BlobView > view_of(std::shared_ptr< Blob const > const& blob, uint64_t off, uint64_t len) {
+    auto const size = blob->body.size();
+    if (off + len > size) {
+        LOGD("Invalid offset length request in get blob offset {} len {} size {}", off, len, size);
+        return folly::makeUnexpected(BlobError::INVALID_ARG);
+    }
+    return BlobView{.holder = blob,
+                    .body = sisl::blob{blob->body.bytes() + off, static_cast< uint32_t >(0 == len ? size - off : len)},
+                    .user_key = blob->user_key,
+                    .object_off = blob->object_off};
+}
+
+blob_id_t MemoryHomeObject::_new_blob_id(ShardInfo const& _shard) {
+    auto pg = _get_pg(_shard.placement_group);
+    RELEASE_ASSERT(pg, "PG not found");
+    return pg->blob_sequence_num_.fetch_add(1, std::memory_order_relaxed);
+}
+
 BlobManager::AsyncResult< blob_id_t > MemoryHomeObject::_put_blob(ShardInfo const& _shard, Blob&& _blob) {
+    return _put_blob_with_id(_shard, _new_blob_id(_shard), std::move(_blob));
+}
+
+// Move the Blob into the Index, its body is kept as is and shares one allocation with its BlobExt's ref count
+BlobManager::AsyncResult< blob_id_t > MemoryHomeObject::_put_blob_with_id(ShardInfo const& _shard, blob_id_t _blob_id,
+                                                                          Blob&& _blob) {
     WITH_SHARD
-    blob_id_t new_blob_id;
-    {
-        auto lg = std::shared_lock(_pg_lock);
-        auto iter = _pg_map.find(_shard.placement_group);
-        RELEASE_ASSERT(iter != _pg_map.end(), "PG not found");
-        new_blob_id = iter->second->blob_sequence_num_.fetch_add(1, std::memory_order_relaxed);
-    }
-    WITH_ROUTE(new_blob_id);
+    auto pg = _get_pg(_shard.placement_group);
+    RELEASE_ASSERT(pg, "PG not found");
+    WITH_ROUTE(_blob_id);
 
-    auto [_, happened] =
-        shard.btree_.try_emplace(route, BlobExt{.state_ = BlobState::ALIVE, .blob_ = new Blob(std::move(_blob))});
+    auto const bytes = _blob.body.size();
+    auto [_, happened] = shard.btree_.try_emplace(
+        route, BlobExt{.state_ = BlobState::ALIVE, .blob_ = std::make_shared< Blob const >(std::move(_blob))});
     RELEASE_ASSERT(happened, "Generated duplicate BlobRoute!");
+    pg->on_blob_added(route.blob, bytes);
     return route.blob;
 }
 
-// Lookup BlobExt and duplicate underyling Blob for user; only *safe* because we defer GC.
+// Reserve a contiguous range of BlobIds and Insert each Blob as if it were put individually
+BlobManager::AsyncResult< std::vector< blob_id_t > > MemoryHomeObject::_put_blob_batch(ShardInfo const& _shard,
+                                                                                       std::vector< Blob >&& _blobs) {
+    WITH_SHARD
+    auto pg = _get_pg(_shard.placement_group);
+    RELEASE_ASSERT(pg, "PG not found");
+    auto const start_blob_id = pg->blob_sequence_num_.fetch_add(_blobs.size(), std::memory_order_relaxed);
+
+    auto blob_ids = std::vector< blob_id_t >();
+    blob_ids.reserve(_blobs.size());
+    for (auto& _blob : _blobs) {
+        WITH_ROUTE(start_blob_id + blob_ids.size());
+        auto const bytes = _blob.body.size();
+        auto [_, happened] = shard.btree_.try_emplace(
+            route, BlobExt{.state_ = BlobState::ALIVE, .blob_ = std::make_shared< Blob const >(std::move(_blob))});
+        RELEASE_ASSERT(happened, "Generated duplicate BlobRoute!");
+        pg->on_blob_added(route.blob, bytes);
+        blob_ids.push_back(route.blob);
+    }
+    return blob_ids;
+}
+
+// Copies only the requested range out of the stored Blob.
 BlobManager::AsyncResult< Blob > MemoryHomeObject::_get_blob(ShardInfo const& _shard, blob_id_t _blob, uint64_t off,
                                                              uint64_t len) const {
     WITH_SHARD
     WITH_ROUTE(_blob)
-    IF_BLOB_ALIVE { return blob_it->second.blob_->clone(); }
+    IF_BLOB_ALIVE {
+        auto view = view_of(blob_it->second.blob_, off, len);
+        if (!view) { return folly::makeUnexpected(view.error()); }
+        return view.value().clone();
+    }
+    return folly::makeUnexpected(BlobError::UNKNOWN_BLOB);
+}
+
+// Each Blob is looked up and duplicated as in _get_blob
+BlobManager::AsyncResult< std::vector< BlobManager::Result< Blob > > >
+MemoryHomeObject::_get_blob_batch(ShardInfo const& _shard, std::vector< blob_id_t > const& _blobs) const {
+    WITH_SHARD
+    auto results = std::vector< BlobManager::Result< Blob > >();
+    results.reserve(_blobs.size());
+    for (auto const _blob : _blobs) {
+        WITH_ROUTE(_blob)
+        IF_BLOB_ALIVE {
+            results.push_back(blob_it->second.blob_->clone());
+            continue;
+        }
+        results.push_back(folly::makeUnexpected(BlobError::UNKNOWN_BLOB));
+    }
+    return results;
+}
+
+// Views share the stored Blob, a Blob deleted while viewed is reclaimed with its last view.
+BlobManager::AsyncResult< BlobView > MemoryHomeObject::_get_blob_view(ShardInfo const& _shard, blob_id_t _blob,
+                                                                      uint64_t off, uint64_t len) const {
+    WITH_SHARD
+    WITH_ROUTE(_blob)
+    IF_BLOB_ALIVE { return view_of(blob_it->second.blob_, off, len); }
     return folly::makeUnexpected(BlobError::UNKNOWN_BLOB);
 }
 
+// Only the delete that swaps the entry counts the blob as deleted, racing deletes of the same blob are no-ops.
+void MemoryHomeObject::tombstone(ShardInfo const& _shard, ShardIndex& shard, BlobRoute const& route,
+                                 BlobExt const& ext) {
+    if (shard.btree_.assign_if_equal(route, ext, BlobExt{.state_ = BlobState::DELETED, .blob_ = nullptr})) {
+        _get_pg(_shard.placement_group)->on_blob_deleted(route.blob, ext.blob_->body.size());
+    }
+}
+
 // Tombstone BlobExt entry
 BlobManager::NullAsyncResult MemoryHomeObject::_del_blob(ShardInfo const& _shard, blob_id_t _blob) {
     WITH_SHARD
     WITH_ROUTE(_blob)
-    IF_BLOB_ALIVE {
-        shard.btree_.assign_if_equal(route, blob_it->second,
-                                     BlobExt{.state_ = BlobState::DELETED, .blob_ = blob_it->second.blob_});
+    IF_BLOB_ALIVE { tombstone(_shard, shard, route, blob_it->second); }
+    return folly::Unit();
+}
+
+BlobManager::NullAsyncResult MemoryHomeObject::_del_blob_batch(ShardInfo const& _shard,
+                                                               std::vector< blob_id_t > const& _blobs) {
+    WITH_SHARD
+    for (auto const _blob : _blobs) {
+        WITH_ROUTE(_blob)
+        IF_BLOB_ALIVE { tombstone(_shard, shard, route, blob_it->second); }
     }
     return folly::Unit();
 }
 
+BlobManager::NullAsyncResult MemoryHomeObject::_del_blob_range(ShardInfo const& _shard, blob_id_t from,
+                                                               blob_id_t to) {
+    WITH_SHARD
+    for (auto const& [route, ext] : shard.btree_) {
+        if (route.blob < from || route.blob >= to || !ext) { continue; }
+        tombstone(_shard, shard, route, ext);
+    }
+    return folly::Unit();
+}
+
+BlobManager::NullAsyncResult MemoryHomeObject::_del_blob_stream(ShardInfo const& _shard, blob_id_t _blob) {
+    WITH_SHARD
+    WITH_ROUTE(_blob)
+    IF_BLOB_ALIVE { tombstone(_shard, shard, route, blob_it->second); }
+    return _del_blob_range(_shard, stream_segments_begin(_blob), stream_segments_end(_blob));
+}
+
+// The index is not ordered, so every page sorts the blobs of the shard past start.
+BlobManager::AsyncResult< BlobList > MemoryHomeObject::_list_blobs(ShardInfo const& _shard, blob_id_t start,
+                                                                   uint32_t limit, BlobState filter) const {
+    WITH_SHARD
+    auto blobs = BlobList();
+    for (auto const& [route, ext] : shard.btree_) {
+        if (route.blob < start || (filter != BlobState::ALL && filter != ext.state_)) { continue; }
+        auto entry = BlobListEntry{.id = route.blob, .state = ext.state_};
+        if (ext) { entry.size = ext.blob_->body.size() + ext.blob_->user_key.size(); }
+        blobs.push_back(std::move(entry));
+    }
+    std::sort(blobs.begin(), blobs.end(), [](auto const& a, auto const& b) { return a.id < b.id; });
+    if (blobs.size() > limit) { blobs.resize(limit); }
+    return blobs;
+}
+
 } // namespace homeobject
@@ -12,10 +12,4 @@ MemoryHomeObject::MemoryHomeObject(std::weak_ptr< HomeObjectApplication >&& appl
     _our_id = _application.lock()->discover_svcid(std::nullopt);
 }
 
-ShardIndex::~ShardIndex() {
-    for (auto it = btree_.begin(); it != btree_.end(); ++it) {
-        delete it->second.blob_;
-    }
-}
-
 } // namespace homeobject
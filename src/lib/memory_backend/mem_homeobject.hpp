@@ -1,6 +1,7 @@
 #pragma once
 
 #include <atomic>
+#include <memory>
 #include <utility>
 
 #include <folly/concurrency/ConcurrentHashMap.h>
@@ -10,20 +11,18 @@
 namespace homeobject {
 
 ///
-// Used to TombStone Blob's in the Index to defer for GC.
-ENUM(BlobState, uint8_t, ALIVE = 0, DELETED);
-
+// Entry of a Blob in the Index. A deleted Blob leaves a TombStone without the Blob, whose memory is reclaimed once
+// the last view of it is gone; gets share the stored Blob instead of copying it.
 struct BlobExt {
     BlobState state_{BlobState::DELETED};
-    Blob* blob_;
+    std::shared_ptr< Blob const > blob_;
 
     explicit operator bool() const { return state_ == BlobState::ALIVE; }
-    bool operator==(const BlobExt& rhs) const { return blob_ == rhs.blob_; }
+    bool operator==(const BlobExt& rhs) const { return state_ == rhs.state_ && blob_ == rhs.blob_; }
 };
 
 struct ShardIndex {
     folly::ConcurrentHashMap< BlobRoute, BlobExt > btree_;
-    ~ShardIndex();
 };
 
 class MemoryHomeObject : public HomeObjectImpl {
@@ -35,13 +34,29 @@ class MemoryHomeObject : public HomeObjectImpl {
     /// Helpers
     // ShardManager
     ShardManager::AsyncResult< ShardInfo > _create_shard(pg_id_t, uint64_t size_bytes) override;
+    ShardManager::AsyncResult< InfoList > _create_shards(pg_id_t, uint32_t count, uint64_t size_bytes) override;
     ShardManager::AsyncResult< ShardInfo > _seal_shard(ShardInfo const&) override;
 
     // BlobManager
     BlobManager::AsyncResult< blob_id_t > _put_blob(ShardInfo const&, Blob&&) override;
+    BlobManager::AsyncResult< std::vector< blob_id_t > > _put_blob_batch(ShardInfo const&,
+                                                                         std::vector< Blob >&&) override;
     BlobManager::AsyncResult< Blob > _get_blob(ShardInfo const&, blob_id_t, uint64_t off = 0,
                                                uint64_t len = 0) const override;
+    BlobManager::AsyncResult< std::vector< BlobManager::Result< Blob > > >
+    _get_blob_batch(ShardInfo const&, std::vector< blob_id_t > const&) const override;
+    BlobManager::AsyncResult< BlobView > _get_blob_view(ShardInfo const&, blob_id_t, uint64_t off = 0,
+                                                        uint64_t len = 0) const override;
     BlobManager::NullAsyncResult _del_blob(ShardInfo const&, blob_id_t) override;
+    BlobManager::NullAsyncResult _del_blob_batch(ShardInfo const&, std::vector< blob_id_t > const&) override;
+    BlobManager::NullAsyncResult _del_blob_range(ShardInfo const&, blob_id_t from, blob_id_t to) override;
+    BlobManager::AsyncResult< BlobList > _list_blobs(ShardInfo const&, blob_id_t start, uint32_t limit,
+                                                     BlobState filter) const override;
+    blob_id_t _new_blob_id(ShardInfo const&) override;
+    BlobManager::AsyncResult< blob_id_t > _put_blob_with_id(ShardInfo const&, blob_id_t, Blob&&) override;
+    BlobManager::NullAsyncResult _del_blob_stream(ShardInfo const&, blob_id_t) override;
+    read_token_t _read_token(pg_id_t) const override;
+    std::optional< peer_id_t > _current_leader(pg_id_t) const override;
     ///
 
     // PGManager
@@ -55,10 +70,11 @@ class MemoryHomeObject : public HomeObjectImpl {
     HomeObjectStats _get_stats() const override;
 
     ShardIndex& _find_index(shard_id_t) const;
+    void tombstone(ShardInfo const&, ShardIndex&, BlobRoute const&, BlobExt const&);
 
 public:
     MemoryHomeObject(std::weak_ptr< HomeObjectApplication >&& application);
-    ~MemoryHomeObject() override = default;
+    ~MemoryHomeObject() override { _join_pg_executors(); }
 };
 
 } // namespace homeobject
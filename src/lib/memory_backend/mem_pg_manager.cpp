@@ -2,9 +2,8 @@
 
 namespace homeobject {
 PGManager::NullAsyncResult MemoryHomeObject::_create_pg(PGInfo&& pg_info, std::set< peer_id_t > const&) {
-    auto lg = std::scoped_lock(_pg_lock);
     auto [it1, _] = _pg_map.try_emplace(pg_info.id, std::make_unique< PG >(pg_info));
-    RELEASE_ASSERT(_pg_map.end() != it1, "Unknown map insert error!");
+    RELEASE_ASSERT(_pg_map.cend() != it1, "Unknown map insert error!");
     return folly::makeSemiFuture< PGManager::NullResult >(folly::Unit());
 }
 
@@ -14,16 +13,16 @@ PGManager::NullAsyncResult MemoryHomeObject::_replace_member(pg_id_t id, peer_id
 }
 
 bool MemoryHomeObject::_get_stats(pg_id_t id, PGStats& stats) const {
-    auto lg = std::shared_lock(_pg_lock);
-    auto it = _pg_map.find(id);
-    if (_pg_map.end() == it) { return false; }
-    auto pg = it->second.get();
+    auto pg = _get_pg(id);
+    if (!pg) { return false; }
     stats.id = pg->pg_info_.id;
     stats.replica_set_uuid = pg->pg_info_.replica_set_uuid;
     stats.num_members = pg->pg_info_.members.size();
-    stats.total_shards = pg->shards_.size();
-    stats.open_shards =
-        std::count_if(pg->shards_.begin(), pg->shards_.end(), [](auto const& s) { return s->is_open(); });
+    stats.total_shards = pg->total_shards_.load(std::memory_order_relaxed);
+    stats.open_shards = pg->open_shards_.load(std::memory_order_relaxed);
+    stats.used_bytes = pg->used_bytes_.load(std::memory_order_relaxed);
+    stats.num_blobs = pg->num_blobs_.load(std::memory_order_relaxed);
+    stats.deleted_bytes = pg->deleted_bytes_.load(std::memory_order_relaxed);
     for (auto const& m : pg->pg_info_.members) {
         stats.members.emplace_back(std::make_tuple(m.id, m.name, 0 /* last commit lsn */));
     }
@@ -31,9 +30,13 @@ bool MemoryHomeObject::_get_stats(pg_id_t id, PGStats& stats) const {
     return true;
 }
 
+// There are no other replicas; this one leads every PG and has applied every put.
+read_token_t MemoryHomeObject::_read_token(pg_id_t) const { return 0; }
+
+std::optional< peer_id_t > MemoryHomeObject::_current_leader(pg_id_t) const { return _our_id; }
+
 void MemoryHomeObject::_get_pg_ids(std::vector< pg_id_t >& pg_ids) const {
-    auto lg = std::shared_lock(_pg_lock);
-    for (auto& [id, _] : _pg_map) {
+    for (auto const& [id, _] : _pg_map) {
         pg_ids.push_back(id);
     }
 }
@@ -41,11 +44,8 @@ void MemoryHomeObject::_get_pg_ids(std::vector< pg_id_t >& pg_ids) const {
 HomeObjectStats MemoryHomeObject::_get_stats() const {
     HomeObjectStats stats;
     uint32_t num_open_shards = 0ul;
-    std::scoped_lock shared_lock(_pg_lock);
     for (auto const& [_, pg] : _pg_map) {
-        auto mem_pg = pg.get();
-        num_open_shards +=
-            std::count_if(mem_pg->shards_.begin(), mem_pg->shards_.end(), [](auto const& s) { return s->is_open(); });
+        num_open_shards += pg->open_shards_.load(std::memory_order_relaxed);
     }
 
     stats.num_open_shards = num_open_shards;
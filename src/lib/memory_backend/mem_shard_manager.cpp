@@ -10,27 +10,58 @@ ShardManager::AsyncResult< ShardInfo > MemoryHomeObject::_create_shard(pg_id_t p
     auto const now = get_current_timestamp();
     auto info = ShardInfo(0ull, pg_owner, ShardInfo::State::OPEN, now, now, size_bytes, size_bytes, 0);
     {
-        auto lg = std::scoped_lock(_pg_lock, _shard_lock);
-        auto pg_it = _pg_map.find(pg_owner);
-        if (_pg_map.end() == pg_it) return folly::makeUnexpected(ShardError::UNKNOWN_PG);
+        auto pg = _get_pg(pg_owner);
+        if (!pg) return folly::makeUnexpected(ShardError::UNKNOWN_PG);
 
-        auto& s_list = pg_it->second->shards_;
+        auto lg = std::scoped_lock(pg->mtx_);
+        auto& s_list = pg->shards_;
         info.id = make_new_shard_id(pg_owner, s_list.size());
-        auto iter = s_list.emplace(s_list.end(), std::make_unique< Shard >(info));
+        auto const& shard = s_list.emplace_back(std::make_unique< Shard >(info));
         LOGDEBUG("Creating Shard [{}]: in Pg [{}] of Size [{}b]", info.id & shard_mask, pg_owner, size_bytes);
-        auto [_, s_happened] = _shard_map.emplace(info.id, iter);
+        auto [_, s_happened] = _shard_map.emplace(info.id, shard.get());
         RELEASE_ASSERT(s_happened, "Duplicate Shard insertion!");
+        pg->on_shard_added(true);
     }
     auto [it, happened] = index_.try_emplace(info.id, std::make_unique< ShardIndex >());
     RELEASE_ASSERT(happened, "Could not create BTree!");
     return info;
 }
 
+ShardManager::AsyncResult< InfoList > MemoryHomeObject::_create_shards(pg_id_t pg_owner, uint32_t count,
+                                                                       uint64_t size_bytes) {
+    auto const now = get_current_timestamp();
+    auto infos = InfoList();
+    {
+        auto pg = _get_pg(pg_owner);
+        if (!pg) return folly::makeUnexpected(ShardError::UNKNOWN_PG);
+
+        auto lg = std::scoped_lock(pg->mtx_);
+        auto& s_list = pg->shards_;
+        for (auto i = 0u; count > i; ++i) {
+            auto info = ShardInfo(make_new_shard_id(pg_owner, s_list.size()), pg_owner, ShardInfo::State::OPEN, now,
+                                  now, size_bytes, size_bytes, 0);
+            auto const& shard = s_list.emplace_back(std::make_unique< Shard >(info));
+            LOGDEBUG("Creating Shard [{}]: in Pg [{}] of Size [{}b]", info.id & shard_mask, pg_owner, size_bytes);
+            auto [_, s_happened] = _shard_map.emplace(info.id, shard.get());
+            RELEASE_ASSERT(s_happened, "Duplicate Shard insertion!");
+            pg->on_shard_added(true);
+            infos.push_back(std::move(info));
+        }
+    }
+    for (auto const& info : infos) {
+        auto [it, happened] = index_.try_emplace(info.id, std::make_unique< ShardIndex >());
+        RELEASE_ASSERT(happened, "Could not create BTree!");
+    }
+    return infos;
+}
+
 ShardManager::AsyncResult< ShardInfo > MemoryHomeObject::_seal_shard(ShardInfo const& info) {
-    auto lg = std::scoped_lock(_shard_lock);
     auto shard_it = _shard_map.find(info.id);
-    RELEASE_ASSERT(_shard_map.end() != shard_it, "Missing ShardIterator!");
-    auto& shard_info = (*shard_it->second)->info;
+    RELEASE_ASSERT(_shard_map.cend() != shard_it, "Missing Shard!");
+    auto pg = _get_pg(info.placement_group);
+    auto lg = std::scoped_lock(pg->mtx_);
+    auto& shard_info = shard_it->second->info;
+    if (ShardInfo::State::OPEN == shard_info.state) { pg->on_shard_sealed(); }
     shard_info.state = ShardInfo::State::SEALED;
     return shard_info;
 }
@@ -1,3 +1,5 @@
+#include <algorithm>
+
 #include "homeobject_impl.hpp"
 
 namespace homeobject {
@@ -6,18 +8,28 @@ std::shared_ptr< ShardManager > HomeObjectImpl::shard_manager() { return shared_
 
 ShardManager::AsyncResult< ShardInfo > HomeObjectImpl::create_shard(pg_id_t pg_owner, uint64_t size_bytes) {
     if (0 == size_bytes || max_shard_size() < size_bytes) return folly::makeUnexpected(ShardError::INVALID_ARG);
-    return _defer().thenValue([this, pg_owner, size_bytes](auto) mutable -> ShardManager::AsyncResult< ShardInfo > {
-        return _create_shard(pg_owner, size_bytes);
-    });
+    return _defer(pg_owner).thenValue(
+        [this, pg_owner, size_bytes](auto) mutable -> ShardManager::AsyncResult< ShardInfo > {
+            return _create_shard(pg_owner, size_bytes);
+        });
+}
+
+ShardManager::AsyncResult< InfoList > HomeObjectImpl::create_shards(pg_id_t pg_owner, uint32_t count,
+                                                                    uint64_t size_bytes) {
+    if (0 == count || max_shard_num_in_pg() <= count) return folly::makeUnexpected(ShardError::INVALID_ARG);
+    if (0 == size_bytes || max_shard_size() < size_bytes) return folly::makeUnexpected(ShardError::INVALID_ARG);
+    return _defer(pg_owner).thenValue(
+        [this, pg_owner, count, size_bytes](auto) mutable -> ShardManager::AsyncResult< InfoList > {
+            return _create_shards(pg_owner, count, size_bytes);
+        });
 }
 
 ShardManager::AsyncResult< InfoList > HomeObjectImpl::list_shards(pg_id_t pgid) const {
-    return _defer().thenValue([this, pgid](auto) mutable -> ShardManager::Result< InfoList > {
-        std::shared_lock lock_guard(_pg_lock);
-        auto iter = _pg_map.find(pgid);
-        if (iter == _pg_map.cend()) { return folly::makeUnexpected(ShardError::UNKNOWN_PG); }
-        auto& pg = iter->second;
+    return _defer(pgid).thenValue([this, pgid](auto) mutable -> ShardManager::Result< InfoList > {
+        auto pg = _get_pg(pgid);
+        if (!pg) { return folly::makeUnexpected(ShardError::UNKNOWN_PG); }
 
+        std::shared_lock lock_guard(pg->mtx_);
         auto info_l = std::list< ShardInfo >();
         for (auto const& shard : pg->shards_) {
             LOGD("found [shard={}]", shard->info.id);
@@ -27,8 +39,43 @@ ShardManager::AsyncResult< InfoList > HomeObjectImpl::list_shards(pg_id_t pgid)
     });
 }
 
+// The shards of a PG are kept sorted by id, a page is found by binary search and only the page is copied.
+ShardManager::AsyncResult< InfoPage > HomeObjectImpl::list_shards(pg_id_t pgid, shard_id_t start, uint32_t limit,
+                                                                  std::optional< ShardInfo::State > filter) const {
+    if (0 == limit) return folly::makeUnexpected(ShardError::INVALID_ARG);
+    return _defer(pgid).thenValue([this, pgid, start, limit, filter](auto) -> ShardManager::Result< InfoPage > {
+        auto pg = _get_pg(pgid);
+        if (!pg) { return folly::makeUnexpected(ShardError::UNKNOWN_PG); }
+
+        auto page = InfoPage();
+        page.reserve(std::min< size_t >(limit, 1024));
+        std::shared_lock lock_guard(pg->mtx_);
+        auto const& shards = pg->shards_;
+        auto it = std::lower_bound(shards.begin(), shards.end(), start,
+                                   [](auto const& shard, shard_id_t id) { return shard->info.id < id; });
+        for (; shards.end() != it && page.size() < limit; ++it) {
+            if (filter && (*it)->info.state != *filter) { continue; }
+            page.push_back((*it)->info);
+        }
+        return page;
+    });
+}
+
+ShardManager::AsyncResult< uint32_t > HomeObjectImpl::count_shards(pg_id_t pgid,
+                                                                   std::optional< ShardInfo::State > filter) const {
+    auto pg = _get_pg(pgid);
+    if (!pg) { return folly::makeUnexpected(ShardError::UNKNOWN_PG); }
+    // the counters of the PG answer the common cases without its lock;
+    if (!filter) { return pg->total_shards_.load(std::memory_order_relaxed); }
+    if (ShardInfo::State::OPEN == *filter) { return pg->open_shards_.load(std::memory_order_relaxed); }
+
+    std::shared_lock lock_guard(pg->mtx_);
+    return static_cast< uint32_t >(std::count_if(pg->shards_.begin(), pg->shards_.end(),
+                                                 [filter](auto const& shard) { return shard->info.state == *filter; }));
+}
+
 ShardManager::AsyncResult< ShardInfo > HomeObjectImpl::seal_shard(shard_id_t id) {
-    return _get_shard(id).thenValue([this](auto const e) mutable -> ShardManager::AsyncResult< ShardInfo > {
+    return _with_shard(id, [this](auto const e) mutable -> ShardManager::AsyncResult< ShardInfo > {
         if (!e) return folly::makeUnexpected(ShardError::UNKNOWN_SHARD);
         if (ShardInfo::State::SEALED == e.value().state) return e.value();
         return _seal_shard(e.value());
@@ -36,21 +83,17 @@ ShardManager::AsyncResult< ShardInfo > HomeObjectImpl::seal_shard(shard_id_t id)
 }
 
 ShardManager::AsyncResult< ShardInfo > HomeObjectImpl::get_shard(shard_id_t id) const {
-    return _get_shard(id).thenValue([this](auto const e) mutable -> ShardManager::Result< ShardInfo > {
-        if (!e) { return folly::makeUnexpected(e.error()); }
-        return e.value();
-    });
+    return _with_shard(id, [](auto const e) -> ShardManager::Result< ShardInfo > { return e; });
 }
 
-///
-// This is used as a first call for many operations and initializes the Future.
-//
-folly::Future< ShardManager::Result< ShardInfo > > HomeObjectImpl::_get_shard(shard_id_t id) const {
-    return _defer().thenValue([this, id](auto) -> ShardManager::Result< ShardInfo > {
-        auto lg = std::shared_lock(_shard_lock);
-        if (auto it = _shard_map.find(id); _shard_map.end() != it) return (*it->second)->info;
-        return folly::makeUnexpected(ShardError::UNKNOWN_SHARD);
-    });
+ShardManager::Result< ShardInfo > HomeObjectImpl::_resolve_shard(shard_id_t id) const {
+    auto it = _shard_map.find(id);
+    if (_shard_map.cend() == it) return folly::makeUnexpected(ShardError::UNKNOWN_SHARD);
+    // Shard ids carry the id of their PG, whose lock guards the shard info.
+    auto pg = _get_pg(id >> shard_width);
+    RELEASE_ASSERT(pg, "Missing PG of known shard!");
+    auto lg = std::shared_lock(pg->mtx_);
+    return it->second->info;
 }
 
 uint64_t HomeObjectImpl::get_current_timestamp() {
@@ -6,6 +6,8 @@
 
 using homeobject::Blob;
 using homeobject::BlobError;
+using homeobject::BlobStream;
+using homeobject::BlobView;
 
 TEST_F(TestFixture, BasicBlobTests) {
     auto const batch_sz = 4;
@@ -75,3 +77,281 @@ TEST_F(TestFixture, BasicBlobTests) {
     // Delete is Idempotent
     EXPECT_TRUE(homeobj_->blob_manager()->del(_shard_1.id, _blob_id).get());
 }
+
+TEST_F(TestFixture, BatchBlobTests) {
+    auto blobs = std::vector< Blob >();
+    for (auto i = 0ul; 8ul > i; ++i) {
+        blobs.emplace_back(sisl::io_blob_safe(4 * Ki, 512u), fmt::format("test_blob_{}", i), i * Ki);
+    }
+    EXPECT_EQ(BlobError::INVALID_ARG, homeobj_->blob_manager()->put_batch(_shard_1.id, {}).get().error());
+    auto unknown = std::vector< Blob >();
+    unknown.push_back(blobs[0].clone());
+    EXPECT_EQ(BlobError::UNKNOWN_SHARD,
+              homeobj_->blob_manager()->put_batch(_shard_2.id + 1, std::move(unknown)).get().error());
+
+    auto p_e = homeobj_->blob_manager()->put_batch(_shard_1.id, std::move(blobs)).get();
+    ASSERT_TRUE(!!p_e);
+    auto const& blob_ids = p_e.value();
+    ASSERT_EQ(8ul, blob_ids.size());
+    for (auto i = 0ul; blob_ids.size() > i; ++i) {
+        if (i > 0) EXPECT_EQ(blob_ids[i - 1] + 1, blob_ids[i]);
+        auto g_e = homeobj_->blob_manager()->get(_shard_1.id, blob_ids[i]).get();
+        ASSERT_TRUE(!!g_e);
+        EXPECT_EQ(fmt::format("test_blob_{}", i), g_e.value().user_key);
+        EXPECT_EQ(i * Ki, g_e.value().object_off);
+        EXPECT_EQ(4 * Ki, g_e.value().body.size());
+    }
+
+    EXPECT_TRUE(homeobj_->shard_manager()->seal_shard(_shard_1.id).get());
+    auto sealed = std::vector< Blob >();
+    sealed.emplace_back(sisl::io_blob_safe(512u, 512u), "test_blob", 0ul);
+    EXPECT_EQ(BlobError::SEALED_SHARD,
+              homeobj_->blob_manager()->put_batch(_shard_1.id, std::move(sealed)).get().error());
+}
+
+TEST_F(TestFixture, BlobViewTests) {
+    auto v_e = homeobj_->blob_manager()->get_view(_shard_1.id, _blob_id).get();
+    ASSERT_TRUE(!!v_e);
+    auto view = std::move(v_e.value());
+    EXPECT_EQ("test_blob", view.user_key);
+    EXPECT_EQ(4 * Mi, view.object_off);
+    EXPECT_EQ(4 * Ki, view.body.size());
+
+    auto g_e = homeobj_->blob_manager()->get(_shard_1.id, _blob_id).get();
+    ASSERT_TRUE(!!g_e);
+    EXPECT_EQ(0, std::memcmp(view.body.cbytes(), g_e.value().body.cbytes(), view.body.size()));
+
+    // A view keeps its buffer after the blob is deleted.
+    EXPECT_TRUE(homeobj_->blob_manager()->del(_shard_1.id, _blob_id).get());
+    auto const copy = view.clone();
+    EXPECT_EQ("test_blob", copy.user_key);
+    EXPECT_EQ(view.body.size(), copy.body.size());
+
+    v_e = homeobj_->blob_manager()->get_view(_shard_1.id, _blob_id).get();
+    ASSERT_FALSE(!!v_e);
+    EXPECT_EQ(BlobError::UNKNOWN_BLOB, v_e.error());
+    EXPECT_EQ(BlobError::UNKNOWN_SHARD, homeobj_->blob_manager()->get_view(_shard_2.id + 1, _blob_id).get().error());
+}
+
+TEST_F(TestFixture, RangedGetTests) {
+    auto put_blob = Blob{sisl::io_blob_safe(8 * Ki, 512u), "ranged_blob", 0ul};
+    for (uint32_t i = 0; put_blob.body.size() > i; ++i) {
+        put_blob.body.bytes()[i] = static_cast< uint8_t >(i % 251);
+    }
+    auto const expected = put_blob.clone();
+    auto p_e = homeobj_->blob_manager()->put(_shard_1.id, std::move(put_blob)).get();
+    ASSERT_TRUE(!!p_e);
+    auto const blob_id = p_e.value();
+
+    auto g_e = homeobj_->blob_manager()->get(_shard_1.id, blob_id, 1000, 3000).get();
+    ASSERT_TRUE(!!g_e);
+    ASSERT_EQ(3000, g_e.value().body.size());
+    EXPECT_EQ(0, std::memcmp(expected.body.cbytes() + 1000, g_e.value().body.cbytes(), 3000));
+    g_e = homeobj_->blob_manager()->get(_shard_1.id, blob_id, 5 * Ki).get();
+    ASSERT_TRUE(!!g_e);
+    EXPECT_EQ(3 * Ki, g_e.value().body.size());
+    EXPECT_EQ(BlobError::INVALID_ARG, homeobj_->blob_manager()->get(_shard_1.id, blob_id, 8 * Ki, 1).get().error());
+
+    // views of the blob share the stored body
+    auto v_e = homeobj_->blob_manager()->get_view(_shard_1.id, blob_id, 512, 512).get();
+    ASSERT_TRUE(!!v_e);
+    auto view = std::move(v_e.value());
+    auto whole = homeobj_->blob_manager()->get_view(_shard_1.id, blob_id).get();
+    ASSERT_TRUE(!!whole);
+    EXPECT_EQ(whole.value().body.cbytes() + 512, view.body.cbytes());
+    EXPECT_EQ(512, view.body.size());
+    EXPECT_EQ(0, std::memcmp(expected.body.cbytes() + 512, view.body.cbytes(), 512));
+
+    // a deleted blob is reclaimed once its last view is gone
+    auto const stored = std::weak_ptr< void const >(view.holder);
+    whole = folly::makeUnexpected(BlobError::UNKNOWN);
+    EXPECT_TRUE(homeobj_->blob_manager()->del(_shard_1.id, blob_id).get());
+    EXPECT_FALSE(stored.expired());
+    view = BlobView{};
+    EXPECT_TRUE(stored.expired());
+}
+
+TEST_F(TestFixture, GetBatchTests) {
+    EXPECT_EQ(BlobError::INVALID_ARG, homeobj_->blob_manager()->get_batch(_shard_1.id, {}).get().error());
+    EXPECT_EQ(BlobError::UNKNOWN_SHARD,
+              homeobj_->blob_manager()->get_batch(_shard_2.id + 1, {_blob_id}).get().error());
+
+    auto g_e = homeobj_->blob_manager()->get_batch(_shard_1.id, {_blob_id + 1, _blob_id}).get();
+    ASSERT_TRUE(!!g_e);
+    auto const& results = g_e.value();
+    ASSERT_EQ(2ul, results.size());
+    EXPECT_EQ(BlobError::UNKNOWN_BLOB, results[0].error());
+    ASSERT_TRUE(!!results[1]);
+    EXPECT_EQ("test_blob", results[1].value().user_key);
+    EXPECT_EQ(4 * Mi, results[1].value().object_off);
+}
+
+TEST_F(TestFixture, DelBatchTests) {
+    auto blobs = std::vector< Blob >();
+    for (auto i = 0ul; 8ul > i; ++i) {
+        blobs.emplace_back(sisl::io_blob_safe(4 * Ki, 512u), fmt::format("test_blob_{}", i), 0ul);
+    }
+    auto p_e = homeobj_->blob_manager()->put_batch(_shard_1.id, std::move(blobs)).get();
+    ASSERT_TRUE(!!p_e);
+    auto const blob_ids = p_e.value();
+
+    EXPECT_EQ(BlobError::INVALID_ARG, homeobj_->blob_manager()->del_batch(_shard_1.id, {}).get().error());
+    EXPECT_EQ(BlobError::INVALID_ARG,
+              homeobj_->blob_manager()->del_range(_shard_1.id, blob_ids[1], blob_ids[1]).get().error());
+    EXPECT_EQ(BlobError::UNKNOWN_SHARD,
+              homeobj_->blob_manager()->del_batch(_shard_2.id + 1, {blob_ids[0]}).get().error());
+    EXPECT_EQ(BlobError::UNKNOWN_SHARD,
+              homeobj_->blob_manager()->del_range(_shard_2.id + 1, blob_ids[0], blob_ids[1]).get().error());
+
+    // Blobs already deleted are skipped.
+    EXPECT_TRUE(homeobj_->blob_manager()->del_batch(_shard_1.id, {blob_ids[0], blob_ids[2]}).get());
+    EXPECT_TRUE(homeobj_->blob_manager()->del_batch(_shard_1.id, {blob_ids[2], blob_ids[3]}).get());
+    EXPECT_TRUE(homeobj_->blob_manager()->del_range(_shard_1.id, blob_ids[3], blob_ids[6]).get());
+    for (auto i = 0ul; blob_ids.size() > i; ++i) {
+        auto g_e = homeobj_->blob_manager()->get(_shard_1.id, blob_ids[i]).get();
+        if (i == 1 || i >= 6) {
+            EXPECT_TRUE(!!g_e);
+        } else {
+            ASSERT_FALSE(!!g_e);
+            EXPECT_EQ(BlobError::UNKNOWN_BLOB, g_e.error());
+        }
+    }
+    EXPECT_TRUE(homeobj_->blob_manager()->get(_shard_1.id, _blob_id).get());
+}
+
+TEST_F(TestFixture, ListBlobsTests) {
+    EXPECT_EQ(BlobError::INVALID_ARG, homeobj_->blob_manager()->list_blobs(_shard_1.id, 0, 0).get().error());
+    EXPECT_EQ(BlobError::UNKNOWN_SHARD, homeobj_->blob_manager()->list_blobs(_shard_2.id + 1, 0, 8).get().error());
+
+    auto blobs = std::vector< Blob >();
+    for (auto i = 0ul; 4ul > i; ++i) {
+        blobs.emplace_back(sisl::io_blob_safe(4 * Ki, 512u), fmt::format("test_blob_{}", i), 0ul);
+    }
+    auto p_e = homeobj_->blob_manager()->put_batch(_shard_1.id, std::move(blobs)).get();
+    ASSERT_TRUE(!!p_e);
+    auto const blob_ids = p_e.value();
+    EXPECT_TRUE(homeobj_->blob_manager()->del(_shard_1.id, blob_ids[1]).get());
+
+    // Pages of live blobs in id order, the fixture's own blob first.
+    auto l_e = homeobj_->blob_manager()->list_blobs(_shard_1.id, 0, 2).get();
+    ASSERT_TRUE(!!l_e);
+    ASSERT_EQ(2ul, l_e.value().size());
+    EXPECT_EQ(_blob_id, l_e.value()[0].id);
+    EXPECT_EQ(blob_ids[0], l_e.value()[1].id);
+    EXPECT_EQ(BlobState::ALIVE, l_e.value()[1].state);
+    EXPECT_TRUE(l_e.value()[1].size.has_value());
+    l_e = homeobj_->blob_manager()->list_blobs(_shard_1.id, l_e.value()[1].id + 1, 8).get();
+    ASSERT_TRUE(!!l_e);
+    ASSERT_EQ(2ul, l_e.value().size());
+    EXPECT_EQ(blob_ids[2], l_e.value()[0].id);
+    EXPECT_EQ(blob_ids[3], l_e.value()[1].id);
+
+    l_e = homeobj_->blob_manager()->list_blobs(_shard_1.id, 0, 8, BlobState::DELETED).get();
+    ASSERT_TRUE(!!l_e);
+    ASSERT_EQ(1ul, l_e.value().size());
+    EXPECT_EQ(blob_ids[1], l_e.value()[0].id);
+    EXPECT_FALSE(l_e.value()[0].size.has_value());
+    l_e = homeobj_->blob_manager()->list_blobs(_shard_1.id, 0, 8, BlobState::ALL).get();
+    ASSERT_TRUE(!!l_e);
+    EXPECT_EQ(5ul, l_e.value().size());
+
+    // Other shards are not listed.
+    l_e = homeobj_->blob_manager()->list_blobs(_shard_2.id, 0, 8, BlobState::ALL).get();
+    ASSERT_TRUE(!!l_e);
+    EXPECT_TRUE(l_e.value().empty());
+}
+
+TEST_F(TestFixture, StreamPutTests) {
+    auto o_e = homeobj_->blob_manager()->open_stream(_shard_1.id).get();
+    ASSERT_TRUE(!!o_e);
+    BlobStream const stream = o_e.value();
+    EXPECT_EQ(BlobError::UNKNOWN_SHARD, homeobj_->blob_manager()->open_stream(_shard_2.id + 1).get().error());
+    EXPECT_EQ(BlobError::INVALID_ARG,
+              homeobj_->blob_manager()->append_stream(stream, sisl::io_blob_safe(0u, 512u)).get().error());
+
+    // Segments of different sizes, appended without waiting on each other.
+    auto expected = std::vector< uint8_t >();
+    auto appends = std::vector< folly::SemiFuture< homeobject::BlobManager::NullResult > >();
+    for (auto const size : {4 * Ki, 8 * Ki, 2 * Ki}) {
+        auto segment = sisl::io_blob_safe(size, 512u);
+        for (uint32_t i = 0; segment.size() > i; ++i) {
+            segment.bytes()[i] = static_cast< uint8_t >((expected.size() + i) % 251);
+        }
+        expected.insert(expected.end(), segment.cbytes(), segment.cbytes() + segment.size());
+        appends.push_back(homeobj_->blob_manager()->append_stream(stream, std::move(segment)));
+    }
+    for (auto& append : appends) {
+        EXPECT_TRUE(std::move(append).get());
+    }
+    EXPECT_EQ(BlobError::UNKNOWN_BLOB, homeobj_->blob_manager()->get(_shard_1.id, stream.blob).get().error());
+
+    auto c_e = homeobj_->blob_manager()->commit_stream(stream, "stream_blob", 4 * Mi).get();
+    ASSERT_TRUE(!!c_e);
+    EXPECT_EQ(stream.blob, c_e.value());
+    EXPECT_EQ(BlobError::UNKNOWN_BLOB,
+              homeobj_->blob_manager()->append_stream(stream, sisl::io_blob_safe(Ki, 512u)).get().error());
+
+    auto g_e = homeobj_->blob_manager()->get(_shard_1.id, stream.blob).get();
+    ASSERT_TRUE(!!g_e);
+    EXPECT_EQ("stream_blob", g_e.value().user_key);
+    EXPECT_EQ(4 * Mi, g_e.value().object_off);
+    ASSERT_EQ(expected.size(), g_e.value().body.size());
+    EXPECT_EQ(0, std::memcmp(expected.data(), g_e.value().body.cbytes(), expected.size()));
+
+    // Ranges within one segment and across segments.
+    g_e = homeobj_->blob_manager()->get(_shard_1.id, stream.blob, 5 * Ki, 2 * Ki).get();
+    ASSERT_TRUE(!!g_e);
+    ASSERT_EQ(2 * Ki, g_e.value().body.size());
+    EXPECT_EQ(0, std::memcmp(expected.data() + 5 * Ki, g_e.value().body.cbytes(), 2 * Ki));
+    g_e = homeobj_->blob_manager()->get(_shard_1.id, stream.blob, 3 * Ki, 10 * Ki).get();
+    ASSERT_TRUE(!!g_e);
+    ASSERT_EQ(10 * Ki, g_e.value().body.size());
+    EXPECT_EQ(0, std::memcmp(expected.data() + 3 * Ki, g_e.value().body.cbytes(), 10 * Ki));
+    EXPECT_EQ(BlobError::INVALID_ARG,
+              homeobj_->blob_manager()->get(_shard_1.id, stream.blob, 14 * Ki, 1).get().error());
+
+    // The segments are not listed, the stream is listed as one blob.
+    auto l_e = homeobj_->blob_manager()->list_blobs(_shard_1.id, 0, 8, BlobState::ALL).get();
+    ASSERT_TRUE(!!l_e);
+    ASSERT_EQ(2ul, l_e.value().size());
+    EXPECT_EQ(_blob_id, l_e.value()[0].id);
+    EXPECT_EQ(stream.blob, l_e.value()[1].id);
+
+    EXPECT_TRUE(homeobj_->blob_manager()->del(_shard_1.id, stream.blob).get());
+    EXPECT_EQ(BlobError::UNKNOWN_BLOB, homeobj_->blob_manager()->get(_shard_1.id, stream.blob).get().error());
+
+    // An aborted stream is never published.
+    o_e = homeobj_->blob_manager()->open_stream(_shard_1.id).get();
+    ASSERT_TRUE(!!o_e);
+    BlobStream const aborted = o_e.value();
+    EXPECT_TRUE(homeobj_->blob_manager()->append_stream(aborted, sisl::io_blob_safe(4 * Ki, 512u)).get());
+    EXPECT_TRUE(homeobj_->blob_manager()->abort_stream(aborted).get());
+    EXPECT_EQ(BlobError::UNKNOWN_BLOB, homeobj_->blob_manager()->commit_stream(aborted).get().error());
+    EXPECT_EQ(BlobError::UNKNOWN_BLOB, homeobj_->blob_manager()->get(_shard_1.id, aborted.blob).get().error());
+}
+
+TEST_F(TestFixture, LocalReadTests) {
+    auto p_e = homeobj_->blob_manager()
+                   ->put_with_token(_shard_1.id, Blob{sisl::io_blob_safe(4 * Ki, 512u), "local_blob", 0ul})
+                   .get();
+    ASSERT_TRUE(!!p_e);
+    auto const receipt = p_e.value();
+    EXPECT_EQ(BlobError::UNKNOWN_SHARD,
+              homeobj_->blob_manager()->put_with_token(_shard_2.id + 1, Blob{sisl::io_blob_safe(512u, 512u), "", 0ul})
+                  .get()
+                  .error());
+
+    // The only replica leads the PG, it serves any token.
+    auto g_e = homeobj_->blob_manager()->get_local(_shard_1.id, receipt.blob, receipt.token + 1).get();
+    ASSERT_TRUE(!!g_e);
+    EXPECT_EQ("local_blob", g_e.value().user_key);
+    ASSERT_TRUE(g_e.value().current_leader.has_value());
+    EXPECT_EQ(homeobj_->our_uuid(), *g_e.value().current_leader);
+    EXPECT_EQ(BlobError::UNKNOWN_BLOB,
+              homeobj_->blob_manager()->get_local(_shard_1.id, receipt.blob + 1, receipt.token).get().error());
+
+    auto stats = homeobject::PGStats{};
+    ASSERT_TRUE(homeobj_->pg_manager()->get_stats(_pg_id, stats));
+    ASSERT_TRUE(stats.leader.has_value());
+    EXPECT_EQ(homeobj_->our_uuid(), *stats.leader);
+}
@@ -6,6 +6,7 @@
 using homeobject::PGError;
 using homeobject::PGInfo;
 using homeobject::PGMember;
+using homeobject::PGStats;
 
 TEST_F(TestFixture, CreatePgEmpty) {
     EXPECT_EQ(homeobj_->pg_manager()->create_pg(PGInfo(0u)).get().error(), PGError::INVALID_ARG);
@@ -55,3 +56,28 @@ TEST_F(TestFixture, Migrate) {
     EXPECT_FALSE(
         homeobj_->pg_manager()->replace_member(_pg_id, _peer2, PGMember{boost::uuids::random_generator()()}).get());
 }
+
+TEST_F(TestFixture, PgStats) {
+    PGStats stats;
+    EXPECT_FALSE(homeobj_->pg_manager()->get_stats(UINT16_MAX, stats));
+    ASSERT_TRUE(homeobj_->pg_manager()->get_stats(_pg_id, stats));
+    EXPECT_EQ(stats.total_shards, 2);
+    EXPECT_EQ(stats.open_shards, 2);
+    EXPECT_EQ(stats.num_blobs, 1);
+    EXPECT_EQ(stats.used_bytes, 4 * Ki);
+    EXPECT_EQ(homeobj_->get_stats().num_open_shards, 2);
+
+    EXPECT_TRUE(homeobj_->shard_manager()->seal_shard(_shard_2.id).get());
+    EXPECT_TRUE(homeobj_->blob_manager()->del(_shard_1.id, _blob_id).get());
+    // deleting the blob again does not count it twice
+    EXPECT_TRUE(homeobj_->blob_manager()->del(_shard_1.id, _blob_id).get());
+
+    stats = PGStats{};
+    ASSERT_TRUE(homeobj_->pg_manager()->get_stats(_pg_id, stats));
+    EXPECT_EQ(stats.total_shards, 2);
+    EXPECT_EQ(stats.open_shards, 1);
+    EXPECT_EQ(stats.num_blobs, 0);
+    EXPECT_EQ(stats.used_bytes, 0);
+    EXPECT_EQ(stats.deleted_bytes, 4 * Ki);
+    EXPECT_EQ(homeobj_->get_stats().num_open_shards, 1);
+}
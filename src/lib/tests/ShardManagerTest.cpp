@@ -1,6 +1,16 @@
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+#include <folly/concurrency/ConcurrentHashMap.h>
+#include <folly/executors/CPUThreadPoolExecutor.h>
 #include <homeobject/shard_manager.hpp>
 #include "lib/tests/fixture_app.hpp"
 
+#define protected public
+#include "lib/homeobject_impl.hpp"
+#undef protected
+
 using homeobject::shard_id_t;
 using homeobject::ShardError;
 using homeobject::ShardInfo;
@@ -19,6 +29,31 @@ TEST_F(TestFixture, CreateShardNoPg) {
     EXPECT_EQ(ShardError::UNKNOWN_PG, homeobj_->shard_manager()->create_shard(_pg_id + 1, Mi).get().error());
 }
 
+TEST_F(TestFixture, CreateShardsInvalid) {
+    EXPECT_EQ(ShardError::INVALID_ARG, homeobj_->shard_manager()->create_shards(_pg_id, 0, Mi).get().error());
+    EXPECT_EQ(ShardError::INVALID_ARG, homeobj_->shard_manager()->create_shards(_pg_id, 4, 0ul).get().error());
+    EXPECT_EQ(ShardError::UNKNOWN_PG, homeobj_->shard_manager()->create_shards(_pg_id + 1, 4, Mi).get().error());
+}
+
+TEST_F(TestFixture, CreateShards) {
+    auto e = homeobj_->shard_manager()->create_shards(_pg_id, 4, Mi).get();
+    ASSERT_TRUE(!!e);
+    auto const& infos = e.value();
+    ASSERT_EQ(4, infos.size());
+    auto expected_id = infos.front().id;
+    for (auto const& info : infos) {
+        EXPECT_EQ(info.id, expected_id++);
+        EXPECT_EQ(info.placement_group, _pg_id);
+        EXPECT_EQ(info.state, ShardInfo::State::OPEN);
+        EXPECT_EQ(info.total_capacity_bytes, Mi);
+        EXPECT_TRUE(!!homeobj_->shard_manager()->get_shard(info.id).get());
+    }
+
+    auto l = homeobj_->shard_manager()->list_shards(_pg_id).get();
+    ASSERT_TRUE(!!l);
+    EXPECT_EQ(6, l.value().size());
+}
+
 TEST_F(TestFixture, GetUnknownShard) {
     EXPECT_EQ(ShardError::UNKNOWN_SHARD, homeobj_->shard_manager()->get_shard(_shard_2.id + 1).get().error());
 }
@@ -48,6 +83,43 @@ TEST_F(TestFixture, ListShards) {
     });
 }
 
+TEST_F(TestFixture, ListShardsPaged) {
+    auto sm = homeobj_->shard_manager();
+    EXPECT_EQ(ShardError::INVALID_ARG, sm->list_shards(_pg_id, 0, 0).get().error());
+    EXPECT_EQ(ShardError::UNKNOWN_PG, sm->list_shards(_pg_id + 1, 0, 8).get().error());
+    EXPECT_EQ(ShardError::UNKNOWN_PG, sm->count_shards(_pg_id + 1).get().error());
+    ASSERT_TRUE(!!sm->create_shards(_pg_id, 4, Mi).get());
+    ASSERT_TRUE(!!sm->seal_shard(_shard_2.id).get());
+
+    // pages of two walk all six shards in id order
+    auto ids = std::vector< shard_id_t >();
+    shard_id_t start = 0;
+    while (true) {
+        auto e = sm->list_shards(_pg_id, start, 2).get();
+        ASSERT_TRUE(!!e);
+        for (auto const& info : e.value()) {
+            ids.push_back(info.id);
+        }
+        if (e.value().size() < 2) { break; }
+        start = e.value().back().id + 1;
+    }
+    ASSERT_EQ(6, ids.size());
+    EXPECT_TRUE(std::is_sorted(ids.begin(), ids.end()));
+    EXPECT_EQ(_shard_1.id, ids.front());
+
+    auto sealed = sm->list_shards(_pg_id, 0, 8, ShardInfo::State::SEALED).get();
+    ASSERT_TRUE(!!sealed);
+    ASSERT_EQ(1, sealed.value().size());
+    EXPECT_EQ(_shard_2.id, sealed.value().front().id);
+    auto open = sm->list_shards(_pg_id, _shard_2.id, 8, ShardInfo::State::OPEN).get();
+    ASSERT_TRUE(!!open);
+    EXPECT_EQ(4, open.value().size());
+
+    EXPECT_EQ(6, sm->count_shards(_pg_id).get().value());
+    EXPECT_EQ(5, sm->count_shards(_pg_id, ShardInfo::State::OPEN).get().value());
+    EXPECT_EQ(1, sm->count_shards(_pg_id, ShardInfo::State::SEALED).get().value());
+}
+
 TEST_F(TestFixture, SealShardNoShard) {
     EXPECT_EQ(ShardError::UNKNOWN_SHARD, homeobj_->shard_manager()->seal_shard(_shard_2.id + 1).get().error());
 }
@@ -63,3 +135,37 @@ TEST_F(TestFixture, SealShard) {
         });
     }
 }
+
+TEST_F(TestFixture, ShardOpsRunOnTheWorkerOfTheirPg) {
+    auto impl = dynamic_cast< homeobject::HomeObjectImpl* >(homeobj_.get());
+    ASSERT_NE(nullptr, impl);
+    if (impl->pg_executors_.empty()) { GTEST_SKIP() << "PG workers are only started by --executor sharded"; }
+    auto const num_workers = impl->pg_executors_.size();
+    auto thread_of = [impl](homeobject::pg_id_t pg) {
+        return impl->_defer(pg).thenValue([](auto) { return std::this_thread::get_id(); }).get();
+    };
+
+    // A PG always lands on the same worker, PGs whose ids differ by the number of workers share it.
+    auto const worker = thread_of(_pg_id);
+    EXPECT_NE(std::this_thread::get_id(), worker);
+    for (auto i = 0; 16 > i; ++i) {
+        EXPECT_EQ(worker, thread_of(_pg_id));
+    }
+    EXPECT_EQ(worker, thread_of(static_cast< homeobject::pg_id_t >(_pg_id + num_workers)));
+    if (1 < num_workers) { EXPECT_NE(worker, thread_of(_pg_id + 1)); }
+
+    // Lookups of its shards continue on the worker of the PG.
+    auto const shard_thread =
+        impl->_get_shard(_shard_1.id).thenValue([](auto) { return std::this_thread::get_id(); }).get();
+    EXPECT_EQ(worker, shard_thread);
+
+    // Operations of a PG run in the order they were issued, without any lock.
+    std::vector< uint32_t > order;
+    std::vector< folly::Future< folly::Unit > > ops;
+    for (uint32_t i = 0; 256 > i; ++i) {
+        ops.push_back(impl->_defer(_pg_id).thenValue([&order, i](auto) { order.push_back(i); }));
+    }
+    folly::collectAll(std::move(ops)).get();
+    ASSERT_EQ(256, order.size());
+    EXPECT_TRUE(std::is_sorted(order.begin(), order.end()));
+}